@@ -0,0 +1,298 @@
+#include "sm_platform.h"
+
+#include "sm_copy.h"
+#include "sm_limits.h"
+
+// Staging copy benchmark. Builds a synthetic sce_sys tree (icons, sound,
+// trophy and metadata files, plus one sparse file) and copies it with the
+// previous 8 KiB stdio loop, the buffered copy engine and, where the host has
+// one, the kernel range copy, then with the staging worker pool. Reports files, bytes, MiB/s and whether the
+// sparse file kept its holes.
+
+#define BENCH_COPY_DEFAULT_ROUNDS 20
+#define BENCH_COPY_DEFAULT_DIR "/tmp/sm_bench_copy"
+#define BENCH_COPY_SPARSE_SIZE (16u * 1024u * 1024u)
+
+typedef struct {
+  const char *name;
+  size_t size;
+} bench_copy_file_t;
+
+// Rough sizes of a retail title's sce_sys staging set.
+static const bench_copy_file_t k_sce_sys_files[] = {
+    {"param.json", 6 * 1024},         {"icon0.png", 480 * 1024},
+    {"icon0.dds", 1024 * 1024},       {"pic0.png", 2600 * 1024},
+    {"pic0.dds", 8 * 1024 * 1024},    {"pic1.png", 3100 * 1024},
+    {"snd0.at9", 1900 * 1024},        {"keystone", 96},
+    {"nptitle.dat", 256},             {"npbind.dat", 2 * 1024},
+    {"trophy2/npbind.dat", 2 * 1024}, {"trophy2/trophy00.ucp", 900 * 1024},
+    {"uds/npbind.dat", 2 * 1024},     {"uds/uds00.ucp", 120 * 1024},
+    {"about/right.sprx", 64 * 1024},  {"changeinfo/changeinfo.xml", 12 * 1024},
+    {"shareparam.json", 1024},        {"icon0_00.png", 450 * 1024},
+    {"icon0_01.png", 450 * 1024},     {"save_data.png", 60 * 1024},
+};
+#define BENCH_COPY_FILE_COUNT \
+  (sizeof(k_sce_sys_files) / sizeof(k_sce_sys_files[0]))
+
+typedef enum {
+  BENCH_COPY_LEGACY = 0,
+  BENCH_COPY_BUFFERED,
+  BENCH_COPY_KERNEL,
+  BENCH_COPY_POOL,
+  BENCH_COPY_MODE_COUNT
+} bench_copy_mode_t;
+
+static const char *const k_mode_names[BENCH_COPY_MODE_COUNT] = {
+    "stdio 8K (old)", "engine buffered", "engine kernel", "engine pool"};
+
+static unsigned g_pool_workers = DEFAULT_COPY_WORKERS;
+
+static uint64_t bench_now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// --- Previous copy_file() loop, kept verbatim for comparison ---
+static int legacy_copy_file(const char *src, const char *dst) {
+  char buf[8192];
+  FILE *fs = fopen(src, "rb");
+  if (!fs)
+    return -1;
+  FILE *fd = fopen(dst, "wb");
+  if (!fd) {
+    fclose(fs);
+    return -1;
+  }
+  int ret = 0;
+  while (true) {
+    size_t n = fread(buf, 1, sizeof(buf), fs);
+    if (n > 0 && fwrite(buf, 1, n, fd) != n) {
+      ret = -1;
+      break;
+    }
+    if (n < sizeof(buf)) {
+      if (ferror(fs))
+        ret = -1;
+      break;
+    }
+  }
+  if (fflush(fd) != 0)
+    ret = -1;
+  if (fclose(fd) != 0)
+    ret = -1;
+  if (fclose(fs) != 0)
+    ret = -1;
+  if (ret != 0)
+    (void)unlink(dst);
+  return ret;
+}
+
+static bool make_parent_dirs(const char *path) {
+  char tmp[MAX_PATH];
+  (void)strlcpy(tmp, path, sizeof(tmp));
+  for (char *p = tmp + 1; *p; p++) {
+    if (*p != '/')
+      continue;
+    *p = '\0';
+    if (mkdir(tmp, 0777) != 0 && errno != EEXIST)
+      return false;
+    *p = '/';
+  }
+  return true;
+}
+
+static bool write_pattern_file(const char *path, size_t size) {
+  if (!make_parent_dirs(path))
+    return false;
+  int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0)
+    return false;
+  uint8_t buf[4096];
+  bool ok = true;
+  for (size_t done = 0; ok && done < size;) {
+    size_t n = size - done < sizeof(buf) ? size - done : sizeof(buf);
+    for (size_t i = 0; i < n; i++)
+      buf[i] = (uint8_t)((done + i) * 131u + (done >> 12));
+    ok = write(fd, buf, n) == (ssize_t)n;
+    done += n;
+  }
+  if (close(fd) != 0)
+    ok = false;
+  return ok;
+}
+
+// 16 MiB with 64 KiB of data at each end and a hole between.
+static bool write_sparse_file(const char *path) {
+  int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0)
+    return false;
+  uint8_t buf[64 * 1024];
+  memset(buf, 0x5a, sizeof(buf));
+  bool ok = pwrite(fd, buf, sizeof(buf), 0) == (ssize_t)sizeof(buf) &&
+            pwrite(fd, buf, sizeof(buf),
+                   BENCH_COPY_SPARSE_SIZE - sizeof(buf)) ==
+                (ssize_t)sizeof(buf);
+  if (close(fd) != 0)
+    ok = false;
+  return ok;
+}
+
+static int pool_copy_file(const char *src, const char *dst,
+                          sm_copy_stats_t *stats) {
+  return sm_copy_file_data(src, dst, 0, stats);
+}
+
+static bool copy_one(bench_copy_mode_t mode, const char *src, const char *dst,
+                     sm_copy_stats_t *stats) {
+  if (mode == BENCH_COPY_LEGACY)
+    return legacy_copy_file(src, dst) == 0;
+  if (mode == BENCH_COPY_POOL)
+    return pool_copy_file(src, dst, stats) == 0;
+  unsigned flags = mode == BENCH_COPY_BUFFERED ? SM_COPY_FLAG_NO_KERNEL : 0u;
+  return sm_copy_file_data(src, dst, flags, stats) == 0;
+}
+
+static bool build_path(char *out, const char *dir, const char *sub,
+                       const char *name) {
+  int written = snprintf(out, MAX_PATH, "%s/%s/%s", dir, sub, name);
+  return written >= 0 && written < MAX_PATH;
+}
+
+// Copy the tree through the worker pool, one batch per round.
+static bool bench_pool_round(const char *dir, sm_copy_job_t *jobs) {
+  for (size_t i = 0; i < BENCH_COPY_FILE_COUNT; i++) {
+    if (!build_path(jobs[i].src, dir, "src", k_sce_sys_files[i].name) ||
+        !build_path(jobs[i].dst, dir, "dst", k_sce_sys_files[i].name) ||
+        !make_parent_dirs(jobs[i].dst)) {
+      return false;
+    }
+  }
+  return sm_copy_run_jobs(jobs, (int)BENCH_COPY_FILE_COUNT, g_pool_workers,
+                          pool_copy_file, SM_COPY_JOB_ATOMIC, NULL);
+}
+
+// Copy the tree rounds times; returns elapsed ns or 0 on failure.
+static uint64_t bench_mode(bench_copy_mode_t mode, const char *dir,
+                           int rounds, uint64_t *bytes_out) {
+  static sm_copy_job_t jobs[BENCH_COPY_FILE_COUNT];
+  uint64_t bytes = 0;
+  uint64_t start = bench_now_ns();
+  for (int round = 0; round < rounds; round++) {
+    if (mode == BENCH_COPY_POOL) {
+      if (!bench_pool_round(dir, jobs))
+        return 0;
+      for (size_t i = 0; i < BENCH_COPY_FILE_COUNT; i++)
+        bytes += k_sce_sys_files[i].size;
+      continue;
+    }
+    for (size_t i = 0; i < BENCH_COPY_FILE_COUNT; i++) {
+      char src[MAX_PATH];
+      char dst[MAX_PATH];
+      if (!build_path(src, dir, "src", k_sce_sys_files[i].name) ||
+          !build_path(dst, dir, "dst", k_sce_sys_files[i].name) ||
+          !make_parent_dirs(dst) || !copy_one(mode, src, dst, NULL)) {
+        return 0;
+      }
+      bytes += k_sce_sys_files[i].size;
+    }
+  }
+  uint64_t elapsed = bench_now_ns() - start;
+  *bytes_out = bytes;
+  return elapsed ? elapsed : 1;
+}
+
+// Copy the sparse file once and report the blocks the copy occupies.
+static bool bench_sparse(bench_copy_mode_t mode, const char *dir,
+                         uint64_t *alloc_kib_out, bool *same_out) {
+  char src[MAX_PATH];
+  char dst[MAX_PATH];
+  if (!build_path(src, dir, "src", "sparse.bin") ||
+      !build_path(dst, dir, "dst", "sparse.bin") ||
+      !copy_one(mode, src, dst, NULL)) {
+    return false;
+  }
+  struct stat src_st;
+  struct stat dst_st;
+  if (stat(src, &src_st) != 0 || stat(dst, &dst_st) != 0)
+    return false;
+  *alloc_kib_out = (uint64_t)dst_st.st_blocks / 2u;
+  *same_out = src_st.st_size == dst_st.st_size;
+  return true;
+}
+
+static void remove_tree(const char *path) {
+  char cmd[MAX_PATH + 16];
+  snprintf(cmd, sizeof(cmd), "rm -rf '%s'", path);
+  if (system(cmd) != 0)
+    fprintf(stderr, "cannot remove %s\n", path);
+}
+
+int main(int argc, char **argv) {
+  int rounds = BENCH_COPY_DEFAULT_ROUNDS;
+  const char *dir = BENCH_COPY_DEFAULT_DIR;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--rounds") == 0 && i + 1 < argc) {
+      rounds = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--dir") == 0 && i + 1 < argc) {
+      dir = argv[++i];
+    } else if (strcmp(argv[i], "--workers") == 0 && i + 1 < argc) {
+      int workers = atoi(argv[++i]);
+      g_pool_workers = workers > 0 ? (unsigned)workers : 1u;
+    } else {
+      fprintf(stderr, "usage: %s [--rounds N] [--dir PATH] [--workers N]\n",
+              argv[0]);
+      return 2;
+    }
+  }
+  if (rounds <= 0)
+    rounds = 1;
+
+  remove_tree(dir);
+  uint64_t tree_bytes = 0;
+  for (size_t i = 0; i < BENCH_COPY_FILE_COUNT; i++) {
+    char path[MAX_PATH];
+    if (!build_path(path, dir, "src", k_sce_sys_files[i].name) ||
+        !write_pattern_file(path, k_sce_sys_files[i].size)) {
+      fprintf(stderr, "cannot create source tree under %s\n", dir);
+      return 1;
+    }
+    tree_bytes += k_sce_sys_files[i].size;
+  }
+  char sparse_path[MAX_PATH];
+  if (!build_path(sparse_path, dir, "src", "sparse.bin") ||
+      !write_sparse_file(sparse_path)) {
+    fprintf(stderr, "cannot create sparse file under %s\n", dir);
+    return 1;
+  }
+
+  printf("staging copy: %zu files, %llu KiB per round, %d rounds, dir=%s, "
+         "pool workers=%u\n",
+         BENCH_COPY_FILE_COUNT, (unsigned long long)(tree_bytes / 1024u),
+         rounds, dir, g_pool_workers);
+  printf("%-16s %10s %10s %12s %10s\n", "engine", "ms", "MiB/s",
+         "sparse KiB", "sparse ok");
+  int failures = 0;
+  for (int mode = 0; mode < BENCH_COPY_MODE_COUNT; mode++) {
+    uint64_t bytes = 0;
+    uint64_t elapsed_ns = bench_mode((bench_copy_mode_t)mode, dir, rounds,
+                                     &bytes);
+    uint64_t alloc_kib = 0;
+    bool same_size = false;
+    if (elapsed_ns == 0 ||
+        !bench_sparse((bench_copy_mode_t)mode, dir, &alloc_kib, &same_size)) {
+      printf("%-16s failed: %s\n", k_mode_names[mode], strerror(errno));
+      failures++;
+      continue;
+    }
+    double mib_s = (double)bytes / (1024.0 * 1024.0) /
+                   ((double)elapsed_ns / 1000000000.0);
+    printf("%-16s %10.1f %10.1f %12llu %10s\n", k_mode_names[mode],
+           (double)elapsed_ns / 1000000.0, mib_s,
+           (unsigned long long)alloc_kib, same_size ? "yes" : "NO");
+    if (!same_size)
+      failures++;
+  }
+  remove_tree(dir);
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,175 @@
+#include "sm_platform.h"
+
+#include <stdatomic.h>
+#include <sys/resource.h>
+
+#include "sm_bench_counters.h"
+
+// Linked with -Wl,--wrap=<fn> for every function below, so only references
+// from payload/bench objects are routed here.
+
+static atomic_uint_fast64_t g_stat_calls;
+static atomic_uint_fast64_t g_open_calls;
+static atomic_uint_fast64_t g_opendir_calls;
+static atomic_uint_fast64_t g_readdir_calls;
+static atomic_uint_fast64_t g_mntinfo_calls;
+static atomic_uint_fast64_t g_statfs_calls;
+
+int __real_stat(const char *path, struct stat *st);
+int __real_lstat(const char *path, struct stat *st);
+int __real_fstatat(int dirfd, const char *path, struct stat *st, int flags);
+int __real_access(const char *path, int mode);
+int __real_open(const char *path, int flags, ...);
+int __real_openat(int dirfd, const char *path, int flags, ...);
+FILE *__real_fopen(const char *path, const char *mode);
+DIR *__real_opendir(const char *path);
+DIR *__real_fdopendir(int fd);
+struct dirent *__real_readdir(DIR *dir);
+int __real_getmntinfo(struct statfs **mntbufp, int mode);
+int __real_sm_host_statfs(const char *path, struct statfs *buf);
+
+int __wrap_stat(const char *path, struct stat *st);
+int __wrap_lstat(const char *path, struct stat *st);
+int __wrap_fstatat(int dirfd, const char *path, struct stat *st, int flags);
+int __wrap_access(const char *path, int mode);
+int __wrap_open(const char *path, int flags, ...);
+int __wrap_openat(int dirfd, const char *path, int flags, ...);
+FILE *__wrap_fopen(const char *path, const char *mode);
+DIR *__wrap_opendir(const char *path);
+DIR *__wrap_fdopendir(int fd);
+struct dirent *__wrap_readdir(DIR *dir);
+int __wrap_getmntinfo(struct statfs **mntbufp, int mode);
+int __wrap_sm_host_statfs(const char *path, struct statfs *buf);
+
+static void bump(atomic_uint_fast64_t *counter) {
+  atomic_fetch_add_explicit(counter, 1u, memory_order_relaxed);
+}
+
+int __wrap_stat(const char *path, struct stat *st) {
+  bump(&g_stat_calls);
+  return __real_stat(path, st);
+}
+
+int __wrap_lstat(const char *path, struct stat *st) {
+  bump(&g_stat_calls);
+  return __real_lstat(path, st);
+}
+
+int __wrap_fstatat(int dirfd, const char *path, struct stat *st, int flags) {
+  bump(&g_stat_calls);
+  return __real_fstatat(dirfd, path, st, flags);
+}
+
+int __wrap_access(const char *path, int mode) {
+  bump(&g_stat_calls);
+  return __real_access(path, mode);
+}
+
+int __wrap_open(const char *path, int flags, ...) {
+  mode_t mode = 0;
+  if ((flags & O_CREAT) != 0) {
+    va_list ap;
+    va_start(ap, flags);
+    mode = (mode_t)va_arg(ap, int);
+    va_end(ap);
+  }
+  bump(&g_open_calls);
+  return __real_open(path, flags, mode);
+}
+
+int __wrap_openat(int dirfd, const char *path, int flags, ...) {
+  mode_t mode = 0;
+  if ((flags & O_CREAT) != 0) {
+    va_list ap;
+    va_start(ap, flags);
+    mode = (mode_t)va_arg(ap, int);
+    va_end(ap);
+  }
+  bump(&g_open_calls);
+  return __real_openat(dirfd, path, flags, mode);
+}
+
+FILE *__wrap_fopen(const char *path, const char *mode) {
+  bump(&g_open_calls);
+  return __real_fopen(path, mode);
+}
+
+DIR *__wrap_opendir(const char *path) {
+  bump(&g_opendir_calls);
+  return __real_opendir(path);
+}
+
+DIR *__wrap_fdopendir(int fd) {
+  bump(&g_opendir_calls);
+  return __real_fdopendir(fd);
+}
+
+struct dirent *__wrap_readdir(DIR *dir) {
+  bump(&g_readdir_calls);
+  return __real_readdir(dir);
+}
+
+int __wrap_getmntinfo(struct statfs **mntbufp, int mode) {
+  bump(&g_mntinfo_calls);
+  return __real_getmntinfo(mntbufp, mode);
+}
+
+// statfs() is a macro for the host emulation's sm_host_statfs().
+int __wrap_sm_host_statfs(const char *path, struct statfs *buf) {
+  bump(&g_statfs_calls);
+  return __real_sm_host_statfs(path, buf);
+}
+
+void bench_counters_reset(void) {
+  atomic_store_explicit(&g_stat_calls, 0u, memory_order_relaxed);
+  atomic_store_explicit(&g_open_calls, 0u, memory_order_relaxed);
+  atomic_store_explicit(&g_opendir_calls, 0u, memory_order_relaxed);
+  atomic_store_explicit(&g_readdir_calls, 0u, memory_order_relaxed);
+  atomic_store_explicit(&g_mntinfo_calls, 0u, memory_order_relaxed);
+  atomic_store_explicit(&g_statfs_calls, 0u, memory_order_relaxed);
+}
+
+void bench_counters_snapshot(bench_fs_counters_t *out) {
+  out->stat_calls = atomic_load_explicit(&g_stat_calls, memory_order_relaxed);
+  out->open_calls = atomic_load_explicit(&g_open_calls, memory_order_relaxed);
+  out->opendir_calls =
+      atomic_load_explicit(&g_opendir_calls, memory_order_relaxed);
+  out->readdir_calls =
+      atomic_load_explicit(&g_readdir_calls, memory_order_relaxed);
+  out->mntinfo_calls =
+      atomic_load_explicit(&g_mntinfo_calls, memory_order_relaxed);
+  out->statfs_calls =
+      atomic_load_explicit(&g_statfs_calls, memory_order_relaxed);
+}
+
+void bench_peak_rss_reset(void) {
+  // "5" resets VmHWM to the current RSS (Linux >= 4.0).
+  int fd = __real_open("/proc/self/clear_refs", O_WRONLY);
+  if (fd < 0)
+    return;
+  (void)write(fd, "5", 1);
+  close(fd);
+}
+
+uint64_t bench_peak_rss_kib(void) {
+  FILE *f = __real_fopen("/proc/self/status", "r");
+  if (f) {
+    char line[256];
+    unsigned long long kib = 0;
+    bool found = false;
+    while (fgets(line, sizeof(line), f)) {
+      if (sscanf(line, "VmHWM: %llu kB", &kib) == 1) {
+        found = true;
+        break;
+      }
+    }
+    fclose(f);
+    if (found)
+      return (uint64_t)kib;
+  }
+
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0)
+    return 0;
+  return (uint64_t)usage.ru_maxrss;
+}
@@ -0,0 +1,28 @@
+#ifndef SM_BENCH_COUNTERS_H
+#define SM_BENCH_COUNTERS_H
+
+#include <stdint.h>
+
+// Filesystem calls made by payload code, counted through the linker --wrap
+// shims in sm_bench_counters.c (libc-internal and sqlite calls are excluded).
+typedef struct {
+  uint64_t stat_calls;
+  uint64_t open_calls;
+  uint64_t opendir_calls;
+  uint64_t readdir_calls;
+  // Mount table reads: getmntinfo() and statfs().
+  uint64_t mntinfo_calls;
+  uint64_t statfs_calls;
+} bench_fs_counters_t;
+
+// Zero the counters before a measured section.
+void bench_counters_reset(void);
+// Copy the counters accumulated since the last reset.
+void bench_counters_snapshot(bench_fs_counters_t *out);
+
+// Reset the kernel peak-RSS watermark (best effort, Linux clear_refs).
+void bench_peak_rss_reset(void);
+// Peak resident set size in KiB since the last reset (or process start).
+uint64_t bench_peak_rss_kib(void);
+
+#endif
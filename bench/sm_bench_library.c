@@ -0,0 +1,203 @@
+#include "sm_platform.h"
+
+#include "sm_bench_library.h"
+#include "sm_limits.h"
+#include "sm_paths.h"
+
+// Synthetic library generator. Titles use BNCHnnnnn ids and image titles use
+// BIMGnnnnn ids so the two never collide.
+
+// Renamed whenever generated content changes so older libraries regenerate.
+#define BENCH_LIBRARY_COMPLETE_MARKER ".bench-library-complete-v2"
+#define BENCH_IMAGE_SIZE (1024 * 1024)
+
+static const char *const k_bench_image_exts[] = {".ffpkg", ".exfat", ".ffpfs"};
+
+bool bench_write_text_file(const char *path, const char *text) {
+  FILE *f = fopen(path, "w");
+  if (!f)
+    return false;
+  bool ok = fputs(text, f) >= 0;
+  if (fclose(f) != 0)
+    ok = false;
+  return ok;
+}
+
+bool bench_mkdir_p(const char *path) {
+  char buf[MAX_PATH];
+  if (strlcpy(buf, path, sizeof(buf)) >= sizeof(buf))
+    return false;
+  for (char *p = buf + 1; *p != '\0'; p++) {
+    if (*p != '/')
+      continue;
+    *p = '\0';
+    if (mkdir(buf, 0777) != 0 && errno != EEXIST)
+      return false;
+    *p = '/';
+  }
+  return mkdir(buf, 0777) == 0 || errno == EEXIST;
+}
+
+// <dir>/{eboot.bin,sce_sys/param.json,sce_sys/icon0.png}
+static bool write_game_tree(const char *dir, const char *title_id,
+                            const char *title_name) {
+  char path[MAX_PATH];
+  char json[256];
+  snprintf(path, sizeof(path), "%s/sce_sys", dir);
+  if (!bench_mkdir_p(path))
+    return false;
+  snprintf(json, sizeof(json),
+           "{\"titleId\":\"%s\",\"localizedParameters\":"
+           "{\"en-US\":{\"titleName\":\"%s\"}}}\n",
+           title_id, title_name);
+  snprintf(path, sizeof(path), "%s/sce_sys/param.json", dir);
+  if (!bench_write_text_file(path, json))
+    return false;
+  snprintf(path, sizeof(path), "%s/sce_sys/icon0.png", dir);
+  if (!bench_write_text_file(path, "\x89PNG\r\n\x1a\n"))
+    return false;
+  snprintf(path, sizeof(path), "%s/eboot.bin", dir);
+  return bench_write_text_file(path, "\x7f" "ELF");
+}
+
+static void build_parent_dir(const char *root,
+                             const bench_library_spec_t *spec, int index,
+                             char out[MAX_PATH]) {
+  if (spec->depth >= 2u)
+    snprintf(out, MAX_PATH, "%s/group%04d", root, index / spec->group_size);
+  else
+    snprintf(out, MAX_PATH, "%s", root);
+}
+
+static bool write_title(const char *root, const bench_library_spec_t *spec,
+                        int index, bench_library_stats_t *stats) {
+  char parent[MAX_PATH];
+  char dir[MAX_PATH];
+  char title_id[MAX_TITLE_ID];
+  char title_name[64];
+  build_parent_dir(root, spec, index, parent);
+  snprintf(dir, sizeof(dir), "%s/BENCH%05d", parent, index);
+  snprintf(title_id, sizeof(title_id), "BNCH%05d", index);
+  snprintf(title_name, sizeof(title_name), "Bench Title %d", index);
+  if (!write_game_tree(dir, title_id, title_name))
+    return false;
+  stats->title_dirs++;
+
+  if (spec->backport_every <= 0 || index % spec->backport_every != 0)
+    return true;
+  snprintf(dir, sizeof(dir), "%s/%s/%s/sce_sys", root,
+           DEFAULT_BACKPORTS_DIR_NAME, title_id);
+  if (!bench_mkdir_p(dir))
+    return false;
+  snprintf(dir, sizeof(dir), "%s/%s/%s/sce_sys/backport.txt", root,
+           DEFAULT_BACKPORTS_DIR_NAME, title_id);
+  if (!bench_write_text_file(dir, title_id))
+    return false;
+  stats->backport_dirs++;
+  return true;
+}
+
+static void put_le32(uint8_t *p, uint32_t v) {
+  for (int i = 0; i < 4; i++)
+    p[i] = (uint8_t)(v >> (8 * i));
+}
+
+// Minimal filesystem header so the payload's pre-attach probe accepts the
+// image: UFS2 superblock magic, exFAT boot sector or PFS header.
+static bool write_image_header(int fd, const char *ext) {
+  uint8_t buf[512];
+  memset(buf, 0, sizeof(buf));
+  if (strcmp(ext, ".ffpkg") == 0) {
+    put_le32(buf + 52, 4096u);
+    if (pwrite(fd, buf, 64, 65536) != 64)
+      return false;
+    put_le32(buf, 0x19540119u);
+    return pwrite(fd, buf, 4, 65536 + 1372) == 4;
+  }
+  if (strcmp(ext, ".exfat") == 0) {
+    memcpy(buf + 3, "EXFAT   ", 8);
+    put_le32(buf + 72, BENCH_IMAGE_SIZE / 512);
+    buf[108] = 9;
+    buf[109] = 7;
+    buf[510] = 0x55;
+    buf[511] = 0xAA;
+  } else {
+    put_le32(buf, 1u);
+    put_le32(buf + 8, 20130315u);
+    put_le32(buf + 0x20, 65536u);
+  }
+  return pwrite(fd, buf, sizeof(buf), 0) == (ssize_t)sizeof(buf);
+}
+
+// A sparse dummy image plus its hidden ".<name>.root" content directory.
+static bool write_image(const char *root, const bench_library_spec_t *spec,
+                        int index, bench_library_stats_t *stats) {
+  size_t ext_count = sizeof(k_bench_image_exts) / sizeof(k_bench_image_exts[0]);
+  const char *ext = k_bench_image_exts[(size_t)index % ext_count];
+  char parent[MAX_PATH];
+  char name[64];
+  char path[MAX_PATH];
+  char title_id[MAX_TITLE_ID];
+  char title_name[64];
+  build_parent_dir(root, spec, index, parent);
+  snprintf(name, sizeof(name), "IMAGE%05d%s", index, ext);
+  snprintf(path, sizeof(path), "%s/%s", parent, name);
+  if (!bench_mkdir_p(parent))
+    return false;
+  int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+  if (fd < 0)
+    return false;
+  bool ok = ftruncate(fd, BENCH_IMAGE_SIZE) == 0 && write_image_header(fd, ext);
+  if (close(fd) != 0)
+    ok = false;
+  if (!ok)
+    return false;
+
+  snprintf(path, sizeof(path), "%s/.%s.root", parent, name);
+  snprintf(title_id, sizeof(title_id), "BIMG%05d", index);
+  snprintf(title_name, sizeof(title_name), "Bench Image %d", index);
+  if (!write_game_tree(path, title_id, title_name))
+    return false;
+  stats->image_files++;
+  return true;
+}
+
+bool bench_generate_library(const char *base,
+                            const bench_library_spec_t *spec,
+                            char *root_out, size_t root_out_size,
+                            bench_library_stats_t *stats_out) {
+  memset(stats_out, 0, sizeof(*stats_out));
+  int written = snprintf(root_out, root_out_size, "%s/lib-t%d-d%u-b%d-i%d",
+                         base, spec->titles, spec->depth,
+                         spec->backport_every, spec->images);
+  if (written < 0 || (size_t)written >= root_out_size ||
+      spec->group_size <= 0) {
+    errno = EINVAL;
+    return false;
+  }
+
+  char marker[MAX_PATH];
+  snprintf(marker, sizeof(marker), "%s/%s", root_out,
+           BENCH_LIBRARY_COMPLETE_MARKER);
+  if (access(marker, F_OK) == 0) {
+    stats_out->reused = true;
+    stats_out->title_dirs = spec->titles;
+    stats_out->image_files = spec->images;
+    if (spec->backport_every > 0)
+      stats_out->backport_dirs =
+          (spec->titles + spec->backport_every - 1) / spec->backport_every;
+    return true;
+  }
+
+  if (!bench_mkdir_p(root_out))
+    return false;
+  for (int i = 0; i < spec->titles; i++) {
+    if (!write_title(root_out, spec, i, stats_out))
+      return false;
+  }
+  for (int i = 0; i < spec->images; i++) {
+    if (!write_image(root_out, spec, i, stats_out))
+      return false;
+  }
+  return bench_write_text_file(marker, "1\n");
+}
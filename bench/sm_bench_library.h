@@ -0,0 +1,41 @@
+#ifndef SM_BENCH_LIBRARY_H
+#define SM_BENCH_LIBRARY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Shape of a synthetic game library.
+typedef struct {
+  // Game directories with sce_sys/param.json, icon0.png and eboot.bin.
+  int titles;
+  // 1 = <root>/<title>, 2 = <root>/<group>/<title> (needs scan_depth=2).
+  unsigned int depth;
+  // Titles per group directory when depth is 2.
+  int group_size;
+  // Every Nth title also gets <root>/backports/<TITLE_ID>; 0 disables.
+  int backport_every;
+  // Dummy .ffpkg/.exfat/.ffpfs files, each exposing one extra title when the
+  // host backend mounts it (see sm_platform_host.h).
+  int images;
+} bench_library_spec_t;
+
+typedef struct {
+  int title_dirs;
+  int backport_dirs;
+  int image_files;
+  bool reused;
+} bench_library_stats_t;
+
+// mkdir -p; existing directories are fine.
+bool bench_mkdir_p(const char *path);
+// Replace path with text.
+bool bench_write_text_file(const char *path, const char *text);
+
+// Build <base>/<name derived from spec> unless a complete copy already
+// exists; the library root is written to root_out.
+bool bench_generate_library(const char *base,
+                            const bench_library_spec_t *spec,
+                            char *root_out, size_t root_out_size,
+                            bench_library_stats_t *stats_out);
+
+#endif
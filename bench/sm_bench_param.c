@@ -0,0 +1,410 @@
+#include "sm_platform.h"
+
+#include "sm_limits.h"
+#include "sm_param_json.h"
+
+// Microbenchmark for the param.json reader. Runs the streaming parser and the
+// previous whole-buffer strstr extractor over a corpus of param.json layouts
+// seen in the wild and reports per-document cost and the chosen title name.
+
+#define BENCH_PARAM_DEFAULT_ITERATIONS 20000
+#define BENCH_PARAM_DOC_SIZE (128u * 1024u)
+
+typedef struct {
+  const char *name;
+  // Title name a correct reader shows for SM_PARAM_JSON_PREFERRED_LOCALE.
+  const char *expected_name;
+  char *data;
+  size_t len;
+} bench_param_doc_t;
+
+static const char *const k_locales[] = {
+    "ar-AE", "cs-CZ", "da-DK", "de-DE", "el-GR", "en-GB", "es-419",
+    "es-ES", "fi-FI", "fr-CA", "fr-FR", "hu-HU", "id-ID", "it-IT",
+    "ja-JP", "ko-KR", "nl-NL", "no-NO", "pl-PL", "pt-BR", "pt-PT",
+    "ro-RO", "ru-RU", "sv-SE", "th-TH", "tr-TR", "vi-VN", "zh-Hans",
+    "zh-Hant",
+};
+#define BENCH_LOCALE_COUNT (sizeof(k_locales) / sizeof(k_locales[0]))
+
+// --- Previous extractor, kept verbatim for comparison ---
+static int legacy_extract_json_string(const char *json, const char *key,
+                                      char *out, size_t out_size) {
+  char search[64];
+  snprintf(search, sizeof(search), "\"%s\"", key);
+  const char *p = strstr(json, search);
+  if (!p)
+    return -1;
+  p = strchr(p + strlen(search), ':');
+  if (!p)
+    return -2;
+  while (*++p && isspace(*p)) {
+    /* skip */
+  }
+  if (*p != '"')
+    return -3;
+  p++;
+
+  size_t i = 0;
+  while (i < out_size - 1 && p[i] && p[i] != '"') {
+    out[i] = p[i];
+    i++;
+  }
+  out[i] = '\0';
+  return 0;
+}
+
+// Mirrors the old get_game_info(): copy the file into a heap buffer, then
+// search it.
+static bool legacy_get_game_info(const char *data, size_t len, char *out_id,
+                                 char *out_name) {
+  out_id[0] = '\0';
+  out_name[0] = '\0';
+  char *buf = (char *)malloc(len + 1);
+  if (!buf)
+    return false;
+  memcpy(buf, data, len);
+  buf[len] = '\0';
+
+  bool valid = false;
+  int res = legacy_extract_json_string(buf, "titleId", out_id, MAX_TITLE_ID);
+  if (res != 0)
+    res = legacy_extract_json_string(buf, "title_id", out_id, MAX_TITLE_ID);
+  if (res == 0) {
+    const char *en_ptr = strstr(buf, "\"en-US\"");
+    const char *search_start = en_ptr ? en_ptr : buf;
+    if (legacy_extract_json_string(search_start, "titleName", out_name,
+                                   MAX_TITLE_NAME) != 0)
+      legacy_extract_json_string(buf, "titleName", out_name, MAX_TITLE_NAME);
+    if (out_name[0] == '\0')
+      (void)strlcpy(out_name, out_id, MAX_TITLE_NAME);
+    valid = true;
+  }
+  free(buf);
+  return valid;
+}
+
+// --- Corpus ---
+typedef struct {
+  char *data;
+  size_t len;
+  size_t cap;
+  bool pretty;
+} bench_json_writer_t;
+
+static void json_append(bench_json_writer_t *w, const char *fmt, ...) {
+  va_list ap;
+  va_start(ap, fmt);
+  int n = vsnprintf(w->data + w->len, w->cap - w->len, fmt, ap);
+  va_end(ap);
+  if (n > 0 && (size_t)n < w->cap - w->len)
+    w->len += (size_t)n;
+}
+
+static void json_newline(bench_json_writer_t *w, int indent) {
+  if (w->pretty)
+    json_append(w, "\n%*s", indent * 2, "");
+}
+
+static void json_field(bench_json_writer_t *w, int indent, bool first,
+                       const char *key, const char *raw_value) {
+  json_append(w, "%s", first ? "" : ",");
+  json_newline(w, indent);
+  json_append(w, w->pretty ? "\"%s\": %s" : "\"%s\":%s", key, raw_value);
+}
+
+static void json_locale_block(bench_json_writer_t *w, bool first,
+                              const char *locale, const char *title_name) {
+  char value[MAX_TITLE_NAME + 2];
+  json_append(w, "%s", first ? "" : ",");
+  json_newline(w, 2);
+  json_append(w, w->pretty ? "\"%s\": {" : "\"%s\":{", locale);
+  snprintf(value, sizeof(value), "\"%s\"", title_name);
+  json_field(w, 3, true, "titleName", value);
+  json_field(w, 3, false, "shortTitleName", value);
+  json_newline(w, 2);
+  json_append(w, "}");
+}
+
+// Retail-style file: top-level metadata, then localizedParameters with every
+// locale. default_language_first controls where defaultLanguage sits.
+static void write_retail_doc(bench_json_writer_t *w, const char *title_id,
+                             const char *default_language,
+                             bool default_language_first, bool with_en_us,
+                             const char *name_escape, int padding_entries) {
+  char value[MAX_TITLE_NAME];
+  json_append(w, "{");
+  json_field(w, 1, true, "ageLevel",
+             "{\"default\": 12, \"AE\": 12, \"US\": 13, \"JP\": 12}");
+  json_field(w, 1, false, "applicationCategoryType", "0");
+  json_field(w, 1, false, "attribute", "0");
+  json_field(w, 1, false, "contentBadgeType", "1");
+  snprintf(value, sizeof(value), "\"UP9000-%s_00-BENCHCONTENT00000\"",
+           title_id);
+  json_field(w, 1, false, "contentId", value);
+  json_field(w, 1, false, "contentVersion", "\"01.004.000\"");
+  json_field(w, 1, false, "downloadDataSize", "2097152");
+  json_field(w, 1, false, "masterVersion", "\"01.00\"");
+
+  // Publishing tools metadata and add-on lists pad real files out.
+  json_append(w, ",");
+  json_newline(w, 1);
+  json_append(w, "\"addcont\": {\"serviceIdForSharing\": [");
+  for (int i = 0; i < padding_entries; i++) {
+    json_append(w, "%s\"UP9000-%s_00-DLC%013d\"", i ? ", " : "", title_id, i);
+  }
+  json_append(w, "]}");
+
+  json_append(w, ",");
+  json_newline(w, 1);
+  json_append(w, "\"localizedParameters\": {");
+  bool first = true;
+  if (default_language_first) {
+    snprintf(value, sizeof(value), "\"%s\"", default_language);
+    json_field(w, 2, true, "defaultLanguage", value);
+    first = false;
+  }
+  for (size_t i = 0; i < BENCH_LOCALE_COUNT; i++) {
+    char name[MAX_TITLE_NAME];
+    snprintf(name, sizeof(name), "Bench Title [%s]", k_locales[i]);
+    json_locale_block(w, first, k_locales[i], name);
+    first = false;
+    if (with_en_us && strcmp(k_locales[i], "en-GB") == 0) {
+      snprintf(name, sizeof(name), "Bench Title%s", name_escape);
+      json_locale_block(w, false, "en-US", name);
+    }
+  }
+  if (!default_language_first) {
+    snprintf(value, sizeof(value), "\"%s\"", default_language);
+    json_field(w, 2, false, "defaultLanguage", value);
+  }
+  json_newline(w, 1);
+  json_append(w, "}");
+
+  json_field(w, 1, false, "pubtools",
+             "{\"creationDate\": \"2023-05-01 12:00:00\", "
+             "\"loudnessSnd0\": \"-24.0\", \"submission\": false, "
+             "\"toolVersion\": \"1.40.00.09-00.00.00.0.1\"}");
+  json_field(w, 1, false, "requiredSystemSoftwareVersion",
+             "\"0x0700000000000000\"");
+  json_field(w, 1, false, "sdkVersion", "\"0x0700000000000000\"");
+  snprintf(value, sizeof(value), "\"%s\"", title_id);
+  json_field(w, 1, false, "titleId", value);
+  json_field(w, 1, false, "userDefinedParam1", "0");
+  json_newline(w, 0);
+  json_append(w, "}\n");
+}
+
+static bool add_doc(bench_param_doc_t *docs, int *count, const char *name,
+                    const char *expected_name, bench_json_writer_t *w) {
+  docs[*count].name = name;
+  docs[*count].expected_name = expected_name;
+  docs[*count].data = w->data;
+  docs[*count].len = w->len;
+  (*count)++;
+  return true;
+}
+
+static bool new_writer(bench_json_writer_t *w, bool pretty) {
+  memset(w, 0, sizeof(*w));
+  w->cap = BENCH_PARAM_DOC_SIZE;
+  w->data = malloc(w->cap);
+  w->pretty = pretty;
+  return w->data != NULL;
+}
+
+#define BENCH_PARAM_MAX_DOCS 8
+
+static int build_corpus(bench_param_doc_t *docs) {
+  bench_json_writer_t w;
+  int count = 0;
+
+  // The synthetic library layout (sm_bench_library.c).
+  if (!new_writer(&w, false))
+    return -1;
+  json_append(&w, "{\"titleId\":\"BENC00001\",\"localizedParameters\":"
+                  "{\"en-US\":{\"titleName\":\"Bench Title 1\"}}}");
+  add_doc(docs, &count, "minimal", "Bench Title 1", &w);
+
+  // defaultLanguage first, locales sorted so en-GB precedes en-US.
+  if (!new_writer(&w, true))
+    return -1;
+  write_retail_doc(&w, "PPSA01001", "en-US", true, true, "", 4);
+  add_doc(docs, &count, "retail-pretty", "Bench Title", &w);
+
+  if (!new_writer(&w, false))
+    return -1;
+  write_retail_doc(&w, "PPSA01002", "en-US", true, true, "", 4);
+  add_doc(docs, &count, "retail-minified", "Bench Title", &w);
+
+  // Japanese release without en-US, defaultLanguage after the locales.
+  if (!new_writer(&w, true))
+    return -1;
+  write_retail_doc(&w, "PPSA01003", "ja-JP", false, false, "", 4);
+  add_doc(docs, &count, "no-en-us-trailing-default", "Bench Title [ja-JP]",
+          &w);
+
+  // Escapes and \u sequences (BMP and a surrogate pair) in the title.
+  if (!new_writer(&w, true))
+    return -1;
+  write_retail_doc(&w, "PPSA01004", "en-US", true, true,
+                   " \\\"Caf\\u00e9\\\" \\ud83c\\udfae", 4);
+  add_doc(docs, &count, "escaped-unicode",
+          "Bench Title \"Caf\xc3\xa9\" \xf0\x9f\x8e\xae", &w);
+
+  // Large add-on list ahead of the locale table.
+  if (!new_writer(&w, true))
+    return -1;
+  write_retail_doc(&w, "PPSA01005", "en-US", true, true, "", 1500);
+  add_doc(docs, &count, "large-addcont", "Bench Title", &w);
+
+  // Homebrew: title_id and a top-level titleName.
+  if (!new_writer(&w, true))
+    return -1;
+  json_append(&w, "{\n  \"title_id\": \"HBRW00001\",\n"
+                  "  \"titleName\": \"Homebrew Loader\",\n"
+                  "  \"contentVersion\": \"1.02\"\n}\n");
+  add_doc(docs, &count, "homebrew", "Homebrew Loader", &w);
+
+  return count;
+}
+
+static uint64_t bench_now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// The file-backed runs read a temporary copy, so the streaming reader sees
+// the same read() pattern it does on the console.
+static bool write_doc_file(const bench_param_doc_t *doc, char *path,
+                           size_t path_size) {
+  snprintf(path, path_size, "/tmp/sm_bench_param_%d.json", (int)getpid());
+  int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0)
+    return false;
+  bool ok = write(fd, doc->data, doc->len) == (ssize_t)doc->len;
+  close(fd);
+  return ok;
+}
+
+static double bench_stream_fd(const char *path, int iterations,
+                              sm_param_json_t *info) {
+  int fd = open(path, O_RDONLY);
+  if (fd < 0)
+    return -1.0;
+
+  uint64_t start = bench_now_ns();
+  for (int i = 0; i < iterations; i++) {
+    if (lseek(fd, 0, SEEK_SET) != 0 ||
+        sm_param_json_parse_fd(fd, SM_PARAM_JSON_PREFERRED_LOCALE, info) < 0) {
+      close(fd);
+      return -1.0;
+    }
+  }
+  uint64_t elapsed = bench_now_ns() - start;
+  close(fd);
+  return (double)elapsed / iterations;
+}
+
+// Old get_game_info() I/O: fopen, heap buffer of st_size, fread, search.
+static double bench_legacy_file(const char *path, size_t len, int iterations,
+                                char *id, char *name) {
+  uint64_t start = bench_now_ns();
+  for (int i = 0; i < iterations; i++) {
+    FILE *f = fopen(path, "rb");
+    if (!f)
+      return -1.0;
+    char *buf = (char *)malloc(len + 1);
+    bool read_ok = buf && fread(buf, 1, len, f) == len;
+    fclose(f);
+    if (read_ok)
+      (void)legacy_get_game_info(buf, len, id, name);
+    free(buf);
+  }
+  return (double)(bench_now_ns() - start) / iterations;
+}
+
+static double bench_stream_buffer(const bench_param_doc_t *doc,
+                                  int iterations, sm_param_json_t *info) {
+  uint64_t start = bench_now_ns();
+  for (int i = 0; i < iterations; i++)
+    (void)sm_param_json_parse_buffer(doc->data, doc->len,
+                                     SM_PARAM_JSON_PREFERRED_LOCALE, info);
+  return (double)(bench_now_ns() - start) / iterations;
+}
+
+static double bench_legacy(const bench_param_doc_t *doc, int iterations,
+                           char *id, char *name) {
+  uint64_t start = bench_now_ns();
+  for (int i = 0; i < iterations; i++)
+    (void)legacy_get_game_info(doc->data, doc->len, id, name);
+  return (double)(bench_now_ns() - start) / iterations;
+}
+
+int main(int argc, char **argv) {
+  int iterations = BENCH_PARAM_DEFAULT_ITERATIONS;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+      iterations = atoi(argv[++i]);
+    } else {
+      fprintf(stderr, "usage: %s [--iterations N]\n", argv[0]);
+      return 2;
+    }
+  }
+  if (iterations <= 0)
+    iterations = 1;
+
+  bench_param_doc_t docs[BENCH_PARAM_MAX_DOCS];
+  int count = build_corpus(docs);
+  if (count < 0) {
+    fprintf(stderr, "corpus allocation failed\n");
+    return 1;
+  }
+
+  printf("param.json reader: %d iterations per document, ns per parse\n",
+         iterations);
+  printf("%-26s %6s %9s %9s %9s %9s  %s\n", "layout", "bytes", "old mem",
+         "new mem", "old file", "new file", "title (old -> new)");
+  int wrong_legacy = 0;
+  int wrong_stream = 0;
+  for (int i = 0; i < count; i++) {
+    const bench_param_doc_t *doc = &docs[i];
+    char path[64];
+    char legacy_id[MAX_TITLE_ID];
+    char legacy_name[MAX_TITLE_NAME];
+    sm_param_json_t info;
+    if (!write_doc_file(doc, path, sizeof(path))) {
+      fprintf(stderr, "cannot write %s\n", path);
+      return 1;
+    }
+    double legacy_ns = bench_legacy(doc, iterations, legacy_id, legacy_name);
+    double buffer_ns = bench_stream_buffer(doc, iterations, &info);
+    double legacy_file_ns = bench_legacy_file(path, doc->len, iterations,
+                                              legacy_id, legacy_name);
+    double fd_ns = bench_stream_fd(path, iterations, &info);
+    unlink(path);
+
+    bool legacy_ok = strcmp(legacy_name, doc->expected_name) == 0;
+    bool stream_ok = strcmp(info.title_name, doc->expected_name) == 0;
+    wrong_legacy += legacy_ok ? 0 : 1;
+    wrong_stream += stream_ok ? 0 : 1;
+    printf("%-26s %6zu %9.0f %9.0f %9.0f %9.0f  %s%s -> %s%s\n", doc->name,
+           doc->len, legacy_ns, buffer_ns, legacy_file_ns, fd_ns,
+           legacy_ok ? "" : "!", legacy_name, stream_ok ? "" : "!",
+           info.title_name);
+    if (i == count - 1 || strcmp(doc->name, "retail-pretty") == 0) {
+      printf("%-26s id=%s content=%s version=%s firmware=%s default=%s "
+             "locale=%s\n",
+             "", info.title_id, info.content_id, info.app_version,
+             info.required_firmware, info.default_language,
+             info.title_locale);
+    }
+  }
+  printf("wrong title: legacy %d/%d, stream %d/%d (! marks a mismatch)\n",
+         wrong_legacy, count, wrong_stream, count);
+
+  for (int i = 0; i < count; i++)
+    free(docs[i].data);
+  return wrong_stream == 0 ? 0 : 1;
+}
@@ -0,0 +1,235 @@
+#include "sm_platform.h"
+
+#include "sm_bench_counters.h"
+#include "sm_bench_library.h"
+#include "sm_config_mount.h"
+#include "sm_filesystem.h"
+#include "sm_image.h"
+#include "sm_install.h"
+#include "sm_limits.h"
+#include "sm_log.h"
+#include "sm_mount_device.h"
+#include "sm_mount_stats.h"
+#include "sm_mount_table.h"
+#include "sm_paths.h"
+#include "sm_scan.h"
+#include "sm_scan_index.h"
+#include "sm_state_table.h"
+#include "sm_time.h"
+#include "sm_types.h"
+
+// Host benchmark for the scan/install pipeline. Runs the same sequence as
+// run_full_scan_cycle() in sm_scanner.c against a synthetic library inside
+// the SM_PATH_ROOT sandbox and reports per-cycle cost.
+
+#define BENCH_LIBRARY_BASE SM_PATH_ROOT "/mnt/usb0"
+#define BENCH_DEFAULT_TITLES 1000
+#define BENCH_DEFAULT_CYCLES 5
+#define BENCH_DEFAULT_GROUP_SIZE 100
+
+typedef struct {
+  bench_library_spec_t library;
+  int cycles;
+  // 0 keeps the runtime default.
+  unsigned int soft_limit;
+  // 0 keeps the runtime default.
+  unsigned int attach_workers;
+  // Give every title its own staged copies instead of asset store links.
+  bool no_asset_dedup;
+  // Start without the scan index left by a previous run.
+  bool cold;
+  bool debug;
+} bench_options_t;
+
+static scan_candidate_list_t g_bench_candidates;
+
+static void usage(const char *argv0) {
+  fprintf(stderr,
+          "usage: %s [--titles N] [--cycles N] [--depth 1|2] "
+          "[--group-size N]\n"
+          "          [--backport-every N] [--images N] [--soft-limit N]"
+          " [--attach-workers N]\n"
+          "          [--no-asset-dedup] [--cold] [--debug]\n"
+          "  sandbox: %s\n",
+          argv0, SM_PATH_ROOT);
+}
+
+static bool parse_options(int argc, char **argv, bench_options_t *opts) {
+  memset(opts, 0, sizeof(*opts));
+  opts->library.titles = BENCH_DEFAULT_TITLES;
+  opts->library.depth = 1u;
+  opts->library.group_size = BENCH_DEFAULT_GROUP_SIZE;
+  opts->cycles = BENCH_DEFAULT_CYCLES;
+  for (int i = 1; i < argc; i++) {
+    const char *arg = argv[i];
+    bool has_value = i + 1 < argc;
+    if (strcmp(arg, "--titles") == 0 && has_value) {
+      opts->library.titles = atoi(argv[++i]);
+    } else if (strcmp(arg, "--cycles") == 0 && has_value) {
+      opts->cycles = atoi(argv[++i]);
+    } else if (strcmp(arg, "--depth") == 0 && has_value) {
+      opts->library.depth = (unsigned int)atoi(argv[++i]);
+    } else if (strcmp(arg, "--group-size") == 0 && has_value) {
+      opts->library.group_size = atoi(argv[++i]);
+    } else if (strcmp(arg, "--backport-every") == 0 && has_value) {
+      opts->library.backport_every = atoi(argv[++i]);
+    } else if (strcmp(arg, "--images") == 0 && has_value) {
+      opts->library.images = atoi(argv[++i]);
+    } else if (strcmp(arg, "--soft-limit") == 0 && has_value) {
+      opts->soft_limit = (unsigned int)strtoul(argv[++i], NULL, 10);
+    } else if (strcmp(arg, "--attach-workers") == 0 && has_value) {
+      opts->attach_workers = (unsigned int)strtoul(argv[++i], NULL, 10);
+    } else if (strcmp(arg, "--no-asset-dedup") == 0) {
+      opts->no_asset_dedup = true;
+    } else if (strcmp(arg, "--cold") == 0) {
+      opts->cold = true;
+    } else if (strcmp(arg, "--debug") == 0) {
+      opts->debug = true;
+    } else {
+      return false;
+    }
+  }
+  return opts->library.titles >= 0 && opts->library.images >= 0 &&
+         opts->library.group_size > 0 && opts->library.backport_every >= 0 &&
+         opts->library.depth >= MIN_SCAN_DEPTH &&
+         opts->library.depth <= MAX_SCAN_DEPTH && opts->cycles > 0;
+}
+
+static bool write_bench_config(const bench_options_t *opts,
+                               const char *library_root) {
+  char config[MAX_PATH + 256];
+  char soft_limit[64] = "";
+  char attach_workers[64] = "";
+  if (opts->soft_limit > 0u)
+    snprintf(soft_limit, sizeof(soft_limit), "state_soft_limit=%u\n",
+             opts->soft_limit);
+  if (opts->attach_workers > 0u)
+    snprintf(attach_workers, sizeof(attach_workers),
+             "image_attach_workers=%u\n", opts->attach_workers);
+  snprintf(config, sizeof(config),
+           "debug=%d\n"
+           "quiet_mode=1\n"
+           "stability_wait_seconds=0\n"
+           "scan_depth=%u\n"
+           "kstuff_game_auto_toggle=0\n"
+           "backport_fakelib=0\n"
+           "global_fakelib=0\n"
+           "%s"
+           "%s"
+           "asset_dedup=%d\n"
+           "scanpath=%s\n",
+           opts->debug ? 1 : 0, opts->library.depth, soft_limit,
+           attach_workers, opts->no_asset_dedup ? 0 : 1, library_root);
+  return bench_write_text_file(CONFIG_FILE, config);
+}
+
+static int run_bench_cycle(int *total_found_out) {
+  bool unstable_found = false;
+  cleanup_lost_sources_before_scan();
+  int candidate_count = collect_scan_candidates(
+      &g_bench_candidates, total_found_out, &unstable_found);
+  process_scan_candidates(g_bench_candidates.items, candidate_count);
+  log_dev_node_wait_stats();
+  mount_backport_overlays(&unstable_found);
+  (void)save_scan_index();
+  return candidate_count;
+}
+
+int main(int argc, char **argv) {
+  bench_options_t opts;
+  if (!parse_options(argc, argv, &opts)) {
+    usage(argv[0]);
+    return 2;
+  }
+
+  char library_root[MAX_PATH];
+  bench_library_stats_t library_stats;
+  uint64_t generate_start_us = monotonic_time_us();
+  if (!sm_host_platform_init() ||
+      !bench_generate_library(BENCH_LIBRARY_BASE, &opts.library, library_root,
+                              sizeof(library_root), &library_stats) ||
+      !write_bench_config(&opts, library_root)) {
+    fprintf(stderr, "bench setup failed: %s\n", strerror(errno));
+    return 1;
+  }
+  uint64_t generate_us = monotonic_time_us() - generate_start_us;
+  // Freshly written sources must be at least one second old to be stable.
+  if (!library_stats.reused)
+    sleep(1);
+
+  // Seed defaults first: load_runtime_config() logs while parsing, and the
+  // first log_debug() would otherwise initialize the slot being parsed.
+  ensure_runtime_config_ready();
+  load_runtime_config();
+  set_image_bookkeeping_thread();
+  printf("library=%s titles=%d images=%d backports=%d depth=%u %s in %.1f ms\n",
+         library_root, library_stats.title_dirs, library_stats.image_files,
+         library_stats.backport_dirs, opts.library.depth,
+         library_stats.reused ? "reused" : "generated",
+         (double)generate_us / 1000.0);
+  if (opts.cold)
+    (void)unlink(SCAN_INDEX_FILE);
+  uint64_t index_start_us = monotonic_time_us();
+  int indexed_titles = load_scan_index();
+  printf("scan index: %d titles loaded in %.1f ms\n", indexed_titles,
+         (double)(monotonic_time_us() - index_start_us) / 1000.0);
+  printf("%-6s %8s %10s %12s %10s %10s %10s %10s %8s %8s %12s %10s\n",
+         "cycle", "found", "candidates", "wall_ms", "stat", "open", "opendir",
+         "readdir", "mntinfo", "statfs", "peak_rss_kib", "state_kib");
+  for (int cycle = 0; cycle < opts.cycles; cycle++) {
+    int total_found = 0;
+    bench_fs_counters_t counters;
+    bench_peak_rss_reset();
+    bench_counters_reset();
+    uint64_t start_us = monotonic_time_us();
+    int candidates = run_bench_cycle(&total_found);
+    uint64_t elapsed_us = monotonic_time_us() - start_us;
+    bench_counters_snapshot(&counters);
+    sm_state_table_usage_t usage[SM_STATE_TABLE_MAX_REPORT];
+    int usage_count = 0;
+    size_t state_bytes =
+        collect_state_memory_usage(&g_bench_candidates, usage, &usage_count);
+    printf("%-6d %8d %10d %12.3f %10llu %10llu %10llu %10llu %8llu %8llu "
+           "%12llu %10zu\n",
+           cycle,
+           total_found, candidates, (double)elapsed_us / 1000.0,
+           (unsigned long long)counters.stat_calls,
+           (unsigned long long)counters.open_calls,
+           (unsigned long long)counters.opendir_calls,
+           (unsigned long long)counters.readdir_calls,
+           (unsigned long long)counters.mntinfo_calls,
+           (unsigned long long)counters.statfs_calls,
+           (unsigned long long)bench_peak_rss_kib(), state_bytes / 1024u);
+  }
+
+  // Startup reconciliation over the title stacks the cycles left mounted.
+  bench_fs_counters_t reconcile_counters;
+  mount_table_invalidate();
+  bench_counters_reset();
+  uint64_t reconcile_start_us = monotonic_time_us();
+  cleanup_staged_mount_links();
+  cleanup_duplicate_title_mounts();
+  uint64_t reconcile_us = monotonic_time_us() - reconcile_start_us;
+  bench_counters_snapshot(&reconcile_counters);
+  printf("startup reconcile: %.3f ms stat=%llu mntinfo=%llu statfs=%llu\n",
+         (double)reconcile_us / 1000.0,
+         (unsigned long long)reconcile_counters.stat_calls,
+         (unsigned long long)reconcile_counters.mntinfo_calls,
+         (unsigned long long)reconcile_counters.statfs_calls);
+
+  sm_state_table_usage_t usage[SM_STATE_TABLE_MAX_REPORT];
+  int usage_count = 0;
+  collect_state_memory_usage(&g_bench_candidates, usage, &usage_count);
+  printf("state tables (soft limit %d entries):\n", sm_state_soft_limit());
+  for (int i = 0; i < usage_count; i++) {
+    printf("  %-16s %6d/%-6d entries %8zu KiB\n", usage[i].name,
+           usage[i].count, usage[i].capacity, usage[i].bytes / 1024u);
+  }
+
+  sm_mount_stats_dump("bench");
+  printf("mount phase latency: %s\n", MOUNT_STATS_FILE);
+
+  free_scan_candidate_list(&g_bench_candidates);
+  sm_log_shutdown();
+  return 0;
+}
@@ -0,0 +1,27 @@
+#ifndef SM_ASSET_STORE_H
+#define SM_ASSET_STORE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "sm_copy.h"
+
+// Content-addressed store for staged title assets. Each distinct file lives
+// once as ASSET_STORE_DIR/<hh>/<hash>-<size>, keyed by its FNV-1a 64 hash and
+// size; staging hard-links the blob into /user/app and /user/appmeta instead
+// of writing another copy. The name only picks the candidate: a blob is
+// compared with the source byte for byte before it is reused. The link count
+// is the refcount: a blob whose only link is the store's own is garbage.
+
+// Copy src to dst through the asset store: dst becomes a hard link to the
+// blob holding the content of src, adding the blob first when the store lacks
+// it. Files copy_file() rewrites, a disabled store or a dst the store cannot
+// link to fall back to copy_file(). Matches sm_copy_file_fn. Returns 0, or -1
+// with errno set.
+int asset_store_copy_file(const char *src, const char *dst,
+                          sm_copy_stats_t *stats);
+// Remove blobs no staged file links to and temporaries left by an interrupted
+// run. Call only while no staging is running.
+void asset_store_collect_garbage(void);
+
+#endif
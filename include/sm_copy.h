@@ -0,0 +1,69 @@
+#ifndef SM_COPY_H
+#define SM_COPY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "sm_limits.h"
+
+// Byte and time totals of one or more file copies.
+typedef struct {
+  uint32_t files;
+  // Data bytes copied; holes skipped in sparse sources are not counted.
+  uint64_t bytes;
+  uint64_t hole_bytes;
+  uint64_t elapsed_us;
+  // Files staged as hard links to an existing copy, and their size.
+  uint32_t linked_files;
+  uint64_t linked_bytes;
+  // Set by a copy that already hashed its whole source (FNV-1a 64), so a
+  // batch job does not read it again. Not summed across copies.
+  bool src_hashed;
+  uint64_t src_hash;
+} sm_copy_stats_t;
+
+// Copy through the aligned buffer even where a kernel range copy exists.
+#define SM_COPY_FLAG_NO_KERNEL 0x1u
+
+// Copy the data of a regular file into dst (created or truncated), using a
+// kernel range copy where the platform has one and a large aligned buffer
+// otherwise. Holes in the source stay holes in dst. Adds to stats when not
+// NULL. Returns 0, or -1 with errno set and dst removed.
+int sm_copy_file_data(const char *src, const char *dst, unsigned flags,
+                      sm_copy_stats_t *stats);
+// Return the copy throughput in bytes per second, or 0 before any timed copy.
+uint64_t sm_copy_stats_bytes_per_sec(const sm_copy_stats_t *stats);
+// FNV-1a 64 of a whole file.
+bool sm_copy_hash_file(const char *path, uint64_t *hash_out);
+// Compare the content of two files. Returns false on a difference or a read
+// error (errno set; 0 for a difference).
+bool sm_copy_files_equal(const char *a, const char *b);
+
+// One file of a batch for sm_copy_run_jobs().
+typedef struct {
+  char src[MAX_PATH];
+  char dst[MAX_PATH];
+  // Filled in once the job is copied.
+  uint64_t src_hash;
+  uint64_t dst_size;
+} sm_copy_job_t;
+
+// Copies one file; copy_file() or a wrapper of sm_copy_file_data().
+typedef int (*sm_copy_file_fn)(const char *src, const char *dst,
+                               sm_copy_stats_t *stats);
+
+// Hash each source after copying it into src_hash, unless the copy reported
+// the hash through stats.
+#define SM_COPY_JOB_HASH_SOURCE 0x1u
+// Copy into "<dst>" COPY_TEMP_SUFFIX and rename every file into place only
+// once all copies succeeded, so a failed copy leaves every dst untouched.
+#define SM_COPY_JOB_ATOMIC 0x2u
+
+// Run a batch of copies on up to workers threads (the caller included). The
+// first failure stops the batch. stats gets the files and bytes copied and
+// the wall time of the batch. Returns false with errno set on failure.
+bool sm_copy_run_jobs(sm_copy_job_t *jobs, int count, unsigned workers,
+                      sm_copy_file_fn copy_fn, unsigned job_flags,
+                      sm_copy_stats_t *stats);
+
+#endif
@@ -5,6 +5,8 @@
 #include <stdbool.h>
 #include <stddef.h>
 
+#include "sm_copy.h"
+
 // Check whether a title is present in the installed app set.
 bool is_installed(const char *title_id);
 // Check whether /user/appmeta/<TITLE_ID>/param.json exists.
@@ -24,6 +26,17 @@ void cleanup_duplicate_title_mounts(void);
 int remount_system_ex(void);
 // Mount a title source into /system_ex/app/<title_id> via nullfs.
 bool mount_title_nullfs(const char *title_id, const char *src_path);
+// Stage the shell metadata of a title source (sce_sys param and icon files,
+// no executables) into its launch stub under LAUNCH_STUB_DIR. A stage
+// manifest stamps each file with its source size and mtime; changed files are
+// copied again and files the source dropped are removed.
+bool stage_title_launch_stub(const char *title_id, const char *src_path);
+// Mount the launch stub of a title on /system_ex/app/<title_id>, so the shell
+// still lists the title and its launch reaches the lifecycle watcher while the
+// image is detached. mount_title_nullfs() puts the real source on top of it.
+bool mount_title_launch_stub(const char *title_id);
+// Delete the launch stub of a title and its manifest.
+void remove_title_launch_stub(const char *title_id);
 // Roll back a just-mounted title nullfs layer when publication is aborted.
 bool rollback_title_nullfs_mount(const char *title_id, const char *src_path);
 // Reconcile the title mount stack against the expected source/backport state.
@@ -35,18 +48,26 @@ bool reconcile_title_backport_mount(const char *title_id, const char *src_path,
 bool mount_backport_overlay(const char *mount_point,
                             const char *backport_path,
                             const char *title_id);
+// Unmount a managed /system_ex/app/<title_id> stack without forcing it.
+// Returns false when the stack is busy or its top layer is not ours.
+bool unmount_title_mount_stack(const char *title_id, const char *src_path);
 // Unmount all managed /system_ex/app/<title_id> mount stacks on shutdown.
 void shutdown_title_mounts(void);
 // Remove stale mount links and optionally restore image-backed mounts.
 void cleanup_mount_links(const char *removed_source_root,
                          bool unmount_system_ex_bind);
-// Unmount and remove title links that point under a source root.
+// Unmount and remove title links that point under a source root. Safe off the
+// scan thread: it only touches title links, the mount table and locked caches.
 void cleanup_mount_links_for_source_unmount(const char *source_root);
 // Unmount and remove title links backed by USB sources or USB-backed images.
 void cleanup_usb_mount_links_for_suspend(void);
-// Recursively copy a directory tree.
-int copy_dir(const char *src, const char *dst);
-// Copy a single file.
-int copy_file(const char *src, const char *dst);
+// Copy a directory tree on the copy worker pool, adding to stats when not
+// NULL. The copy is built beside dst and replaces it only once complete; on
+// failure dst is left as it was.
+int copy_dir(const char *src, const char *dst, sm_copy_stats_t *stats);
+// Copy a single file, adding to stats when not NULL.
+int copy_file(const char *src, const char *dst, sm_copy_stats_t *stats);
+// Check whether copy_file() rewrites src instead of copying it verbatim.
+bool copy_file_rewrites(const char *src);
 
 #endif
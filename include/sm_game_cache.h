@@ -3,6 +3,8 @@
 
 #include <stdbool.h>
 
+typedef struct sm_state_table_usage sm_state_table_usage_t;
+
 typedef bool (*game_cache_iter_fn)(const char *path, const char *title_id,
                                    const char *title_name,
                                    const char *owning_scan_root, void *ctx);
@@ -22,5 +24,7 @@ void for_each_cached_game_entry(const char *root, game_cache_iter_fn fn,
                                 void *ctx);
 // Remove a game cache entry by path.
 void clear_cached_game(const char *path);
+// Report entries and heap held by the game cache.
+void game_cache_memory_usage(sm_state_table_usage_t *out);
 
 #endif
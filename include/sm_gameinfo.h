@@ -9,5 +9,7 @@ bool get_game_info(const char *base_path, const struct stat *param_st,
                    char *out_id, char *out_name);
 // Check whether a directory contains sce_sys/param.json and stat it.
 bool directory_has_param_json(const char *dir_path, struct stat *param_st_out);
+// Same check relative to an already open directory descriptor.
+bool directory_fd_has_param_json(int dir_fd, struct stat *param_st_out);
 
 #endif
@@ -1,6 +1,7 @@
 #ifndef SM_HASH_H
 #define SM_HASH_H
 
+#include <stddef.h>
 #include <stdint.h>
 
 // Return a stable 32-bit FNV-1a hash for a NUL-terminated string.
@@ -13,4 +14,31 @@ static inline uint32_t sm_fnv1a32(const char *s) {
   return h;
 }
 
+#define SM_FNV1A32_INIT 2166136261u
+
+// Fold a byte range into a running FNV-1a hash started at SM_FNV1A32_INIT.
+static inline uint32_t sm_fnv1a32_update(uint32_t h, const void *data,
+                                         size_t len) {
+  const uint8_t *p = (const uint8_t *)data;
+  for (size_t i = 0; i < len; i++) {
+    h ^= p[i];
+    h *= 16777619u;
+  }
+  return h;
+}
+
+#define SM_FNV1A64_INIT 14695981039346656037ull
+
+// Fold a byte range into a running 64-bit FNV-1a hash started at
+// SM_FNV1A64_INIT.
+static inline uint64_t sm_fnv1a64_update(uint64_t h, const void *data,
+                                         size_t len) {
+  const uint8_t *p = (const uint8_t *)data;
+  for (size_t i = 0; i < len; i++) {
+    h ^= p[i];
+    h *= 1099511628211ull;
+  }
+  return h;
+}
+
 #endif
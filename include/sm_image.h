@@ -7,13 +7,29 @@
 
 // Log filesystem statistics for a mounted path.
 void log_fs_stats(const char *tag, const char *path, const char *type_hint);
-// Attach and mount an image file to its runtime mount point.
+// Attach and mount an image file to its runtime mount point. Waits while
+// another thread mounts or unmounts the same image.
 bool mount_image(const char *file_path, image_fs_type_t fs_type);
-// Unmount an image mount point and detach its backing device.
+// Unmount an image mount point and detach its backing device. Fails with
+// EBUSY while another thread mounts the same image.
 bool unmount_image(const char *file_path, int unit_id, attach_backend_t backend);
+// Detach an idle image-backed title, keeping its registration and mount.lnk;
+// its staged launch stub takes the place of the title mount. Called from the
+// lifecycle watcher: the game cache entry of the mount is queued for the scan
+// thread (flush_dropped_image_mounts()). Returns false when the title or image
+// mount is busy, the stub cannot be mounted or a mount is in flight.
+bool park_image_mount(const char *file_path, const char *title_id);
+// Make the calling thread the scan thread, which owns the game cache and path
+// state. Call once before other threads mount or unmount images.
+void set_image_bookkeeping_thread(void);
+// Clear the game cache and path state entries of image mounts other threads
+// dropped. Scan thread only.
+void flush_dropped_image_mounts(void);
 // Reconcile cached image mounts with current sources and remount if needed.
+// Does nothing off the scan thread.
 void cleanup_stale_image_mounts(void);
-// Reconcile cached image mounts that belong to a specific scan root.
+// Reconcile cached image mounts that belong to a specific scan root. Does
+// nothing off the scan thread.
 void cleanup_stale_image_mounts_for_root(const char *root);
 // Unmount cached image mounts backed by USB storage during suspend.
 bool unmount_usb_image_mounts_for_suspend(void);
@@ -21,12 +37,23 @@ bool unmount_usb_image_mounts_for_suspend(void);
 bool shutdown_image_mounts(void);
 // Remove empty directories left under the image mount root.
 void cleanup_mount_dirs(void);
+// Run the checks done before attaching an image (stable, not rate-limited,
+// not parked). Returns IMAGE_FS_UNKNOWN when it must not be attached now.
+image_fs_type_t prepare_image_mount_attempt(const char *full_path,
+                                            const char *display_name,
+                                            bool *unstable_out);
+// Reset or bump the retry counter of an image after an attach attempt and
+// notify its first failure (from the calling thread's last error).
+void finish_image_mount_attempt(const char *full_path, bool mounted,
+                                int mount_err);
 // Mount an image file if it is stable and not currently rate-limited.
 bool maybe_mount_image_file(const char *full_path, const char *name,
                             bool *unstable_out);
 // Build the deterministic runtime mount point for an image source path.
 void get_image_mount_point_for_source(const char *file_path,
                                       char mount_point[MAX_PATH]);
+// Return the filesystem type implied by an image source path.
+image_fs_type_t get_image_fs_type_for_path(const char *path);
 // Return true when the filename has a supported image extension.
 bool is_supported_image_file_name(const char *name);
 // Return true when the source path is a supported image, including nested names.
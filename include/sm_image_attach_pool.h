@@ -0,0 +1,22 @@
+#ifndef SM_IMAGE_ATTACH_POOL_H
+#define SM_IMAGE_ATTACH_POOL_H
+
+#include <stdbool.h>
+
+typedef struct sm_state_table_usage sm_state_table_usage_t;
+
+// Attach and mount an image on the worker pool, or inline when the pool is
+// off, the image is already attached or the queue cannot grow. Returns false
+// when the image was skipped or its inline attach failed.
+bool image_attach_pool_submit(const char *full_path, const char *display_name,
+                              bool *unstable_out);
+// Wait for every queued image and record retry counters and failure
+// notifications on the calling thread, in submit order, after clearing the
+// cache entries of image mounts the workers dropped. Workers stay up.
+void image_attach_pool_drain(void);
+// Drain the queue, then stop and join the workers.
+void image_attach_pool_stop(void);
+// Report entries and heap held by the attach queue.
+void image_attach_pool_memory_usage(sm_state_table_usage_t *out);
+
+#endif
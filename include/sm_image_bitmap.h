@@ -0,0 +1,65 @@
+#ifndef SM_IMAGE_BITMAP_H
+#define SM_IMAGE_BITMAP_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/stat.h>
+
+#include "sm_limits.h"
+
+// <image>.smp.bitmap marks which blocks of an image hold data. Blocks whose
+// bit is clear come from the layer below (zeros for a standalone image) and
+// need not be stored, so the image file may end before the device it
+// describes. Attached through an LVD layer bitmap; written by tools/smp_bitmap
+// and, for delta layers, tools/smp_delta.
+#define IMAGE_BITMAP_SUFFIX ".smp.bitmap"
+#define IMAGE_BITMAP_MAGIC "SMPBMAP1"
+#define IMAGE_BITMAP_VERSION 1u
+// Fixed little-endian header; the bitmap itself follows at bitmap_offset.
+#define IMAGE_BITMAP_HEADER_SIZE 64u
+// Block size written by the tool unless told otherwise; a multiple of every
+// LVD sector size in use.
+#define IMAGE_BITMAP_DEFAULT_BLOCK_SIZE (64u * 1024u)
+#define IMAGE_BITMAP_MIN_BLOCK_SIZE 512u
+#define IMAGE_BITMAP_MAX_BLOCK_SIZE (16u * 1024u * 1024u)
+
+typedef struct {
+  uint32_t block_size;
+  // Size of the device the image describes.
+  uint64_t device_size;
+  // Bytes stored in the image file; blocks past it are all clear.
+  uint64_t data_size;
+  uint64_t bitmap_offset;
+  uint64_t bitmap_size;
+  // compute_image_head_hash() of the image the bitmap was built from.
+  uint64_t head_hash;
+  // Head hash of the base image a delta layer applies to; 0 for an image
+  // that stands on its own.
+  uint64_t base_hash;
+} image_bitmap_header_t;
+
+typedef struct {
+  // False when the image has no bitmap and is attached as a plain file.
+  bool present;
+  char path[MAX_PATH];
+  image_bitmap_header_t header;
+} image_bitmap_t;
+
+// Build the bitmap path next to an image.
+bool build_image_bitmap_path(const char *image_path, char *out,
+                             size_t out_size);
+// Bytes of bitmap needed for device_size at block_size (one bit per block).
+uint64_t image_bitmap_size_for(uint64_t device_size, uint32_t block_size);
+// Serialize a bitmap header into IMAGE_BITMAP_HEADER_SIZE bytes.
+void encode_image_bitmap_header(const image_bitmap_header_t *header,
+                                uint8_t *out);
+// Parse and sanity check a serialized header.
+bool decode_image_bitmap_header(const uint8_t *in,
+                                image_bitmap_header_t *out);
+// Look up the bitmap of an image. Returns true with present=false when there
+// is none; returns false with the IMG error set when a bitmap exists but does
+// not match the image.
+bool load_image_bitmap(const char *image_path, const struct stat *image_st,
+                       image_bitmap_t *out);
+
+#endif
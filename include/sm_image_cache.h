@@ -18,6 +18,9 @@ bool cache_image_mount(const char *path, const char *mount_point,
                        int unit_id, attach_backend_t backend);
 // Cache an image source mapping without attach metadata.
 bool cache_image_source_mapping(const char *path, const char *mount_point);
+// Return whether path is the source of a cached image mapping, without
+// copying the entry out.
+bool is_image_cache_source(const char *path);
 // Return a cached image mount entry by index.
 bool get_image_cache_entry(int index, image_cache_entry_t *entry_out);
 // Mark a cached image mount entry as invalid.
@@ -0,0 +1,39 @@
+#ifndef SM_IMAGE_LAYERS_H
+#define SM_IMAGE_LAYERS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/stat.h>
+
+#include "sm_image_bitmap.h"
+#include "sm_mount_defs.h"
+
+// <image>.smp.layers stacks delta layers on a read-only base image; the stack
+// is attached as one LVD device. One "layer=<path>" line per delta, bottom
+// first; relative paths resolve against the base image's directory. Every
+// delta carries an .smp.bitmap naming the blocks it replaces and the base it
+// was built against.
+#define IMAGE_LAYERS_SUFFIX ".smp.layers"
+// LVD layer slots left after the base image.
+#define MAX_IMAGE_DELTA_LAYERS (LVD_ATTACH_LAYER_ARRAY_SIZE - 1)
+
+typedef struct {
+  // Allocation bitmap of the base image; not present for a plain file.
+  image_bitmap_t base;
+  int delta_count;
+  char delta_paths[MAX_IMAGE_DELTA_LAYERS][MAX_PATH];
+  off_t delta_sizes[MAX_IMAGE_DELTA_LAYERS];
+  image_bitmap_t deltas[MAX_IMAGE_DELTA_LAYERS];
+} image_layers_t;
+
+// Load the base bitmap and layer manifest of an image. Returns false with the
+// IMG error set when either exists but does not match the files on disk.
+bool load_image_layers(const char *image_path, const struct stat *image_st,
+                       image_layers_t *out);
+// Return true when the image needs an LVD layer bitmap or several layers.
+bool image_layers_need_lvd(const image_layers_t *layers);
+// Size of the device exported for the stack.
+uint64_t image_layers_device_size(const image_layers_t *layers,
+                                  off_t image_size);
+
+#endif
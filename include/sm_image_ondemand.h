@@ -0,0 +1,44 @@
+#ifndef SM_IMAGE_ONDEMAND_H
+#define SM_IMAGE_ONDEMAND_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+typedef struct sm_state_table_usage sm_state_table_usage_t;
+
+// Return true when image_mount_on_launch keeps idle images detached.
+bool sm_image_ondemand_enabled(void);
+// Track an image that backs a registered title and is attached now. Does
+// nothing while image_mount_on_launch is off.
+void sm_image_ondemand_note_attached(const char *title_id,
+                                     const char *image_path);
+// Track a registered title whose image is not attached (startup warmup).
+void sm_image_ondemand_note_parked(const char *title_id,
+                                   const char *image_path);
+// Return true when the image is detached on purpose and must not be attached
+// by a scan. Entries whose title link no longer points at the image are
+// dropped here.
+bool sm_image_ondemand_is_parked(const char *image_path);
+// Stop tracking an image.
+void sm_image_ondemand_forget(const char *image_path);
+// Return true once after a scan attached an image the idle timer must cover.
+bool sm_image_ondemand_consume_timer_change(void);
+
+// Attach the image of a launched title when it is parked. The launch made
+// from the launch stub is ended first; the title is started again from the
+// image. Returns false when the launch was ended.
+bool sm_image_ondemand_game_on_exec(pid_t pid, const char *title_id);
+// Start the idle timer of the image used by an exiting game.
+void sm_image_ondemand_game_on_exit(pid_t pid);
+// Return the next idle-detach deadline in monotonic microseconds, or 0.
+uint64_t sm_image_ondemand_next_wake_us(uint64_t now_us);
+// Detach images that stayed idle for image_idle_detach_seconds, staging the
+// launch stub of each title first.
+void sm_image_ondemand_poll(void);
+// Forget running games (watcher stop or sleep) and restart idle timers.
+void sm_image_ondemand_game_shutdown(void);
+// Report entries and heap held by the on-demand image table.
+void image_ondemand_memory_usage(sm_state_table_usage_t *out);
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef SM_IMAGE_PROBE_H
+#define SM_IMAGE_PROBE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "sm_types.h"
+
+typedef struct sm_state_table_usage sm_state_table_usage_t;
+
+// What the on-disk filesystem header of an image says, read before attaching.
+typedef struct {
+  // IMAGE_FS_UNKNOWN when no UFS2, exFAT or PFS header was recognized.
+  image_fs_type_t fs_type;
+  // Fundamental block size (statfs f_bsize once mounted); 0 when unknown.
+  uint32_t block_size;
+  // Bytes the filesystem claims to span; 0 when the header does not say.
+  uint64_t fs_size;
+} image_probe_t;
+
+// Read the UFS2 superblock, exFAT boot sector or PFS header of an open image.
+// Returns false only on a read error.
+bool probe_image_fd(int fd, image_probe_t *out);
+// Probe an image file, cached per (dev, ino, size, mtime).
+bool get_image_probe(const char *image_path, image_probe_t *out);
+// Drop cached probes whose image is gone.
+void prune_image_probe_cache(void);
+// Report entries and heap held by the probe cache.
+void image_probe_cache_memory_usage(sm_state_table_usage_t *out);
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef SM_IMAGE_SIDECAR_H
+#define SM_IMAGE_SIDECAR_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "sm_limits.h"
+#include "sm_types.h"
+
+typedef struct sm_state_table_usage sm_state_table_usage_t;
+
+// <image>.smp.json describes an image so it can be identified without being
+// attached. Format version written by write_image_sidecar().
+#define IMAGE_SIDECAR_SUFFIX ".smp.json"
+#define IMAGE_SIDECAR_VERSION 1
+
+typedef struct {
+  char title_id[MAX_TITLE_ID];
+  char title_name[MAX_TITLE_NAME];
+  // IMAGE_FS_UNKNOWN when the sidecar does not say.
+  image_fs_type_t fs_type;
+  // Filesystem cluster (block) size inside the image; 0 when unknown.
+  uint32_t cluster_size;
+  uint64_t image_size;
+  // FNV-1a 64 of the whole image; recorded by the build tool, not verified.
+  uint64_t content_hash;
+  // FNV-1a 64 of the first IMAGE_SIDECAR_HEAD_BYTES, checked against the image.
+  uint64_t head_hash;
+} image_sidecar_t;
+
+// Load the sidecar of an image and check it still matches the image. Results
+// are cached per image and sidecar stamp, so the image head is hashed once.
+bool get_image_sidecar(const char *image_path, image_sidecar_t *out);
+// Same lookup relative to the directory holding the image (parent_fd may be
+// -1 to resolve image_path).
+bool get_image_sidecar_at(int parent_fd, const char *image_path,
+                          const char *image_name, image_sidecar_t *out);
+// Drop cached sidecars whose image is gone.
+void prune_image_sidecar_cache(void);
+// Hash the first IMAGE_SIDECAR_HEAD_BYTES of an open image.
+bool compute_image_head_hash(int fd, uint64_t *hash_out);
+// Write <image_path>.smp.json atomically (temp file + rename).
+bool write_image_sidecar(const char *image_path, const image_sidecar_t *sidecar);
+// Report entries and heap held by the sidecar cache.
+void image_sidecar_cache_memory_usage(sm_state_table_usage_t *out);
+
+#endif
@@ -5,6 +5,7 @@
 #include <stdint.h>
 
 typedef struct scan_candidate scan_candidate_t;
+typedef struct sm_state_table_usage sm_state_table_usage_t;
 
 // Return whether a title is already waiting for async batch installation.
 bool is_title_install_pending(const char *title_id);
@@ -24,5 +25,7 @@ bool sm_install_queue_candidate(const scan_candidate_t *candidate,
 bool sm_install_submit_queued(void);
 // Record retry state for every queued title after a batch submit failure.
 void sm_install_note_submit_failure(void);
+// Report entries and heap held by the pending install table.
+void install_queue_memory_usage(sm_state_table_usage_t *out);
 
 #endif
@@ -6,15 +6,27 @@
 #define DEFAULT_STABILITY_WAIT_SECONDS 10u
 #define DEFAULT_KSTUFF_PAUSE_DELAY_IMAGE_SECONDS 25u
 #define DEFAULT_KSTUFF_PAUSE_DELAY_DIRECT_SECONDS 15u
+#define DEFAULT_IMAGE_IDLE_DETACH_SECONDS 600u
+#define DEFAULT_IMAGE_ATTACH_WORKERS 4u
+#define DEFAULT_IMAGE_ATTACH_PER_DEVICE 2u
+#define DEFAULT_COPY_WORKERS 4u
 
-#define MAX_PENDING 512
+// Growable tracking tables (game cache, path/title state, install queue, scan
+// candidates) start small and double on demand up to state_soft_limit.
+#define INITIAL_STATE_CAPACITY 64
+#define DEFAULT_STATE_SOFT_LIMIT 8192u
+#define MIN_STATE_SOFT_LIMIT 64u
+#define MAX_STATE_SOFT_LIMIT 65536u
+// Entries inspected from the LRU tail when a full table picks an eviction
+// victim; sticky entries inside this window are skipped.
+#define STATE_EVICT_SCAN_LIMIT 8
+// Directories whose mtime is this close to the time they were read are not
+// fingerprinted; coarse exFAT timestamps could hide a change made just after.
+#define SCAN_TREE_RACY_SECONDS 2
 #define MAX_IMAGE_MOUNTS 256
 #define MAX_IMAGE_MODE_RULES 128
 #define MAX_KSTUFF_TITLE_RULES 128
 #define MAX_FAKELIB_EXCLUDE_RULES 128
-#define PATH_STATE_CAPACITY MAX_PENDING
-#define TITLE_STATE_CAPACITY MAX_PENDING
-#define STATE_HASH_SIZE 1024u
 #define MAX_SCAN_PATHS 256
 
 #define MAX_FAILED_MOUNT_ATTEMPTS 2
@@ -24,6 +36,7 @@
 #define MAX_LAYERED_UNMOUNT_ATTEMPTS 4
 
 #define LVD_RELEASE_WAIT_MAX_US 15000000u
+#define LVD_RELEASE_WAIT_MIN_POLL_US 10000u
 #define LVD_RELEASE_WAIT_POLL_US 500000u
 #define GAME_LIFECYCLE_POLL_INTERVAL_US 250000u
 #define GAME_APPINFO_LOOKUP_TIMEOUT_US 1000000u
@@ -35,6 +48,12 @@
 #define MAX_SCAN_INTERVAL_SECONDS 3600u
 #define MAX_STABILITY_WAIT_SECONDS 3600u
 #define MAX_KSTUFF_PAUSE_DELAY_SECONDS 3600u
+#define MIN_IMAGE_IDLE_DETACH_SECONDS 30u
+#define MAX_IMAGE_IDLE_DETACH_SECONDS 86400u
+// Image attach worker pool: total workers and workers per backing device.
+#define MAX_IMAGE_ATTACH_WORKERS 8u
+// Staging copy worker pool.
+#define MAX_COPY_WORKERS 8u
 
 #define APP_DB_QUERY_BUSY_RETRIES 3
 #define APP_DB_UPDATE_BUSY_RETRIES 25
@@ -45,6 +64,27 @@
 #define MAX_PATH 1024
 #define MAX_TITLE_ID 32
 #define MAX_TITLE_NAME 256
+#define MAX_CONTENT_ID 48
+#define MAX_PARAM_VERSION 32
+#define MAX_PARAM_LOCALE 16
 #define MAX_PARAM_JSON_SIZE (1024u * 1024u)
+// Read chunk for the streaming param.json parser (stack allocated).
+#define PARAM_JSON_READ_CHUNK 4096u
+// Deepest container nesting accepted in param.json.
+#define PARAM_JSON_MAX_DEPTH 32
+// Leading image bytes hashed to bind an .smp.json sidecar to its image; covers
+// the exFAT boot region and the UFS2 superblock at 64 KiB.
+#define IMAGE_SIDECAR_HEAD_BYTES (128u * 1024u)
+// Largest .smp.json sidecar read.
+#define MAX_IMAGE_SIDECAR_SIZE (64u * 1024u)
+// Largest .smp.layers manifest read.
+#define MAX_IMAGE_LAYERS_MANIFEST_SIZE (8u * 1024u)
+// Largest buffer sm_copy_file_data() moves data through; smaller files get a
+// buffer rounded up to COPY_BUFFER_ALIGN. Aligned for uncached USB reads.
+#define COPY_BUFFER_SIZE (1024u * 1024u)
+#define COPY_BUFFER_ALIGN (64u * 1024u)
+// Suffix of the temporary files and directories a copy batch writes before
+// renaming them into place.
+#define COPY_TEMP_SUFFIX ".smtmp"
 
 #endif
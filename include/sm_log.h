@@ -24,7 +24,9 @@ void sm_error_clear(void);
 // Store the last subsystem error with formatted details.
 void sm_error_set(const char *subsystem, int code, const char *path,
                   const char *fmt, ...);
-// Return the last recorded subsystem error.
+// Replace the last error with one recorded on another thread (NULL clears).
+void sm_error_restore(const sm_error_t *err);
+// Return the last recorded subsystem error of the calling thread.
 const sm_error_t *sm_last_error(void);
 // Return whether the current error was already notified.
 bool sm_error_notified(void);
@@ -20,9 +20,13 @@
 // standalone LVD readonly bit by itself.
 // image_type values accepted by validator: 0..0xC (13 values total).
 // layer source_type observed: 1=file, 2=device/special source (/dev/sbram0, char/block).
-// layer descriptor flag bit0 is "no bitmap file specified".
-#define LVD_CTRL_PATH "/dev/lvdctl"
-#define MD_CTRL_PATH "/dev/mdctl"
+// layer descriptor flag bit0 is "no bitmap file specified". Without it the
+// layer names a bitmap file region (one bit per block of device_size); blocks
+// whose bit is clear are not read from the layer and return zeros.
+#define LVD_CTRL_PATH SM_PATH_ROOT "/dev/lvdctl"
+#define MD_CTRL_PATH SM_PATH_ROOT "/dev/mdctl"
+#define LVD_DEV_PREFIX SM_PATH_ROOT "/dev/lvd"
+#define MD_DEV_PREFIX SM_PATH_ROOT "/dev/md"
 #define SCE_LVD_IOC_ATTACH_V0 0xC0286D00
 #define SCE_LVD_IOC_ATTACH_V1 0xC0286D09
 #define SCE_LVD_IOC_DETACH 0xC0286D01
@@ -47,13 +51,18 @@
 #define LVD_ATTACH_IMAGE_TYPE_PFS_SAVE_DATA 5
 #define PFS_NESTED_OUTER_IMG_TYPE 0x02u
 #define PFS_NESTED_INNER_IMG_TYPE 0x82u
+// Layers of a plain image; delta layers from an .smp.layers manifest add up
+// to LVD_ATTACH_LAYER_ARRAY_SIZE.
 #define LVD_ATTACH_LAYER_COUNT 1
 #define LVD_ATTACH_LAYER_ARRAY_SIZE 3
 #define LVD_ENTRY_TYPE_FILE 1
 #define LVD_ENTRY_TYPE_SPECIAL 2
 #define LVD_ENTRY_FLAG_NO_BITMAP 0x1
-#define LVD_NODE_WAIT_US 100000
-#define LVD_NODE_WAIT_RETRIES 100
+// Device node waits poll with a backoff that doubles from the min to the max
+// interval; most nodes appear within a few milliseconds of the attach.
+#define DEV_NODE_WAIT_MIN_POLL_US 250u
+#define DEV_NODE_WAIT_MAX_POLL_US 100000u
+#define DEV_NODE_WAIT_TIMEOUT_US 10000000u
 #define UFS_NMOUNT_FLAG_RW 0x10000000u
 #define UFS_NMOUNT_FLAG_RO 0x10000001u
 
@@ -12,6 +12,9 @@ bool is_source_stable_for_mount(const char *path, const char *name,
                                 const char *tag);
 // Wait until a device node appears or disappears.
 bool wait_for_dev_node_state(const char *devname, bool should_exist);
+// Log the cumulative latency distribution of device node waits when a wait
+// finished since the previous call.
+void log_dev_node_wait_stats(void);
 // Resolve backend and unit ID for a mounted image path.
 bool resolve_device_from_mount(const char *mount_point,
                                attach_backend_t *backend_out, int *unit_out);
@@ -0,0 +1,56 @@
+#ifndef SM_MOUNT_STATS_H
+#define SM_MOUNT_STATS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "sm_types.h"
+
+// Latency histogram with log2 buckets: bucket b counts samples shorter than
+// 2^b us; the last bucket also takes everything longer.
+#define SM_LATENCY_BUCKETS 25
+
+typedef struct {
+  uint32_t count;
+  uint64_t total_us;
+  uint64_t max_us;
+  uint32_t buckets[SM_LATENCY_BUCKETS];
+} sm_latency_hist_t;
+
+// Add one sample to a histogram (caller serializes access).
+void sm_latency_hist_add(sm_latency_hist_t *hist, uint64_t elapsed_us);
+// Return the upper bound (us) of the bucket reaching percent of the samples.
+uint64_t sm_latency_hist_percentile_us(const sm_latency_hist_t *hist,
+                                       uint32_t percent);
+
+// Timed phases of mount_image() and mount_and_install().
+typedef enum {
+  SM_MOUNT_PHASE_OVERRIDE = 0,
+  SM_MOUNT_PHASE_BACKEND,
+  SM_MOUNT_PHASE_ATTACH,
+  SM_MOUNT_PHASE_DEV_NODE,
+  SM_MOUNT_PHASE_NMOUNT,
+  SM_MOUNT_PHASE_VALIDATE,
+  SM_MOUNT_PHASE_PUBLISH,
+  SM_MOUNT_PHASE_IMAGE_TOTAL,
+  SM_MOUNT_PHASE_STAGE,
+  SM_MOUNT_PHASE_NULLFS,
+  SM_MOUNT_PHASE_LINK,
+  SM_MOUNT_PHASE_REGISTER,
+  SM_MOUNT_PHASE_INSTALL_TOTAL,
+  SM_MOUNT_PHASE_COUNT
+} sm_mount_phase_t;
+
+// Return a monotonic start stamp for sm_mount_stats_end().
+uint64_t sm_mount_stats_begin(void);
+// Record the time since start_us for a phase of an image of fs_type attached
+// through backend (IMAGE_FS_UNKNOWN for directory titles, ATTACH_BACKEND_NONE
+// for install phases).
+void sm_mount_stats_end(sm_mount_phase_t phase, image_fs_type_t fs_type,
+                        attach_backend_t backend, uint64_t start_us);
+// Write every histogram to MOUNT_STATS_FILE and log a per-phase summary.
+void sm_mount_stats_dump(const char *reason);
+// Dump the stats when MOUNT_STATS_REQUEST_FILE exists, consuming it.
+void sm_mount_stats_poll_request(void);
+
+#endif
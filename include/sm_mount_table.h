@@ -0,0 +1,44 @@
+#ifndef SM_MOUNT_TABLE_H
+#define SM_MOUNT_TABLE_H
+
+#include <stdbool.h>
+
+struct iovec;
+struct statfs;
+
+// Snapshot of the kernel mount table shared by title-stack and image mount
+// inspections. One getmntinfo() pass fills it and indexes the entries by
+// mount-on path and by mount-from device or source; it is rebuilt on the next
+// lookup after mount_table_invalidate(). Our own mounts and unmounts go
+// through mount_table_nmount()/mount_table_unmount(), which invalidate it, and
+// every scan pass invalidates it to pick up changes made by anyone else.
+
+// Visit one entry; return false to stop. Runs with the snapshot locked, so it
+// must not call back into mount_table_*().
+typedef bool (*mount_table_visit_fn)(const struct statfs *entry, void *ctx);
+
+// Drop the snapshot so the next lookup reads the mount table again.
+void mount_table_invalidate(void);
+// nmount(2) that invalidates the snapshot.
+int mount_table_nmount(struct iovec *iov, unsigned int niov, int flags);
+// unmount(2) that invalidates the snapshot.
+int mount_table_unmount(const char *path, int flags);
+// Visit the entries mounted on path in mount order. Returns the number of
+// entries visited, or -1 when the mount table cannot be read.
+int mount_table_for_each_on(const char *path, mount_table_visit_fn fn,
+                            void *ctx);
+// Visit the entries mounted from a device or source path in mount order.
+// Returns the number of entries visited, or -1 when the mount table cannot be
+// read.
+int mount_table_for_each_from(const char *from, mount_table_visit_fn fn,
+                              void *ctx);
+// Visit every entry in mount order. Returns the number of entries visited, or
+// -1 when the mount table cannot be read.
+int mount_table_for_each(mount_table_visit_fn fn, void *ctx);
+// Copy the entry statfs() reports for a mount point (a unionfs layer over any
+// other, else the first mounted) into out.
+bool mount_table_find_top(const char *path, struct statfs *out);
+// Check whether anything is mounted on path.
+bool mount_table_is_mount_point(const char *path);
+
+#endif
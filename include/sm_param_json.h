@@ -0,0 +1,52 @@
+#ifndef SM_PARAM_JSON_H
+#define SM_PARAM_JSON_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "sm_limits.h"
+
+// Locale whose titleName is shown when param.json provides one.
+#define SM_PARAM_JSON_PREFERRED_LOCALE "en-US"
+
+// Fields the daemon reads from sce_sys/param.json. Strings are NUL-terminated
+// UTF-8 and empty when the key is absent.
+typedef struct {
+  char title_id[MAX_TITLE_ID];
+  char content_id[MAX_CONTENT_ID];
+  // contentVersion, falling back to masterVersion.
+  char app_version[MAX_PARAM_VERSION];
+  // requiredSystemSoftwareVersion as written (usually a hex string).
+  char required_firmware[MAX_PARAM_VERSION];
+  char default_language[MAX_PARAM_LOCALE];
+  // titleName of the preferred locale, else of defaultLanguage, else the first
+  // one in the file.
+  char title_name[MAX_TITLE_NAME];
+  // Locale title_name came from; empty for a top-level titleName.
+  char title_locale[MAX_PARAM_LOCALE];
+} sm_param_json_t;
+
+// Receives top-level string or scalar members the reader does not consume
+// itself. Values are decoded and cut to MAX_TITLE_NAME - 1 bytes; scalars come
+// through as written (e.g. "65536", "true").
+typedef void (*sm_param_json_member_fn)(const char *key, const char *value,
+                                        void *ctx);
+
+// Parse param.json from an open descriptor in one streaming pass through a
+// fixed stack buffer, reading at most MAX_PARAM_JSON_SIZE bytes. Returns 1
+// when a title ID was found (even if the document is malformed after it), 0
+// when not and -1 on a read error.
+int sm_param_json_parse_fd(int fd, const char *preferred_locale,
+                           sm_param_json_t *out);
+// sm_param_json_parse_fd() that also reports other top-level members, for
+// documents sharing the param.json title keys.
+int sm_param_json_parse_fd_members(int fd, const char *preferred_locale,
+                                   sm_param_json_t *out,
+                                   sm_param_json_member_fn on_member,
+                                   void *member_ctx);
+// Parse an in-memory document; returns true when a title ID was found.
+bool sm_param_json_parse_buffer(const char *data, size_t len,
+                                const char *preferred_locale,
+                                sm_param_json_t *out);
+
+#endif
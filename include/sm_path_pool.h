@@ -0,0 +1,37 @@
+#ifndef SM_PATH_POOL_H
+#define SM_PATH_POOL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct sm_state_table_usage sm_state_table_usage_t;
+
+// Handle to a refcounted, deduplicated path string. Two handles are equal
+// exactly when their strings are equal, so tables compare paths by handle.
+typedef uint32_t sm_path_id_t;
+
+#define SM_PATH_ID_NONE 0u
+
+// Intern a path and take a reference; returns SM_PATH_ID_NONE for empty
+// input or on allocation failure.
+sm_path_id_t sm_path_intern(const char *path);
+// Return the handle of an already interned path with a reference taken, or
+// SM_PATH_ID_NONE. The caller releases it with sm_path_release(); holding the
+// reference keeps the handle from being reused for another path while it is
+// compared.
+sm_path_id_t sm_path_lookup(const char *path);
+// Take an extra reference on a handle.
+void sm_path_retain(sm_path_id_t id);
+// Drop a reference; the string is freed with its last reference.
+void sm_path_release(sm_path_id_t id);
+// Point *slot at an interned copy of path, releasing the previous handle.
+bool sm_path_assign(sm_path_id_t *slot, const char *path);
+// Release *slot and reset it to SM_PATH_ID_NONE.
+void sm_path_clear(sm_path_id_t *slot);
+// Return the string for a handle ("" for SM_PATH_ID_NONE). The pointer stays
+// valid while the caller holds a reference.
+const char *sm_path_str(sm_path_id_t id);
+// Report entries and heap held by the path pool.
+void path_pool_memory_usage(sm_state_table_usage_t *out);
+
+#endif
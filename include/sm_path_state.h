@@ -5,6 +5,26 @@
 #include <stdint.h>
 #include <sys/stat.h>
 
+typedef struct sm_state_table_usage sm_state_table_usage_t;
+
+// Path state is owned by the scan thread and is not locked, like the game
+// cache. Attach-pool workers and the game lifecycle watcher queue the image
+// mounts they drop (flush_dropped_image_mounts()) and attach outcomes are
+// recorded through finish_image_mount_attempt() when the scan thread drains
+// the pool.
+
+// Parsed param.json identity and titles cached for one source directory.
+typedef struct {
+  const char *path;
+  const char *title_id;
+  const char *title_name;
+  time_t param_mtime;
+  off_t param_size;
+  ino_t param_ino;
+} cached_game_info_t;
+
+typedef bool (*cached_game_info_fn)(const cached_game_info_t *info, void *ctx);
+
 // Load cached game info if the param file state still matches.
 bool load_cached_game_info(const char *path, const struct stat *param_st,
                            char *out_id, char *out_name, bool *valid_out);
@@ -12,6 +32,10 @@ bool load_cached_game_info(const char *path, const struct stat *param_st,
 void store_cached_game_info(const char *path, const struct stat *param_st,
                             bool valid, const char *title_id,
                             const char *title_name);
+// Visit every cached game info entry that parsed successfully.
+void for_each_cached_game_info(cached_game_info_fn fn, void *ctx);
+// Return a counter that changes whenever cached game info changes.
+uint32_t cached_game_info_generation(void);
 // Drop expired entries from path-based retry and metadata state.
 void prune_path_state(void);
 // Drop expired entries that belong to a specific scan root.
@@ -38,5 +62,7 @@ void clear_backport_mount_failure(const char *path);
 bool note_manual_missing_source_once(const char *path);
 // Allow a manual source to be reported missing again after it becomes visible.
 void clear_manual_missing_source(const char *path);
+// Report entries and heap held by the path state table.
+void path_state_memory_usage(sm_state_table_usage_t *out);
 
 #endif
@@ -1,26 +1,47 @@
 #ifndef SM_PATHS_H
 #define SM_PATHS_H
 
-#define IMAGE_MOUNT_BASE "/mnt/shadowmnt"
-#define PFSC_IMAGE_MOUNT_BASE "/mnt/shadowmnt/pfsc"
+// Prefix for every absolute payload path. Empty on console; host builds set it
+// to a sandbox directory so the real code can run against a synthetic tree.
+#ifndef SM_PATH_ROOT
+#define SM_PATH_ROOT ""
+#endif
+
+#define IMAGE_MOUNT_BASE SM_PATH_ROOT "/mnt/shadowmnt"
+#define PFSC_IMAGE_MOUNT_BASE SM_PATH_ROOT "/mnt/shadowmnt/pfsc"
 
 #define DEFAULT_BACKPORTS_DIR_NAME "backports"
-#define DEFAULT_GLOBAL_FAKELIB_PATH "/data/shadowmount/fakelib"
-#define LOG_DIR "/data/shadowmount"
-#define LOG_FILE "/data/shadowmount/debug.log"
-#define LOG_FILE_PREV "/data/shadowmount/debug.log.1"
-#define CONFIG_FILE "/data/shadowmount/config.ini"
-#define AUTOTUNE_FILE "/data/shadowmount/autotune.ini"
-#define MANUAL_LIST_FILE "/data/shadowmount/manual.lst"
-#define MANUAL_STATUS_FILE "/data/shadowmount/manual.status"
-#define APPMETA_BASE "/user/appmeta"
-#define APP_BASE "/user/app"
-#define KSTUFF_NOAUTOMOUNT_FILE "/data/.kstuff_noautomount"
-#define KILL_FILE "/data/shadowmount/STOP"
-#define TOAST_FILE "/data/shadowmount/notify.txt"
-#define NOTIFY_ICON_DIR "/user/data/shadowmount"
-#define NOTIFY_ICON_FILE "/user/data/shadowmount/smp_icon.png"
-#define APP_DB_PATH "/system_data/priv/mms/app.db"
+#define DEFAULT_GLOBAL_FAKELIB_PATH SM_PATH_ROOT "/data/shadowmount/fakelib"
+#define LOG_DIR SM_PATH_ROOT "/data/shadowmount"
+#define LOG_FILE SM_PATH_ROOT "/data/shadowmount/debug.log"
+#define LOG_FILE_PREV SM_PATH_ROOT "/data/shadowmount/debug.log.1"
+#define CONFIG_FILE SM_PATH_ROOT "/data/shadowmount/config.ini"
+#define AUTOTUNE_FILE SM_PATH_ROOT "/data/shadowmount/autotune.ini"
+#define MANUAL_LIST_FILE SM_PATH_ROOT "/data/shadowmount/manual.lst"
+#define MANUAL_STATUS_FILE SM_PATH_ROOT "/data/shadowmount/manual.status"
+#define SCAN_INDEX_FILE SM_PATH_ROOT "/data/shadowmount/scan_index.bin"
+#define MOUNT_STATS_FILE SM_PATH_ROOT "/data/shadowmount/mount_stats.txt"
+// Creating this file asks the payload to write MOUNT_STATS_FILE.
+#define MOUNT_STATS_REQUEST_FILE SM_PATH_ROOT "/data/shadowmount/STATS"
+#define APPMETA_BASE SM_PATH_ROOT "/user/appmeta"
+#define APP_BASE SM_PATH_ROOT "/user/app"
+#define USER_DATA_DIR SM_PATH_ROOT "/user/data"
+#define SYSTEM_EX_BASE SM_PATH_ROOT "/system_ex"
+#define SYSTEM_EX_APP_BASE SM_PATH_ROOT "/system_ex/app"
+#define SYSTEM_APPMETA_BASE SM_PATH_ROOT "/system_data/priv/appmeta"
+#define SANDBOX_BASE SM_PATH_ROOT "/mnt/sandbox"
+#define KSTUFF_NOAUTOMOUNT_FILE SM_PATH_ROOT "/data/.kstuff_noautomount"
+#define KILL_FILE SM_PATH_ROOT "/data/shadowmount/STOP"
+#define TOAST_FILE SM_PATH_ROOT "/data/shadowmount/notify.txt"
+#define NOTIFY_ICON_DIR SM_PATH_ROOT "/user/data/shadowmount"
+#define NOTIFY_ICON_FILE SM_PATH_ROOT "/user/data/shadowmount/smp_icon.png"
+// Same directory as /data/shadowmount, but reached through /user so blobs can
+// be hard-linked into /user/app and /user/appmeta.
+#define ASSET_STORE_DIR SM_PATH_ROOT "/user/data/shadowmount/assets"
+// Launch stubs of titles whose image is detached (mount on launch).
+#define LAUNCH_STUB_DIR SM_PATH_ROOT "/user/data/shadowmount/launch"
+#define APP_DB_PATH SM_PATH_ROOT "/system_data/priv/mms/app.db"
+#define APP_INST_UTIL_SPRX_PATH SM_PATH_ROOT "/system/common/lib/libSceAppInstUtil.sprx"
 
 /* Compile-time default scan roots (used when config has no scanpath entries). */
 #define SM_DEFAULT_SCAN_PATHS_INITIALIZER                                      \
@@ -16,8 +16,6 @@
 #include <string.h>
 #include <sys/file.h>
 #include <sys/ioctl.h>
-#include <sys/mdioctl.h>
-#include <sys/mount.h>
 #include <sys/param.h>
 #include <sys/stat.h>
 #include <sys/syscall.h>
@@ -26,7 +24,15 @@
 #include <time.h>
 #include <unistd.h>
 
+// Host builds (make bench) swap the console kernel/SDK surface for a Linux
+// stand-in; see sm_platform_host.h.
+#ifdef SM_HOST_BUILD
+#include "sm_platform_host.h"
+#else
+#include <sys/mdioctl.h>
+#include <sys/mount.h>
 #include <ps5/kernel.h>
+#endif
 
 typedef struct {
   uint32_t app_id;
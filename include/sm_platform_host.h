@@ -0,0 +1,99 @@
+#ifndef SM_PLATFORM_HOST_H
+#define SM_PLATFORM_HOST_H
+
+// Linux stand-in for the console kernel/SDK surface. Only included by
+// sm_platform.h when SM_HOST_BUILD is defined (make bench); the payload build
+// never sees this header.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#ifndef SM_PATH_ROOT
+#error "SM_HOST_BUILD requires SM_PATH_ROOT (sandbox directory for payload paths)"
+#endif
+
+// --- BSD libc ---
+size_t strlcpy(char *dst, const char *src, size_t size);
+size_t strlcat(char *dst, const char *src, size_t size);
+
+// --- BSD mount API ---
+#define MNAMELEN 1024
+#define MFSNAMELEN 16
+
+#define MNT_RDONLY 0x0000000000000001ULL
+#define MNT_UPDATE 0x0000000000010000ULL
+#define MNT_FORCE 0x0000000000080000ULL
+#define MNT_WAIT 1
+#define MNT_NOWAIT 2
+
+// BSD struct statfs; the macro keeps glibc's incompatible statfs out of scope.
+#define statfs sm_host_statfs
+struct statfs {
+  uint64_t f_flags;
+  uint64_t f_bsize;
+  uint64_t f_iosize;
+  uint64_t f_blocks;
+  uint64_t f_bfree;
+  int64_t f_bavail;
+  uint64_t f_files;
+  int64_t f_ffree;
+  char f_fstypename[MFSNAMELEN];
+  char f_mntfromname[MNAMELEN];
+  char f_mntonname[MNAMELEN];
+};
+
+// Resolve the emulated mount covering path (longest mount-point prefix, else
+// the sandbox root entry).
+int statfs(const char *path, struct statfs *buf);
+// Return the emulated mount table; the buffer stays valid until the next call.
+int getmntinfo(struct statfs **mntbufp, int mode);
+// Record a mount described by fstype/from/fspath iovec pairs. nullfs exposes
+// its source; image mounts expose "<image dir>/.<image name>.root" if present.
+int nmount(struct iovec *iov, unsigned int niov, int flags);
+// Drop a recorded mount; fails with EINVAL when path is not a mount point.
+int unmount(const char *path, int flags);
+
+// --- md(4) ioctl ABI ---
+#define MDIOVERSION 0
+#define MD_VNODE 3
+#define MD_AUTOUNIT 0x04
+#define MD_READONLY 0x08
+#define MD_FORCE 0x20
+#define MD_ASYNC 0x40
+
+struct md_ioctl {
+  unsigned md_version;
+  unsigned md_unit;
+  int md_type;
+  char *md_file;
+  off_t md_mediasize;
+  unsigned md_sectorsize;
+  unsigned md_options;
+  uint64_t md_base;
+  int md_fwheads;
+  int md_fwsectors;
+  char *md_label;
+  int md_pad[16];
+};
+
+#define MDIOCATTACH 0xC1A86D00UL
+#define MDIOCDETACH 0xC1A86D01UL
+
+// LVD/MD control ioctls create or remove emulated /dev/lvdN and /dev/mdN
+// nodes under SM_PATH_ROOT; anything else is forwarded to the host kernel.
+int sm_host_ioctl(int fd, unsigned long request, void *arg);
+#define ioctl(fd, request, arg) sm_host_ioctl((fd), (request), (arg))
+
+// Create the sandbox skeleton (payload dirs, LVD/MD control nodes) and drop
+// mounts/device nodes left by a previous run.
+bool sm_host_platform_init(void);
+
+// --- ps5/kernel.h ---
+// Firmware version in console BCD layout (SM_HOST_FW_VERSION overrides).
+uint32_t kernel_get_fw_version(void);
+int kernel_set_ucred_authid(pid_t pid, uint64_t authid);
+
+#endif
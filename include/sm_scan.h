@@ -4,6 +4,15 @@
 #include <stdbool.h>
 
 typedef struct scan_candidate scan_candidate_t;
+typedef struct sm_state_table_usage sm_state_table_usage_t;
+
+// Growable candidate list filled by collect_scan_candidates*(); the caller
+// owns it and may reuse it across cycles.
+typedef struct scan_candidate_list {
+  scan_candidate_t *items;
+  int count;
+  int capacity;
+} scan_candidate_list_t;
 
 // Unmount and clean up mounts whose backing sources disappeared.
 void cleanup_lost_sources_before_scan(void);
@@ -12,15 +21,21 @@ void cleanup_lost_sources_for_scan_root(const char *scan_root);
 // Immediately unmount runtime mounts backed by USB storage for suspend.
 void unmount_usb_sources_for_suspend(void);
 // Scan configured roots and collect install candidates.
-int collect_scan_candidates(scan_candidate_t *candidates, int max_candidates,
+int collect_scan_candidates(scan_candidate_list_t *candidates,
                             int *total_found_out,
                             bool *unstable_found_out);
 // Scan a single configured root and collect install candidates.
 int collect_scan_candidates_for_scan_root(const char *scan_root,
-                                          scan_candidate_t *candidates,
-                                          int max_candidates,
+                                          scan_candidate_list_t *candidates,
                                           int *total_found_out,
                                           bool *unstable_found_out);
+// Release a candidate list's storage.
+void free_scan_candidate_list(scan_candidate_list_t *list);
+// Report entries and heap held by a candidate list.
+void scan_candidate_list_memory_usage(const scan_candidate_list_t *list,
+                                      sm_state_table_usage_t *out);
+// Report entries and heap held by the per-cycle scan workspace.
+void scan_workspace_memory_usage(sm_state_table_usage_t *out);
 // Mount stable backport overlays for already mounted titles.
 void mount_backport_overlays(bool *unstable_found_out);
 
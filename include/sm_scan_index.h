@@ -0,0 +1,13 @@
+#ifndef SM_SCAN_INDEX_H
+#define SM_SCAN_INDEX_H
+
+#include <stdbool.h>
+
+// Seed cached game info from the on-disk scan index so unchanged sources skip
+// param.json parsing. Returns the number of titles loaded.
+int load_scan_index(void);
+// Rewrite the on-disk scan index when cached game info changed since the last
+// load or save.
+bool save_scan_index(void);
+
+#endif
@@ -3,16 +3,22 @@
 
 #include <stdbool.h>
 
+typedef struct sm_state_table_usage sm_state_table_usage_t;
+
 typedef enum {
   SM_SCAN_TREE_DIR_DESCEND = 0,
   SM_SCAN_TREE_DIR_SKIP_DESCEND,
   SM_SCAN_TREE_DIR_ABORT,
 } sm_scan_tree_dir_visit_t;
 
-typedef sm_scan_tree_dir_visit_t (*sm_scan_tree_dir_fn)(const char *dir_path,
+// dir_fd is open on dir_path for the duration of the call; probe entries
+// with *at() calls relative to it instead of re-resolving dir_path.
+typedef sm_scan_tree_dir_visit_t (*sm_scan_tree_dir_fn)(int dir_fd,
+                                                        const char *dir_path,
                                                         unsigned int depth_from_root,
                                                         void *ctx);
-typedef bool (*sm_scan_tree_image_fn)(const char *image_path,
+// parent_fd is open on the directory holding image_name.
+typedef bool (*sm_scan_tree_image_fn)(int parent_fd, const char *image_path,
                                       const char *image_name,
                                       unsigned int depth_from_root,
                                       void *ctx);
@@ -27,5 +33,7 @@ bool sm_scan_tree_walk(const char *scan_root, const char *dir_path,
                        unsigned int depth_from_root,
                        unsigned int remaining_depth,
                        const sm_scan_tree_callbacks_t *callbacks, void *ctx);
+// Report entries and heap held by the directory fingerprint cache.
+void scan_tree_cache_memory_usage(sm_state_table_usage_t *out);
 
 #endif
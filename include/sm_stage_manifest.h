@@ -0,0 +1,83 @@
+#ifndef SM_STAGE_MANIFEST_H
+#define SM_STAGE_MANIFEST_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/stat.h>
+
+#include "sm_copy.h"
+#include "sm_limits.h"
+
+// /user/app/<TITLE_ID>/<name> records what was staged into a destination
+// root: one line per file with the source size, mtime and FNV-1a 64 content
+// hash, the staged size and the path relative to the root. A restage walks
+// the source first and queues only files whose source changed or whose staged
+// copy is gone; the queue is copied in parallel and renamed into place all at
+// once, then staged files the source no longer has are removed.
+#define STAGE_MANIFEST_STAGING_NAME "sce_sys.smp.manifest"
+#define STAGE_MANIFEST_APPMETA_NAME "appmeta.smp.manifest"
+// Appended to LAUNCH_STUB_DIR/<TITLE_ID> for the manifest of a launch stub.
+#define STAGE_MANIFEST_LAUNCH_STUB_SUFFIX ".smp.manifest"
+#define STAGE_MANIFEST_VERSION 1
+
+typedef struct {
+  char rel_path[MAX_PATH];
+  uint64_t src_size;
+  int64_t src_mtime_sec;
+  long src_mtime_nsec;
+  uint64_t src_hash;
+  uint64_t dst_size;
+  // Set when the current restage visited the file.
+  bool seen;
+} stage_manifest_entry_t;
+
+// Source stamp of a queued copy; pending[i] goes with jobs[i].
+typedef struct {
+  char rel_path[MAX_PATH];
+  uint64_t src_size;
+  int64_t src_mtime_sec;
+  long src_mtime_nsec;
+} stage_manifest_pending_t;
+
+typedef struct {
+  char path[MAX_PATH];
+  char dst_root[MAX_PATH];
+  stage_manifest_entry_t *entries;
+  int count;
+  int capacity;
+  bool dirty;
+  // Files skipped as unchanged during the current restage.
+  uint32_t unchanged;
+  sm_copy_job_t *jobs;
+  stage_manifest_pending_t *pending;
+  int pending_count;
+  int pending_capacity;
+} stage_manifest_t;
+
+// Decide whether a source file name is staged (NULL stages every file).
+typedef bool (*stage_manifest_filter_fn)(const char *name);
+
+// Load manifest_path for files staged under dst_root. A missing or unreadable
+// manifest loads empty, so everything is copied once.
+void load_stage_manifest(const char *manifest_path, const char *dst_root,
+                         stage_manifest_t *out);
+// Queue a copy of src to dst_root/rel_path unless the manifest shows it is
+// unchanged.
+int stage_manifest_queue_file(stage_manifest_t *manifest, const char *src,
+                              const struct stat *src_st, const char *rel_path);
+// Queue the regular files of src_dir for dst_root/rel_dir ("" for the root
+// itself), recursing into subdirectories when recursive is set. Creates the
+// destination directories.
+int stage_manifest_queue_dir(stage_manifest_t *manifest, const char *src_dir,
+                             const char *rel_dir, bool recursive,
+                             stage_manifest_filter_fn filter);
+// Copy the queued files on up to workers threads and rename them into place,
+// then remove staged files that were not visited and write the manifest if it
+// changed. Returns false when a copy failed; every staged file is then left
+// as it was.
+bool commit_stage_manifest(stage_manifest_t *manifest, unsigned workers,
+                           sm_copy_stats_t *stats);
+// Release the entries and queue of a manifest.
+void free_stage_manifest(stage_manifest_t *manifest);
+
+#endif
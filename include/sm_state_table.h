@@ -0,0 +1,63 @@
+#ifndef SM_STATE_TABLE_H
+#define SM_STATE_TABLE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct scan_candidate_list scan_candidate_list_t;
+
+// Upper bound for collect_state_memory_usage() output entries.
+#define SM_STATE_TABLE_MAX_REPORT 16
+
+// Heap held by one growable tracking table.
+typedef struct sm_state_table_usage {
+  const char *name;
+  int count;
+  int capacity;
+  size_t bytes;
+} sm_state_table_usage_t;
+
+// Open-addressing index from a 32-bit key hash to table entry indexes. Slots
+// keep the hash so resizing never touches the table; keys may repeat and
+// callers compare their own keys while walking candidates.
+typedef struct {
+  uint32_t hash;
+  // 0 = empty, SM_STATE_INDEX_TOMBSTONE = removed, otherwise entry + 1.
+  uint32_t value;
+} sm_state_index_slot_t;
+
+#define SM_STATE_INDEX_TOMBSTONE UINT32_MAX
+
+typedef struct sm_state_index {
+  sm_state_index_slot_t *slots;
+  uint32_t size;
+  // Live plus tombstone slots.
+  uint32_t used;
+  uint32_t live;
+} sm_state_index_t;
+
+// Return the per-table entry limit configured by state_soft_limit.
+int sm_state_soft_limit(void);
+// Grow a zero-filled table to at least needed entries; fails past the limit.
+bool sm_state_table_reserve(void **items, int *capacity, int needed,
+                            size_t entry_size);
+// Add entry under hash, resizing at 3/4 load (tombstones included).
+bool sm_state_index_insert(sm_state_index_t *index, uint32_t hash, int entry);
+// Remove entry under hash, leaving a tombstone.
+void sm_state_index_remove(sm_state_index_t *index, uint32_t hash, int entry);
+// Return the next entry stored under hash, or -1. Start with *cursor = 0.
+int sm_state_index_next(const sm_state_index_t *index, uint32_t hash,
+                        uint32_t *cursor);
+// Return the heap held by an index.
+size_t sm_state_index_bytes(const sm_state_index_t *index);
+// Return a counter that changes whenever any tracking table grows.
+uint32_t sm_state_table_growth_count(void);
+// Fill per-table usage (candidates may be NULL) and return total bytes.
+size_t collect_state_memory_usage(const scan_candidate_list_t *candidates,
+                                  sm_state_table_usage_t *out, int *count_out);
+// Log per-table entry counts and heap bytes against the soft limit.
+void log_state_memory_budget(const char *reason,
+                             const scan_candidate_list_t *candidates);
+
+#endif
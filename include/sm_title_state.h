@@ -4,6 +4,8 @@
 #include <stdbool.h>
 #include <stdint.h>
 
+typedef struct sm_state_table_usage sm_state_table_usage_t;
+
 // Return whether registration was already attempted for a title.
 bool was_register_attempted(const char *title_id);
 // Return the number of registration attempts for a title.
@@ -23,5 +25,7 @@ uint8_t get_failed_mount_attempts(const char *title_id);
 void clear_failed_mount_attempts(const char *title_id);
 // Increment and return failed install/remount attempts for a title.
 uint8_t bump_failed_mount_attempts(const char *title_id);
+// Report entries and heap held by the title state table.
+void title_state_memory_usage(sm_state_table_usage_t *out);
 
 #endif
@@ -116,14 +116,26 @@ typedef struct runtime_config {
   bool kstuff_game_auto_toggle;
   bool kstuff_crash_detection_enabled;
   bool legacy_recursive_scan_forced;
+  // Attach registered images only while their title runs (mount on launch).
+  bool image_mount_on_launch;
   char global_fakelib_path[MAX_PATH];
   uint32_t global_fakelib_exclude_title_count;
   char global_fakelib_exclude_title_ids[MAX_FAKELIB_EXCLUDE_RULES][MAX_TITLE_ID];
   uint32_t scan_depth;
+  uint32_t state_soft_limit;
   uint32_t scan_interval_us;
   uint32_t stability_wait_seconds;
   uint32_t kstuff_pause_delay_image_seconds;
   uint32_t kstuff_pause_delay_direct_seconds;
+  uint32_t image_idle_detach_seconds;
+  // Images attached in parallel during a scan (1 = one at a time).
+  uint32_t image_attach_workers;
+  // Parallel attaches allowed per backing device (USB drive, internal SSD).
+  uint32_t image_attach_per_device;
+  // Files copied in parallel while staging a title (1 = one at a time).
+  uint32_t copy_workers;
+  // Stage identical assets as hard links into the shared asset store.
+  bool asset_dedup;
   attach_backend_t exfat_backend;
   attach_backend_t ufs_backend;
   uint32_t lvd_sector_exfat;
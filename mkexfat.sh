@@ -93,4 +93,15 @@ rsync -r --info=progress2 "$INPUT_DIR"/ /mnt/exfat/
 
 umount /mnt/exfat
 
+# Optional: record which blocks hold data and drop the zeroed tail, so the
+# unused headroom is neither stored nor copied. Must run before smp_sidecar.
+if command -v smp_bitmap >/dev/null 2>&1; then
+    smp_bitmap --trim "$OUTPUT"
+fi
+
+# Optional: describe the image so ShadowMount+ can identify it unmounted.
+if command -v smp_sidecar >/dev/null 2>&1; then
+    smp_sidecar "$OUTPUT" "$INPUT_DIR"
+fi
+
 echo "Created $OUTPUT"
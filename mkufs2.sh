@@ -107,4 +107,15 @@ chmod -R 777 /mnt/*
 umount /mnt
 mdconfig -d -u ${MD}
 
+# Optional: record which blocks hold data and drop the zeroed tail, so the
+# unused headroom is neither stored nor copied. Must run before smp_sidecar.
+if command -v smp_bitmap >/dev/null 2>&1; then
+    smp_bitmap --trim "$OUTPUT"
+fi
+
+# Optional: describe the image so ShadowMount+ can identify it unmounted.
+if command -v smp_sidecar >/dev/null 2>&1; then
+    smp_sidecar "$OUTPUT" "$INPUT_DIR"
+fi
+
 echo "Created $OUTPUT"
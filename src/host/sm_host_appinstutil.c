@@ -0,0 +1,60 @@
+#include <sqlite3.h>
+#include <stdio.h>
+
+// Host stand-in for libSceAppInstUtil.sprx, loaded by sm_install.c through
+// dlopen(APP_INST_UTIL_SPRX_PATH). Registration becomes a row in the sandbox
+// app.db so later scan cycles see the title as installed.
+
+#define SCE_APP_INST_UTIL_RESTORED 0x80990002
+#define SCE_APP_INST_UTIL_FAILED (-1)
+
+int sceAppInstUtilAppInstallTitleDir(const char *title_id,
+                                     const char *install_path, void *reserved);
+
+int sceAppInstUtilAppInstallTitleDir(const char *title_id,
+                                     const char *install_path, void *reserved) {
+  (void)reserved;
+  if (!title_id || !install_path)
+    return SCE_APP_INST_UTIL_FAILED;
+
+  sqlite3 *db = NULL;
+  if (sqlite3_open_v2(SM_HOST_APP_DB_PATH, &db, SQLITE_OPEN_READWRITE, NULL) !=
+      SQLITE_OK) {
+    sqlite3_close(db);
+    return SCE_APP_INST_UTIL_FAILED;
+  }
+
+  int result = SCE_APP_INST_UTIL_FAILED;
+  sqlite3_stmt *stmt = NULL;
+  if (sqlite3_prepare_v2(db,
+                         "SELECT COUNT(*) FROM tbl_contentinfo "
+                         "WHERE titleId = ?1;",
+                         -1, &stmt, NULL) == SQLITE_OK &&
+      sqlite3_bind_text(stmt, 1, title_id, -1, SQLITE_STATIC) == SQLITE_OK &&
+      sqlite3_step(stmt) == SQLITE_ROW && sqlite3_column_int(stmt, 0) > 0) {
+    result = (int)SCE_APP_INST_UTIL_RESTORED;
+  }
+  sqlite3_finalize(stmt);
+  stmt = NULL;
+
+  if (result == SCE_APP_INST_UTIL_FAILED) {
+    char snd0_path[1024];
+    snprintf(snd0_path, sizeof(snd0_path), "%s%s/sce_sys/snd0.at9",
+             install_path, title_id);
+    if (sqlite3_prepare_v2(db,
+                           "INSERT INTO tbl_contentinfo "
+                           "(titleId, snd0Info, uninstallable) "
+                           "VALUES (?1, ?2, 1);",
+                           -1, &stmt, NULL) == SQLITE_OK &&
+        sqlite3_bind_text(stmt, 1, title_id, -1, SQLITE_STATIC) == SQLITE_OK &&
+        sqlite3_bind_text(stmt, 2, snd0_path, -1, SQLITE_STATIC) ==
+            SQLITE_OK &&
+        sqlite3_step(stmt) == SQLITE_DONE) {
+      result = 0;
+    }
+    sqlite3_finalize(stmt);
+  }
+
+  sqlite3_close(db);
+  return result;
+}
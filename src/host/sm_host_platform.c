@@ -0,0 +1,753 @@
+#include "sm_platform.h"
+
+#include <pthread.h>
+#include <sqlite3.h>
+#include <sys/statvfs.h>
+
+#include "sm_mount_defs.h"
+#include "sm_paths.h"
+#include "sm_types.h"
+
+// The host build routes ioctl() through sm_host_ioctl(); the real syscall is
+// needed here for the pass-through case.
+#undef ioctl
+
+#define HOST_MAX_DEV_UNITS 4096
+#define HOST_DEFAULT_FW_VERSION 0x09600000u
+
+#define HOST_COVERED_DIR SM_PATH_ROOT "/.host-covered"
+
+// A mounted tree is emulated by moving the mount-point directory aside and
+// replacing it with a directory of symlinks to the exposed content, so path
+// lookups through the mount point see the mounted files like on console.
+typedef struct {
+  struct statfs sfs;
+  char covered_path[MAX_PATH];
+  bool swapped;
+} host_mount_entry_t;
+
+typedef struct {
+  host_mount_entry_t *entries;
+  int count;
+  int capacity;
+  struct statfs *snapshot;
+  int snapshot_capacity;
+  uint64_t next_cover_id;
+} host_mount_table_t;
+
+static host_mount_table_t g_host_mounts;
+static pthread_mutex_t g_host_mounts_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t g_host_units_mutex = PTHREAD_MUTEX_INITIALIZER;
+static bool g_host_lvd_units[HOST_MAX_DEV_UNITS];
+static bool g_host_md_units[HOST_MAX_DEV_UNITS];
+
+size_t strlcpy(char *dst, const char *src, size_t size) {
+  size_t len = strlen(src);
+  if (size > 0) {
+    size_t n = len < size - 1 ? len : size - 1;
+    memcpy(dst, src, n);
+    dst[n] = '\0';
+  }
+  return len;
+}
+
+size_t strlcat(char *dst, const char *src, size_t size) {
+  size_t used = strnlen(dst, size);
+  if (used == size)
+    return size + strlen(src);
+  return used + strlcpy(dst + used, src, size - used);
+}
+
+static bool ensure_host_mount_capacity(int needed) {
+  if (needed <= g_host_mounts.capacity)
+    return true;
+  int capacity = g_host_mounts.capacity > 0 ? g_host_mounts.capacity : 64;
+  while (capacity < needed)
+    capacity *= 2;
+  host_mount_entry_t *entries =
+      realloc(g_host_mounts.entries, (size_t)capacity * sizeof(*entries));
+  if (!entries)
+    return false;
+  g_host_mounts.entries = entries;
+  g_host_mounts.capacity = capacity;
+  return true;
+}
+
+static void fill_host_fs_counters(const char *path, struct statfs *out) {
+  struct statvfs vfs;
+  if (statvfs(path, &vfs) != 0) {
+    out->f_bsize = 4096;
+    out->f_iosize = 4096;
+    return;
+  }
+  out->f_bsize = vfs.f_bsize;
+  out->f_iosize = vfs.f_bsize;
+  out->f_blocks = vfs.f_blocks;
+  out->f_bfree = vfs.f_bfree;
+  out->f_bavail = (int64_t)vfs.f_bavail;
+  out->f_files = vfs.f_files;
+  out->f_ffree = (int64_t)vfs.f_ffree;
+}
+
+// Lazily seed the table with the sandbox root so every path resolves to a
+// mount, like "/" does on console.
+static bool ensure_host_root_mount(void) {
+  if (g_host_mounts.count > 0)
+    return true;
+  if (!ensure_host_mount_capacity(1))
+    return false;
+  host_mount_entry_t *root = &g_host_mounts.entries[0];
+  memset(root, 0, sizeof(*root));
+  (void)strlcpy(root->sfs.f_fstypename, "hostfs",
+                sizeof(root->sfs.f_fstypename));
+  (void)strlcpy(root->sfs.f_mntfromname, "host",
+                sizeof(root->sfs.f_mntfromname));
+  (void)strlcpy(root->sfs.f_mntonname,
+                SM_PATH_ROOT[0] != '\0' ? SM_PATH_ROOT : "/",
+                sizeof(root->sfs.f_mntonname));
+  fill_host_fs_counters(root->sfs.f_mntonname, &root->sfs);
+  g_host_mounts.count = 1;
+  return true;
+}
+
+static bool path_is_under_mount(const char *path, const char *mount_point) {
+  size_t len = strlen(mount_point);
+  if (len == 1 && mount_point[0] == '/')
+    return path[0] == '/';
+  return strncmp(path, mount_point, len) == 0 &&
+         (path[len] == '\0' || path[len] == '/');
+}
+
+int statfs(const char *path, struct statfs *buf) {
+  struct stat st;
+  if (!path || !buf) {
+    errno = EINVAL;
+    return -1;
+  }
+  if (stat(path, &st) != 0)
+    return -1;
+
+  pthread_mutex_lock(&g_host_mounts_mutex);
+  if (!ensure_host_root_mount()) {
+    pthread_mutex_unlock(&g_host_mounts_mutex);
+    errno = ENOMEM;
+    return -1;
+  }
+  int best = 0;
+  size_t best_len = 0;
+  for (int i = 0; i < g_host_mounts.count; i++) {
+    const char *mnt = g_host_mounts.entries[i].sfs.f_mntonname;
+    size_t len = strlen(mnt);
+    // Later entries are stacked on top, so ties go to the newest mount.
+    if (len >= best_len && path_is_under_mount(path, mnt)) {
+      best = i;
+      best_len = len;
+    }
+  }
+  *buf = g_host_mounts.entries[best].sfs;
+  pthread_mutex_unlock(&g_host_mounts_mutex);
+  return 0;
+}
+
+int getmntinfo(struct statfs **mntbufp, int mode) {
+  (void)mode;
+  if (!mntbufp) {
+    errno = EINVAL;
+    return 0;
+  }
+
+  pthread_mutex_lock(&g_host_mounts_mutex);
+  if (!ensure_host_root_mount()) {
+    pthread_mutex_unlock(&g_host_mounts_mutex);
+    errno = ENOMEM;
+    return 0;
+  }
+  if (g_host_mounts.snapshot_capacity < g_host_mounts.count) {
+    struct statfs *snapshot =
+        realloc(g_host_mounts.snapshot,
+                (size_t)g_host_mounts.capacity * sizeof(*snapshot));
+    if (!snapshot) {
+      pthread_mutex_unlock(&g_host_mounts_mutex);
+      errno = ENOMEM;
+      return 0;
+    }
+    g_host_mounts.snapshot = snapshot;
+    g_host_mounts.snapshot_capacity = g_host_mounts.capacity;
+  }
+  int count = g_host_mounts.count;
+  for (int i = 0; i < count; i++)
+    g_host_mounts.snapshot[i] = g_host_mounts.entries[i].sfs;
+  *mntbufp = g_host_mounts.snapshot;
+  pthread_mutex_unlock(&g_host_mounts_mutex);
+  return count;
+}
+
+static const char *find_iov_value(struct iovec *iov, unsigned int niov,
+                                  const char *key) {
+  for (unsigned int i = 0; i + 1 < niov; i += 2) {
+    if (iov[i].iov_base && strcmp((const char *)iov[i].iov_base, key) == 0)
+      return (const char *)iov[i + 1].iov_base;
+  }
+  return NULL;
+}
+
+static bool is_host_dev_node(const char *path) {
+  return path &&
+         (strncmp(path, LVD_DEV_PREFIX, sizeof(LVD_DEV_PREFIX) - 1) == 0 ||
+          strncmp(path, MD_DEV_PREFIX, sizeof(MD_DEV_PREFIX) - 1) == 0);
+}
+
+// Resolve what a new mount exposes: nullfs shows its source directory, image
+// filesystems show the hidden ".<image name>.root" directory next to the
+// backing file (an empty tree when absent), unionfs layers are record-only.
+static bool resolve_host_mount_content(const char *fstype, const char *from,
+                                       char content[MAX_PATH]) {
+  content[0] = '\0';
+  if (strcmp(fstype, "unionfs") == 0 || !from)
+    return true;
+  if (strcmp(fstype, "nullfs") == 0) {
+    (void)strlcpy(content, from, MAX_PATH);
+    return true;
+  }
+  if (!is_host_dev_node(from))
+    return true;
+
+  char image_path[MAX_PATH];
+  ssize_t len = readlink(from, image_path, sizeof(image_path) - 1);
+  if (len < 0)
+    return false;
+  image_path[len] = '\0';
+  const char *slash = strrchr(image_path, '/');
+  if (!slash)
+    return true;
+  snprintf(content, MAX_PATH, "%.*s/.%s.root", (int)(slash - image_path),
+           image_path, slash + 1);
+  struct stat st;
+  if (stat(content, &st) != 0 || !S_ISDIR(st.st_mode))
+    content[0] = '\0';
+  return true;
+}
+
+static bool write_host_cover_record(const char *covered_path,
+                                    const char *fspath) {
+  char record_path[MAX_PATH];
+  snprintf(record_path, sizeof(record_path), "%s.path", covered_path);
+  FILE *f = fopen(record_path, "w");
+  if (!f)
+    return false;
+  bool ok = fputs(fspath, f) >= 0;
+  if (fclose(f) != 0)
+    ok = false;
+  return ok;
+}
+
+// Remove a mirror directory built by mirror_host_content(), including any
+// files the payload created inside the emulated mount.
+static void remove_host_tree(const char *path) {
+  DIR *d = opendir(path);
+  if (d) {
+    struct dirent *e;
+    while ((e = readdir(d)) != NULL) {
+      if (strcmp(e->d_name, ".") == 0 || strcmp(e->d_name, "..") == 0)
+        continue;
+      char child[MAX_PATH];
+      snprintf(child, sizeof(child), "%s/%s", path, e->d_name);
+      struct stat st;
+      if (lstat(child, &st) == 0 && S_ISDIR(st.st_mode))
+        remove_host_tree(child);
+      else
+        (void)unlink(child);
+    }
+    closedir(d);
+  }
+  (void)rmdir(path);
+}
+
+// The mount point stays a real directory (scanners rely on d_type); each
+// top-level content entry is exposed through a symlink inside it.
+static bool mirror_host_content(const char *fspath, const char *content) {
+  if (mkdir(fspath, 0777) != 0)
+    return false;
+  DIR *d = opendir(content);
+  if (!d)
+    return false;
+  bool ok = true;
+  struct dirent *e;
+  while (ok && (e = readdir(d)) != NULL) {
+    if (strcmp(e->d_name, ".") == 0 || strcmp(e->d_name, "..") == 0)
+      continue;
+    char target[MAX_PATH];
+    char link_path[MAX_PATH];
+    snprintf(target, sizeof(target), "%s/%s", content, e->d_name);
+    snprintf(link_path, sizeof(link_path), "%s/%s", fspath, e->d_name);
+    ok = symlink(target, link_path) == 0;
+  }
+  int saved_errno = errno;
+  closedir(d);
+  errno = saved_errno;
+  return ok;
+}
+
+static bool cover_host_mount_point(host_mount_entry_t *entry,
+                                   const char *content) {
+  snprintf(entry->covered_path, sizeof(entry->covered_path), "%s/%llu",
+           HOST_COVERED_DIR, (unsigned long long)++g_host_mounts.next_cover_id);
+  const char *fspath = entry->sfs.f_mntonname;
+  if (rename(fspath, entry->covered_path) != 0)
+    return false;
+  if (!mirror_host_content(fspath, content) ||
+      !write_host_cover_record(entry->covered_path, fspath)) {
+    int saved_errno = errno;
+    remove_host_tree(fspath);
+    (void)rename(entry->covered_path, fspath);
+    errno = saved_errno;
+    return false;
+  }
+  entry->swapped = true;
+  return true;
+}
+
+static void uncover_host_mount_point(const char *fspath,
+                                     const char *covered_path) {
+  remove_host_tree(fspath);
+  (void)rename(covered_path, fspath);
+  char record_path[MAX_PATH];
+  snprintf(record_path, sizeof(record_path), "%s.path", covered_path);
+  (void)unlink(record_path);
+}
+
+int nmount(struct iovec *iov, unsigned int niov, int flags) {
+  const char *fstype = find_iov_value(iov, niov, "fstype");
+  const char *from = find_iov_value(iov, niov, "from");
+  const char *fspath = find_iov_value(iov, niov, "fspath");
+  if (!fstype || !fspath) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  struct stat st;
+  if (stat(fspath, &st) != 0)
+    return -1;
+  if (!S_ISDIR(st.st_mode)) {
+    errno = ENOTDIR;
+    return -1;
+  }
+  // Device-backed mounts must name a node created by an emulated attach.
+  if (is_host_dev_node(from) && lstat(from, &st) != 0) {
+    errno = ENXIO;
+    return -1;
+  }
+
+  pthread_mutex_lock(&g_host_mounts_mutex);
+  if (!ensure_host_root_mount()) {
+    pthread_mutex_unlock(&g_host_mounts_mutex);
+    errno = ENOMEM;
+    return -1;
+  }
+
+  if (((uint64_t)flags & MNT_UPDATE) != 0) {
+    for (int i = g_host_mounts.count - 1; i >= 0; i--) {
+      struct statfs *sfs = &g_host_mounts.entries[i].sfs;
+      if (strcmp(sfs->f_mntonname, fspath) != 0)
+        continue;
+      sfs->f_flags = (uint64_t)flags & ~MNT_UPDATE;
+      pthread_mutex_unlock(&g_host_mounts_mutex);
+      return 0;
+    }
+    pthread_mutex_unlock(&g_host_mounts_mutex);
+    errno = EINVAL;
+    return -1;
+  }
+
+  char content[MAX_PATH];
+  if (!resolve_host_mount_content(fstype, from, content) ||
+      !ensure_host_mount_capacity(g_host_mounts.count + 1)) {
+    int saved_errno = errno != 0 ? errno : ENOMEM;
+    pthread_mutex_unlock(&g_host_mounts_mutex);
+    errno = saved_errno;
+    return -1;
+  }
+  host_mount_entry_t *entry = &g_host_mounts.entries[g_host_mounts.count];
+  memset(entry, 0, sizeof(*entry));
+  struct statfs *sfs = &entry->sfs;
+  sfs->f_flags = (uint64_t)flags;
+  (void)strlcpy(sfs->f_fstypename, fstype, sizeof(sfs->f_fstypename));
+  (void)strlcpy(sfs->f_mntfromname, from ? from : fstype,
+                sizeof(sfs->f_mntfromname));
+  (void)strlcpy(sfs->f_mntonname, fspath, sizeof(sfs->f_mntonname));
+  fill_host_fs_counters(fspath, sfs);
+  // Image filesystems report a cluster size that passes the sector check.
+  if (strcmp(fstype, "nullfs") != 0 && strcmp(fstype, "unionfs") != 0) {
+    sfs->f_bsize = 65536;
+    sfs->f_iosize = 65536;
+  }
+  if (content[0] != '\0' && !cover_host_mount_point(entry, content)) {
+    int saved_errno = errno;
+    pthread_mutex_unlock(&g_host_mounts_mutex);
+    errno = saved_errno;
+    return -1;
+  }
+  g_host_mounts.count++;
+  pthread_mutex_unlock(&g_host_mounts_mutex);
+  return 0;
+}
+
+int unmount(const char *path, int flags) {
+  (void)flags;
+  if (!path) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  pthread_mutex_lock(&g_host_mounts_mutex);
+  // Index 0 is the sandbox root and is never unmounted.
+  for (int i = g_host_mounts.count - 1; i > 0; i--) {
+    host_mount_entry_t *entry = &g_host_mounts.entries[i];
+    if (strcmp(entry->sfs.f_mntonname, path) != 0)
+      continue;
+    if (entry->swapped)
+      uncover_host_mount_point(path, entry->covered_path);
+    memmove(entry, entry + 1,
+            (size_t)(g_host_mounts.count - i - 1) * sizeof(*entry));
+    g_host_mounts.count--;
+    pthread_mutex_unlock(&g_host_mounts_mutex);
+    return 0;
+  }
+  pthread_mutex_unlock(&g_host_mounts_mutex);
+
+  struct stat st;
+  errno = stat(path, &st) == 0 ? EINVAL : ENOENT;
+  return -1;
+}
+
+// Emulated kernel state does not survive the process, so a new run starts
+// like a reboot: covered mount points are restored and device nodes removed.
+static void reset_host_kernel_state(void) {
+  DIR *d = opendir(HOST_COVERED_DIR);
+  if (d) {
+    struct dirent *e;
+    while ((e = readdir(d)) != NULL) {
+      size_t len = strlen(e->d_name);
+      if (len <= 5 || strcmp(e->d_name + len - 5, ".path") != 0)
+        continue;
+      char record_path[MAX_PATH];
+      char covered_path[MAX_PATH];
+      char fspath[MAX_PATH] = {0};
+      snprintf(record_path, sizeof(record_path), "%s/%s", HOST_COVERED_DIR,
+               e->d_name);
+      snprintf(covered_path, sizeof(covered_path), "%s/%.*s",
+               HOST_COVERED_DIR, (int)(len - 5), e->d_name);
+      FILE *f = fopen(record_path, "r");
+      if (!f)
+        continue;
+      bool have_path = fgets(fspath, sizeof(fspath), f) != NULL;
+      fclose(f);
+      if (have_path)
+        uncover_host_mount_point(fspath, covered_path);
+    }
+    closedir(d);
+  }
+
+  d = opendir(SM_PATH_ROOT "/dev");
+  if (d) {
+    struct dirent *e;
+    while ((e = readdir(d)) != NULL) {
+      char path[MAX_PATH];
+      snprintf(path, sizeof(path), SM_PATH_ROOT "/dev/%s", e->d_name);
+      if (is_host_dev_node(path) && strcmp(path, LVD_CTRL_PATH) != 0 &&
+          strcmp(path, MD_CTRL_PATH) != 0) {
+        (void)unlink(path);
+      }
+    }
+    closedir(d);
+  }
+}
+
+// SM_HOST_ATTACH_US delays every LVD/MD attach, standing in for the time the
+// kernel takes to attach a unit and create its device node.
+static void delay_host_attach(void) {
+  static int delay_us = -1;
+  if (delay_us < 0) {
+    const char *env = getenv("SM_HOST_ATTACH_US");
+    delay_us = (env && env[0] != '\0') ? atoi(env) : 0;
+    if (delay_us < 0)
+      delay_us = 0;
+  }
+  if (delay_us > 0)
+    usleep((useconds_t)delay_us);
+}
+
+static int attach_host_unit(bool *units, const char *prefix,
+                            const char *backing_path) {
+  delay_host_attach();
+  pthread_mutex_lock(&g_host_units_mutex);
+  int unit = -1;
+  for (int i = 0; i < HOST_MAX_DEV_UNITS; i++) {
+    if (!units[i]) {
+      unit = i;
+      break;
+    }
+  }
+  if (unit < 0) {
+    pthread_mutex_unlock(&g_host_units_mutex);
+    errno = EBUSY;
+    return -1;
+  }
+
+  char devname[MAX_PATH];
+  snprintf(devname, sizeof(devname), "%s%d", prefix, unit);
+  (void)unlink(devname);
+  if (symlink(backing_path, devname) != 0) {
+    pthread_mutex_unlock(&g_host_units_mutex);
+    return -1;
+  }
+  units[unit] = true;
+  pthread_mutex_unlock(&g_host_units_mutex);
+  return unit;
+}
+
+static int detach_host_unit(bool *units, const char *prefix, int unit) {
+  if (unit < 0 || unit >= HOST_MAX_DEV_UNITS) {
+    errno = EINVAL;
+    return -1;
+  }
+  pthread_mutex_lock(&g_host_units_mutex);
+  if (!units[unit]) {
+    pthread_mutex_unlock(&g_host_units_mutex);
+    errno = ENOENT;
+    return -1;
+  }
+  char devname[MAX_PATH];
+  snprintf(devname, sizeof(devname), "%s%d", prefix, unit);
+  (void)unlink(devname);
+  units[unit] = false;
+  pthread_mutex_unlock(&g_host_units_mutex);
+  return 0;
+}
+
+int sm_host_ioctl(int fd, unsigned long request, void *arg) {
+  if (request == SCE_LVD_IOC_ATTACH_V0) {
+    lvd_ioctl_attach_v0_t *req = (lvd_ioctl_attach_v0_t *)arg;
+    if (!req || req->layer_count == 0 || !req->layers_ptr ||
+        !req->layers_ptr[0].path) {
+      errno = EINVAL;
+      return -1;
+    }
+    for (uint32_t i = 0; i < req->layer_count; i++) {
+      const lvd_ioctl_layer_v0_t *layer = &req->layers_ptr[i];
+      struct stat st;
+      if (stat(layer->path, &st) != 0)
+        return -1;
+      if (layer->size > req->device_size) {
+        errno = EINVAL;
+        return -1;
+      }
+      if ((layer->flags & LVD_ENTRY_FLAG_NO_BITMAP) != 0)
+        continue;
+      if (!layer->bitmap_path || stat(layer->bitmap_path, &st) != 0 ||
+          layer->bitmap_size == 0 ||
+          layer->bitmap_offset + layer->bitmap_size > (uint64_t)st.st_size) {
+        errno = EINVAL;
+        return -1;
+      }
+    }
+    int unit = attach_host_unit(g_host_lvd_units, LVD_DEV_PREFIX,
+                                req->layers_ptr[0].path);
+    if (unit < 0)
+      return -1;
+    req->device_id = unit;
+    return 0;
+  }
+  if (request == SCE_LVD_IOC_DETACH) {
+    lvd_ioctl_detach_t *req = (lvd_ioctl_detach_t *)arg;
+    return req ? detach_host_unit(g_host_lvd_units, LVD_DEV_PREFIX,
+                                  req->device_id)
+               : (errno = EINVAL, -1);
+  }
+  if (request == MDIOCATTACH) {
+    struct md_ioctl *req = (struct md_ioctl *)arg;
+    struct stat st;
+    if (!req || !req->md_file) {
+      errno = EINVAL;
+      return -1;
+    }
+    if (stat(req->md_file, &st) != 0)
+      return -1;
+    int unit = attach_host_unit(g_host_md_units, MD_DEV_PREFIX, req->md_file);
+    if (unit < 0)
+      return -1;
+    req->md_unit = (unsigned)unit;
+    return 0;
+  }
+  if (request == MDIOCDETACH) {
+    struct md_ioctl *req = (struct md_ioctl *)arg;
+    return req ? detach_host_unit(g_host_md_units, MD_DEV_PREFIX,
+                                  (int)req->md_unit)
+               : (errno = EINVAL, -1);
+  }
+  return ioctl(fd, request, arg);
+}
+
+static bool mkdir_host_tree(const char *path) {
+  char buf[MAX_PATH];
+  if (strlcpy(buf, path, sizeof(buf)) >= sizeof(buf)) {
+    errno = ENAMETOOLONG;
+    return false;
+  }
+  for (char *p = buf + 1; *p != '\0'; p++) {
+    if (*p != '/')
+      continue;
+    *p = '\0';
+    if (mkdir(buf, 0777) != 0 && errno != EEXIST)
+      return false;
+    *p = '/';
+  }
+  return mkdir(buf, 0777) == 0 || errno == EEXIST;
+}
+
+static bool touch_host_file(const char *path) {
+  int fd = open(path, O_WRONLY | O_CREAT, 0666);
+  if (fd < 0)
+    return false;
+  close(fd);
+  return true;
+}
+
+static bool ensure_host_app_db(void) {
+  sqlite3 *db = NULL;
+  if (sqlite3_open_v2(APP_DB_PATH, &db,
+                      SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE,
+                      NULL) != SQLITE_OK) {
+    fprintf(stderr, "[HOST] app.db open failed: %s\n",
+            db ? sqlite3_errmsg(db) : APP_DB_PATH);
+    sqlite3_close(db);
+    return false;
+  }
+  char *err = NULL;
+  int rc = sqlite3_exec(db,
+                        "CREATE TABLE IF NOT EXISTS tbl_contentinfo ("
+                        "titleId TEXT NOT NULL, "
+                        "snd0Info TEXT, "
+                        "uninstallable INTEGER NOT NULL DEFAULT 1);",
+                        NULL, NULL, &err);
+  if (rc != SQLITE_OK)
+    fprintf(stderr, "[HOST] app.db schema failed: %s\n", err ? err : "?");
+  sqlite3_free(err);
+  sqlite3_close(db);
+  return rc == SQLITE_OK;
+}
+
+bool sm_host_platform_init(void) {
+  static const char *const dirs[] = {
+      SM_PATH_ROOT "/dev",
+      LOG_DIR,
+      APP_BASE,
+      APPMETA_BASE,
+      NOTIFY_ICON_DIR,
+      SYSTEM_EX_APP_BASE,
+      SYSTEM_APPMETA_BASE,
+      SM_PATH_ROOT "/system_data/priv/mms",
+      SM_PATH_ROOT "/system/common/lib",
+      IMAGE_MOUNT_BASE,
+      SANDBOX_BASE,
+      HOST_COVERED_DIR,
+  };
+  for (size_t i = 0; i < sizeof(dirs) / sizeof(dirs[0]); i++) {
+    if (!mkdir_host_tree(dirs[i])) {
+      fprintf(stderr, "[HOST] mkdir failed: %s (%s)\n", dirs[i],
+              strerror(errno));
+      return false;
+    }
+  }
+  reset_host_kernel_state();
+  if (!touch_host_file(LVD_CTRL_PATH) || !touch_host_file(MD_CTRL_PATH)) {
+    fprintf(stderr, "[HOST] control node create failed: %s\n",
+            strerror(errno));
+    return false;
+  }
+  return ensure_host_app_db();
+}
+
+uint32_t kernel_get_fw_version(void) {
+  const char *env = getenv("SM_HOST_FW_VERSION");
+  if (env && env[0] != '\0')
+    return (uint32_t)strtoul(env, NULL, 16);
+  return HOST_DEFAULT_FW_VERSION;
+}
+
+int kernel_set_ucred_authid(pid_t pid, uint64_t authid) {
+  (void)pid;
+  (void)authid;
+  return 0;
+}
+
+// SM_HOST_SLEEP_PERCENT scales payload sleeps (0 disables them) so fixed
+// settle delays do not dominate bench wall time.
+int sceKernelUsleep(unsigned int microseconds) {
+  static int percent = -1;
+  if (percent < 0) {
+    const char *env = getenv("SM_HOST_SLEEP_PERCENT");
+    percent = (env && env[0] != '\0') ? atoi(env) : 100;
+    if (percent < 0)
+      percent = 0;
+  }
+  uint64_t scaled = (uint64_t)microseconds * (uint64_t)percent / 100u;
+  if (scaled == 0)
+    return 0;
+  return usleep((useconds_t)scaled);
+}
+
+int sceKernelSendNotificationRequest(int device, notify_request_t *req,
+                                     size_t size, int blocking) {
+  (void)device;
+  (void)req;
+  (void)size;
+  (void)blocking;
+  return 0;
+}
+
+int sceNotificationSend(int user_id, bool is_logged, const char *payload);
+int sceNotificationSend(int user_id, bool is_logged, const char *payload) {
+  (void)user_id;
+  (void)is_logged;
+  (void)payload;
+  return 0;
+}
+
+int sceNotificationSendById(int user_id, bool logged_in,
+                            const char *use_case_id, const char *message);
+int sceNotificationSendById(int user_id, bool logged_in,
+                            const char *use_case_id, const char *message) {
+  (void)user_id;
+  (void)logged_in;
+  (void)use_case_id;
+  (void)message;
+  return 0;
+}
+
+int sceAppInstUtilInitialize(void) {
+  return 0;
+}
+
+int sceAppInstUtilAppInstallAll(void) {
+  return 0;
+}
+
+int sceAppInstUtilAppUnInstall(const char *title_id) {
+  (void)title_id;
+  return 0;
+}
+
+int sceKernelGetAppInfo(pid_t pid, app_info_t *info) {
+  (void)pid;
+  (void)info;
+  errno = ESRCH;
+  return -1;
+}
+
+int sceUserServiceInitialize(void *params) {
+  (void)params;
+  return 0;
+}
+
+void sceUserServiceTerminate(void) {}
@@ -0,0 +1,79 @@
+#include "sm_platform.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "sm_runtime.h"
+
+// Host counterpart of the runtime control surface in main.c. There is no
+// kill file, suspend or scanner thread here; the bench drives cycles itself.
+
+static atomic_bool g_host_stop_requested = false;
+static atomic_bool g_host_sleep_mode_active = false;
+static pthread_mutex_t g_host_mount_state_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t g_host_scan_now_mutex = PTHREAD_MUTEX_INITIALIZER;
+static char g_host_scan_now_reason[128];
+
+void install_signal_handlers(void) {}
+
+pid_t find_pid_by_name(const char *name, bool exclude_self) {
+  (void)name;
+  (void)exclude_self;
+  return 0;
+}
+
+bool should_stop_requested(void) {
+  return atomic_load_explicit(&g_host_stop_requested, memory_order_acquire);
+}
+
+void request_shutdown_stop(const char *reason) {
+  (void)reason;
+  atomic_store_explicit(&g_host_stop_requested, true, memory_order_release);
+}
+
+bool runtime_sleep_mode_active(void) {
+  return atomic_load_explicit(&g_host_sleep_mode_active, memory_order_acquire);
+}
+
+bool request_runtime_sleep_mode(bool active, const char *reason) {
+  (void)reason;
+  return atomic_exchange_explicit(&g_host_sleep_mode_active, active,
+                                  memory_order_acq_rel) != active;
+}
+
+void runtime_mount_state_lock(void) {
+  pthread_mutex_lock(&g_host_mount_state_mutex);
+}
+
+void runtime_mount_state_unlock(void) {
+  pthread_mutex_unlock(&g_host_mount_state_mutex);
+}
+
+void request_scan_now(const char *reason) {
+  pthread_mutex_lock(&g_host_scan_now_mutex);
+  if (g_host_scan_now_reason[0] == '\0') {
+    (void)strlcpy(g_host_scan_now_reason,
+                  (reason && reason[0] != '\0') ? reason : "unknown",
+                  sizeof(g_host_scan_now_reason));
+  }
+  pthread_mutex_unlock(&g_host_scan_now_mutex);
+}
+
+bool consume_scan_now_request(char *reason_out, size_t reason_out_size) {
+  if (reason_out && reason_out_size > 0)
+    reason_out[0] = '\0';
+  pthread_mutex_lock(&g_host_scan_now_mutex);
+  bool pending = g_host_scan_now_reason[0] != '\0';
+  if (pending && reason_out && reason_out_size > 0)
+    (void)strlcpy(reason_out, g_host_scan_now_reason, reason_out_size);
+  g_host_scan_now_reason[0] = '\0';
+  pthread_mutex_unlock(&g_host_scan_now_mutex);
+  return pending;
+}
+
+bool sleep_with_stop_check(unsigned int total_us) {
+  if (should_stop_requested())
+    return true;
+  usleep(total_us);
+  return should_stop_requested();
+}
@@ -20,6 +20,7 @@
 #include "sm_time.h"
 #include "sm_install.h"
 #include "sm_appdb.h"
+#include "sm_asset_store.h"
 #include "sm_limits.h"
 #include "sm_mdbg.h"
 #include "sm_paths.h"
@@ -476,7 +477,7 @@ int main(void) {
   if (!refresh_game_lifecycle_watcher())
     log_debug("  [GAME] lifecycle watcher unavailable");
 
-  if (mkdir("/system_ex/app", 0777) != 0 && errno != EEXIST) {
+  if (mkdir(SYSTEM_EX_APP_BASE, 0777) != 0 && errno != EEXIST) {
     log_debug("  [MOUNT] failed to create /system_ex/app: %s", strerror(errno));
   }
   if (remount_system_ex() != 0) {
@@ -503,6 +504,7 @@ int main(void) {
   cleanup_staged_mount_links();
   log_debug("[STARTUP] cleanup_duplicate_title_mounts begin");
   cleanup_duplicate_title_mounts();
+  asset_store_collect_garbage();
   if (!app_db_run_startup_maintenance())
     log_debug("  [DB] startup snd0info maintenance unavailable");
   log_debug("[STARTUP] scanner startup sync begin");
@@ -0,0 +1,178 @@
+#include "sm_platform.h"
+#include "sm_asset_store.h"
+
+#include <stdatomic.h>
+
+#include "sm_config_mount.h"
+#include "sm_filesystem.h"
+#include "sm_limits.h"
+#include "sm_log.h"
+#include "sm_paths.h"
+#include "sm_types.h"
+
+// Suffix of blobs being written; each writer uses its own sequence number so
+// parallel copy workers never share a temporary.
+static atomic_uint g_asset_temp_seq;
+
+static bool build_blob_paths(uint64_t hash, uint64_t size, char dir[MAX_PATH],
+                             char path[MAX_PATH]) {
+  int dir_written = snprintf(dir, MAX_PATH, "%s/%02x", ASSET_STORE_DIR,
+                             (unsigned)(hash >> 56));
+  int path_written = snprintf(path, MAX_PATH, "%s/%016llx-%llu", dir,
+                              (unsigned long long)hash,
+                              (unsigned long long)size);
+  return dir_written >= 0 && dir_written < MAX_PATH && path_written >= 0 &&
+         path_written < MAX_PATH;
+}
+
+static bool ensure_store_dir(const char *dir) {
+  if (mkdir(dir, 0777) == 0 || errno == EEXIST)
+    return true;
+  if (errno != ENOENT)
+    return false;
+  if ((mkdir(ASSET_STORE_DIR, 0777) != 0 && errno != EEXIST) ||
+      (mkdir(dir, 0777) != 0 && errno != EEXIST)) {
+    return false;
+  }
+  return true;
+}
+
+// Check that an existing blob holds the content of src. The name is only a
+// 64-bit hash and the size, so a reused blob is compared byte for byte.
+static bool blob_matches(const char *src, const char *blob_path,
+                         const struct stat *blob_st, uint64_t size) {
+  if (!S_ISREG(blob_st->st_mode) || (uint64_t)blob_st->st_size != size) {
+    errno = EEXIST;
+    return false;
+  }
+  if (sm_copy_files_equal(src, blob_path))
+    return true;
+  if (errno == 0) {
+    log_debug("  [ASSET] hash collision with %s: %s", blob_path, src);
+    errno = EEXIST;
+  }
+  return false;
+}
+
+// Make sure blob_path holds the content of src. The first writer of a blob
+// publishes it with link(); a writer that loses the race keeps the winner's.
+static bool fill_blob(const char *src, const char *blob_dir,
+                      const char *blob_path, uint64_t size,
+                      sm_copy_stats_t *stats) {
+  struct stat st;
+  if (lstat(blob_path, &st) == 0)
+    return blob_matches(src, blob_path, &st, size);
+  if (!ensure_store_dir(blob_dir))
+    return false;
+
+  char temp_path[MAX_PATH];
+  unsigned seq = atomic_fetch_add_explicit(&g_asset_temp_seq, 1u,
+                                           memory_order_relaxed);
+  int written = snprintf(temp_path, sizeof(temp_path), "%s.%u%s", blob_path,
+                         seq, COPY_TEMP_SUFFIX);
+  if (written < 0 || (size_t)written >= sizeof(temp_path)) {
+    errno = ENAMETOOLONG;
+    return false;
+  }
+  if (sm_copy_file_data(src, temp_path, 0, stats) != 0)
+    return false;
+  bool ok = link(temp_path, blob_path) == 0;
+  if (!ok && errno == EEXIST && lstat(blob_path, &st) == 0)
+    ok = blob_matches(src, blob_path, &st, size);
+  int saved_errno = errno;
+  (void)unlink(temp_path);
+  errno = saved_errno;
+  return ok;
+}
+
+static bool link_fallback_errno(int error) {
+  return error == EXDEV || error == EPERM || error == EMLINK ||
+         error == ENOTSUP || error == EOPNOTSUPP;
+}
+
+int asset_store_copy_file(const char *src, const char *dst,
+                          sm_copy_stats_t *stats) {
+  if (!runtime_config()->asset_dedup || copy_file_rewrites(src))
+    return copy_file(src, dst, stats);
+
+  struct stat src_st;
+  uint64_t hash = 0;
+  char blob_dir[MAX_PATH];
+  char blob_path[MAX_PATH];
+  if (stat(src, &src_st) != 0 || !S_ISREG(src_st.st_mode) ||
+      !sm_copy_hash_file(src, &hash) ||
+      !build_blob_paths(hash, (uint64_t)src_st.st_size, blob_dir, blob_path) ||
+      !fill_blob(src, blob_dir, blob_path, (uint64_t)src_st.st_size, stats)) {
+    log_debug("  [ASSET] store unavailable for %s: %s", src, strerror(errno));
+    return copy_file(src, dst, stats);
+  }
+  if (stats) {
+    stats->src_hashed = true;
+    stats->src_hash = hash;
+  }
+
+  if (unlink(dst) != 0 && errno != ENOENT)
+    return -1;
+  if (link(blob_path, dst) != 0) {
+    if (!link_fallback_errno(errno))
+      return -1;
+    return copy_file(src, dst, stats);
+  }
+  if (stats) {
+    stats->linked_files++;
+    stats->linked_bytes += (uint64_t)src_st.st_size;
+  }
+  return 0;
+}
+
+void asset_store_collect_garbage(void) {
+  DIR *store = opendir(ASSET_STORE_DIR);
+  if (!store)
+    return;
+  uint32_t removed = 0;
+  uint32_t kept = 0;
+  uint64_t removed_bytes = 0;
+  struct dirent *fan;
+  while ((fan = readdir(store))) {
+    if (fan->d_name[0] == '.')
+      continue;
+    char dir[MAX_PATH];
+    int written =
+        snprintf(dir, sizeof(dir), "%s/%s", ASSET_STORE_DIR, fan->d_name);
+    if (written < 0 || (size_t)written >= sizeof(dir))
+      continue;
+    DIR *d = opendir(dir);
+    if (!d)
+      continue;
+    struct dirent *e;
+    while ((e = readdir(d))) {
+      if (e->d_name[0] == '.')
+        continue;
+      char path[MAX_PATH];
+      struct stat st;
+      written = snprintf(path, sizeof(path), "%s/%s", dir, e->d_name);
+      if (written < 0 || (size_t)written >= sizeof(path) ||
+          lstat(path, &st) != 0) {
+        continue;
+      }
+      bool orphan = !S_ISREG(st.st_mode) || st.st_nlink <= 1 ||
+                    strstr(e->d_name, COPY_TEMP_SUFFIX) != NULL;
+      if (!orphan) {
+        kept++;
+        continue;
+      }
+      if (unlink(path) == 0) {
+        removed++;
+        removed_bytes += (uint64_t)st.st_size;
+      }
+    }
+    closedir(d);
+    // Only succeeds once the fan-out directory is empty.
+    (void)rmdir(dir);
+  }
+  closedir(store);
+  if (removed > 0 || kept > 0) {
+    log_debug("  [ASSET] store: kept=%u removed=%u freed=%llu KiB", kept,
+              removed, (unsigned long long)(removed_bytes / 1024u));
+  }
+}
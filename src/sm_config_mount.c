@@ -257,15 +257,22 @@ static void init_runtime_config_defaults(runtime_config_state_t *state) {
   state->cfg.kstuff_game_auto_toggle = true;
   state->cfg.kstuff_crash_detection_enabled = true;
   state->cfg.legacy_recursive_scan_forced = false;
+  state->cfg.image_mount_on_launch = false;
   (void)strlcpy(state->cfg.global_fakelib_path, DEFAULT_GLOBAL_FAKELIB_PATH,
                 sizeof(state->cfg.global_fakelib_path));
   state->cfg.scan_depth = DEFAULT_SCAN_DEPTH;
+  state->cfg.state_soft_limit = DEFAULT_STATE_SOFT_LIMIT;
   state->cfg.scan_interval_us = DEFAULT_SCAN_INTERVAL_US;
   state->cfg.stability_wait_seconds = DEFAULT_STABILITY_WAIT_SECONDS;
   state->cfg.kstuff_pause_delay_image_seconds =
       DEFAULT_KSTUFF_PAUSE_DELAY_IMAGE_SECONDS;
   state->cfg.kstuff_pause_delay_direct_seconds =
       DEFAULT_KSTUFF_PAUSE_DELAY_DIRECT_SECONDS;
+  state->cfg.image_idle_detach_seconds = DEFAULT_IMAGE_IDLE_DETACH_SECONDS;
+  state->cfg.image_attach_workers = DEFAULT_IMAGE_ATTACH_WORKERS;
+  state->cfg.image_attach_per_device = DEFAULT_IMAGE_ATTACH_PER_DEVICE;
+  state->cfg.copy_workers = DEFAULT_COPY_WORKERS;
+  state->cfg.asset_dedup = true;
   state->cfg.exfat_backend = default_exfat_backend();
   state->cfg.ufs_backend = default_ufs_backend();
   state->cfg.lvd_sector_exfat = LVD_SECTOR_SIZE_EXFAT;
@@ -1190,6 +1197,65 @@ static config_load_status_t load_runtime_config_state(runtime_config_state_t *st
       continue;
     }
 
+    if (strcasecmp(key, "image_mount_on_launch") == 0) {
+      if (!parse_bool_ini(value, &bval)) {
+        log_debug("  [CFG] invalid bool at line %d: %s=%s", line_no, key, value);
+        continue;
+      }
+      state->cfg.image_mount_on_launch = bval;
+      continue;
+    }
+
+    if (strcasecmp(key, "image_idle_detach_seconds") == 0 ||
+        strcasecmp(key, "image_idle_detach_sec") == 0) {
+      if (!parse_u32_ini(value, &u32) || u32 < MIN_IMAGE_IDLE_DETACH_SECONDS ||
+          u32 > MAX_IMAGE_IDLE_DETACH_SECONDS) {
+        log_debug("  [CFG] invalid image idle detach delay at line %d: %s=%s "
+                  "(range: %u..%u)",
+                  line_no, key, value, (unsigned)MIN_IMAGE_IDLE_DETACH_SECONDS,
+                  (unsigned)MAX_IMAGE_IDLE_DETACH_SECONDS);
+        continue;
+      }
+      state->cfg.image_idle_detach_seconds = u32;
+      continue;
+    }
+
+    if (strcasecmp(key, "image_attach_workers") == 0 ||
+        strcasecmp(key, "image_attach_per_device") == 0) {
+      if (!parse_u32_ini(value, &u32) || u32 < 1u ||
+          u32 > MAX_IMAGE_ATTACH_WORKERS) {
+        log_debug("  [CFG] invalid image attach concurrency at line %d: %s=%s "
+                  "(range: 1..%u)",
+                  line_no, key, value, (unsigned)MAX_IMAGE_ATTACH_WORKERS);
+        continue;
+      }
+      if (strcasecmp(key, "image_attach_workers") == 0)
+        state->cfg.image_attach_workers = u32;
+      else
+        state->cfg.image_attach_per_device = u32;
+      continue;
+    }
+
+    if (strcasecmp(key, "copy_workers") == 0) {
+      if (!parse_u32_ini(value, &u32) || u32 < 1u || u32 > MAX_COPY_WORKERS) {
+        log_debug("  [CFG] invalid copy workers at line %d: %s=%s "
+                  "(range: 1..%u)",
+                  line_no, key, value, (unsigned)MAX_COPY_WORKERS);
+        continue;
+      }
+      state->cfg.copy_workers = u32;
+      continue;
+    }
+
+    if (strcasecmp(key, "asset_dedup") == 0) {
+      if (!parse_bool_ini(value, &bval)) {
+        log_debug("  [CFG] invalid bool at line %d: %s=%s", line_no, key, value);
+        continue;
+      }
+      state->cfg.asset_dedup = bval;
+      continue;
+    }
+
     if (strcasecmp(key, "app_install_all") == 0) {
       if (!parse_bool_ini(value, &bval)) {
         log_debug("  [CFG] invalid bool at line %d: %s=%s", line_no, key, value);
@@ -1241,6 +1307,19 @@ static config_load_status_t load_runtime_config_state(runtime_config_state_t *st
       continue;
     }
 
+    if (strcasecmp(key, "state_soft_limit") == 0) {
+      if (!parse_u32_ini(value, &u32) || u32 < MIN_STATE_SOFT_LIMIT ||
+          u32 > MAX_STATE_SOFT_LIMIT) {
+        log_debug("  [CFG] invalid state soft limit at line %d: %s=%s "
+                  "(range: %u..%u)",
+                  line_no, key, value, (unsigned)MIN_STATE_SOFT_LIMIT,
+                  (unsigned)MAX_STATE_SOFT_LIMIT);
+        continue;
+      }
+      state->cfg.state_soft_limit = u32;
+      continue;
+    }
+
     if (strcasecmp(key, "backport_fakelib") == 0) {
       if (!parse_bool_ini(value, &bval)) {
         log_debug("  [CFG] invalid bool at line %d: %s=%s", line_no, key, value);
@@ -1485,12 +1564,14 @@ static config_load_status_t load_runtime_config_state(runtime_config_state_t *st
 
   log_debug("  [CFG] loaded: debug=%d quiet=%d ro=%d force=%d "
             "app_install_all=%d app_install_all_forced=%d scan_depth=%u "
-            "legacy_recursive_scan_forced=%d backport_fakelib=%d "
+            "state_soft_limit=%u legacy_recursive_scan_forced=%d backport_fakelib=%d "
             "global_fakelib=%d global_fakelib_priority=%s "
             "global_fakelib_path=%s global_fakelib_exclude=%u "
             "kstuff_game_auto_toggle=%d kstuff_crash_detection=%d "
             "kstuff_pause_delay_image_s=%u kstuff_pause_delay_direct_s=%u "
-            "exfat_backend=%s ufs_backend=%s "
+            "image_mount_on_launch=%d image_idle_detach_s=%u "
+            "image_attach_workers=%u image_attach_per_device=%u "
+            "copy_workers=%u asset_dedup=%d exfat_backend=%s ufs_backend=%s "
             "lvd_sec(exfat=%u ufs=%u pfs=%u) md_sec(exfat=%u ufs=%u) "
             "scan_interval_s=%u stability_wait_s=%u scan_paths=%d image_rules=%d "
             "kstuff_no_pause=%d kstuff_delay_rules=%d",
@@ -1499,6 +1580,7 @@ static config_load_status_t load_runtime_config_state(runtime_config_state_t *st
             state->cfg.force_mount ? 1 : 0,
             state->cfg.app_install_all_enabled ? 1 : 0,
             state->cfg.app_install_all_forced ? 1 : 0, state->cfg.scan_depth,
+            state->cfg.state_soft_limit,
             state->cfg.legacy_recursive_scan_forced ? 1 : 0,
             state->cfg.backport_fakelib_enabled ? 1 : 0,
             state->cfg.global_fakelib_enabled ? 1 : 0,
@@ -1509,6 +1591,11 @@ static config_load_status_t load_runtime_config_state(runtime_config_state_t *st
             state->cfg.kstuff_crash_detection_enabled ? 1 : 0,
             state->cfg.kstuff_pause_delay_image_seconds,
             state->cfg.kstuff_pause_delay_direct_seconds,
+            state->cfg.image_mount_on_launch ? 1 : 0,
+            state->cfg.image_idle_detach_seconds,
+            state->cfg.image_attach_workers,
+            state->cfg.image_attach_per_device, state->cfg.copy_workers,
+            state->cfg.asset_dedup ? 1 : 0,
             attach_backend_name(state->cfg.exfat_backend),
             attach_backend_name(state->cfg.ufs_backend),
             state->cfg.lvd_sector_exfat, state->cfg.lvd_sector_ufs,
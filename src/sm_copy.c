@@ -0,0 +1,427 @@
+#include "sm_platform.h"
+#include "sm_copy.h"
+
+#include <pthread.h>
+
+#include "sm_hash.h"
+#include "sm_limits.h"
+#include "sm_time.h"
+
+// The console kernel has no copy_file_range(2); host builds use it so the
+// bench can compare both paths.
+#if defined(SM_HOST_BUILD) && defined(__linux__)
+#define SM_COPY_HAVE_KERNEL_RANGE 1
+#endif
+
+static bool write_all_at(int fd, const uint8_t *buf, size_t len, off_t offset) {
+  size_t done = 0;
+  while (done < len) {
+    ssize_t n = pwrite(fd, buf + done, len - done, offset + (off_t)done);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0) {
+      if (n == 0)
+        errno = EIO;
+      return false;
+    }
+    done += (size_t)n;
+  }
+  return true;
+}
+
+// Copy [offset, end) through buf. A source that shrinks mid-copy fails with
+// EIO rather than leaving a short file behind.
+static bool copy_range_buffered(int src_fd, int dst_fd, off_t offset,
+                                off_t end, uint8_t *buf, size_t buf_size) {
+  while (offset < end) {
+    size_t want = (uint64_t)(end - offset) < buf_size
+                      ? (size_t)(end - offset)
+                      : buf_size;
+    ssize_t n = pread(src_fd, buf, want, offset);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0) {
+      if (n == 0)
+        errno = EIO;
+      return false;
+    }
+    if (!write_all_at(dst_fd, buf, (size_t)n, offset))
+      return false;
+    offset += n;
+  }
+  return true;
+}
+
+#ifdef SM_COPY_HAVE_KERNEL_RANGE
+// Returns false with errno set and copied_end at the first byte not copied;
+// EXDEV, ENOSYS, EINVAL and EOPNOTSUPP hand the rest to the buffered path.
+static bool copy_range_kernel(int src_fd, int dst_fd, off_t offset, off_t end,
+                              off_t *copied_end) {
+  *copied_end = offset;
+  while (offset < end) {
+    loff_t in_off = offset;
+    loff_t out_off = offset;
+    ssize_t n = copy_file_range(src_fd, &in_off, dst_fd, &out_off,
+                                (size_t)(end - offset), 0);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0) {
+      if (n == 0)
+        errno = EIO;
+      return false;
+    }
+    offset += n;
+    *copied_end = offset;
+  }
+  return true;
+}
+#endif
+
+// Find the next data region at or after offset; false once only a hole is
+// left. Where the filesystem cannot report holes the rest of the file is one
+// region.
+static bool next_data_region(int fd, off_t offset, off_t size, off_t *start_out,
+                             off_t *end_out) {
+  *start_out = offset;
+  *end_out = size;
+#ifdef SEEK_DATA
+  off_t start = lseek(fd, offset, SEEK_DATA);
+  if (start < 0)
+    return errno != ENXIO && offset < size;
+  off_t end = lseek(fd, start, SEEK_HOLE);
+  *start_out = start;
+  *end_out = end < 0 || end > size ? size : end;
+  return start < size;
+#else
+  (void)fd;
+  return offset < size;
+#endif
+}
+
+static uint8_t *alloc_copy_buffer(off_t file_size, size_t *size_out) {
+  size_t size = COPY_BUFFER_SIZE;
+  if (file_size < (off_t)COPY_BUFFER_SIZE) {
+    size = ((size_t)file_size + COPY_BUFFER_ALIGN - 1u) &
+           ~(size_t)(COPY_BUFFER_ALIGN - 1u);
+    if (size == 0)
+      size = COPY_BUFFER_ALIGN;
+  }
+  void *buf = NULL;
+  if (posix_memalign(&buf, COPY_BUFFER_ALIGN, size) != 0)
+    return NULL;
+  *size_out = size;
+  return (uint8_t *)buf;
+}
+
+static bool copy_file_regions(int src_fd, int dst_fd, off_t size,
+                              unsigned flags, uint64_t *data_bytes_out) {
+  uint8_t *buf = NULL;
+  size_t buf_size = 0;
+  bool use_kernel = false;
+#ifdef SM_COPY_HAVE_KERNEL_RANGE
+  use_kernel = (flags & SM_COPY_FLAG_NO_KERNEL) == 0;
+#else
+  (void)flags;
+#endif
+
+  bool ok = true;
+  uint64_t data_bytes = 0;
+  off_t offset = 0;
+  off_t start;
+  off_t end;
+  while (ok && next_data_region(src_fd, offset, size, &start, &end)) {
+    off_t from = start;
+#ifdef SM_COPY_HAVE_KERNEL_RANGE
+    if (use_kernel) {
+      if (copy_range_kernel(src_fd, dst_fd, start, end, &from)) {
+        data_bytes += (uint64_t)(end - start);
+        offset = end;
+        continue;
+      }
+      if (errno != EXDEV && errno != ENOSYS && errno != EINVAL &&
+          errno != EOPNOTSUPP) {
+        ok = false;
+        break;
+      }
+      use_kernel = false;
+    }
+#endif
+    if (!buf && !(buf = alloc_copy_buffer(size, &buf_size))) {
+      errno = ENOMEM;
+      ok = false;
+      break;
+    }
+    ok = copy_range_buffered(src_fd, dst_fd, from, end, buf, buf_size);
+    data_bytes += (uint64_t)(end - start);
+    offset = end;
+  }
+  free(buf);
+  *data_bytes_out = data_bytes;
+  return ok;
+}
+
+int sm_copy_file_data(const char *src, const char *dst, unsigned flags,
+                      sm_copy_stats_t *stats) {
+  uint64_t start_us = monotonic_time_us();
+  int src_fd = open(src, O_RDONLY);
+  if (src_fd < 0)
+    return -1;
+  struct stat st;
+  if (fstat(src_fd, &st) != 0) {
+    int saved_errno = errno;
+    close(src_fd);
+    errno = saved_errno;
+    return -1;
+  }
+  int dst_fd = open(dst, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+  if (dst_fd < 0) {
+    int saved_errno = errno;
+    close(src_fd);
+    errno = saved_errno;
+    return -1;
+  }
+
+  // Regions are written at their source offsets; the final ftruncate covers
+  // a trailing hole.
+  uint64_t data_bytes = 0;
+  bool ok =
+      copy_file_regions(src_fd, dst_fd, st.st_size, flags, &data_bytes) &&
+      ftruncate(dst_fd, st.st_size) == 0;
+  int saved_errno = errno;
+  if (close(dst_fd) != 0 && ok) {
+    ok = false;
+    saved_errno = errno;
+  }
+  close(src_fd);
+  if (!ok) {
+    (void)unlink(dst);
+    errno = saved_errno;
+    return -1;
+  }
+
+  if (stats) {
+    stats->files++;
+    stats->bytes += data_bytes;
+    stats->hole_bytes += (uint64_t)st.st_size - data_bytes;
+    stats->elapsed_us += monotonic_time_us() - start_us;
+  }
+  return 0;
+}
+
+uint64_t sm_copy_stats_bytes_per_sec(const sm_copy_stats_t *stats) {
+  if (stats->elapsed_us == 0)
+    return 0;
+  return (uint64_t)((double)stats->bytes * 1000000.0 /
+                    (double)stats->elapsed_us);
+}
+
+bool sm_copy_hash_file(const char *path, uint64_t *hash_out) {
+  int fd = open(path, O_RDONLY);
+  if (fd < 0)
+    return false;
+  uint8_t *buf = (uint8_t *)malloc(COPY_BUFFER_ALIGN);
+  uint64_t hash = SM_FNV1A64_INIT;
+  bool ok = buf != NULL;
+  while (ok) {
+    ssize_t n = read(fd, buf, COPY_BUFFER_ALIGN);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0) {
+      ok = n == 0;
+      break;
+    }
+    hash = sm_fnv1a64_update(hash, buf, (size_t)n);
+  }
+  free(buf);
+  close(fd);
+  *hash_out = hash;
+  return ok;
+}
+
+static ssize_t read_full(int fd, uint8_t *buf, size_t len) {
+  size_t done = 0;
+  while (done < len) {
+    ssize_t n = read(fd, buf + done, len - done);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n < 0)
+      return -1;
+    if (n == 0)
+      break;
+    done += (size_t)n;
+  }
+  return (ssize_t)done;
+}
+
+bool sm_copy_files_equal(const char *a, const char *b) {
+  int fd_a = open(a, O_RDONLY);
+  if (fd_a < 0)
+    return false;
+  int fd_b = open(b, O_RDONLY);
+  if (fd_b < 0) {
+    int saved_errno = errno;
+    close(fd_a);
+    errno = saved_errno;
+    return false;
+  }
+  uint8_t *buf = (uint8_t *)malloc(2u * COPY_BUFFER_ALIGN);
+  bool equal = buf != NULL;
+  int error = equal ? 0 : ENOMEM;
+  while (equal) {
+    ssize_t n_a = read_full(fd_a, buf, COPY_BUFFER_ALIGN);
+    ssize_t n_b = read_full(fd_b, buf + COPY_BUFFER_ALIGN, COPY_BUFFER_ALIGN);
+    if (n_a < 0 || n_b < 0) {
+      error = errno;
+      equal = false;
+      break;
+    }
+    if (n_a != n_b || memcmp(buf, buf + COPY_BUFFER_ALIGN, (size_t)n_a) != 0)
+      equal = false;
+    if (n_a == 0)
+      break;
+  }
+  free(buf);
+  close(fd_a);
+  close(fd_b);
+  errno = error;
+  return equal;
+}
+
+// --- Copy batches ---
+typedef struct {
+  sm_copy_job_t *jobs;
+  int count;
+  sm_copy_file_fn copy_fn;
+  unsigned flags;
+  pthread_mutex_t mutex;
+  int next;
+  bool failed;
+  int error;
+  sm_copy_stats_t stats;
+} copy_batch_t;
+
+static bool build_copy_temp_path(const char *dst, char out[MAX_PATH]) {
+  int written = snprintf(out, MAX_PATH, "%s%s", dst, COPY_TEMP_SUFFIX);
+  return written >= 0 && written < MAX_PATH;
+}
+
+static bool run_copy_job(const copy_batch_t *batch, sm_copy_job_t *job,
+                         sm_copy_stats_t *stats) {
+  char temp_path[MAX_PATH];
+  const char *target = job->dst;
+  if (batch->flags & SM_COPY_JOB_ATOMIC) {
+    if (!build_copy_temp_path(job->dst, temp_path)) {
+      errno = ENAMETOOLONG;
+      return false;
+    }
+    target = temp_path;
+  }
+  struct stat st;
+  if (batch->copy_fn(job->src, target, stats) != 0)
+    return false;
+  if (stats->src_hashed)
+    job->src_hash = stats->src_hash;
+  if (stat(target, &st) != 0 ||
+      ((batch->flags & SM_COPY_JOB_HASH_SOURCE) && !stats->src_hashed &&
+       !sm_copy_hash_file(job->src, &job->src_hash))) {
+    int saved_errno = errno;
+    (void)unlink(target);
+    errno = saved_errno;
+    return false;
+  }
+  job->dst_size = (uint64_t)st.st_size;
+  return true;
+}
+
+static void *copy_batch_worker_main(void *arg) {
+  copy_batch_t *batch = (copy_batch_t *)arg;
+  pthread_mutex_lock(&batch->mutex);
+  while (!batch->failed && batch->next < batch->count) {
+    sm_copy_job_t *job = &batch->jobs[batch->next++];
+    pthread_mutex_unlock(&batch->mutex);
+    sm_copy_stats_t stats;
+    memset(&stats, 0, sizeof(stats));
+    bool ok = run_copy_job(batch, job, &stats);
+    int error = errno;
+    pthread_mutex_lock(&batch->mutex);
+    batch->stats.files += stats.files;
+    batch->stats.bytes += stats.bytes;
+    batch->stats.hole_bytes += stats.hole_bytes;
+    batch->stats.linked_files += stats.linked_files;
+    batch->stats.linked_bytes += stats.linked_bytes;
+    if (!ok && !batch->failed) {
+      batch->failed = true;
+      batch->error = error;
+    }
+  }
+  pthread_mutex_unlock(&batch->mutex);
+  return NULL;
+}
+
+// Drop the temporaries of an atomic batch that did not finish.
+static void remove_copy_temps(const copy_batch_t *batch) {
+  char temp_path[MAX_PATH];
+  for (int i = 0; i < batch->count; i++) {
+    if (build_copy_temp_path(batch->jobs[i].dst, temp_path))
+      (void)unlink(temp_path);
+  }
+}
+
+bool sm_copy_run_jobs(sm_copy_job_t *jobs, int count, unsigned workers,
+                      sm_copy_file_fn copy_fn, unsigned job_flags,
+                      sm_copy_stats_t *stats) {
+  if (count <= 0)
+    return true;
+  uint64_t start_us = monotonic_time_us();
+  copy_batch_t batch;
+  memset(&batch, 0, sizeof(batch));
+  batch.jobs = jobs;
+  batch.count = count;
+  batch.copy_fn = copy_fn;
+  batch.flags = job_flags;
+  pthread_mutex_init(&batch.mutex, NULL);
+
+  if (workers > MAX_COPY_WORKERS)
+    workers = MAX_COPY_WORKERS;
+  if (workers > (unsigned)count)
+    workers = (unsigned)count;
+  pthread_t threads[MAX_COPY_WORKERS];
+  unsigned started = 0;
+  // The caller is one of the workers; a thread that fails to start only
+  // narrows the batch.
+  while (started + 1u < workers &&
+         pthread_create(&threads[started], NULL, copy_batch_worker_main,
+                        &batch) == 0) {
+    started++;
+  }
+  (void)copy_batch_worker_main(&batch);
+  for (unsigned i = 0; i < started; i++)
+    pthread_join(threads[i], NULL);
+  pthread_mutex_destroy(&batch.mutex);
+
+  bool ok = !batch.failed;
+  if (ok && (job_flags & SM_COPY_JOB_ATOMIC)) {
+    char temp_path[MAX_PATH];
+    for (int i = 0; ok && i < count; i++) {
+      if (!build_copy_temp_path(jobs[i].dst, temp_path) ||
+          rename(temp_path, jobs[i].dst) != 0) {
+        batch.error = errno;
+        ok = false;
+      }
+    }
+  }
+  if (!ok && (job_flags & SM_COPY_JOB_ATOMIC))
+    remove_copy_temps(&batch);
+
+  if (stats) {
+    stats->files += batch.stats.files;
+    stats->bytes += batch.stats.bytes;
+    stats->hole_bytes += batch.stats.hole_bytes;
+    stats->linked_files += batch.stats.linked_files;
+    stats->linked_bytes += batch.stats.linked_bytes;
+    stats->elapsed_us += monotonic_time_us() - start_us;
+  }
+  if (!ok)
+    errno = batch.error;
+  return ok;
+}
@@ -3,6 +3,8 @@
 #include "sm_fakelib.h"
 #include "sm_config_mount.h"
 #include "sm_log.h"
+#include "sm_mount_table.h"
+#include "sm_paths.h"
 #include "sm_types.h"
 
 #include <pthread.h>
@@ -39,7 +41,7 @@ static bool mount_fakelib_overlay(const char *title_id,
       IOVEC_ENTRY("notime"), IOVEC_ENTRY(NULL),
       IOVEC_ENTRY("fnodup"), IOVEC_ENTRY(NULL)};
 
-  if (nmount(overlay_iov, IOVEC_SIZE(overlay_iov), 0) == 0) {
+  if (mount_table_nmount(overlay_iov, IOVEC_SIZE(overlay_iov), 0) == 0) {
     log_debug("  [FAKELIB] %s libraries mounted for %s: %s -> %s", label,
               title_id, source_path, mount_path);
     return true;
@@ -52,7 +54,7 @@ static bool mount_fakelib_overlay(const char *title_id,
 
 static bool unmount_fakelib_overlay(const fakelib_layer_t *layer) {
   const char *mount_path = layer->mount_path;
-  if (unmount(mount_path, MNT_FORCE) == 0 || errno == ENOENT ||
+  if (mount_table_unmount(mount_path, MNT_FORCE) == 0 || errno == ENOENT ||
       errno == EINVAL) {
     log_debug("  [FAKELIB] %s libraries unmounted: %s -> %s", layer->label,
               layer->source_path, mount_path);
@@ -85,7 +87,7 @@ static bool resolve_sandbox_context(const char *title_id,
   mount_path[0] = '\0';
 
   char sandbox_id[MAX_TITLE_ID];
-  DIR *d = opendir("/mnt/sandbox");
+  DIR *d = opendir(SANDBOX_BASE);
   if (!d)
     return false;
 
@@ -125,20 +127,20 @@ static bool resolve_sandbox_context(const char *title_id,
     return false;
 
   char source_path[MAX_PATH];
-  snprintf(source_path, sizeof(source_path), "/mnt/sandbox/%s/app0/fakelib2",
+  snprintf(source_path, sizeof(source_path), SANDBOX_BASE "/%s/app0/fakelib2",
            sandbox_id);
   struct stat st;
   if (stat(source_path, &st) == 0 && S_ISDIR(st.st_mode)) {
     (void)strlcpy(game_source_path, source_path, MAX_PATH);
   } else {
-    snprintf(source_path, sizeof(source_path), "/mnt/sandbox/%s/app0/fakelib",
+    snprintf(source_path, sizeof(source_path), SANDBOX_BASE "/%s/app0/fakelib",
              sandbox_id);
     if (stat(source_path, &st) == 0 && S_ISDIR(st.st_mode))
       (void)strlcpy(game_source_path, source_path, MAX_PATH);
   }
 
   char sandbox_root[MAX_PATH];
-  snprintf(sandbox_root, sizeof(sandbox_root), "/mnt/sandbox/%s", sandbox_id);
+  snprintf(sandbox_root, sizeof(sandbox_root), SANDBOX_BASE "/%s", sandbox_id);
   d = opendir(sandbox_root);
   if (!d)
     return false;
@@ -6,8 +6,13 @@
 #include "sm_log.h"
 #include "sm_image_cache.h"
 #include "sm_image.h"
+#include "sm_image_ondemand.h"
+#include "sm_mount_device.h"
+#include "sm_mount_table.h"
 #include "sm_path_utils.h"
 #include "sm_paths.h"
+#include "sm_stage_manifest.h"
+#include "sm_time.h"
 
 // --- FILESYSTEM ---
 bool is_installed(const char *title_id) {
@@ -26,7 +31,7 @@ bool has_appmeta_data(const char *title_id) {
 
 bool is_data_mounted(const char *title_id) {
   char path[MAX_PATH];
-  snprintf(path, sizeof(path), "/system_ex/app/%s/sce_sys/param.json",
+  snprintf(path, sizeof(path), SYSTEM_EX_APP_BASE "/%s/sce_sys/param.json",
            title_id);
   return path_exists(path);
 }
@@ -171,7 +176,7 @@ static bool source_path_needs_cleanup(const char *source_path,
 
   if (!path_exists(source_path))
     return true;
-  if (path_matches_root_or_child(source_path, "/system_ex/app"))
+  if (path_matches_root_or_child(source_path, SYSTEM_EX_APP_BASE))
     return true;
 
   char eboot_path[MAX_PATH];
@@ -198,7 +203,10 @@ static bool resolve_mount_image_source_path(const title_link_paths_t *paths,
     return false;
 
   if (read_mount_link_file(paths->mount_image_link, image_source_path, MAX_PATH)) {
-    (void)cache_image_source_mapping(image_source_path, source_path);
+    // A parked image has no mapping on purpose; caching one would make stale
+    // image cleanup remount it.
+    if (!sm_image_ondemand_is_parked(image_source_path))
+      (void)cache_image_source_mapping(image_source_path, source_path);
     return true;
   }
 
@@ -209,7 +217,6 @@ static bool resolve_mount_image_source_path(const title_link_paths_t *paths,
 static bool cleanup_staged_mount_links_entry(const char *title_id,
                                              const title_link_paths_t *paths,
                                              void *ctx) {
-  (void)title_id;
   (void)ctx;
 
   struct stat staged_st;
@@ -262,6 +269,17 @@ static bool cleanup_staged_mount_links_entry(const char *title_id,
                             sizeof(image_source_path))) {
     return true;
   }
+  if (sm_image_ondemand_enabled() && path_exists(image_source_path)) {
+    char mount_point[MAX_PATH];
+    get_image_mount_point_for_source(image_source_path, mount_point);
+    // A parked title stays launchable through its stub; without one the
+    // image is mounted again like any other.
+    if (!is_active_image_mount_point(mount_point) &&
+        mount_title_launch_stub(title_id)) {
+      sm_image_ondemand_note_parked(title_id, image_source_path);
+      return true;
+    }
+  }
   if (!cache_image_source_mapping(image_source_path, source_path)) {
     log_debug("  [LINK] image source cache warmup failed: %s -> %s",
               source_path, image_source_path);
@@ -279,28 +297,7 @@ static bool get_top_mount(const char *path, struct statfs *mount_st_out) {
       strcmp(mount_st_out->f_mntonname, path) == 0) {
     return true;
   }
-
-  struct statfs *mntbuf = NULL;
-  int mntcount = getmntinfo(&mntbuf, MNT_NOWAIT);
-  if (mntcount <= 0 || !mntbuf)
-    return false;
-
-  const struct statfs *best_mount = NULL;
-  for (int i = 0; i < mntcount; i++) {
-    if (strcmp(mntbuf[i].f_mntonname, path) != 0)
-      continue;
-    if (!best_mount ||
-        (strcmp(mntbuf[i].f_fstypename, "unionfs") == 0 &&
-         strcmp(best_mount->f_fstypename, "unionfs") != 0)) {
-      best_mount = &mntbuf[i];
-    }
-  }
-
-  if (!best_mount)
-    return false;
-
-  *mount_st_out = *best_mount;
-  return true;
+  return mount_table_find_top(path, mount_st_out);
 }
 
 typedef enum {
@@ -308,13 +305,16 @@ typedef enum {
   TITLE_STACK_TOP_OTHER,
   TITLE_STACK_TOP_NULLFS,
   TITLE_STACK_TOP_BACKPORT,
+  TITLE_STACK_TOP_LAUNCH_STUB,
 } title_stack_top_kind_t;
 
 typedef struct {
   bool mounted;
+  // Set for the launch stub too: a stack holding it is ours.
   bool has_our_nullfs;
   bool has_nullfs_from_root;
   bool has_our_backport;
+  bool has_launch_stub;
   bool top_is_our_nullfs;
   int our_nullfs_count;
   int our_backport_count;
@@ -345,12 +345,75 @@ static bool path_is_managed_backport_for_title(const char *title_id,
   return false;
 }
 
+static bool build_title_launch_stub_path(const char *title_id,
+                                         char out[MAX_PATH]) {
+  int written = snprintf(out, MAX_PATH, "%s/%s", LAUNCH_STUB_DIR, title_id);
+  return written >= 0 && written < MAX_PATH;
+}
+
+static bool is_title_launch_stub(const char *title_id, const char *path) {
+  char stub_path[MAX_PATH];
+  return build_title_launch_stub_path(title_id, stub_path) &&
+         strcmp(path, stub_path) == 0;
+}
+
+typedef struct {
+  const char *title_id;
+  const char *source_path;
+  const char *source_root;
+  title_mount_state_t *state;
+  struct statfs best_mount;
+  bool has_best_mount;
+} title_stack_scan_t;
+
+static bool visit_title_stack_entry(const struct statfs *entry, void *ctx) {
+  title_stack_scan_t *scan = (title_stack_scan_t *)ctx;
+  title_mount_state_t *state = scan->state;
+  if (!scan->has_best_mount ||
+      (strcmp(entry->f_fstypename, "unionfs") == 0 &&
+       strcmp(scan->best_mount.f_fstypename, "unionfs") != 0)) {
+    scan->best_mount = *entry;
+    scan->has_best_mount = true;
+  }
+
+  if (strcmp(entry->f_fstypename, "nullfs") == 0) {
+    if (scan->source_path && scan->source_path[0] != '\0' &&
+        strcmp(entry->f_mntfromname, scan->source_path) == 0) {
+      state->has_our_nullfs = true;
+      state->our_nullfs_count++;
+    } else if (is_title_launch_stub(scan->title_id, entry->f_mntfromname)) {
+      state->has_our_nullfs = true;
+      state->has_launch_stub = true;
+    }
+    if (scan->source_root && scan->source_root[0] != '\0' &&
+        path_matches_root_or_child(entry->f_mntfromname, scan->source_root)) {
+      state->has_nullfs_from_root = true;
+    }
+    return true;
+  }
+
+  if (strcmp(entry->f_fstypename, "unionfs") == 0 &&
+      path_is_managed_backport_for_title(scan->title_id,
+                                         entry->f_mntfromname)) {
+    state->has_our_backport = true;
+    state->our_backport_count++;
+  }
+  return true;
+}
+
+static bool log_title_stack_entry(const struct statfs *entry, void *ctx) {
+  log_debug("  [LINK] mount entry for %s: type=%s from=%s flags=0x%lX",
+            (const char *)ctx, entry->f_fstypename, entry->f_mntfromname,
+            (unsigned long)entry->f_flags);
+  return true;
+}
+
 static bool inspect_title_stack(const char *title_id, const char *source_path,
                                 const char *source_root,
                                 title_mount_state_t *state_out) {
   memset(state_out, 0, sizeof(*state_out));
   snprintf(state_out->system_ex_path, sizeof(state_out->system_ex_path),
-           "/system_ex/app/%s", title_id);
+           SYSTEM_EX_APP_BASE "/%s", title_id);
 
   struct statfs statfs_mount;
   bool statfs_ok = false;
@@ -363,49 +426,20 @@ static bool inspect_title_stack(const char *title_id, const char *source_path,
     inspect_errno = errno;
   }
 
-  struct statfs *mntbuf = NULL;
-  int mntcount = getmntinfo(&mntbuf, MNT_NOWAIT);
-  const struct statfs *best_mount = NULL;
-  bool found_mount_entry = false;
-  if (mntcount > 0 && mntbuf) {
-    for (int i = 0; i < mntcount; i++) {
-      if (strcmp(mntbuf[i].f_mntonname, state_out->system_ex_path) != 0)
-        continue;
-
-      found_mount_entry = true;
-      if (!best_mount ||
-          (strcmp(mntbuf[i].f_fstypename, "unionfs") == 0 &&
-           strcmp(best_mount->f_fstypename, "unionfs") != 0)) {
-        best_mount = &mntbuf[i];
-      }
-
-      if (strcmp(mntbuf[i].f_fstypename, "nullfs") == 0) {
-        if (source_path && source_path[0] != '\0' &&
-            strcmp(mntbuf[i].f_mntfromname, source_path) == 0) {
-          state_out->has_our_nullfs = true;
-          state_out->our_nullfs_count++;
-        }
-        if (source_root && source_root[0] != '\0' &&
-            path_matches_root_or_child(mntbuf[i].f_mntfromname, source_root)) {
-          state_out->has_nullfs_from_root = true;
-        }
-        continue;
-      }
-
-      if (strcmp(mntbuf[i].f_fstypename, "unionfs") == 0 &&
-          path_is_managed_backport_for_title(title_id,
-                                             mntbuf[i].f_mntfromname)) {
-        state_out->has_our_backport = true;
-        state_out->our_backport_count++;
-      }
-    }
-  }
+  title_stack_scan_t scan;
+  memset(&scan, 0, sizeof(scan));
+  scan.title_id = title_id;
+  scan.source_path = source_path;
+  scan.source_root = source_root;
+  scan.state = state_out;
+  int entry_count = mount_table_for_each_on(state_out->system_ex_path,
+                                            visit_title_stack_entry, &scan);
 
   const struct statfs *top_mount = NULL;
   if (statfs_ok) {
     top_mount = &statfs_mount;
-  } else if (best_mount) {
-    top_mount = best_mount;
+  } else if (scan.has_best_mount) {
+    top_mount = &scan.best_mount;
     if (inspect_errno == EEXIST) {
       log_debug("  [LINK] inspect recovered from statfs(EEXIST) for %s",
                 state_out->system_ex_path);
@@ -414,19 +448,15 @@ static bool inspect_title_stack(const char *title_id, const char *source_path,
              inspect_errno != EINVAL) {
     log_debug("  [LINK] inspect statfs failed for %s: %s",
               state_out->system_ex_path, strerror(inspect_errno));
-    if (mntcount <= 0 || !mntbuf) {
+    if (entry_count < 0) {
       log_debug("  [LINK] mount table unavailable for %s",
                 state_out->system_ex_path);
-    } else if (!found_mount_entry) {
+    } else if (entry_count == 0) {
       log_debug("  [LINK] no mount entries for %s", state_out->system_ex_path);
     }
-    for (int i = 0; i < mntcount; i++) {
-      if (strcmp(mntbuf[i].f_mntonname, state_out->system_ex_path) != 0)
-        continue;
-      log_debug("  [LINK] mount entry for %s: type=%s from=%s flags=0x%lX",
-                state_out->system_ex_path, mntbuf[i].f_fstypename,
-                mntbuf[i].f_mntfromname, (unsigned long)mntbuf[i].f_flags);
-    }
+    (void)mount_table_for_each_on(state_out->system_ex_path,
+                                  log_title_stack_entry,
+                                  state_out->system_ex_path);
     errno = inspect_errno;
     return false;
   }
@@ -449,6 +479,10 @@ static bool inspect_title_stack(const char *title_id, const char *source_path,
         strcmp(top_from, source_path) == 0) {
       state_out->top_is_our_nullfs = true;
       state_out->has_our_nullfs = true;
+    } else if (is_title_launch_stub(title_id, top_from)) {
+      state_out->top_kind = TITLE_STACK_TOP_LAUNCH_STUB;
+      state_out->has_our_nullfs = true;
+      state_out->has_launch_stub = true;
     }
   } else if (strcmp(top_mount->f_fstypename, "unionfs") == 0 &&
              path_is_managed_backport_for_title(title_id, top_from)) {
@@ -474,9 +508,10 @@ static bool unmount_top_controlled_layer(const char *path) {
     return false;
   }
 
-  if (unmount(path, 0) == 0 || errno == ENOENT || errno == EINVAL)
+  if (mount_table_unmount(path, 0) == 0 || errno == ENOENT || errno == EINVAL)
     return true;
-  if (unmount(path, MNT_FORCE) == 0 || errno == ENOENT || errno == EINVAL)
+  if (mount_table_unmount(path, MNT_FORCE) == 0 || errno == ENOENT ||
+      errno == EINVAL)
     return true;
 
   log_debug("  [LINK] unmount failed for %s: %s", path, strerror(errno));
@@ -484,7 +519,9 @@ static bool unmount_top_controlled_layer(const char *path) {
 }
 
 static bool title_stack_top_is_managed(const title_mount_state_t *state) {
-  return state->top_is_our_nullfs || state->top_kind == TITLE_STACK_TOP_BACKPORT;
+  return state->top_is_our_nullfs ||
+         state->top_kind == TITLE_STACK_TOP_BACKPORT ||
+         state->top_kind == TITLE_STACK_TOP_LAUNCH_STUB;
 }
 
 bool rollback_title_nullfs_mount(const char *title_id, const char *src_path) {
@@ -567,7 +604,8 @@ bool mount_backport_overlay(const char *mount_point,
     };
 
   int overlay_flags = mount_read_only ? MNT_RDONLY : 0;
-  if (nmount(overlay_iov, IOVEC_SIZE(overlay_iov), overlay_flags) == 0) {
+  if (mount_table_nmount(overlay_iov, IOVEC_SIZE(overlay_iov),
+                         overlay_flags) == 0) {
     log_debug("  [IMG] backport overlay mounted (%s): %s -> %s",
               mount_read_only ? "ro" : "rw", backport_path, mount_point);
     return true;
@@ -594,19 +632,49 @@ static bool unmount_controlled_mount_stack(const char *path) {
   return !get_top_mount(path, &mount_st);
 }
 
+bool unmount_title_mount_stack(const char *title_id, const char *src_path) {
+  title_mount_state_t state;
+  if (!inspect_title_stack(title_id, src_path, NULL, &state))
+    return false;
+  if (!state.mounted)
+    return true;
+  if (!state.has_our_nullfs || !title_stack_top_is_managed(&state))
+    return false;
+
+  // No MNT_FORCE: a busy stack means the title is still in use.
+  for (int i = 0; i < MAX_LAYERED_UNMOUNT_ATTEMPTS * 4; i++) {
+    struct statfs mount_st;
+    if (!get_top_mount(state.system_ex_path, &mount_st))
+      return true;
+    if (strcmp(mount_st.f_fstypename, "nullfs") != 0 &&
+        strcmp(mount_st.f_fstypename, "unionfs") != 0) {
+      return false;
+    }
+    if (mount_table_unmount(state.system_ex_path, 0) != 0 && errno != ENOENT &&
+        errno != EINVAL) {
+      log_debug("  [LINK] unmount failed for %s: %s", state.system_ex_path,
+                strerror(errno));
+      return false;
+    }
+  }
+
+  struct statfs mount_st;
+  return !get_top_mount(state.system_ex_path, &mount_st);
+}
+
 static void unmount_mount_point_for_recovery(const char *path) {
   if (!unmount_controlled_mount_stack(path)) {
     log_debug("  [LINK] failed to reset mount stack for recovery: %s", path);
   }
 
-  if (unmount(path, 0) == 0) {
+  if (mount_table_unmount(path, 0) == 0) {
     log_debug("  [LINK] extra unmount for recovery: %s", path);
     return;
   }
   if (errno == ENOENT || errno == EINVAL)
     return;
 
-  if (unmount(path, MNT_FORCE) == 0) {
+  if (mount_table_unmount(path, MNT_FORCE) == 0) {
     log_debug("  [LINK] extra forced unmount for recovery: %s", path);
     return;
   }
@@ -686,7 +754,9 @@ void cleanup_duplicate_title_mounts(void) {
 }
 
 // --- Copy Helpers for Install Action ---
-static int copy_param_json_rewrite(const char *src, const char *dst) {
+static int copy_param_json_rewrite(const char *src, const char *dst,
+                                   sm_copy_stats_t *stats) {
+  uint64_t start_us = monotonic_time_us();
   FILE *fs = fopen(src, "rb");
   if (!fs)
     return -1;
@@ -743,6 +813,11 @@ static int copy_param_json_rewrite(const char *src, const char *dst) {
 
   if (ret == 0 && hit)
     log_debug("  [COPY] param.json patched: %s", dst);
+  if (ret == 0 && stats) {
+    stats->files++;
+    stats->bytes += len;
+    stats->elapsed_us += monotonic_time_us() - start_us;
+  }
   if (ret != 0)
     (void)unlink(dst);
 
@@ -750,45 +825,44 @@ static int copy_param_json_rewrite(const char *src, const char *dst) {
   return ret;
 }
 
-int copy_file(const char *src, const char *dst) {
-  if (strstr(src, "/sce_sys/param.json")) {
-    return copy_param_json_rewrite(src, dst);
-  }
+bool copy_file_rewrites(const char *src) {
+  return strstr(src, "/sce_sys/param.json") != NULL;
+}
 
-  char buf[8192];
-  FILE *fs = fopen(src, "rb");
-  if (!fs)
-    return -1;
-  FILE *fd = fopen(dst, "wb");
-  if (!fd) {
-    fclose(fs);
-    return -1;
+int copy_file(const char *src, const char *dst, sm_copy_stats_t *stats) {
+  if (copy_file_rewrites(src)) {
+    return copy_param_json_rewrite(src, dst, stats);
   }
-  int ret = 0;
-  while (true) {
-    size_t n = fread(buf, 1, sizeof(buf), fs);
-    if (n > 0 && fwrite(buf, 1, n, fd) != n) {
-      ret = -1;
-      break;
-    }
-    if (n < sizeof(buf)) {
-      if (ferror(fs))
-        ret = -1;
-      break;
-    }
+  return sm_copy_file_data(src, dst, 0, stats);
+}
+
+typedef struct {
+  sm_copy_job_t *jobs;
+  int count;
+  int capacity;
+} copy_dir_jobs_t;
+
+static bool add_copy_dir_job(copy_dir_jobs_t *list, const char *src,
+                             const char *dst) {
+  if (list->count == list->capacity) {
+    int capacity = list->capacity ? list->capacity * 2 : 32;
+    sm_copy_job_t *jobs = (sm_copy_job_t *)realloc(
+        list->jobs, (size_t)capacity * sizeof(*jobs));
+    if (!jobs)
+      return false;
+    list->jobs = jobs;
+    list->capacity = capacity;
   }
-  if (fflush(fd) != 0)
-    ret = -1;
-  if (fclose(fd) != 0)
-    ret = -1;
-  if (fclose(fs) != 0)
-    ret = -1;
-  if (ret != 0)
-    (void)unlink(dst);
-  return ret;
+  sm_copy_job_t *job = &list->jobs[list->count++];
+  memset(job, 0, sizeof(*job));
+  (void)strlcpy(job->src, src, sizeof(job->src));
+  (void)strlcpy(job->dst, dst, sizeof(job->dst));
+  return true;
 }
 
-int copy_dir(const char *src, const char *dst) {
+// Mirror the directories of src under dst and list the files to copy.
+static int collect_copy_dir_jobs(const char *src, const char *dst,
+                                 copy_dir_jobs_t *list) {
   if (mkdir(dst, 0777) != 0 && errno != EEXIST)
     return -1;
   DIR *d = opendir(src);
@@ -820,6 +894,7 @@ int copy_dir(const char *src, const char *dst) {
       }
       if (S_ISDIR(st.st_mode)) {
         log_debug("  [COPY] refusing symlink directory: %s", ss);
+        errno = ELOOP;
         ret = -1;
         break;
       }
@@ -827,15 +902,13 @@ int copy_dir(const char *src, const char *dst) {
       st = lst;
     }
     if (S_ISDIR(st.st_mode)) {
-      if (copy_dir(ss, dd) != 0) {
-        ret = -1;
-        break;
-      }
-    } else {
-      if (copy_file(ss, dd) != 0) {
+      if (collect_copy_dir_jobs(ss, dd, list) != 0) {
         ret = -1;
         break;
       }
+    } else if (!add_copy_dir_job(list, ss, dd)) {
+      ret = -1;
+      break;
     }
   }
   if (closedir(d) != 0)
@@ -843,23 +916,182 @@ int copy_dir(const char *src, const char *dst) {
   return ret;
 }
 
+// Remove a tree built by copy_dir(); symlinks are removed, not followed.
+static void remove_copy_tree(const char *path) {
+  struct stat st;
+  if (lstat(path, &st) != 0)
+    return;
+  if (!S_ISDIR(st.st_mode)) {
+    (void)unlink(path);
+    return;
+  }
+  DIR *d = opendir(path);
+  if (d) {
+    struct dirent *e;
+    char child[MAX_PATH];
+    while ((e = readdir(d))) {
+      if (!strcmp(e->d_name, ".") || !strcmp(e->d_name, ".."))
+        continue;
+      int written = snprintf(child, sizeof(child), "%s/%s", path, e->d_name);
+      if (written >= 0 && (size_t)written < sizeof(child))
+        remove_copy_tree(child);
+    }
+    closedir(d);
+  }
+  (void)rmdir(path);
+}
+
+int copy_dir(const char *src, const char *dst, sm_copy_stats_t *stats) {
+  char temp_dir[MAX_PATH];
+  char old_dir[MAX_PATH];
+  int temp_written =
+      snprintf(temp_dir, sizeof(temp_dir), "%s%s", dst, COPY_TEMP_SUFFIX);
+  int old_written =
+      snprintf(old_dir, sizeof(old_dir), "%s%s.old", dst, COPY_TEMP_SUFFIX);
+  if (temp_written < 0 || (size_t)temp_written >= sizeof(temp_dir) ||
+      old_written < 0 || (size_t)old_written >= sizeof(old_dir)) {
+    errno = ENAMETOOLONG;
+    return -1;
+  }
+
+  // Build the whole tree beside dst, then swap it in with two renames.
+  remove_copy_tree(temp_dir);
+  copy_dir_jobs_t list;
+  memset(&list, 0, sizeof(list));
+  bool ok = collect_copy_dir_jobs(src, temp_dir, &list) == 0 &&
+            sm_copy_run_jobs(list.jobs, list.count,
+                             runtime_config()->copy_workers, copy_file, 0,
+                             stats);
+  free(list.jobs);
+  if (!ok) {
+    int saved_errno = errno;
+    remove_copy_tree(temp_dir);
+    errno = saved_errno;
+    return -1;
+  }
+
+  struct stat st;
+  bool had_dst = lstat(dst, &st) == 0;
+  if (had_dst) {
+    remove_copy_tree(old_dir);
+    if (rename(dst, old_dir) != 0) {
+      int saved_errno = errno;
+      remove_copy_tree(temp_dir);
+      errno = saved_errno;
+      return -1;
+    }
+  }
+  if (rename(temp_dir, dst) != 0) {
+    int saved_errno = errno;
+    if (had_dst)
+      (void)rename(old_dir, dst);
+    remove_copy_tree(temp_dir);
+    errno = saved_errno;
+    return -1;
+  }
+  if (had_dst)
+    remove_copy_tree(old_dir);
+  return 0;
+}
+
+// Metadata the shell reads for a title; executables are never staged.
+static bool is_launch_stub_file(const char *name) {
+  return strcmp(name, "param.json") == 0 || strcmp(name, "param.sfo") == 0 ||
+         strcmp(name, "icon0.png") == 0 || strcmp(name, "pic0.png") == 0 ||
+         strcmp(name, "pic1.png") == 0;
+}
+
+static bool build_launch_stub_manifest_path(const char *stub_path,
+                                            char out[MAX_PATH]) {
+  int written = snprintf(out, MAX_PATH, "%s%s", stub_path,
+                         STAGE_MANIFEST_LAUNCH_STUB_SUFFIX);
+  return written >= 0 && written < MAX_PATH;
+}
+
+bool stage_title_launch_stub(const char *title_id, const char *src_path) {
+  char stub_path[MAX_PATH];
+  char manifest_path[MAX_PATH];
+  char src_sce_sys[MAX_PATH];
+  int written = snprintf(src_sce_sys, sizeof(src_sce_sys), "%s/sce_sys",
+                         src_path);
+  if (!build_title_launch_stub_path(title_id, stub_path) ||
+      !build_launch_stub_manifest_path(stub_path, manifest_path) ||
+      written < 0 || (size_t)written >= sizeof(src_sce_sys)) {
+    errno = ENAMETOOLONG;
+    return false;
+  }
+
+  (void)mkdir(USER_DATA_DIR "/shadowmount", 0777);
+  if ((mkdir(LAUNCH_STUB_DIR, 0777) != 0 && errno != EEXIST) ||
+      (mkdir(stub_path, 0777) != 0 && errno != EEXIST)) {
+    return false;
+  }
+
+  // The manifest stamps every staged file with its source size and mtime, so
+  // an update of any of them is staged again.
+  stage_manifest_t manifest;
+  load_stage_manifest(manifest_path, stub_path, &manifest);
+  if (manifest.count == 0) {
+    // Nothing is known about files left in the stub; start over.
+    remove_copy_tree(stub_path);
+    if (mkdir(stub_path, 0777) != 0 && errno != EEXIST) {
+      free_stage_manifest(&manifest);
+      return false;
+    }
+  }
+  sm_copy_stats_t stats;
+  memset(&stats, 0, sizeof(stats));
+  bool staged = stage_manifest_queue_dir(&manifest, src_sce_sys, "sce_sys",
+                                         false, is_launch_stub_file) == 0 &&
+                commit_stage_manifest(&manifest, 1, &stats);
+  uint32_t unchanged = manifest.unchanged;
+  free_stage_manifest(&manifest);
+  if (!staged)
+    return false;
+
+  if (stats.files > 0) {
+    log_debug("  [LINK] launch stub staged for %s: files=%u unchanged=%u "
+              "bytes=%llu",
+              title_id, stats.files, unchanged,
+              (unsigned long long)stats.bytes);
+  }
+  return true;
+}
+
+bool mount_title_launch_stub(const char *title_id) {
+  char stub_path[MAX_PATH];
+  if (!build_title_launch_stub_path(title_id, stub_path))
+    return false;
+  return mount_title_nullfs(title_id, stub_path);
+}
+
+void remove_title_launch_stub(const char *title_id) {
+  char stub_path[MAX_PATH];
+  char manifest_path[MAX_PATH];
+  if (!build_title_launch_stub_path(title_id, stub_path))
+    return;
+  remove_copy_tree(stub_path);
+  if (build_launch_stub_manifest_path(stub_path, manifest_path))
+    (void)unlink(manifest_path);
+}
+
 int remount_system_ex(void) {
   struct iovec iov[] = {
       IOVEC_ENTRY("from"),      IOVEC_ENTRY("/dev/ssd0.system_ex"),
-      IOVEC_ENTRY("fspath"),    IOVEC_ENTRY("/system_ex"),
+      IOVEC_ENTRY("fspath"),    IOVEC_ENTRY(SYSTEM_EX_BASE),
       IOVEC_ENTRY("fstype"),    IOVEC_ENTRY("exfatfs"),
       IOVEC_ENTRY("large"),     IOVEC_ENTRY("yes"),
       IOVEC_ENTRY("timezone"),  IOVEC_ENTRY("static"),
       IOVEC_ENTRY("async"),     IOVEC_ENTRY(NULL),
       IOVEC_ENTRY("ignoreacl"), IOVEC_ENTRY(NULL)};
-  return nmount(iov, IOVEC_SIZE(iov), MNT_UPDATE);
+  return mount_table_nmount(iov, IOVEC_SIZE(iov), MNT_UPDATE);
 }
 
 bool mount_title_nullfs(const char *title_id, const char *src_path) {
   char dst[MAX_PATH];
   char src_eboot[MAX_PATH];
   char dst_eboot[MAX_PATH];
-  snprintf(dst, sizeof(dst), "/system_ex/app/%s", title_id);
+  snprintf(dst, sizeof(dst), SYSTEM_EX_APP_BASE "/%s", title_id);
   int written = snprintf(src_eboot, sizeof(src_eboot), "%s/eboot.bin", src_path);
   if (written < 0 || (size_t)written >= sizeof(src_eboot)) {
     log_debug("  [LINK] source eboot path too long for %s: %s", title_id,
@@ -868,6 +1100,8 @@ bool mount_title_nullfs(const char *title_id, const char *src_path) {
   }
   snprintf(dst_eboot, sizeof(dst_eboot), "%s/eboot.bin", dst);
 
+  // The launch stub holds metadata only and has no eboot.bin.
+  bool is_stub = is_title_launch_stub(title_id, src_path);
   struct stat src_st;
   if (stat(src_path, &src_st) != 0) {
     log_debug("  [LINK] source path check failed for %s -> %s: %s", title_id,
@@ -879,7 +1113,7 @@ bool mount_title_nullfs(const char *title_id, const char *src_path) {
               title_id, src_path, (unsigned)(src_st.st_mode & 077777));
     return false;
   }
-  if (!path_exists(src_eboot)) {
+  if (!is_stub && !path_exists(src_eboot)) {
     bool tried_image_recovery = false;
     if (source_path_needs_cleanup(src_path, &tried_image_recovery)) {
       log_debug("  [LINK] source eboot.bin missing for %s: %s", title_id,
@@ -916,9 +1150,18 @@ bool mount_title_nullfs(const char *title_id, const char *src_path) {
               strerror(errno));
     return false;
   }
-  if (state.mounted) {
-    if (state.has_our_nullfs && title_stack_top_is_managed(&state) &&
-        path_exists(dst_eboot)) {
+  // A game launched from the launch stub may be running: the title goes on
+  // top of the stub instead of replacing it.
+  bool over_launch_stub =
+      state.top_kind == TITLE_STACK_TOP_LAUNCH_STUB && !is_stub;
+  bool already_active =
+      is_stub ? state.top_kind == TITLE_STACK_TOP_LAUNCH_STUB
+              : state.has_our_nullfs && title_stack_top_is_managed(&state) &&
+                    path_exists(dst_eboot);
+  if (over_launch_stub) {
+    log_debug("  [LINK] mounting over launch stub: %s -> %s", src_path, dst);
+  } else if (state.mounted) {
+    if (already_active) {
       log_debug("  [LINK] mount stack already active: %s -> %s", src_path, dst);
       return true;
     }
@@ -938,23 +1181,25 @@ bool mount_title_nullfs(const char *title_id, const char *src_path) {
   if (runtime_sleep_mode_active())
     return false;
 
-  if (nmount(iov, IOVEC_SIZE(iov), 0) != 0) {
+  if (mount_table_nmount(iov, IOVEC_SIZE(iov), 0) != 0) {
     log_debug("  [LINK] Failed to auto-mount nullfs title=%s src=%s dst=%s: %s",
               title_id, src_path, dst, strerror(errno));
     return false;
   }
 
   if (runtime_sleep_mode_active()) {
-    if (unmount(dst, 0) != 0 && errno != ENOENT && errno != EINVAL)
-      (void)unmount(dst, MNT_FORCE);
+    if (mount_table_unmount(dst, 0) != 0 && errno != ENOENT && errno != EINVAL)
+      (void)mount_table_unmount(dst, MNT_FORCE);
     return false;
   }
 
-  if (!path_exists(dst_eboot)) {
+  if (!is_stub && !path_exists(dst_eboot)) {
     log_debug("  [LINK] mounted nullfs but eboot.bin is missing at target: %s",
               dst_eboot);
-    if (unmount(dst, 0) != 0 && errno != ENOENT && errno != EINVAL) {
-      if (unmount(dst, MNT_FORCE) != 0 && errno != ENOENT && errno != EINVAL) {
+    if (mount_table_unmount(dst, 0) != 0 && errno != ENOENT &&
+        errno != EINVAL) {
+      if (mount_table_unmount(dst, MNT_FORCE) != 0 && errno != ENOENT &&
+          errno != EINVAL) {
         log_debug("  [LINK] failed to rollback empty nullfs mount %s: %s", dst,
                   strerror(errno));
       }
@@ -996,6 +1241,13 @@ static bool cleanup_mount_links_entry(const char *title_id,
         resolve_mount_image_source_path(paths, source_path, image_source_path);
   }
 
+  // Titles parked by mount on launch keep their links while the image exists.
+  if (has_image_source && sm_image_ondemand_is_parked(image_source_path)) {
+    if (path_exists(image_source_path))
+      return true;
+    sm_image_ondemand_forget(image_source_path);
+  }
+
   if (!should_remove) {
     if (ctx->match_usb_sources) {
       matches_removed_source =
@@ -1023,8 +1275,11 @@ static bool cleanup_mount_links_entry(const char *title_id,
     }
   }
 
-  if (!should_remove)
+  if (!should_remove) {
+    if (has_image_source && is_image_cache_source(image_source_path))
+      sm_image_ondemand_note_attached(title_id, image_source_path);
     return true;
+  }
 
   bool keep_mount_link = false;
   bool mount_link_staged = false;
@@ -1071,6 +1326,7 @@ static bool cleanup_mount_links_entry(const char *title_id,
                                        : unlink(paths->mount_link);
     if (unlink_res == 0 || errno == ENOENT) {
       log_debug("  [LINK] removed stale mount link: %s", paths->mount_link);
+      remove_title_launch_stub(title_id);
       if (unlink(paths->mount_image_link) != 0 && errno != ENOENT) {
         log_debug("  [LINK] remove failed for %s: %s", paths->mount_image_link,
                   strerror(errno));
@@ -2,21 +2,55 @@
 #include "sm_game_cache.h"
 #include "sm_config_mount.h"
 #include "sm_filesystem.h"
+#include "sm_hash.h"
 #include "sm_image_cache.h"
 #include "sm_limits.h"
 #include "sm_log.h"
+#include "sm_path_pool.h"
 #include "sm_path_utils.h"
+#include "sm_state_table.h"
 #include "sm_title_state.h"
 
+#define GAME_CACHE_NONE (-1)
+// Bucket 0 collects entries whose owning scan root is not resolved yet; an
+// entry with an owning root always gets a bucket of its own root, growing the
+// bucket table when needed (scan paths may change on config reload while
+// entries for the old roots are still cached).
+#define GAME_CACHE_UNOWNED_BUCKET 0
+
 struct GameCache {
-  char path[MAX_PATH];
+  sm_path_id_t path;
   char title_id[MAX_TITLE_ID];
   char title_name[MAX_TITLE_NAME];
-  char owning_scan_root[MAX_PATH];
+  sm_path_id_t owning_scan_root;
+  uint32_t title_hash;
+  int root_bucket;
+  // Root bucket list links for valid entries; free entries are chained
+  // through bucket_next instead.
+  int bucket_prev;
+  int bucket_next;
   bool valid;
 };
 
-static struct GameCache g_game_cache[MAX_PENDING];
+struct GameCacheRootBucket {
+  sm_path_id_t root;
+  // First entry index + 1; 0 when the bucket is empty.
+  int head;
+};
+
+static struct GameCache *g_game_cache = NULL;
+static int g_game_cache_capacity = 0;
+static int g_game_cache_count = 0;
+static int g_game_cache_free_head = GAME_CACHE_NONE;
+static bool g_game_cache_limit_logged = false;
+static sm_state_index_t g_game_cache_path_index;
+static sm_state_index_t g_game_cache_title_index;
+static struct GameCacheRootBucket *g_game_cache_roots = NULL;
+static int g_game_cache_root_capacity = 0;
+
+static uint32_t game_cache_path_hash(sm_path_id_t path) {
+  return path * 2654435761u;
+}
 
 static bool resolve_game_cache_owning_scan_root(const char *path,
                                                 char owning_scan_root[MAX_PATH]) {
@@ -47,41 +81,236 @@ static bool resolve_game_cache_owning_scan_root(const char *path,
   return owning_scan_root[0] != '\0';
 }
 
-static void write_game_cache_slot(struct GameCache *entry, const char *path,
+static int game_cache_bucket_first(int bucket) {
+  if (bucket < 0 || bucket >= g_game_cache_root_capacity)
+    return GAME_CACHE_NONE;
+  return g_game_cache_roots[bucket].head - 1;
+}
+
+static int find_game_cache_root_bucket(sm_path_id_t root) {
+  if (root == SM_PATH_ID_NONE)
+    return GAME_CACHE_UNOWNED_BUCKET;
+  for (int b = 1; b < g_game_cache_root_capacity; b++) {
+    if (g_game_cache_roots[b].root == root)
+      return b;
+  }
+  return GAME_CACHE_NONE;
+}
+
+// Return the bucket of root, claiming a free one or growing the table; returns
+// GAME_CACHE_NONE only when the table cannot grow.
+static int get_or_create_game_cache_root_bucket(sm_path_id_t root) {
+  int bucket = find_game_cache_root_bucket(root);
+  if (bucket != GAME_CACHE_NONE && bucket < g_game_cache_root_capacity)
+    return bucket;
+  int b = 1;
+  while (b < g_game_cache_root_capacity &&
+         g_game_cache_roots[b].root != SM_PATH_ID_NONE) {
+    b++;
+  }
+  if (b >= g_game_cache_root_capacity &&
+      !sm_state_table_reserve((void **)&g_game_cache_roots,
+                              &g_game_cache_root_capacity, b + 1,
+                              sizeof(*g_game_cache_roots))) {
+    log_debug("  [CACHE] root bucket table full (%d buckets)",
+              g_game_cache_root_capacity);
+    return GAME_CACHE_NONE;
+  }
+  if (bucket == GAME_CACHE_UNOWNED_BUCKET)
+    return bucket;
+  g_game_cache_roots[b].root = root;
+  return b;
+}
+
+static void link_game_cache_root_bucket(int k, int bucket) {
+  struct GameCache *entry = &g_game_cache[k];
+  entry->root_bucket = bucket;
+  entry->bucket_prev = GAME_CACHE_NONE;
+  entry->bucket_next = game_cache_bucket_first(bucket);
+  if (entry->bucket_next != GAME_CACHE_NONE)
+    g_game_cache[entry->bucket_next].bucket_prev = k;
+  g_game_cache_roots[bucket].head = k + 1;
+}
+
+static bool link_game_cache_root(int k) {
+  int bucket =
+      get_or_create_game_cache_root_bucket(g_game_cache[k].owning_scan_root);
+  if (bucket == GAME_CACHE_NONE)
+    return false;
+  link_game_cache_root_bucket(k, bucket);
+  return true;
+}
+
+static void unlink_game_cache_root(int k) {
+  struct GameCache *entry = &g_game_cache[k];
+  int bucket = entry->root_bucket;
+  if (entry->bucket_prev != GAME_CACHE_NONE)
+    g_game_cache[entry->bucket_prev].bucket_next = entry->bucket_next;
+  else
+    g_game_cache_roots[bucket].head = entry->bucket_next + 1;
+  if (entry->bucket_next != GAME_CACHE_NONE)
+    g_game_cache[entry->bucket_next].bucket_prev = entry->bucket_prev;
+  if (bucket != GAME_CACHE_UNOWNED_BUCKET &&
+      g_game_cache_roots[bucket].head == 0) {
+    g_game_cache_roots[bucket].root = SM_PATH_ID_NONE;
+  }
+  entry->bucket_prev = GAME_CACHE_NONE;
+  entry->bucket_next = GAME_CACHE_NONE;
+}
+
+static bool index_game_cache_entry(int k) {
+  struct GameCache *entry = &g_game_cache[k];
+  if (!sm_state_index_insert(&g_game_cache_path_index,
+                             game_cache_path_hash(entry->path), k)) {
+    return false;
+  }
+  if (!sm_state_index_insert(&g_game_cache_title_index, entry->title_hash, k)) {
+    sm_state_index_remove(&g_game_cache_path_index,
+                          game_cache_path_hash(entry->path), k);
+    return false;
+  }
+  if (!link_game_cache_root(k)) {
+    sm_state_index_remove(&g_game_cache_path_index,
+                          game_cache_path_hash(entry->path), k);
+    sm_state_index_remove(&g_game_cache_title_index, entry->title_hash, k);
+    return false;
+  }
+  return true;
+}
+
+static void unindex_game_cache_entry(int k) {
+  struct GameCache *entry = &g_game_cache[k];
+  sm_state_index_remove(&g_game_cache_path_index,
+                        game_cache_path_hash(entry->path), k);
+  sm_state_index_remove(&g_game_cache_title_index, entry->title_hash, k);
+  unlink_game_cache_root(k);
+}
+
+static int find_game_cache_by_path(sm_path_id_t path) {
+  if (path == SM_PATH_ID_NONE)
+    return GAME_CACHE_NONE;
+  uint32_t hash = game_cache_path_hash(path);
+  uint32_t cursor = 0;
+  int k;
+  while ((k = sm_state_index_next(&g_game_cache_path_index, hash, &cursor)) >=
+         0) {
+    if (g_game_cache[k].path == path)
+      return k;
+  }
+  return GAME_CACHE_NONE;
+}
+
+static int find_game_cache_by_title(const char *title_id) {
+  if (!title_id || title_id[0] == '\0')
+    return GAME_CACHE_NONE;
+  uint32_t hash = sm_fnv1a32(title_id);
+  uint32_t cursor = 0;
+  int k;
+  while ((k = sm_state_index_next(&g_game_cache_title_index, hash, &cursor)) >=
+         0) {
+    if (strcmp(g_game_cache[k].title_id, title_id) == 0)
+      return k;
+  }
+  return GAME_CACHE_NONE;
+}
+
+static void release_game_cache_slot(int k) {
+  struct GameCache *entry = &g_game_cache[k];
+  sm_path_release(entry->path);
+  sm_path_release(entry->owning_scan_root);
+  memset(entry, 0, sizeof(*entry));
+  entry->bucket_prev = GAME_CACHE_NONE;
+  entry->bucket_next = g_game_cache_free_head;
+  g_game_cache_free_head = k;
+}
+
+static bool write_game_cache_slot(int k, bool was_valid, const char *path,
                                   const char *title_id,
                                   const char *title_name,
                                   const char *owning_scan_root) {
-  (void)strlcpy(entry->path, path, sizeof(entry->path));
+  struct GameCache *entry = &g_game_cache[k];
+  if (was_valid)
+    unindex_game_cache_entry(k);
+  if (!sm_path_assign(&entry->path, path)) {
+    if (was_valid)
+      g_game_cache_count--;
+    release_game_cache_slot(k);
+    return false;
+  }
   (void)strlcpy(entry->title_id, title_id, sizeof(entry->title_id));
   (void)strlcpy(entry->title_name, title_name, sizeof(entry->title_name));
-  (void)strlcpy(entry->owning_scan_root, owning_scan_root,
-                sizeof(entry->owning_scan_root));
+  (void)sm_path_assign(&entry->owning_scan_root, owning_scan_root);
+  entry->title_hash = sm_fnv1a32(entry->title_id);
   entry->valid = true;
+  if (!index_game_cache_entry(k)) {
+    if (was_valid)
+      g_game_cache_count--;
+    release_game_cache_slot(k);
+    return false;
+  }
+  if (!was_valid)
+    g_game_cache_count++;
+  return true;
 }
 
-static bool ensure_game_cache_owning_scan_root(struct GameCache *entry) {
-  if (entry->owning_scan_root[0] != '\0')
+// Resolve a missing owning scan root and move the entry to its bucket.
+static bool ensure_game_cache_owning_scan_root(int k) {
+  struct GameCache *entry = &g_game_cache[k];
+  if (entry->owning_scan_root != SM_PATH_ID_NONE)
     return true;
 
-  return resolve_game_cache_owning_scan_root(entry->path, entry->owning_scan_root);
+  char owning_scan_root[MAX_PATH];
+  sm_path_id_t root = SM_PATH_ID_NONE;
+  if (!resolve_game_cache_owning_scan_root(sm_path_str(entry->path),
+                                           owning_scan_root) ||
+      !sm_path_assign(&root, owning_scan_root) || root == SM_PATH_ID_NONE) {
+    return false;
+  }
+  // Claim the bucket first so a failed growth leaves the entry unowned.
+  int bucket = get_or_create_game_cache_root_bucket(root);
+  if (bucket == GAME_CACHE_NONE) {
+    sm_path_release(root);
+    return false;
+  }
+  unlink_game_cache_root(k);
+  entry->owning_scan_root = root;
+  link_game_cache_root_bucket(k, bucket);
+  return true;
 }
 
 static void clear_game_cache_slot(int index, const char *reason) {
-  if (index < 0 || index >= MAX_PENDING || !g_game_cache[index].valid)
+  if (index < 0 || index >= g_game_cache_capacity || !g_game_cache[index].valid)
     return;
 
   if (reason && reason[0] != '\0') {
     if (g_game_cache[index].title_id[0] != '\0')
       log_debug("  [CACHE] %s: %s (%s)", reason, g_game_cache[index].title_id,
-                g_game_cache[index].path);
+                sm_path_str(g_game_cache[index].path));
     else
-      log_debug("  [CACHE] %s: %s", reason, g_game_cache[index].path);
+      log_debug("  [CACHE] %s: %s", reason,
+                sm_path_str(g_game_cache[index].path));
   }
 
   if (g_game_cache[index].title_id[0] != '\0')
     clear_duplicate_title_notification(g_game_cache[index].title_id);
 
-  memset(&g_game_cache[index], 0, sizeof(g_game_cache[index]));
+  unindex_game_cache_entry(index);
+  release_game_cache_slot(index);
+  g_game_cache_count--;
+}
+
+static bool grow_game_cache(void) {
+  int old_capacity = g_game_cache_capacity;
+  if (!sm_state_table_reserve((void **)&g_game_cache, &g_game_cache_capacity,
+                              old_capacity + 1, sizeof(*g_game_cache))) {
+    return false;
+  }
+  for (int k = g_game_cache_capacity - 1; k >= old_capacity; k--) {
+    g_game_cache[k].bucket_prev = GAME_CACHE_NONE;
+    g_game_cache[k].bucket_next = g_game_cache_free_head;
+    g_game_cache_free_head = k;
+  }
+  return true;
 }
 
 void cache_game_entry(const char *path, const char *title_id,
@@ -89,32 +318,37 @@ void cache_game_entry(const char *path, const char *title_id,
   char owning_scan_root[MAX_PATH];
   (void)resolve_game_cache_owning_scan_root(path, owning_scan_root);
 
-  for (int k = 0; k < MAX_PENDING; k++) {
-    if (!g_game_cache[k].valid)
-      continue;
-    if (strcmp(g_game_cache[k].path, path) != 0 &&
-        strcmp(g_game_cache[k].title_id, title_id) != 0) {
-      continue;
-    }
-    write_game_cache_slot(&g_game_cache[k], path, title_id, title_name,
-                          owning_scan_root);
+  sm_path_id_t path_id = sm_path_lookup(path);
+  int k = find_game_cache_by_path(path_id);
+  sm_path_release(path_id);
+  if (k == GAME_CACHE_NONE)
+    k = find_game_cache_by_title(title_id);
+  if (k != GAME_CACHE_NONE) {
+    (void)write_game_cache_slot(k, true, path, title_id, title_name,
+                                owning_scan_root);
     return;
   }
 
-  for (int k = 0; k < MAX_PENDING; k++) {
-    if (!g_game_cache[k].valid) {
-      write_game_cache_slot(&g_game_cache[k], path, title_id, title_name,
-                            owning_scan_root);
-      return;
+  if (g_game_cache_free_head == GAME_CACHE_NONE && !grow_game_cache()) {
+    if (!g_game_cache_limit_logged) {
+      log_debug("  [CACHE] soft limit reached (%d entries), not caching: %s (%s)",
+                g_game_cache_capacity, title_id, path);
+      g_game_cache_limit_logged = true;
     }
+    return;
   }
+  k = g_game_cache_free_head;
+  g_game_cache_free_head = g_game_cache[k].bucket_next;
+  g_game_cache[k].bucket_next = GAME_CACHE_NONE;
+  (void)write_game_cache_slot(k, false, path, title_id, title_name,
+                              owning_scan_root);
 }
 
 void prune_game_cache(void) {
-  for (int k = 0; k < MAX_PENDING; k++) {
+  for (int k = 0; k < g_game_cache_capacity; k++) {
     if (!g_game_cache[k].valid)
       continue;
-    if (path_exists(g_game_cache[k].path))
+    if (path_exists(sm_path_str(g_game_cache[k].path)))
       continue;
     clear_game_cache_slot(k, "source removed");
   }
@@ -126,40 +360,94 @@ void prune_game_cache_for_root(const char *root) {
     return;
   }
 
-  for (int k = 0; k < MAX_PENDING; k++) {
-    if (!g_game_cache[k].valid)
-      continue;
-    const char *entry_root =
-        ensure_game_cache_owning_scan_root(&g_game_cache[k])
-            ? g_game_cache[k].owning_scan_root
-            : g_game_cache[k].path;
-    if (!path_matches_root_or_child(entry_root, root))
-      continue;
-    if (path_exists(g_game_cache[k].path))
+  // Unowned entries match on their own path once resolution fails.
+  int k = game_cache_bucket_first(GAME_CACHE_UNOWNED_BUCKET);
+  while (k != GAME_CACHE_NONE) {
+    int next = g_game_cache[k].bucket_next;
+    if (!ensure_game_cache_owning_scan_root(k) &&
+        path_matches_root_or_child(sm_path_str(g_game_cache[k].path), root) &&
+        !path_exists(sm_path_str(g_game_cache[k].path))) {
+      clear_game_cache_slot(k, "source removed");
+    }
+    k = next;
+  }
+
+  for (int b = 1; b < g_game_cache_root_capacity; b++) {
+    if (g_game_cache_roots[b].root == SM_PATH_ID_NONE ||
+        !path_matches_root_or_child(sm_path_str(g_game_cache_roots[b].root),
+                                    root)) {
       continue;
-    clear_game_cache_slot(k, "source removed");
+    }
+    k = game_cache_bucket_first(b);
+    while (k != GAME_CACHE_NONE) {
+      int next = g_game_cache[k].bucket_next;
+      if (!path_exists(sm_path_str(g_game_cache[k].path)))
+        clear_game_cache_slot(k, "source removed");
+      k = next;
+    }
   }
 }
 
+static void visit_game_cache_root(sm_path_id_t root_id, game_cache_iter_fn fn,
+                                  void *ctx);
+
 void for_each_cached_game_entry(const char *root, game_cache_iter_fn fn,
                                 void *ctx) {
   if (!fn)
     return;
 
-  for (int k = 0; k < MAX_PENDING; k++) {
-    if (!g_game_cache[k].valid)
-      continue;
-    bool has_owning_scan_root = ensure_game_cache_owning_scan_root(&g_game_cache[k]);
-    const char *entry_root =
-        has_owning_scan_root ? g_game_cache[k].owning_scan_root : g_game_cache[k].path;
-    if (root && root[0] != '\0' && strcmp(entry_root, root) != 0) {
-      continue;
+  if (!root || root[0] == '\0') {
+    for (int k = 0; k < g_game_cache_capacity; k++) {
+      if (!g_game_cache[k].valid)
+        continue;
+      bool has_owning_scan_root = ensure_game_cache_owning_scan_root(k);
+      if (!fn(sm_path_str(g_game_cache[k].path), g_game_cache[k].title_id,
+              g_game_cache[k].title_name,
+              has_owning_scan_root
+                  ? sm_path_str(g_game_cache[k].owning_scan_root)
+                  : NULL,
+              ctx)) {
+        return;
+      }
     }
-    if (!fn(g_game_cache[k].path, g_game_cache[k].title_id,
+    return;
+  }
+
+  sm_path_id_t root_id = sm_path_lookup(root);
+  if (root_id == SM_PATH_ID_NONE)
+    return;
+  visit_game_cache_root(root_id, fn, ctx);
+  sm_path_release(root_id);
+}
+
+static void visit_game_cache_root(sm_path_id_t root_id, game_cache_iter_fn fn,
+                                  void *ctx) {
+  // Settle unowned entries first so newly resolved ones are visited through
+  // the root bucket below.
+  int k = game_cache_bucket_first(GAME_CACHE_UNOWNED_BUCKET);
+  while (k != GAME_CACHE_NONE) {
+    int next = g_game_cache[k].bucket_next;
+    if (!ensure_game_cache_owning_scan_root(k) &&
+        g_game_cache[k].path == root_id &&
+        !fn(sm_path_str(g_game_cache[k].path), g_game_cache[k].title_id,
+            g_game_cache[k].title_name, NULL, ctx)) {
+      return;
+    }
+    k = next;
+  }
+
+  int bucket = find_game_cache_root_bucket(root_id);
+  if (bucket == GAME_CACHE_NONE || bucket == GAME_CACHE_UNOWNED_BUCKET)
+    return;
+  k = game_cache_bucket_first(bucket);
+  while (k != GAME_CACHE_NONE) {
+    int next = g_game_cache[k].bucket_next;
+    if (!fn(sm_path_str(g_game_cache[k].path), g_game_cache[k].title_id,
             g_game_cache[k].title_name,
-            has_owning_scan_root ? g_game_cache[k].owning_scan_root : NULL, ctx)) {
-      break;
+            sm_path_str(g_game_cache[k].owning_scan_root), ctx)) {
+      return;
     }
+    k = next;
   }
 }
 
@@ -168,31 +456,34 @@ bool find_cached_game(const char *path, const char *title_id,
   if (existing_path_out)
     *existing_path_out = NULL;
 
-  for (int k = 0; k < MAX_PENDING; k++) {
-    if (!g_game_cache[k].valid)
-      continue;
-    if (path && strcmp(g_game_cache[k].path, path) == 0) {
-      if (existing_path_out)
-        *existing_path_out = g_game_cache[k].path;
-      return true;
-    }
-    if (title_id && title_id[0] != '\0' &&
-        strcmp(g_game_cache[k].title_id, title_id) == 0) {
-      if (existing_path_out)
-        *existing_path_out = g_game_cache[k].path;
-      return true;
-    }
-  }
+  sm_path_id_t path_id = sm_path_lookup(path);
+  int k = find_game_cache_by_path(path_id);
+  sm_path_release(path_id);
+  if (k == GAME_CACHE_NONE)
+    k = find_game_cache_by_title(title_id);
+  if (k == GAME_CACHE_NONE)
+    return false;
 
-  return false;
+  if (existing_path_out)
+    *existing_path_out = sm_path_str(g_game_cache[k].path);
+  return true;
 }
 
 void clear_cached_game(const char *path) {
-  for (int k = 0; k < MAX_PENDING; k++) {
-    if (!g_game_cache[k].valid)
-      continue;
-    if (strcmp(g_game_cache[k].path, path) != 0)
-      continue;
+  sm_path_id_t path_id = sm_path_lookup(path);
+  int k;
+  while ((k = find_game_cache_by_path(path_id)) != GAME_CACHE_NONE)
     clear_game_cache_slot(k, "removed from duplicate tracking");
-  }
+  sm_path_release(path_id);
+}
+
+void game_cache_memory_usage(sm_state_table_usage_t *out) {
+  out->name = "game_cache";
+  out->count = g_game_cache_count;
+  out->capacity = g_game_cache_capacity;
+  out->bytes = (size_t)g_game_cache_capacity * sizeof(*g_game_cache) +
+               (size_t)g_game_cache_root_capacity *
+                   sizeof(*g_game_cache_roots) +
+               sm_state_index_bytes(&g_game_cache_path_index) +
+               sm_state_index_bytes(&g_game_cache_title_index);
 }
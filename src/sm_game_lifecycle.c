@@ -9,6 +9,7 @@
 #include "sm_appdb.h"
 #include "sm_fakelib.h"
 #include "sm_game_lifecycle.h"
+#include "sm_image_ondemand.h"
 #include "sm_kstuff.h"
 #include "sm_limits.h"
 #include "sm_log.h"
@@ -175,6 +176,10 @@ static bool dispatch_game_launch(int kq, pid_t pid, uint64_t exec_time_us,
   log_debug("  [GAME] started: %s pid=%ld app_id=0x%08X", title_id,
             (long)pid, app_id);
   publish_active_game(pid, title_id);
+  // Attach a parked image first; a launch made from its stub is ended and
+  // the other hooks wait for the next one.
+  if (!sm_image_ondemand_game_on_exec(pid, title_id))
+    return true;
   sm_kstuff_game_on_exec(pid, title_id, app_id, exec_time_us);
   sm_fakelib_game_on_exec(pid, title_id);
   return true;
@@ -332,6 +337,8 @@ static const struct timespec *compute_game_wait_timeout(
   next_wake_us = min_nonzero_u64(next_wake_us, next_pending_game_wake_us(now_us));
   next_wake_us = min_nonzero_u64(next_wake_us, sm_kstuff_game_next_wake_us(now_us));
   next_wake_us = min_nonzero_u64(next_wake_us, sm_mdbg_next_wake_us(now_us));
+  next_wake_us =
+      min_nonzero_u64(next_wake_us, sm_image_ondemand_next_wake_us(now_us));
   if (next_wake_us == 0)
     return NULL;
 
@@ -383,6 +390,7 @@ static void poll_game_modules(int kq) {
 
   sm_kstuff_game_poll();
   sm_mdbg_poll();
+  sm_image_ondemand_poll();
 }
 
 static bool register_game_exit_watch(int kq, pid_t pid) {
@@ -430,6 +438,7 @@ static void handle_game_exit(pid_t pid) {
     publish_active_game_pid(0);
   sm_fakelib_game_on_exit(pid);
   sm_kstuff_game_on_exit(pid);
+  sm_image_ondemand_game_on_exit(pid);
   if (had_active_title) {
     int snd0_updates = normalize_snd0info_for_title(title_id);
     if (snd0_updates >= 0)
@@ -503,6 +512,7 @@ static void *game_lifecycle_watcher_main(void *arg) {
         suspended_game_pid = atomic_load(&g_active_game_pid);
         clear_all_pending_game_launches();
         sm_fakelib_game_shutdown();
+        sm_image_ondemand_game_shutdown();
         sm_kstuff_sleep_enter();
         publish_active_game(0, NULL);
         sleep_cleanup_done = true;
@@ -565,6 +575,7 @@ static void *game_lifecycle_watcher_main(void *arg) {
   clear_all_pending_game_launches();
   sm_fakelib_game_shutdown();
   sm_kstuff_game_shutdown();
+  sm_image_ondemand_game_shutdown();
   publish_active_game(0, NULL);
   close(kq);
   log_debug("  [GAME] lifecycle watcher stopped");
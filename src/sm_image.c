@@ -1,18 +1,28 @@
 #include "sm_platform.h"
+#include <pthread.h>
+
 #include "sm_runtime.h"
 #include "sm_image.h"
 #include "sm_hash.h"
 #include "sm_image_cache.h"
+#include "sm_image_layers.h"
+#include "sm_image_ondemand.h"
+#include "sm_image_probe.h"
+#include "sm_image_sidecar.h"
 #include "sm_game_cache.h"
 #include "sm_log.h"
 #include "sm_config_mount.h"
 #include "sm_limits.h"
 #include "sm_mount_defs.h"
 #include "sm_mount_device.h"
+#include "sm_mount_stats.h"
+#include "sm_mount_table.h"
 #include "sm_filesystem.h"
+#include "sm_path_pool.h"
 #include "sm_path_state.h"
 #include "sm_path_utils.h"
 #include "sm_paths.h"
+#include "sm_state_table.h"
 
 static bool image_fs_type_is_pfs(image_fs_type_t fs_type) {
   return fs_type == IMAGE_FS_PFS || fs_type == IMAGE_FS_PFSC_CONTAINER;
@@ -68,6 +78,17 @@ static uint32_t get_image_sector_size_override_or_default(
       get_image_sector_size_override(filename, &override)) {
     return override;
   }
+  // Knowing the inner block size up front saves the failed mount and
+  // autotune round trip when it is smaller than the default sector.
+  image_probe_t probe;
+  if (get_image_probe(path, &probe) && probe.block_size != 0) {
+    return probe.block_size < fallback ? probe.block_size : fallback;
+  }
+  image_sidecar_t sidecar;
+  if (get_image_sidecar(path, &sidecar) && sidecar.cluster_size != 0 &&
+      sidecar.cluster_size < fallback) {
+    return sidecar.cluster_size;
+  }
   return fallback;
 }
 
@@ -188,6 +209,8 @@ static uint16_t get_lvd_source_type(const char *path) {
 }
 
 // --- Image Path and Naming Helpers ---
+// Split parts (game.ffpkg.000, .001, ...) end in a numeric extension and are
+// not images: split images are not supported.
 static image_fs_type_t detect_image_fs_type(const char *name) {
   if (!name || name[0] == '\0')
     return IMAGE_FS_UNKNOWN;
@@ -228,6 +251,10 @@ static image_fs_type_t detect_image_fs_type_for_path(const char *path,
   return IMAGE_FS_UNKNOWN;
 }
 
+image_fs_type_t get_image_fs_type_for_path(const char *path) {
+  return detect_image_fs_type_for_path(path, NULL);
+}
+
 bool is_supported_image_file_name(const char *name) {
   return detect_image_fs_type(name) != IMAGE_FS_UNKNOWN;
 }
@@ -333,6 +360,7 @@ void get_image_mount_point_for_source(const char *file_path,
 
 typedef bool (*image_attach_fn)(const char *file_path, image_fs_type_t fs_type,
                                 bool mount_read_only, off_t file_size,
+                                const image_layers_t *stack,
                                 int *unit_id_out, char *devname_out,
                                 size_t devname_size);
 
@@ -343,8 +371,15 @@ typedef struct {
 
 static bool attach_md_backend(const char *file_path, image_fs_type_t fs_type,
                               bool mount_read_only, off_t file_size,
+                              const image_layers_t *stack,
                               int *unit_id_out, char *devname_out,
                               size_t devname_size) {
+  if (image_layers_need_lvd(stack)) {
+    log_debug("  [IMG][%s] bitmaps and delta layers need LVD: %s",
+              attach_backend_name(ATTACH_BACKEND_MD), file_path);
+    errno = EINVAL;
+    return false;
+  }
   int md_fd = open(MD_CTRL_PATH, O_RDWR);
   if (md_fd < 0) {
     log_debug("  [IMG][%s] open %s failed: %s",
@@ -365,10 +400,13 @@ static bool attach_md_backend(const char *file_path, image_fs_type_t fs_type,
   int last_errno = 0;
   log_debug("  [IMG][%s] attach try: options=0x%x",
             attach_backend_name(ATTACH_BACKEND_MD), req.md_options);
+  uint64_t attach_start_us = sm_mount_stats_begin();
   int ret = ioctl(md_fd, MDIOCATTACH, &req);
   if (ret != 0)
     last_errno = errno;
   close(md_fd);
+  sm_mount_stats_end(SM_MOUNT_PHASE_ATTACH, fs_type, ATTACH_BACKEND_MD,
+                     attach_start_us);
 
   if (ret != 0) {
     errno = last_errno;
@@ -384,8 +422,12 @@ static bool attach_md_backend(const char *file_path, image_fs_type_t fs_type,
     return false;
   }
 
-  snprintf(devname_out, devname_size, "/dev/md%d", unit_id);
-  if (!wait_for_dev_node_state(devname_out, true)) {
+  snprintf(devname_out, devname_size, MD_DEV_PREFIX "%d", unit_id);
+  uint64_t node_start_us = sm_mount_stats_begin();
+  bool node_ready = wait_for_dev_node_state(devname_out, true);
+  sm_mount_stats_end(SM_MOUNT_PHASE_DEV_NODE, fs_type, ATTACH_BACKEND_MD,
+                     node_start_us);
+  if (!node_ready) {
     log_debug("  [IMG][%s] device node did not appear: %s",
               attach_backend_name(ATTACH_BACKEND_MD), devname_out);
     (void)detach_attached_unit(ATTACH_BACKEND_MD, unit_id);
@@ -398,10 +440,39 @@ static bool attach_md_backend(const char *file_path, image_fs_type_t fs_type,
   return true;
 }
 
+// Describe one file layer, with its allocation bitmap when it has one.
+static bool fill_lvd_file_layer(lvd_ioctl_layer_v0_t *layer, const char *path,
+                                off_t size, const image_bitmap_t *bitmap,
+                                uint32_t sector_size) {
+  layer->source_type = get_lvd_source_type(path);
+  layer->flags = LVD_ENTRY_FLAG_NO_BITMAP;
+  layer->path = path;
+  layer->offset = 0;
+  layer->size = (uint64_t)size;
+  if (!bitmap->present)
+    return true;
+
+  const image_bitmap_header_t *header = &bitmap->header;
+  if (header->block_size % sector_size != 0) {
+    sm_error_set("IMG", EINVAL, path,
+                 "Bitmap block size %u is not a multiple of sector %u",
+                 header->block_size, sector_size);
+    log_debug("  [IMG][%s] %s", attach_backend_name(ATTACH_BACKEND_LVD),
+              sm_last_error()->message);
+    errno = EINVAL;
+    return false;
+  }
+  layer->flags = 0;
+  layer->bitmap_path = bitmap->path;
+  layer->bitmap_offset = header->bitmap_offset;
+  layer->bitmap_size = header->bitmap_size;
+  return true;
+}
+
 static bool attach_lvd_backend(const char *file_path, image_fs_type_t fs_type,
                                bool mount_read_only, off_t file_size,
-                               int *unit_id_out, char *devname_out,
-                               size_t devname_size) {
+                               const image_layers_t *stack, int *unit_id_out,
+                               char *devname_out, size_t devname_size) {
 /*  if (pfs_path_is_nested_inner(file_path, fs_type)) {
     struct stat req;
     memset(&req, 0, sizeof(req));
@@ -439,15 +510,25 @@ static bool attach_lvd_backend(const char *file_path, image_fs_type_t fs_type,
     return false;
   }
 
-  lvd_ioctl_layer_v0_t layers[LVD_ATTACH_LAYER_COUNT];
+  // The base image is layer 0; delta layers follow bottom to top.
+  uint32_t sector_size = get_lvd_sector_size(file_path, fs_type);
+  lvd_ioctl_layer_v0_t layers[LVD_ATTACH_LAYER_ARRAY_SIZE];
   memset(layers, 0, sizeof(layers));
-  layers[0].source_type = get_lvd_source_type(file_path);
-  layers[0].flags = LVD_ENTRY_FLAG_NO_BITMAP;
-  layers[0].path = file_path;
-  layers[0].offset = 0;
-  layers[0].size = (uint64_t)file_size;
+  uint32_t layer_count = LVD_ATTACH_LAYER_COUNT;
+  bool layers_ok = fill_lvd_file_layer(&layers[0], file_path, file_size,
+                                       &stack->base, sector_size);
+  for (int i = 0; layers_ok && i < stack->delta_count; i++) {
+    layers_ok = fill_lvd_file_layer(&layers[layer_count],
+                                    stack->delta_paths[i],
+                                    stack->delta_sizes[i], &stack->deltas[i],
+                                    sector_size);
+    layer_count++;
+  }
+  if (!layers_ok) {
+    close(lvd_fd);
+    return false;
+  }
 
-  uint32_t sector_size = get_lvd_sector_size(file_path, fs_type);
   uint32_t secondary_unit = get_lvd_secondary_unit(file_path, fs_type);
   uint16_t raw_flags = get_lvd_attach_raw_flags(fs_type, mount_read_only);
   uint16_t normalized_flags = normalize_lvd_raw_flags(raw_flags);
@@ -456,8 +537,8 @@ static bool attach_lvd_backend(const char *file_path, image_fs_type_t fs_type,
   memset(&req, 0, sizeof(req));
   req.io_version = LVD_ATTACH_IO_VERSION_V0;
   req.image_type = get_lvd_image_type(file_path, fs_type);
-  req.layer_count = LVD_ATTACH_LAYER_COUNT;
-  req.device_size = (uint64_t)file_size;
+  req.layer_count = layer_count;
+  req.device_size = image_layers_device_size(stack, file_size);
   req.layers_ptr = layers;
   req.sector_size = sector_size;
   req.secondary_unit = secondary_unit;
@@ -466,14 +547,17 @@ static bool attach_lvd_backend(const char *file_path, image_fs_type_t fs_type,
 
   int last_errno = 0;
   log_debug("  [IMG][%s] attach try: ver=%u sec=%u sec2=%u raw=0x%x "
-            "flags=0x%x img=%u",
+            "flags=0x%x img=%u layers=%u",
             attach_backend_name(ATTACH_BACKEND_LVD), req.io_version,
             req.sector_size, req.secondary_unit, raw_flags, req.flags,
-            req.image_type);
+            req.image_type, req.layer_count);
+  uint64_t attach_start_us = sm_mount_stats_begin();
   int ret = ioctl(lvd_fd, SCE_LVD_IOC_ATTACH_V0, &req);
   if (ret != 0)
     last_errno = errno;
   close(lvd_fd);
+  sm_mount_stats_end(SM_MOUNT_PHASE_ATTACH, fs_type, ATTACH_BACKEND_LVD,
+                     attach_start_us);
   int unit_id = req.device_id;
 
   if (ret != 0) {
@@ -491,8 +575,12 @@ static bool attach_lvd_backend(const char *file_path, image_fs_type_t fs_type,
   log_debug("  [IMG][%s] attach returned unit=%d",
             attach_backend_name(ATTACH_BACKEND_LVD), unit_id);
 
-  snprintf(devname_out, devname_size, "/dev/lvd%d", unit_id);
-  if (!wait_for_dev_node_state(devname_out, true)) {
+  snprintf(devname_out, devname_size, LVD_DEV_PREFIX "%d", unit_id);
+  uint64_t node_start_us = sm_mount_stats_begin();
+  bool node_ready = wait_for_dev_node_state(devname_out, true);
+  sm_mount_stats_end(SM_MOUNT_PHASE_DEV_NODE, fs_type, ATTACH_BACKEND_LVD,
+                     node_start_us);
+  if (!node_ready) {
     log_debug("  [IMG][%s] device node did not appear: %s",
               attach_backend_name(ATTACH_BACKEND_LVD), devname_out);
     (void)detach_attached_unit(ATTACH_BACKEND_LVD, unit_id);
@@ -515,17 +603,6 @@ static const image_backend_ops_t *get_image_backend_ops(attach_backend_t backend
   return NULL;
 }
 
-static bool is_cached_image_path(const char *file_path) {
-  for (int k = 0; k < MAX_IMAGE_MOUNTS; k++) {
-    image_cache_entry_t cached_entry;
-    if (get_image_cache_entry(k, &cached_entry) &&
-        strcmp(cached_entry.path, file_path) == 0) {
-      return true;
-    }
-  }
-  return false;
-}
-
 static bool directory_has_visible_entries(const char *path) {
   DIR *dir = opendir(path);
   if (!dir)
@@ -558,6 +635,80 @@ static bool is_image_mount_root_accessible(const char *mount_point,
   return true;
 }
 
+// The game cache and path state belong to the scan thread and are not locked.
+// Image mounts dropped on any other thread (attach-pool workers, the lifecycle
+// watcher) are queued here and their entries cleared by the scan thread.
+typedef struct {
+  sm_path_id_t mount_point;
+  bool clear_missing_param;
+} dropped_image_mount_t;
+
+static pthread_t g_image_bookkeeping_thread;
+static bool g_image_bookkeeping_thread_set = false;
+static pthread_mutex_t g_dropped_mounts_mutex = PTHREAD_MUTEX_INITIALIZER;
+static dropped_image_mount_t *g_dropped_mounts = NULL;
+static int g_dropped_mount_capacity = 0;
+static int g_dropped_mount_count = 0;
+
+void set_image_bookkeeping_thread(void) {
+  g_image_bookkeeping_thread = pthread_self();
+  g_image_bookkeeping_thread_set = true;
+}
+
+static bool on_image_bookkeeping_thread(void) {
+  return !g_image_bookkeeping_thread_set ||
+         pthread_equal(g_image_bookkeeping_thread, pthread_self());
+}
+
+static void forget_image_mount_entries(const char *mount_point,
+                                       bool clear_missing_param) {
+  clear_cached_game(mount_point);
+  if (clear_missing_param)
+    clear_missing_param_entry(mount_point);
+}
+
+static void drop_image_mount_entries(const char *mount_point,
+                                     bool clear_missing_param) {
+  if (on_image_bookkeeping_thread()) {
+    forget_image_mount_entries(mount_point, clear_missing_param);
+    return;
+  }
+
+  pthread_mutex_lock(&g_dropped_mounts_mutex);
+  bool queued = false;
+  if (sm_state_table_reserve((void **)&g_dropped_mounts,
+                             &g_dropped_mount_capacity,
+                             g_dropped_mount_count + 1,
+                             sizeof(*g_dropped_mounts))) {
+    dropped_image_mount_t *dropped = &g_dropped_mounts[g_dropped_mount_count];
+    dropped->mount_point = sm_path_intern(mount_point);
+    dropped->clear_missing_param = clear_missing_param;
+    queued = dropped->mount_point != SM_PATH_ID_NONE;
+    if (queued)
+      g_dropped_mount_count++;
+  }
+  pthread_mutex_unlock(&g_dropped_mounts_mutex);
+  if (!queued)
+    log_debug("  [IMG] cannot queue cache cleanup for %s", mount_point);
+}
+
+void flush_dropped_image_mounts(void) {
+  pthread_mutex_lock(&g_dropped_mounts_mutex);
+  dropped_image_mount_t *dropped = g_dropped_mounts;
+  int count = g_dropped_mount_count;
+  g_dropped_mounts = NULL;
+  g_dropped_mount_capacity = 0;
+  g_dropped_mount_count = 0;
+  pthread_mutex_unlock(&g_dropped_mounts_mutex);
+
+  for (int i = 0; i < count; i++) {
+    forget_image_mount_entries(sm_path_str(dropped[i].mount_point),
+                               dropped[i].clear_missing_param);
+    sm_path_clear(&dropped[i].mount_point);
+  }
+  free(dropped);
+}
+
 static bool reject_mounted_image_io(const char *file_path,
                                     attach_backend_t attach_backend, int unit_id,
                                     const char *devname,
@@ -592,10 +743,9 @@ static bool prepare_image_mount_retry(const image_cache_entry_t *cached_entry,
     log_debug("  [IMG][%s] mount lost, retrying: %s -> %s",
               attach_backend_name(cached_entry->backend), source_path,
               mount_point);
-    clear_cached_game(mount_point);
   }
 
-  clear_missing_param_entry(mount_point);
+  drop_image_mount_entries(mount_point, true);
   return true;
 }
 
@@ -657,7 +807,7 @@ static bool handle_cached_or_existing_image_mount_locked(
   if (runtime_sleep_mode_active())
     return true;
 
-  if (is_cached_image_path(file_path)) {
+  if (is_image_cache_source(file_path)) {
     if (success_out)
       *success_out = true;
     return true;
@@ -687,6 +837,44 @@ static bool stat_image_file(const char *file_path, struct stat *st_out) {
   return true;
 }
 
+// Reject images whose filesystem header cannot be mounted as fs_type before
+// any device is attached.
+static bool check_image_header(const char *file_path, image_fs_type_t fs_type,
+                               uint64_t device_size) {
+  if (fs_type == IMAGE_FS_PFSC_CONTAINER)
+    return true;
+  image_probe_t probe;
+  if (!get_image_probe(file_path, &probe))
+    return true;
+
+  log_debug("  [IMG] header probe: %s fs=%s block=%u fs_size=%llu", file_path,
+            probe.fs_type != IMAGE_FS_UNKNOWN ? image_fs_name(probe.fs_type)
+                                              : "unknown",
+            probe.block_size, (unsigned long long)probe.fs_size);
+  // PFS headers may be unreadable (e.g. encrypted), so only a foreign header
+  // rules a PFS image out.
+  bool header_required = fs_type == IMAGE_FS_UFS || fs_type == IMAGE_FS_EXFAT;
+  if (probe.fs_type == IMAGE_FS_UNKNOWN && header_required) {
+    sm_error_set("IMG", EINVAL, file_path, "No %s filesystem header found",
+                 image_fs_name(fs_type));
+  } else if (probe.fs_type != IMAGE_FS_UNKNOWN && probe.fs_type != fs_type) {
+    sm_error_set("IMG", EINVAL, file_path,
+                 "Image contains %s, expected %s", image_fs_name(probe.fs_type),
+                 image_fs_name(fs_type));
+  } else if (probe.fs_size > device_size) {
+    sm_error_set("IMG", EINVAL, file_path,
+                 "Image is truncated (%llu of %llu bytes)",
+                 (unsigned long long)device_size,
+                 (unsigned long long)probe.fs_size);
+  } else {
+    return true;
+  }
+
+  log_debug("  [IMG] %s: %s", sm_last_error()->message, file_path);
+  errno = EINVAL;
+  return false;
+}
+
 static void ensure_mount_dirs(const char *mount_point) {
   mkdir(IMAGE_MOUNT_BASE, 0777);
   if (is_pfsc_image_mount_base_or_child(mount_point))
@@ -705,6 +893,7 @@ static attach_backend_t select_image_backend(const runtime_config_t *cfg,
 
 static bool attach_image_device(const char *file_path, image_fs_type_t fs_type,
                                 bool mount_read_only, off_t file_size,
+                                const image_layers_t *stack,
                                 attach_backend_t attach_backend, int *unit_id_out,
                                 char *devname_out, size_t devname_size) {
   const image_backend_ops_t *backend_ops = get_image_backend_ops(attach_backend);
@@ -715,7 +904,7 @@ static bool attach_image_device(const char *file_path, image_fs_type_t fs_type,
   }
 
   if (!backend_ops->attach(file_path, fs_type, mount_read_only, file_size,
-                           unit_id_out, devname_out, devname_size)) {
+                           stack, unit_id_out, devname_out, devname_size)) {
     return false;
   }
 
@@ -853,7 +1042,7 @@ static bool perform_image_nmount(const char *file_path, image_fs_type_t fs_type,
   const char *mount_mode = NULL;
   unsigned int mount_flags =
       get_nmount_flags(fs_type, mount_read_only, &mount_mode);
-  if (nmount(iov, iovlen, (int)mount_flags) == 0)
+  if (mount_table_nmount(iov, iovlen, (int)mount_flags) == 0)
     return true;
 
   int mount_errno = errno;
@@ -929,9 +1118,101 @@ static bool validate_mounted_image(const char *file_path, image_fs_type_t fs_typ
 }
 
 // --- Image Attach + nmount Pipeline ---
-bool mount_image(const char *file_path, image_fs_type_t fs_type) {
+// Per-image claims. The attach, device node wait and nmount of an image run
+// without the runtime mount lock so other images can attach meanwhile, so
+// the lock no longer covers a whole mount. What replaces it: every change to
+// one image's attach or mount state (mount_image, unmount_image,
+// park_image_mount and the stale-mount retry) runs with that image's claim
+// held, and the runtime mount lock only guards the image cache and shared
+// mount state for the short sections that touch them. Claims are taken before
+// the lock; a thread holding the lock never waits for a claim, so unmounts
+// and parks only try to claim and give up on an image another thread has in
+// flight. A thread may claim an image it already holds.
+#define MAX_IMAGE_MOUNTS_IN_FLIGHT (MAX_IMAGE_ATTACH_WORKERS + 4u)
+typedef struct {
+  const char *path;
+  pthread_t owner;
+  int depth;
+} image_mount_claim_t;
+
+static image_mount_claim_t g_image_mounts_in_flight[MAX_IMAGE_MOUNTS_IN_FLIGHT];
+static pthread_mutex_t g_image_in_flight_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_image_in_flight_cond = PTHREAD_COND_INITIALIZER;
+
+// Returns the slot holding file_path, else -1 with *free_out set to a free
+// slot or -1.
+static int find_image_mount_in_flight_locked(const char *file_path,
+                                             int *free_out) {
+  *free_out = -1;
+  for (int i = 0; i < (int)MAX_IMAGE_MOUNTS_IN_FLIGHT; i++) {
+    const char *path = g_image_mounts_in_flight[i].path;
+    if (!path) {
+      if (*free_out < 0)
+        *free_out = i;
+      continue;
+    }
+    if (strcmp(path, file_path) == 0)
+      return i;
+  }
+  return -1;
+}
+
+// Claim file_path for the calling thread. Returns the slot, or -1 when
+// another thread holds it (or the table is full) and wait is false.
+static int acquire_image_mount_claim(const char *file_path, bool wait) {
+  pthread_mutex_lock(&g_image_in_flight_mutex);
+  int slot = -1;
+  for (;;) {
+    int free_slot = -1;
+    int held = find_image_mount_in_flight_locked(file_path, &free_slot);
+    if (held >= 0 &&
+        pthread_equal(g_image_mounts_in_flight[held].owner, pthread_self())) {
+      g_image_mounts_in_flight[held].depth++;
+      slot = held;
+      break;
+    }
+    if (held < 0 && free_slot >= 0) {
+      g_image_mounts_in_flight[free_slot].path = file_path;
+      g_image_mounts_in_flight[free_slot].owner = pthread_self();
+      g_image_mounts_in_flight[free_slot].depth = 1;
+      slot = free_slot;
+      break;
+    }
+    if (!wait)
+      break;
+    pthread_cond_wait(&g_image_in_flight_cond, &g_image_in_flight_mutex);
+  }
+  pthread_mutex_unlock(&g_image_in_flight_mutex);
+  return slot;
+}
+
+static int claim_image_mount(const char *file_path) {
+  return acquire_image_mount_claim(file_path, true);
+}
+
+static int try_claim_image_mount(const char *file_path) {
+  return acquire_image_mount_claim(file_path, false);
+}
+
+static void release_image_mount(int slot) {
+  pthread_mutex_lock(&g_image_in_flight_mutex);
+  if (--g_image_mounts_in_flight[slot].depth == 0) {
+    g_image_mounts_in_flight[slot].path = NULL;
+    pthread_cond_broadcast(&g_image_in_flight_cond);
+  }
+  pthread_mutex_unlock(&g_image_in_flight_mutex);
+}
+
+static bool mount_image_claimed(const char *file_path,
+                                image_fs_type_t fs_type) {
   sm_error_clear();
+  uint64_t mount_start_us = sm_mount_stats_begin();
   const runtime_config_t *cfg = runtime_config();
+  uint64_t phase_start_us = sm_mount_stats_begin();
+  attach_backend_t attach_backend = select_image_backend(cfg, fs_type);
+  sm_mount_stats_end(SM_MOUNT_PHASE_BACKEND, fs_type, attach_backend,
+                     phase_start_us);
+  phase_start_us = sm_mount_stats_begin();
   bool mount_read_only = cfg->mount_read_only;
   bool mount_mode_overridden = false;
   bool force_mount = cfg->force_mount;
@@ -941,6 +1222,8 @@ bool mount_image(const char *file_path, image_fs_type_t fs_type) {
         get_image_mode_override(filename, &mount_read_only);
   if (pfs_path_uses_nested_profile(file_path, fs_type))
     mount_read_only = true;
+  sm_mount_stats_end(SM_MOUNT_PHASE_OVERRIDE, fs_type, attach_backend,
+                     phase_start_us);
 
   if (runtime_sleep_mode_active())
     return false;
@@ -961,6 +1244,23 @@ bool mount_image(const char *file_path, image_fs_type_t fs_type) {
   struct stat st;
   if (!stat_image_file(file_path, &st))
     return false;
+  image_layers_t stack;
+  if (!load_image_layers(file_path, &st, &stack))
+    return false;
+  if (image_layers_need_lvd(&stack)) {
+    // Writes could not mark new blocks in a bitmap, and only LVD takes
+    // bitmaps and several layers.
+    mount_read_only = true;
+    if (attach_backend != ATTACH_BACKEND_LVD) {
+      log_debug("  [IMG] bitmap or delta layers present, using %s for %s",
+                attach_backend_name(ATTACH_BACKEND_LVD), file_path);
+      attach_backend = ATTACH_BACKEND_LVD;
+    }
+  }
+  if (!check_image_header(file_path, fs_type,
+                          image_layers_device_size(&stack, st.st_size))) {
+    return false;
+  }
   if (runtime_sleep_mode_active())
     return false;
   runtime_mount_state_lock();
@@ -985,36 +1285,46 @@ bool mount_image(const char *file_path, image_fs_type_t fs_type) {
 
   ensure_mount_dirs(mount_point);
 
-  attach_backend_t attach_backend = select_image_backend(cfg, fs_type);
   log_debug("  [IMG][%s] attach backend selected for %s",
             attach_backend_name(attach_backend), file_path);
 
+  // Attach, device node wait and nmount mostly wait on the kernel. They run
+  // unlocked so other images can attach meanwhile; the claim keeps this image
+  // and its mount point exclusive. A failure here only detaches.
+  runtime_mount_state_unlock();
   int unit_id = -1;
   char devname[64];
   memset(devname, 0, sizeof(devname));
   if (!attach_image_device(file_path, fs_type, mount_read_only, st.st_size,
-                           attach_backend, &unit_id, devname, sizeof(devname))) {
-    runtime_mount_state_unlock();
+                           &stack, attach_backend, &unit_id, devname,
+                           sizeof(devname))) {
     return false;
   }
   if (runtime_sleep_mode_active()) {
     (void)detach_attached_unit(attach_backend, unit_id);
-    runtime_mount_state_unlock();
     return false;
   }
-  if (!perform_image_nmount(file_path, fs_type, attach_backend, unit_id, devname,
-                            mount_point, mount_read_only, force_mount)) {
-    runtime_mount_state_unlock();
+  phase_start_us = sm_mount_stats_begin();
+  bool nmounted =
+      perform_image_nmount(file_path, fs_type, attach_backend, unit_id,
+                           devname, mount_point, mount_read_only, force_mount);
+  sm_mount_stats_end(SM_MOUNT_PHASE_NMOUNT, fs_type, attach_backend,
+                     phase_start_us);
+  if (!nmounted)
     return false;
-  }
+  runtime_mount_state_lock();
   if (runtime_sleep_mode_active()) {
     (void)unmount_image(file_path, unit_id, attach_backend);
     runtime_mount_state_unlock();
     return false;
   }
 
-  if (!validate_mounted_image(file_path, fs_type, attach_backend, unit_id,
-                              devname, mount_point)) {
+  phase_start_us = sm_mount_stats_begin();
+  bool valid = validate_mounted_image(file_path, fs_type, attach_backend,
+                                      unit_id, devname, mount_point);
+  sm_mount_stats_end(SM_MOUNT_PHASE_VALIDATE, fs_type, attach_backend,
+                     phase_start_us);
+  if (!valid) {
     runtime_mount_state_unlock();
     return false;
   }
@@ -1024,7 +1334,12 @@ bool mount_image(const char *file_path, image_fs_type_t fs_type) {
             devname, mount_point);
   log_fs_stats("IMG", mount_point, image_fs_name(fs_type));
 
-  if (!cache_image_mount(file_path, mount_point, unit_id, attach_backend)) {
+  phase_start_us = sm_mount_stats_begin();
+  bool cached = cache_image_mount(file_path, mount_point, unit_id,
+                                  attach_backend);
+  sm_mount_stats_end(SM_MOUNT_PHASE_PUBLISH, fs_type, attach_backend,
+                     phase_start_us);
+  if (!cached) {
     sm_error_set("IMG", ENOSPC, file_path,
                  "Image cache full (%u entries), rolling back mount",
                  (unsigned)MAX_IMAGE_MOUNTS);
@@ -1036,9 +1351,20 @@ bool mount_image(const char *file_path, image_fs_type_t fs_type) {
     return false;
   }
   runtime_mount_state_unlock();
+  sm_mount_stats_end(SM_MOUNT_PHASE_IMAGE_TOTAL, fs_type, attach_backend,
+                     mount_start_us);
   return true;
 }
 
+bool mount_image(const char *file_path, image_fs_type_t fs_type) {
+  int slot = claim_image_mount(file_path);
+  bool mounted = mount_image_claimed(file_path, fs_type);
+  int mount_err = errno;
+  release_image_mount(slot);
+  errno = mount_err;
+  return mounted;
+}
+
 static bool unmount_child_image_mounts_for_container(const char *mount_point) {
   bool all_unmounted = true;
 
@@ -1065,7 +1391,11 @@ static bool unmount_child_image_mounts_for_container(const char *mount_point) {
   return all_unmounted;
 }
 
-bool unmount_image(const char *file_path, int unit_id, attach_backend_t backend) {
+// keep_title_links: the title stays registered with its image detached
+// (mount on launch), so mount.lnk is kept and busy layers are not forced.
+static bool unmount_image_mount(const char *file_path, int unit_id,
+                                attach_backend_t backend,
+                                bool keep_title_links) {
   char mount_point[MAX_PATH];
   image_fs_type_t fs_type = detect_image_fs_type_for_path(file_path, NULL);
   build_image_mount_point_for_fs(file_path, fs_type, mount_point);
@@ -1091,19 +1421,21 @@ bool unmount_image(const char *file_path, int unit_id, attach_backend_t backend)
 
   // Remove mount.lnk and unmount /system_ex/app/<titleid> that point to this
   // source before unmounting the virtual disk itself.
-  cleanup_mount_links_for_source_unmount(mount_point);
-  clear_cached_game(mount_point);
+  if (!keep_title_links)
+    cleanup_mount_links_for_source_unmount(mount_point);
+  drop_image_mount_entries(mount_point, false);
 
   // Unmount stacked layers (unionfs over image fs).
   for (int i = 0; i < MAX_LAYERED_UNMOUNT_ATTEMPTS; i++) {
     if (!is_active_image_mount_point(mount_point))
       break;
-    if (unmount(mount_point, 0) == 0)
+    if (mount_table_unmount(mount_point, 0) == 0)
       continue;
     if (errno == ENOENT || errno == EINVAL)
       break;
-    if (unmount(mount_point, MNT_FORCE) != 0 && errno != ENOENT &&
-        errno != EINVAL) {
+    if ((keep_title_links ||
+         mount_table_unmount(mount_point, MNT_FORCE) != 0) &&
+        errno != ENOENT && errno != EINVAL) {
       log_debug("  [IMG][%s] unmount failed for %s: %s",
                 attach_backend_name(resolved_backend), mount_point,
                 strerror(errno));
@@ -1152,8 +1484,108 @@ bool unmount_image(const char *file_path, int unit_id, attach_backend_t backend)
   return detach_ok;
 }
 
+bool unmount_image(const char *file_path, int unit_id, attach_backend_t backend) {
+  int slot = try_claim_image_mount(file_path);
+  if (slot < 0) {
+    log_debug("  [IMG] unmount deferred, mount in flight: %s", file_path);
+    errno = EBUSY;
+    return false;
+  }
+  bool unmounted = unmount_image_mount(file_path, unit_id, backend, false);
+  int unmount_err = errno;
+  release_image_mount(slot);
+  errno = unmount_err;
+  return unmounted;
+}
+
+bool park_image_mount(const char *file_path, const char *title_id) {
+  int slot = try_claim_image_mount(file_path);
+  if (slot < 0) {
+    log_debug("  [IMG] park deferred, mount in flight: %s", file_path);
+    return false;
+  }
+  runtime_mount_state_lock();
+  int index = -1;
+  image_cache_entry_t cached_entry;
+  for (int k = 0; k < MAX_IMAGE_MOUNTS; k++) {
+    if (get_image_cache_entry(k, &cached_entry) &&
+        strcmp(cached_entry.path, file_path) == 0) {
+      index = k;
+      break;
+    }
+  }
+  bool unmounted = false;
+  if (index >= 0) {
+    char source_path[MAX_PATH];
+    bool has_link = read_mount_link(title_id, source_path, sizeof(source_path));
+    if (has_link && !unmount_title_mount_stack(title_id, source_path)) {
+      log_debug("  [IMG] park deferred, title mount busy: %s", title_id);
+    } else if (has_link && !mount_title_launch_stub(title_id)) {
+      // Without its stub the title could not be launched; restore it.
+      (void)mount_title_nullfs(title_id, source_path);
+      log_debug("  [IMG] park deferred, launch stub mount failed: %s",
+                title_id);
+    } else {
+      unmounted = unmount_image_mount(file_path, cached_entry.unit_id,
+                                      cached_entry.backend, true);
+      if (unmounted)
+        invalidate_image_cache_entry(index);
+    }
+  }
+  runtime_mount_state_unlock();
+  release_image_mount(slot);
+  return unmounted;
+}
+
+// Unmount or remount one image cache entry a cleanup pass found stale. Runs
+// with the image claimed, so a launch attach of the same image finishes
+// first; the entry is checked again once the claim is held.
+static void cleanup_stale_image_entry(int k,
+                                      const image_cache_entry_t *stale_entry) {
+  int slot = claim_image_mount(stale_entry->path);
+  image_cache_entry_t cached_entry;
+  if (!get_image_cache_entry(k, &cached_entry) ||
+      strcmp(cached_entry.path, stale_entry->path) != 0) {
+    release_image_mount(slot);
+    return;
+  }
+
+  if (!path_exists(cached_entry.path)) {
+    log_debug("  [IMG][%s] Source removed, unmounting: %s",
+              attach_backend_name(cached_entry.backend), cached_entry.path);
+    if (unmount_image(cached_entry.path, cached_entry.unit_id,
+                      cached_entry.backend))
+      invalidate_image_cache_entry(k);
+    release_image_mount(slot);
+    return;
+  }
+
+  image_fs_type_t fs_type =
+      detect_image_fs_type_for_path(cached_entry.path, NULL);
+  char mount_point[MAX_PATH];
+  char source_path[MAX_PATH];
+  if (!prepare_image_mount_retry(&cached_entry, mount_point, source_path)) {
+    release_image_mount(slot);
+    return;
+  }
+
+  invalidate_image_cache_entry(k);
+  bool mounted = mount_image(source_path, fs_type);
+  int mount_err = errno;
+  release_image_mount(slot);
+  if (mounted) {
+    clear_image_mount_attempts(source_path);
+    return;
+  }
+  if (bump_image_mount_attempts(source_path) == 1 && !sm_error_notified()) {
+    notify_image_mount_failed(source_path, mount_err);
+  }
+}
+
 void cleanup_stale_image_mounts(void) {
-  if (should_stop_requested())
+  // Retry counters are path state; other threads leave the reconcile to the
+  // next scan pass.
+  if (should_stop_requested() || !on_image_bookkeeping_thread())
     return;
 
   log_debug("  [IMG] stale image cleanup begin");
@@ -1168,32 +1600,7 @@ void cleanup_stale_image_mounts(void) {
               attach_backend_name(cached_entry.backend), k, cached_entry.path,
               cached_entry.mount_point);
 
-    if (!path_exists(cached_entry.path)) {
-      log_debug("  [IMG][%s] Source removed, unmounting: %s",
-                attach_backend_name(cached_entry.backend), cached_entry.path);
-      if (unmount_image(cached_entry.path, cached_entry.unit_id,
-                        cached_entry.backend))
-        invalidate_image_cache_entry(k);
-      continue;
-    }
-
-    image_fs_type_t fs_type =
-        detect_image_fs_type_for_path(cached_entry.path, NULL);
-    char mount_point[MAX_PATH];
-    char source_path[MAX_PATH];
-    if (!prepare_image_mount_retry(&cached_entry, mount_point, source_path))
-      continue;
-
-    invalidate_image_cache_entry(k);
-    if (mount_image(source_path, fs_type)) {
-      clear_image_mount_attempts(source_path);
-      continue;
-    }
-
-    int mount_err = errno;
-    if (bump_image_mount_attempts(source_path) == 1 && !sm_error_notified()) {
-      notify_image_mount_failed(source_path, mount_err);
-    }
+    cleanup_stale_image_entry(k, &cached_entry);
   }
   log_debug("  [IMG] stale image cleanup done");
 }
@@ -1204,7 +1611,7 @@ void cleanup_stale_image_mounts_for_root(const char *root) {
     return;
   }
 
-  if (should_stop_requested())
+  if (should_stop_requested() || !on_image_bookkeeping_thread())
     return;
 
   for (int k = 0; k < MAX_IMAGE_MOUNTS; k++) {
@@ -1218,35 +1625,12 @@ void cleanup_stale_image_mounts_for_root(const char *root) {
       continue;
     }
 
-    if (!path_exists(cached_entry.path)) {
-      log_debug("  [IMG][%s] Source removed, unmounting: %s",
-                attach_backend_name(cached_entry.backend), cached_entry.path);
-      if (unmount_image(cached_entry.path, cached_entry.unit_id,
-                        cached_entry.backend))
-        invalidate_image_cache_entry(k);
-      continue;
-    }
-
-    image_fs_type_t fs_type =
-        detect_image_fs_type_for_path(cached_entry.path, NULL);
-    char mount_point[MAX_PATH];
-    char source_path[MAX_PATH];
-    if (!prepare_image_mount_retry(&cached_entry, mount_point, source_path))
-      continue;
-
-    invalidate_image_cache_entry(k);
-    if (mount_image(source_path, fs_type)) {
-      clear_image_mount_attempts(source_path);
-      continue;
-    }
-
-    int mount_err = errno;
-    if (bump_image_mount_attempts(source_path) == 1 && !sm_error_notified()) {
-      notify_image_mount_failed(source_path, mount_err);
-    }
+    cleanup_stale_image_entry(k, &cached_entry);
   }
 }
 
+// Runs under the runtime mount lock. An image with a mount in flight stays
+// pending here; its mount sees sleep mode and rolls itself back.
 bool unmount_usb_image_mounts_for_suspend(void) {
   bool all_unmounted = true;
 
@@ -1324,30 +1708,46 @@ void cleanup_mount_dirs(void) {
   cleanup_mount_dirs_under(IMAGE_MOUNT_BASE, "pfsc");
 }
 
-bool maybe_mount_image_file(const char *full_path, const char *display_name,
-                            bool *unstable_out) {
+image_fs_type_t prepare_image_mount_attempt(const char *full_path,
+                                            const char *display_name,
+                                            bool *unstable_out) {
   image_fs_type_t fs_type =
       detect_image_fs_type_for_path(full_path, display_name);
   if (fs_type == IMAGE_FS_UNKNOWN)
-    return false;
+    return IMAGE_FS_UNKNOWN;
   if (!is_source_stable_for_mount(full_path, display_name, "IMG")) {
     if (unstable_out)
       *unstable_out = true;
-    return false;
+    return IMAGE_FS_UNKNOWN;
   }
   if (is_image_mount_limited(full_path))
-    return false;
+    return IMAGE_FS_UNKNOWN;
+  if (sm_image_ondemand_is_parked(full_path))
+    return IMAGE_FS_UNKNOWN;
+  return fs_type;
+}
 
-  if (mount_image(full_path, fs_type)) {
+void finish_image_mount_attempt(const char *full_path, bool mounted,
+                                int mount_err) {
+  if (mounted) {
     clear_image_mount_attempts(full_path);
-    return true;
+    return;
   }
-
-  int mount_err = errno;
   if (bump_image_mount_attempts(full_path) == 1 && !sm_error_notified()) {
     notify_image_mount_failed(full_path, mount_err);
   }
-  return false;
+}
+
+bool maybe_mount_image_file(const char *full_path, const char *display_name,
+                            bool *unstable_out) {
+  image_fs_type_t fs_type =
+      prepare_image_mount_attempt(full_path, display_name, unstable_out);
+  if (fs_type == IMAGE_FS_UNKNOWN)
+    return false;
+
+  bool mounted = mount_image(full_path, fs_type);
+  finish_image_mount_attempt(full_path, mounted, errno);
+  return mounted;
 }
 
 bool shutdown_image_mounts(void) {
@@ -0,0 +1,315 @@
+#include "sm_platform.h"
+#include "sm_image_attach_pool.h"
+
+#include <pthread.h>
+
+#include "sm_config_mount.h"
+#include "sm_image.h"
+#include "sm_image_cache.h"
+#include "sm_limits.h"
+#include "sm_log.h"
+#include "sm_path_pool.h"
+#include "sm_runtime.h"
+#include "sm_state_table.h"
+#include "sm_time.h"
+
+// Image attach worker pool. The scan thread queues images it would have
+// mounted one by one; workers run mount_image() in parallel, bounded in total
+// and per backing device. Workers start on demand and stay parked on the work
+// condition between batches until image_attach_pool_stop(). mount_image()
+// holds the image's claim for the whole attach and publishes into the image
+// cache under the runtime mount lock; retry counters and notifications are
+// recorded by the scan thread when it drains the queue.
+
+typedef enum {
+  ATTACH_JOB_QUEUED = 0,
+  ATTACH_JOB_RUNNING,
+  ATTACH_JOB_DONE,
+  ATTACH_JOB_CANCELLED,
+} attach_job_state_t;
+
+typedef struct {
+  sm_path_id_t image_path;
+  dev_t dev;
+  image_fs_type_t fs_type;
+  attach_job_state_t state;
+  bool mounted;
+  int mount_err;
+  // Last error of the worker when the attach failed; NULL otherwise.
+  sm_error_t *error;
+} image_attach_job_t;
+
+typedef struct {
+  dev_t dev;
+  int active;
+} attach_device_slot_t;
+
+static image_attach_job_t *g_attach_jobs = NULL;
+static int g_attach_capacity = 0;
+static int g_attach_count = 0;
+// First job that may still be queued.
+static int g_attach_next = 0;
+// Jobs queued or running.
+static int g_attach_pending = 0;
+static bool g_attach_closing = false;
+static pthread_t g_attach_threads[MAX_IMAGE_ATTACH_WORKERS];
+static int g_attach_thread_count = 0;
+static attach_device_slot_t g_attach_devices[MAX_IMAGE_ATTACH_WORKERS];
+static uint64_t g_attach_batch_start_us = 0;
+static pthread_mutex_t g_attach_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_attach_work_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t g_attach_done_cond = PTHREAD_COND_INITIALIZER;
+
+static int get_attach_worker_limit(void) {
+  uint32_t workers = runtime_config()->image_attach_workers;
+  if (workers > MAX_IMAGE_ATTACH_WORKERS)
+    workers = MAX_IMAGE_ATTACH_WORKERS;
+  return (int)workers;
+}
+
+static int get_attach_device_limit(void) {
+  return (int)runtime_config()->image_attach_per_device;
+}
+
+static attach_device_slot_t *find_attach_device_locked(dev_t dev) {
+  for (int i = 0; i < (int)MAX_IMAGE_ATTACH_WORKERS; i++) {
+    if (g_attach_devices[i].active > 0 && g_attach_devices[i].dev == dev)
+      return &g_attach_devices[i];
+  }
+  return NULL;
+}
+
+static bool acquire_attach_device_locked(dev_t dev) {
+  attach_device_slot_t *slot = find_attach_device_locked(dev);
+  if (slot) {
+    if (slot->active >= get_attach_device_limit())
+      return false;
+    slot->active++;
+    return true;
+  }
+  // Running jobs never exceed the worker count, so a slot is always free.
+  for (int i = 0; i < (int)MAX_IMAGE_ATTACH_WORKERS; i++) {
+    if (g_attach_devices[i].active == 0) {
+      g_attach_devices[i].dev = dev;
+      g_attach_devices[i].active = 1;
+      return true;
+    }
+  }
+  return false;
+}
+
+static void release_attach_device_locked(dev_t dev) {
+  attach_device_slot_t *slot = find_attach_device_locked(dev);
+  if (slot)
+    slot->active--;
+}
+
+// Pick the oldest queued job whose backing device has a free slot.
+static int take_attach_job_locked(void) {
+  while (g_attach_next < g_attach_count &&
+         g_attach_jobs[g_attach_next].state != ATTACH_JOB_QUEUED) {
+    g_attach_next++;
+  }
+  for (int i = g_attach_next; i < g_attach_count; i++) {
+    image_attach_job_t *job = &g_attach_jobs[i];
+    if (job->state != ATTACH_JOB_QUEUED)
+      continue;
+    if (!acquire_attach_device_locked(job->dev))
+      continue;
+    job->state = ATTACH_JOB_RUNNING;
+    return i;
+  }
+  return -1;
+}
+
+static void *image_attach_worker_main(void *arg) {
+  (void)arg;
+  pthread_mutex_lock(&g_attach_mutex);
+  for (;;) {
+    int index = take_attach_job_locked();
+    if (index < 0) {
+      if (g_attach_closing)
+        break;
+      pthread_cond_wait(&g_attach_work_cond, &g_attach_mutex);
+      continue;
+    }
+
+    // The table may grow while the job runs; keep copies, not pointers.
+    sm_path_id_t image_path = g_attach_jobs[index].image_path;
+    image_fs_type_t fs_type = g_attach_jobs[index].fs_type;
+    pthread_mutex_unlock(&g_attach_mutex);
+
+    bool cancelled = should_stop_requested() || runtime_sleep_mode_active();
+    bool mounted = false;
+    int mount_err = 0;
+    sm_error_t *error = NULL;
+    if (!cancelled) {
+      mounted = mount_image(sm_path_str(image_path), fs_type);
+      mount_err = errno;
+      if (!mounted && sm_last_error()->valid) {
+        error = (sm_error_t *)malloc(sizeof(*error));
+        if (error)
+          *error = *sm_last_error();
+      }
+    }
+
+    pthread_mutex_lock(&g_attach_mutex);
+    image_attach_job_t *job = &g_attach_jobs[index];
+    job->state = cancelled ? ATTACH_JOB_CANCELLED : ATTACH_JOB_DONE;
+    job->mounted = mounted;
+    job->mount_err = mount_err;
+    job->error = error;
+    release_attach_device_locked(job->dev);
+    g_attach_pending--;
+    // A freed device slot can unblock a queued job another worker skipped.
+    pthread_cond_broadcast(&g_attach_work_cond);
+    if (g_attach_pending == 0)
+      pthread_cond_broadcast(&g_attach_done_cond);
+  }
+  pthread_mutex_unlock(&g_attach_mutex);
+  return NULL;
+}
+
+static void start_attach_worker_locked(void) {
+  if (g_attach_thread_count < get_attach_worker_limit() &&
+      g_attach_thread_count < g_attach_pending) {
+    int rc = pthread_create(&g_attach_threads[g_attach_thread_count], NULL,
+                            image_attach_worker_main, NULL);
+    if (rc == 0)
+      g_attach_thread_count++;
+    else
+      log_debug("  [IMG] attach worker start failed: %s", strerror(rc));
+  }
+  pthread_cond_signal(&g_attach_work_cond);
+}
+
+static bool queue_attach_job(const char *full_path, dev_t dev,
+                             image_fs_type_t fs_type) {
+  pthread_mutex_lock(&g_attach_mutex);
+  if (!sm_state_table_reserve((void **)&g_attach_jobs, &g_attach_capacity,
+                              g_attach_count + 1, sizeof(*g_attach_jobs))) {
+    pthread_mutex_unlock(&g_attach_mutex);
+    return false;
+  }
+  image_attach_job_t *job = &g_attach_jobs[g_attach_count];
+  memset(job, 0, sizeof(*job));
+  job->image_path = sm_path_intern(full_path);
+  if (job->image_path == SM_PATH_ID_NONE) {
+    pthread_mutex_unlock(&g_attach_mutex);
+    return false;
+  }
+  job->dev = dev;
+  job->fs_type = fs_type;
+  job->state = ATTACH_JOB_QUEUED;
+  if (g_attach_count == 0)
+    g_attach_batch_start_us = monotonic_time_us();
+  g_attach_count++;
+  g_attach_pending++;
+  // A worker only waits for a device slot while another job on that device
+  // runs, and that job wakes it when done, so the queue always drains.
+  start_attach_worker_locked();
+  bool started = g_attach_thread_count > 0;
+  if (!started) {
+    g_attach_count--;
+    g_attach_pending--;
+    sm_path_clear(&job->image_path);
+  }
+  pthread_mutex_unlock(&g_attach_mutex);
+  return started;
+}
+
+bool image_attach_pool_submit(const char *full_path, const char *display_name,
+                              bool *unstable_out) {
+  if (get_attach_worker_limit() <= 1 || is_image_cache_source(full_path))
+    return maybe_mount_image_file(full_path, display_name, unstable_out);
+
+  image_fs_type_t fs_type =
+      prepare_image_mount_attempt(full_path, display_name, unstable_out);
+  if (fs_type == IMAGE_FS_UNKNOWN)
+    return false;
+
+  struct stat st;
+  if (stat(full_path, &st) != 0 || !queue_attach_job(full_path, st.st_dev,
+                                                     fs_type)) {
+    bool mounted = mount_image(full_path, fs_type);
+    finish_image_mount_attempt(full_path, mounted, errno);
+    return mounted;
+  }
+  return true;
+}
+
+void image_attach_pool_drain(void) {
+  pthread_mutex_lock(&g_attach_mutex);
+  if (g_attach_count == 0) {
+    pthread_mutex_unlock(&g_attach_mutex);
+    flush_dropped_image_mounts();
+    return;
+  }
+  while (g_attach_pending > 0)
+    pthread_cond_wait(&g_attach_done_cond, &g_attach_mutex);
+  int thread_count = g_attach_thread_count;
+  pthread_mutex_unlock(&g_attach_mutex);
+  flush_dropped_image_mounts();
+
+  // Nothing is queued or running and only this thread queues, so the jobs are
+  // owned here until the queue is reset; idle workers never touch them.
+  int mounted_count = 0;
+  int failed_count = 0;
+  for (int i = 0; i < g_attach_count; i++) {
+    image_attach_job_t *job = &g_attach_jobs[i];
+    if (job->state == ATTACH_JOB_DONE) {
+      sm_error_restore(job->error);
+      finish_image_mount_attempt(sm_path_str(job->image_path), job->mounted,
+                                 job->mount_err);
+      if (job->mounted)
+        mounted_count++;
+      else
+        failed_count++;
+    }
+    free(job->error);
+    sm_path_clear(&job->image_path);
+  }
+  sm_error_clear();
+  log_debug("  [IMG] attach pool: %d image(s), %d mounted, %d failed, "
+            "%d worker(s), %llu ms",
+            g_attach_count, mounted_count, failed_count, thread_count,
+            (unsigned long long)((monotonic_time_us() -
+                                  g_attach_batch_start_us) /
+                                 1000ull));
+
+  pthread_mutex_lock(&g_attach_mutex);
+  memset(g_attach_jobs, 0, (size_t)g_attach_count * sizeof(*g_attach_jobs));
+  g_attach_count = 0;
+  g_attach_next = 0;
+  pthread_mutex_unlock(&g_attach_mutex);
+}
+
+void image_attach_pool_stop(void) {
+  image_attach_pool_drain();
+
+  pthread_mutex_lock(&g_attach_mutex);
+  g_attach_closing = true;
+  pthread_cond_broadcast(&g_attach_work_cond);
+  int thread_count = g_attach_thread_count;
+  pthread_mutex_unlock(&g_attach_mutex);
+
+  for (int i = 0; i < thread_count; i++)
+    (void)pthread_join(g_attach_threads[i], NULL);
+
+  pthread_mutex_lock(&g_attach_mutex);
+  g_attach_thread_count = 0;
+  g_attach_closing = false;
+  free(g_attach_jobs);
+  g_attach_jobs = NULL;
+  g_attach_capacity = 0;
+  pthread_mutex_unlock(&g_attach_mutex);
+}
+
+void image_attach_pool_memory_usage(sm_state_table_usage_t *out) {
+  pthread_mutex_lock(&g_attach_mutex);
+  out->name = "image_attach_jobs";
+  out->count = g_attach_count;
+  out->capacity = g_attach_capacity;
+  out->bytes = (size_t)g_attach_capacity * sizeof(*g_attach_jobs);
+  pthread_mutex_unlock(&g_attach_mutex);
+}
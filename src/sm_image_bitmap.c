@@ -0,0 +1,146 @@
+#include "sm_platform.h"
+#include "sm_image_bitmap.h"
+
+#include "sm_image_sidecar.h"
+#include "sm_log.h"
+
+// Header layout (little-endian):
+//   0 magic[8]  8 version u32  12 block_size u32  16 device_size u64
+//   24 data_size u64  32 bitmap_offset u64  40 bitmap_size u64
+//   48 head_hash u64  56 base_hash u64
+// Bit i (byte i / 8, bit i % 8) covers device bytes [i, i + 1) * block_size.
+
+static void put_le32(uint8_t *p, uint32_t v) {
+  for (int i = 0; i < 4; i++)
+    p[i] = (uint8_t)(v >> (8 * i));
+}
+
+static void put_le64(uint8_t *p, uint64_t v) {
+  for (int i = 0; i < 8; i++)
+    p[i] = (uint8_t)(v >> (8 * i));
+}
+
+static uint32_t get_le32(const uint8_t *p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) |
+         ((uint32_t)p[3] << 24);
+}
+
+static uint64_t get_le64(const uint8_t *p) {
+  return (uint64_t)get_le32(p) | ((uint64_t)get_le32(p + 4) << 32);
+}
+
+bool build_image_bitmap_path(const char *image_path, char *out,
+                             size_t out_size) {
+  int written = snprintf(out, out_size, "%s%s", image_path,
+                         IMAGE_BITMAP_SUFFIX);
+  return written >= 0 && (size_t)written < out_size;
+}
+
+uint64_t image_bitmap_size_for(uint64_t device_size, uint32_t block_size) {
+  if (block_size == 0)
+    return 0;
+  uint64_t blocks = (device_size + block_size - 1u) / block_size;
+  return (blocks + 7u) / 8u;
+}
+
+void encode_image_bitmap_header(const image_bitmap_header_t *header,
+                                uint8_t *out) {
+  memset(out, 0, IMAGE_BITMAP_HEADER_SIZE);
+  memcpy(out, IMAGE_BITMAP_MAGIC, 8);
+  put_le32(out + 8, IMAGE_BITMAP_VERSION);
+  put_le32(out + 12, header->block_size);
+  put_le64(out + 16, header->device_size);
+  put_le64(out + 24, header->data_size);
+  put_le64(out + 32, header->bitmap_offset);
+  put_le64(out + 40, header->bitmap_size);
+  put_le64(out + 48, header->head_hash);
+  put_le64(out + 56, header->base_hash);
+}
+
+bool decode_image_bitmap_header(const uint8_t *in,
+                                image_bitmap_header_t *out) {
+  if (memcmp(in, IMAGE_BITMAP_MAGIC, 8) != 0 ||
+      get_le32(in + 8) != IMAGE_BITMAP_VERSION) {
+    return false;
+  }
+  memset(out, 0, sizeof(*out));
+  out->block_size = get_le32(in + 12);
+  out->device_size = get_le64(in + 16);
+  out->data_size = get_le64(in + 24);
+  out->bitmap_offset = get_le64(in + 32);
+  out->bitmap_size = get_le64(in + 40);
+  out->head_hash = get_le64(in + 48);
+  out->base_hash = get_le64(in + 56);
+
+  uint32_t bs = out->block_size;
+  if (bs < IMAGE_BITMAP_MIN_BLOCK_SIZE || bs > IMAGE_BITMAP_MAX_BLOCK_SIZE ||
+      (bs & (bs - 1u)) != 0) {
+    return false;
+  }
+  return out->device_size != 0 && out->data_size <= out->device_size &&
+         out->bitmap_offset >= IMAGE_BITMAP_HEADER_SIZE &&
+         out->bitmap_size == image_bitmap_size_for(out->device_size, bs);
+}
+
+static bool read_image_bitmap_header(const char *bitmap_path,
+                                     image_bitmap_header_t *out) {
+  int fd = open(bitmap_path, O_RDONLY);
+  if (fd < 0)
+    return false;
+  uint8_t raw[IMAGE_BITMAP_HEADER_SIZE];
+  struct stat st;
+  bool ok = fstat(fd, &st) == 0 &&
+            pread(fd, raw, sizeof(raw), 0) == (ssize_t)sizeof(raw) &&
+            decode_image_bitmap_header(raw, out) &&
+            out->bitmap_offset + out->bitmap_size <= (uint64_t)st.st_size;
+  close(fd);
+  return ok;
+}
+
+static bool image_head_matches(const char *image_path, uint64_t head_hash) {
+  int fd = open(image_path, O_RDONLY);
+  if (fd < 0)
+    return false;
+  uint64_t hash = 0;
+  bool ok = compute_image_head_hash(fd, &hash);
+  close(fd);
+  return ok && hash == head_hash;
+}
+
+bool load_image_bitmap(const char *image_path, const struct stat *image_st,
+                       image_bitmap_t *out) {
+  memset(out, 0, sizeof(*out));
+  if (!build_image_bitmap_path(image_path, out->path, sizeof(out->path)))
+    return true;
+  struct stat st;
+  if (stat(out->path, &st) != 0 || !S_ISREG(st.st_mode))
+    return true;
+
+  // A stale bitmap would hide live blocks, so any mismatch fails the mount
+  // instead of attaching the image without it.
+  image_bitmap_header_t *header = &out->header;
+  if (!read_image_bitmap_header(out->path, header)) {
+    sm_error_set("IMG", EINVAL, image_path, "Invalid allocation bitmap %s",
+                 out->path);
+  } else if (header->data_size != (uint64_t)image_st->st_size) {
+    sm_error_set("IMG", EINVAL, image_path,
+                 "Allocation bitmap expects %llu image bytes, found %lld",
+                 (unsigned long long)header->data_size,
+                 (long long)image_st->st_size);
+  } else if (!image_head_matches(image_path, header->head_hash)) {
+    sm_error_set("IMG", EINVAL, image_path,
+                 "Allocation bitmap was built for a different image");
+  } else {
+    out->present = true;
+    log_debug("  [IMG] allocation bitmap: %s block=%u device=%llu "
+              "stored=%llu",
+              out->path, header->block_size,
+              (unsigned long long)header->device_size,
+              (unsigned long long)header->data_size);
+    return true;
+  }
+
+  log_debug("  [IMG] %s: %s", sm_last_error()->message, image_path);
+  errno = EINVAL;
+  return false;
+}
@@ -3,49 +3,123 @@
 
 #include "sm_image_cache.h"
 #include "sm_limits.h"
+#include "sm_path_pool.h"
+#include "sm_state_table.h"
 
 struct ImageCache {
-  char path[MAX_PATH];
-  char mount_point[MAX_PATH];
+  sm_path_id_t path;
+  sm_path_id_t mount_point;
   int unit_id;
   attach_backend_t backend;
   bool valid;
 };
 
 static struct ImageCache g_image_cache[MAX_IMAGE_MOUNTS];
-static pthread_mutex_t g_image_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+// Lookups from scanner, install and lifecycle threads share the read side;
+// only mount bookkeeping takes the write side.
+static pthread_rwlock_t g_image_cache_lock = PTHREAD_RWLOCK_INITIALIZER;
+static sm_state_index_t g_image_cache_path_index;
+static sm_state_index_t g_image_cache_mount_index;
+
+static uint32_t image_cache_path_hash(sm_path_id_t path) {
+  return path * 2654435761u;
+}
 
-static int find_cache_index(const char *path, const char *mount_point) {
-  for (int k = 0; k < MAX_IMAGE_MOUNTS; k++) {
-    if (!g_image_cache[k].valid)
-      continue;
-    if (mount_point && strcmp(g_image_cache[k].mount_point, mount_point) == 0) {
-      return k;
-    }
-    if (path && strcmp(g_image_cache[k].path, path) == 0)
+static int find_cache_index_by_id(const sm_state_index_t *index,
+                                  sm_path_id_t id, bool by_mount_point) {
+  if (id == SM_PATH_ID_NONE)
+    return -1;
+  uint32_t hash = image_cache_path_hash(id);
+  uint32_t cursor = 0;
+  int k;
+  while ((k = sm_state_index_next(index, hash, &cursor)) >= 0) {
+    const struct ImageCache *entry = &g_image_cache[k];
+    if ((by_mount_point ? entry->mount_point : entry->path) == id)
       return k;
   }
-
   return -1;
 }
 
+static int find_cache_index(const char *path, const char *mount_point) {
+  int k = -1;
+  if (mount_point) {
+    sm_path_id_t mount_id = sm_path_lookup(mount_point);
+    k = find_cache_index_by_id(&g_image_cache_mount_index, mount_id, true);
+    sm_path_release(mount_id);
+  }
+  if (k < 0 && path) {
+    sm_path_id_t path_id = sm_path_lookup(path);
+    k = find_cache_index_by_id(&g_image_cache_path_index, path_id, false);
+    sm_path_release(path_id);
+  }
+  return k;
+}
+
+static bool index_image_cache_slot(int k) {
+  const struct ImageCache *entry = &g_image_cache[k];
+  if (entry->path != SM_PATH_ID_NONE &&
+      !sm_state_index_insert(&g_image_cache_path_index,
+                             image_cache_path_hash(entry->path), k)) {
+    return false;
+  }
+  if (entry->mount_point != SM_PATH_ID_NONE &&
+      !sm_state_index_insert(&g_image_cache_mount_index,
+                             image_cache_path_hash(entry->mount_point), k)) {
+    sm_state_index_remove(&g_image_cache_path_index,
+                          image_cache_path_hash(entry->path), k);
+    return false;
+  }
+  return true;
+}
+
+static void unindex_image_cache_slot(int k) {
+  const struct ImageCache *entry = &g_image_cache[k];
+  if (entry->path != SM_PATH_ID_NONE)
+    sm_state_index_remove(&g_image_cache_path_index,
+                          image_cache_path_hash(entry->path), k);
+  if (entry->mount_point != SM_PATH_ID_NONE)
+    sm_state_index_remove(&g_image_cache_mount_index,
+                          image_cache_path_hash(entry->mount_point), k);
+}
+
+static void clear_image_cache_slot(int k) {
+  struct ImageCache *entry = &g_image_cache[k];
+  if (entry->valid)
+    unindex_image_cache_slot(k);
+  sm_path_release(entry->path);
+  sm_path_release(entry->mount_point);
+  memset(entry, 0, sizeof(*entry));
+}
+
+static bool assign_image_cache_slot(int k, const char *path,
+                                    const char *mount_point) {
+  struct ImageCache *entry = &g_image_cache[k];
+  if (entry->valid)
+    unindex_image_cache_slot(k);
+  entry->valid = false;
+  if (!sm_path_assign(&entry->path, path) ||
+      !sm_path_assign(&entry->mount_point, mount_point) ||
+      !index_image_cache_slot(k)) {
+    clear_image_cache_slot(k);
+    return false;
+  }
+  entry->valid = true;
+  return true;
+}
+
 static int upsert_image_source_mapping(const char *path, const char *mount_point) {
   int entry_index = find_cache_index(path, mount_point);
-  if (entry_index >= 0) {
-    struct ImageCache *entry = &g_image_cache[entry_index];
-    (void)strlcpy(entry->path, path, sizeof(entry->path));
-    (void)strlcpy(entry->mount_point, mount_point, sizeof(entry->mount_point));
-    return entry_index;
-  }
+  if (entry_index >= 0)
+    return assign_image_cache_slot(entry_index, path, mount_point)
+               ? entry_index
+               : -1;
 
   for (int k = 0; k < MAX_IMAGE_MOUNTS; k++) {
     if (!g_image_cache[k].valid) {
-      (void)strlcpy(g_image_cache[k].path, path, sizeof(g_image_cache[k].path));
-      (void)strlcpy(g_image_cache[k].mount_point, mount_point,
-                    sizeof(g_image_cache[k].mount_point));
+      if (!assign_image_cache_slot(k, path, mount_point))
+        return -1;
       g_image_cache[k].unit_id = -1;
       g_image_cache[k].backend = ATTACH_BACKEND_NONE;
-      g_image_cache[k].valid = true;
       return k;
     }
   }
@@ -54,89 +128,99 @@ static int upsert_image_source_mapping(const char *path, const char *mount_point
 }
 
 bool cache_image_source_mapping(const char *path, const char *mount_point) {
-  pthread_mutex_lock(&g_image_cache_mutex);
+  pthread_rwlock_wrlock(&g_image_cache_lock);
   bool ok = upsert_image_source_mapping(path, mount_point) >= 0;
-  pthread_mutex_unlock(&g_image_cache_mutex);
+  pthread_rwlock_unlock(&g_image_cache_lock);
   return ok;
 }
 
 bool cache_image_mount(const char *path, const char *mount_point, int unit_id,
                        attach_backend_t backend) {
-  pthread_mutex_lock(&g_image_cache_mutex);
+  pthread_rwlock_wrlock(&g_image_cache_lock);
   int entry_index = upsert_image_source_mapping(path, mount_point);
   if (entry_index < 0) {
-    pthread_mutex_unlock(&g_image_cache_mutex);
+    pthread_rwlock_unlock(&g_image_cache_lock);
     return false;
   }
 
   struct ImageCache *entry = &g_image_cache[entry_index];
   entry->unit_id = unit_id;
   entry->backend = backend;
-  pthread_mutex_unlock(&g_image_cache_mutex);
+  pthread_rwlock_unlock(&g_image_cache_lock);
   return true;
 }
 
+bool is_image_cache_source(const char *path) {
+  if (!path || path[0] == '\0')
+    return false;
+  pthread_rwlock_rdlock(&g_image_cache_lock);
+  bool found = find_cache_index(path, NULL) >= 0;
+  pthread_rwlock_unlock(&g_image_cache_lock);
+  return found;
+}
+
 bool get_image_cache_entry(int index, image_cache_entry_t *entry_out) {
-  pthread_mutex_lock(&g_image_cache_mutex);
-  if (index < 0 || index >= MAX_IMAGE_MOUNTS || !g_image_cache[index].valid) {
-    pthread_mutex_unlock(&g_image_cache_mutex);
+  if (index < 0 || index >= MAX_IMAGE_MOUNTS)
+    return false;
+  pthread_rwlock_rdlock(&g_image_cache_lock);
+  if (!g_image_cache[index].valid) {
+    pthread_rwlock_unlock(&g_image_cache_lock);
     return false;
   }
 
   memset(entry_out, 0, sizeof(*entry_out));
-  (void)strlcpy(entry_out->path, g_image_cache[index].path,
+  (void)strlcpy(entry_out->path, sm_path_str(g_image_cache[index].path),
                 sizeof(entry_out->path));
-  (void)strlcpy(entry_out->mount_point, g_image_cache[index].mount_point,
+  (void)strlcpy(entry_out->mount_point,
+                sm_path_str(g_image_cache[index].mount_point),
                 sizeof(entry_out->mount_point));
   entry_out->unit_id = g_image_cache[index].unit_id;
   entry_out->backend = g_image_cache[index].backend;
-  pthread_mutex_unlock(&g_image_cache_mutex);
+  pthread_rwlock_unlock(&g_image_cache_lock);
   return true;
 }
 
 void invalidate_image_cache_entry(int index) {
-  pthread_mutex_lock(&g_image_cache_mutex);
-  if (index < 0 || index >= MAX_IMAGE_MOUNTS) {
-    pthread_mutex_unlock(&g_image_cache_mutex);
+  if (index < 0 || index >= MAX_IMAGE_MOUNTS)
     return;
-  }
-  memset(&g_image_cache[index], 0, sizeof(g_image_cache[index]));
-  pthread_mutex_unlock(&g_image_cache_mutex);
+  pthread_rwlock_wrlock(&g_image_cache_lock);
+  clear_image_cache_slot(index);
+  pthread_rwlock_unlock(&g_image_cache_lock);
 }
 
 bool resolve_device_from_mount_cache(const char *mount_point,
                                      attach_backend_t *backend_out,
                                      int *unit_out) {
-  pthread_mutex_lock(&g_image_cache_mutex);
+  pthread_rwlock_rdlock(&g_image_cache_lock);
   int entry_index = find_cache_index(NULL, mount_point);
   if (entry_index < 0) {
-    pthread_mutex_unlock(&g_image_cache_mutex);
+    pthread_rwlock_unlock(&g_image_cache_lock);
     return false;
   }
   const struct ImageCache *entry = &g_image_cache[entry_index];
   if (entry->backend == ATTACH_BACKEND_NONE || entry->unit_id < 0) {
-    pthread_mutex_unlock(&g_image_cache_mutex);
+    pthread_rwlock_unlock(&g_image_cache_lock);
     return false;
   }
   *backend_out = entry->backend;
   *unit_out = entry->unit_id;
-  pthread_mutex_unlock(&g_image_cache_mutex);
+  pthread_rwlock_unlock(&g_image_cache_lock);
   return true;
 }
 
 bool resolve_image_source_from_mount_cache(const char *mount_point,
                                            char *path_out,
                                            size_t path_out_size) {
-  pthread_mutex_lock(&g_image_cache_mutex);
+  pthread_rwlock_rdlock(&g_image_cache_lock);
   int entry_index = find_cache_index(NULL, mount_point);
   if (entry_index < 0) {
-    pthread_mutex_unlock(&g_image_cache_mutex);
+    pthread_rwlock_unlock(&g_image_cache_lock);
     return false;
   }
   const struct ImageCache *entry = &g_image_cache[entry_index];
 
   path_out[0] = '\0';
-  (void)strlcpy(path_out, entry->path, path_out_size);
-  pthread_mutex_unlock(&g_image_cache_mutex);
+  (void)strlcpy(path_out, sm_path_str(entry->path), path_out_size);
+  pthread_rwlock_unlock(&g_image_cache_lock);
   return true;
 }
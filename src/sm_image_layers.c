@@ -0,0 +1,159 @@
+#include "sm_platform.h"
+#include "sm_image_layers.h"
+
+#include "sm_image_sidecar.h"
+#include "sm_log.h"
+
+static bool fail_image_layers(const char *image_path) {
+  log_debug("  [IMG] %s: %s", sm_last_error()->message, image_path);
+  errno = EINVAL;
+  return false;
+}
+
+static void resolve_layer_path(const char *image_path, const char *layer,
+                               char out[MAX_PATH]) {
+  const char *slash = strrchr(image_path, '/');
+  if (layer[0] == '/' || !slash) {
+    (void)strlcpy(out, layer, MAX_PATH);
+    return;
+  }
+  int dir_len = (int)(slash - image_path);
+  int written = snprintf(out, MAX_PATH, "%.*s/%s", dir_len, image_path, layer);
+  if (written < 0 || written >= MAX_PATH)
+    out[0] = '\0';
+}
+
+// Read the manifest into delta_paths; false on a malformed manifest.
+static bool read_layers_manifest(const char *image_path,
+                                 const char *manifest_path,
+                                 image_layers_t *out) {
+  FILE *f = fopen(manifest_path, "r");
+  if (!f) {
+    sm_error_set("IMG", errno, image_path, "Cannot read layer manifest %s",
+                 manifest_path);
+    return false;
+  }
+  char line[MAX_PATH + 16];
+  int line_no = 0;
+  bool ok = true;
+  while (ok && fgets(line, sizeof(line), f)) {
+    line_no++;
+    char *p = line;
+    while (*p == ' ' || *p == '\t')
+      p++;
+    size_t len = strlen(p);
+    while (len > 0 && (p[len - 1] == '\n' || p[len - 1] == '\r' ||
+                       p[len - 1] == ' ' || p[len - 1] == '\t')) {
+      p[--len] = '\0';
+    }
+    if (len == 0 || p[0] == '#' || p[0] == ';')
+      continue;
+    if (strncmp(p, "layer=", 6) != 0 || p[6] == '\0') {
+      sm_error_set("IMG", EINVAL, image_path,
+                   "Layer manifest line %d not understood", line_no);
+      ok = false;
+    } else if (out->delta_count >= MAX_IMAGE_DELTA_LAYERS) {
+      sm_error_set("IMG", EINVAL, image_path,
+                   "Layer manifest lists more than %d delta layers",
+                   MAX_IMAGE_DELTA_LAYERS);
+      ok = false;
+    } else {
+      char *path = out->delta_paths[out->delta_count];
+      resolve_layer_path(image_path, p + 6, path);
+      if (path[0] == '\0') {
+        sm_error_set("IMG", ENAMETOOLONG, image_path,
+                     "Layer manifest line %d: path too long", line_no);
+        ok = false;
+      } else {
+        out->delta_count++;
+      }
+    }
+  }
+  fclose(f);
+  return ok;
+}
+
+static bool compute_file_head_hash(const char *path, uint64_t *hash_out) {
+  int fd = open(path, O_RDONLY);
+  if (fd < 0)
+    return false;
+  bool ok = compute_image_head_hash(fd, hash_out);
+  close(fd);
+  return ok;
+}
+
+bool load_image_layers(const char *image_path, const struct stat *image_st,
+                       image_layers_t *out) {
+  memset(out, 0, sizeof(*out));
+  if (!load_image_bitmap(image_path, image_st, &out->base))
+    return false;
+  if (out->base.present && out->base.header.base_hash != 0) {
+    sm_error_set("IMG", EINVAL, image_path,
+                 "Image is a delta layer; mount its base image instead");
+    return fail_image_layers(image_path);
+  }
+
+  char manifest_path[MAX_PATH];
+  int written = snprintf(manifest_path, sizeof(manifest_path), "%s%s",
+                         image_path, IMAGE_LAYERS_SUFFIX);
+  struct stat st;
+  if (written < 0 || (size_t)written >= sizeof(manifest_path) ||
+      stat(manifest_path, &st) != 0 || !S_ISREG(st.st_mode)) {
+    return true;
+  }
+  if (st.st_size > (off_t)MAX_IMAGE_LAYERS_MANIFEST_SIZE) {
+    sm_error_set("IMG", EFBIG, image_path, "Layer manifest too large: %s",
+                 manifest_path);
+    return fail_image_layers(image_path);
+  }
+  if (!read_layers_manifest(image_path, manifest_path, out))
+    return fail_image_layers(image_path);
+  if (out->delta_count == 0)
+    return true;
+
+  uint64_t base_hash = 0;
+  if (!compute_file_head_hash(image_path, &base_hash)) {
+    sm_error_set("IMG", errno, image_path, "Cannot read image head");
+    return fail_image_layers(image_path);
+  }
+
+  for (int i = 0; i < out->delta_count; i++) {
+    const char *delta_path = out->delta_paths[i];
+    struct stat delta_st;
+    if (stat(delta_path, &delta_st) != 0 || !S_ISREG(delta_st.st_mode)) {
+      sm_error_set("IMG", ENOENT, image_path, "Delta layer missing: %s",
+                   delta_path);
+      return fail_image_layers(image_path);
+    }
+    image_bitmap_t *bitmap = &out->deltas[i];
+    if (!load_image_bitmap(delta_path, &delta_st, bitmap))
+      return false;
+    // A delta without its bitmap or built for another base would replace
+    // blocks it never meant to.
+    if (!bitmap->present || bitmap->header.base_hash != base_hash) {
+      sm_error_set("IMG", EINVAL, image_path,
+                   "Delta layer %s was not built for this image", delta_path);
+      return fail_image_layers(image_path);
+    }
+    out->delta_sizes[i] = delta_st.st_size;
+    log_debug("  [IMG] delta layer %d: %s device=%llu stored=%llu", i + 1,
+              delta_path, (unsigned long long)bitmap->header.device_size,
+              (unsigned long long)bitmap->header.data_size);
+  }
+  return true;
+}
+
+bool image_layers_need_lvd(const image_layers_t *layers) {
+  return layers->base.present || layers->delta_count > 0;
+}
+
+uint64_t image_layers_device_size(const image_layers_t *layers,
+                                  off_t image_size) {
+  uint64_t size = layers->base.present ? layers->base.header.device_size
+                                       : (uint64_t)image_size;
+  for (int i = 0; i < layers->delta_count; i++) {
+    if (layers->deltas[i].header.device_size > size)
+      size = layers->deltas[i].header.device_size;
+  }
+  return size;
+}
@@ -0,0 +1,393 @@
+#include "sm_platform.h"
+#include "sm_image_ondemand.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "sm_config_mount.h"
+#include "sm_filesystem.h"
+#include "sm_image.h"
+#include "sm_image_cache.h"
+#include "sm_log.h"
+#include "sm_path_pool.h"
+#include "sm_path_utils.h"
+#include "sm_runtime.h"
+#include "sm_state_table.h"
+#include "sm_time.h"
+
+// One entry per registered image-backed title. An attached entry becomes
+// parked (image detached, /user/app registration and mount.lnk kept) after
+// image_idle_detach_seconds without a running game, and attached again when
+// the lifecycle watcher sees the title launch. While parked, the title mount
+// shows a launch stub holding only the shell metadata of sce_sys. The watcher
+// sees a launch after exec, when the process already holds whatever it mapped
+// from the stub, so that launch is ended, the image attached and the title
+// started again from the real source. An entry is never parked while
+// its game process runs, which includes a process launched from the stub.
+typedef struct {
+  sm_path_id_t image_path;
+  char title_id[MAX_TITLE_ID];
+  bool attached;
+  // Game process using the image; 0 while the idle timer runs.
+  pid_t pid;
+  uint64_t last_used_us;
+  int next_free;
+} image_ondemand_entry_t;
+
+static image_ondemand_entry_t *g_ondemand_entries = NULL;
+static int g_ondemand_capacity = 0;
+static int g_ondemand_used = 0;
+static int g_ondemand_count = 0;
+static int g_ondemand_free_head = -1;
+static sm_state_index_t g_ondemand_index;
+static pthread_mutex_t g_ondemand_mutex = PTHREAD_MUTEX_INITIALIZER;
+static atomic_bool g_ondemand_timer_changed = false;
+
+static uint32_t ondemand_path_hash(sm_path_id_t id) {
+  return id * 2654435761u;
+}
+
+static int find_ondemand_entry_locked(const char *image_path) {
+  sm_path_id_t path_id = sm_path_lookup(image_path);
+  if (path_id == SM_PATH_ID_NONE)
+    return -1;
+
+  uint32_t cursor = 0;
+  int entry;
+  while ((entry = sm_state_index_next(&g_ondemand_index,
+                                      ondemand_path_hash(path_id), &cursor)) >=
+         0) {
+    if (g_ondemand_entries[entry].image_path == path_id)
+      break;
+  }
+  sm_path_release(path_id);
+  return entry;
+}
+
+static int find_ondemand_title_locked(const char *title_id) {
+  for (int i = 0; i < g_ondemand_used; i++) {
+    const image_ondemand_entry_t *e = &g_ondemand_entries[i];
+    if (e->image_path != SM_PATH_ID_NONE && strcmp(e->title_id, title_id) == 0)
+      return i;
+  }
+  return -1;
+}
+
+static void remove_ondemand_entry_locked(int entry) {
+  image_ondemand_entry_t *e = &g_ondemand_entries[entry];
+  sm_state_index_remove(&g_ondemand_index, ondemand_path_hash(e->image_path),
+                        entry);
+  sm_path_clear(&e->image_path);
+  memset(e, 0, sizeof(*e));
+  e->next_free = g_ondemand_free_head;
+  g_ondemand_free_head = entry;
+  g_ondemand_count--;
+}
+
+static int add_ondemand_entry_locked(const char *image_path) {
+  int entry;
+  if (g_ondemand_free_head >= 0) {
+    entry = g_ondemand_free_head;
+    g_ondemand_free_head = g_ondemand_entries[entry].next_free;
+  } else {
+    if (!sm_state_table_reserve((void **)&g_ondemand_entries,
+                                &g_ondemand_capacity, g_ondemand_used + 1,
+                                sizeof(*g_ondemand_entries))) {
+      return -1;
+    }
+    entry = g_ondemand_used++;
+  }
+
+  image_ondemand_entry_t *e = &g_ondemand_entries[entry];
+  memset(e, 0, sizeof(*e));
+  e->image_path = sm_path_intern(image_path);
+  if (e->image_path == SM_PATH_ID_NONE ||
+      !sm_state_index_insert(&g_ondemand_index,
+                             ondemand_path_hash(e->image_path), entry)) {
+    sm_path_clear(&e->image_path);
+    e->next_free = g_ondemand_free_head;
+    g_ondemand_free_head = entry;
+    return -1;
+  }
+  g_ondemand_count++;
+  return entry;
+}
+
+// Compressed PFS containers and images nested inside mounted containers are
+// left attached: their children are resolved through the container mount.
+static bool image_supports_ondemand(const char *image_path) {
+  return get_image_fs_type_for_path(image_path) != IMAGE_FS_PFSC_CONTAINER &&
+         !is_under_image_mount_base(image_path);
+}
+
+static void note_ondemand_state(const char *title_id, const char *image_path,
+                                bool attached) {
+  if (!title_id || title_id[0] == '\0' || !image_path ||
+      image_path[0] == '\0' || !image_supports_ondemand(image_path)) {
+    return;
+  }
+
+  uint64_t now_us = monotonic_time_us();
+  bool timer_changed = false;
+  pthread_mutex_lock(&g_ondemand_mutex);
+  int entry = find_ondemand_entry_locked(image_path);
+  if (entry < 0)
+    entry = add_ondemand_entry_locked(image_path);
+  if (entry >= 0) {
+    image_ondemand_entry_t *e = &g_ondemand_entries[entry];
+    timer_changed = attached && !e->attached;
+    (void)strlcpy(e->title_id, title_id, sizeof(e->title_id));
+    e->attached = attached;
+    if (!attached)
+      e->pid = 0;
+    if (timer_changed || !attached)
+      e->last_used_us = now_us;
+  }
+  pthread_mutex_unlock(&g_ondemand_mutex);
+
+  if (timer_changed)
+    atomic_store(&g_ondemand_timer_changed, true);
+}
+
+bool sm_image_ondemand_enabled(void) {
+  return runtime_config()->image_mount_on_launch;
+}
+
+void sm_image_ondemand_note_attached(const char *title_id,
+                                     const char *image_path) {
+  if (!sm_image_ondemand_enabled())
+    return;
+  note_ondemand_state(title_id, image_path, true);
+}
+
+void sm_image_ondemand_note_parked(const char *title_id,
+                                   const char *image_path) {
+  note_ondemand_state(title_id, image_path, false);
+  log_debug("  [IMG] mount on launch: %s stays detached (%s)", title_id,
+            image_path);
+}
+
+bool sm_image_ondemand_is_parked(const char *image_path) {
+  if (!sm_image_ondemand_enabled())
+    return false;
+
+  char title_id[MAX_TITLE_ID];
+  pthread_mutex_lock(&g_ondemand_mutex);
+  int entry = find_ondemand_entry_locked(image_path);
+  bool parked = entry >= 0 && !g_ondemand_entries[entry].attached;
+  if (parked) {
+    (void)strlcpy(title_id, g_ondemand_entries[entry].title_id,
+                  sizeof(title_id));
+  }
+  pthread_mutex_unlock(&g_ondemand_mutex);
+  if (!parked)
+    return false;
+
+  char tracked_path[MAX_PATH];
+  char mount_point[MAX_PATH];
+  get_image_mount_point_for_source(image_path, mount_point);
+  if (read_mount_link(title_id, tracked_path, sizeof(tracked_path)) &&
+      path_matches_root_or_child(tracked_path, mount_point)) {
+    return true;
+  }
+
+  log_debug("  [IMG] mount on launch: %s no longer registered from %s",
+            title_id, image_path);
+  sm_image_ondemand_forget(image_path);
+  return false;
+}
+
+void sm_image_ondemand_forget(const char *image_path) {
+  pthread_mutex_lock(&g_ondemand_mutex);
+  int entry = find_ondemand_entry_locked(image_path);
+  if (entry >= 0)
+    remove_ondemand_entry_locked(entry);
+  pthread_mutex_unlock(&g_ondemand_mutex);
+}
+
+bool sm_image_ondemand_consume_timer_change(void) {
+  return atomic_exchange(&g_ondemand_timer_changed, false);
+}
+
+static bool attach_ondemand_image(const char *title_id,
+                                  const char *image_path) {
+  if (!mount_image(image_path, get_image_fs_type_for_path(image_path))) {
+    log_debug("  [IMG] mount on launch failed for %s: %s (%s)", title_id,
+              image_path, strerror(errno));
+    return false;
+  }
+
+  char source_path[MAX_PATH];
+  if (!read_mount_link(title_id, source_path, sizeof(source_path))) {
+    log_debug("  [IMG] mount on launch: mount.lnk missing for %s", title_id);
+    return false;
+  }
+  if (!mount_title_nullfs(title_id, source_path))
+    return false;
+
+  log_debug("  [IMG] mounted on launch: %s -> %s", image_path, source_path);
+  return true;
+}
+
+bool sm_image_ondemand_game_on_exec(pid_t pid, const char *title_id) {
+  uint64_t now_us = monotonic_time_us();
+  char image_path[MAX_PATH];
+  image_path[0] = '\0';
+
+  pthread_mutex_lock(&g_ondemand_mutex);
+  int entry = find_ondemand_title_locked(title_id);
+  if (entry >= 0) {
+    image_ondemand_entry_t *e = &g_ondemand_entries[entry];
+    if (!e->attached) {
+      (void)strlcpy(image_path, sm_path_str(e->image_path),
+                    sizeof(image_path));
+      // Claimed before attaching so a concurrent scan reuses the mount.
+      e->attached = true;
+    }
+    e->pid = pid;
+    e->last_used_us = now_us;
+  }
+  pthread_mutex_unlock(&g_ondemand_mutex);
+  if (image_path[0] == '\0')
+    return true;
+
+  // The process was executed from the stub and must not run on a mix of stub
+  // and image files; its exit starts the idle timer.
+  if (kill(pid, SIGKILL) != 0 && errno != ESRCH) {
+    log_debug("  [IMG] mount on launch: cannot end stub launch pid=%ld: %s",
+              (long)pid, strerror(errno));
+  }
+  bool attached = attach_ondemand_image(title_id, image_path);
+  if (attached) {
+    notify_system_info("%s is ready.\nLaunch the game again.", title_id);
+  } else {
+    pthread_mutex_lock(&g_ondemand_mutex);
+    entry = find_ondemand_entry_locked(image_path);
+    if (entry >= 0 && !is_image_cache_source(image_path)) {
+      g_ondemand_entries[entry].attached = false;
+      g_ondemand_entries[entry].pid = 0;
+    }
+    pthread_mutex_unlock(&g_ondemand_mutex);
+  }
+  // Backport overlays and appmeta follow the regular scan path.
+  request_scan_now("image mount on launch");
+  return false;
+}
+
+void sm_image_ondemand_game_on_exit(pid_t pid) {
+  uint64_t now_us = monotonic_time_us();
+  pthread_mutex_lock(&g_ondemand_mutex);
+  for (int i = 0; i < g_ondemand_used; i++) {
+    image_ondemand_entry_t *e = &g_ondemand_entries[i];
+    if (e->image_path == SM_PATH_ID_NONE || e->pid != pid)
+      continue;
+    e->pid = 0;
+    e->last_used_us = now_us;
+  }
+  pthread_mutex_unlock(&g_ondemand_mutex);
+}
+
+static uint64_t ondemand_idle_us(void) {
+  return (uint64_t)runtime_config()->image_idle_detach_seconds * 1000000ull;
+}
+
+uint64_t sm_image_ondemand_next_wake_us(uint64_t now_us) {
+  if (!sm_image_ondemand_enabled() || now_us == 0)
+    return 0;
+
+  uint64_t idle_us = ondemand_idle_us();
+  uint64_t next_wake_us = 0;
+  pthread_mutex_lock(&g_ondemand_mutex);
+  for (int i = 0; i < g_ondemand_used; i++) {
+    const image_ondemand_entry_t *e = &g_ondemand_entries[i];
+    if (e->image_path == SM_PATH_ID_NONE || !e->attached || e->pid != 0)
+      continue;
+    uint64_t deadline_us = e->last_used_us + idle_us;
+    if (next_wake_us == 0 || deadline_us < next_wake_us)
+      next_wake_us = deadline_us;
+  }
+  pthread_mutex_unlock(&g_ondemand_mutex);
+  return next_wake_us;
+}
+
+// Claim one idle attached entry and mark it parked so scans leave it alone
+// while it is detached. Entries whose image was unmounted elsewhere (source
+// removal, USB suspend) are dropped; the next scan tracks them again.
+static bool claim_idle_ondemand_entry(uint64_t now_us, char *title_id,
+                                      char image_path[MAX_PATH]) {
+  uint64_t idle_us = ondemand_idle_us();
+  bool claimed = false;
+  pthread_mutex_lock(&g_ondemand_mutex);
+  for (int i = 0; i < g_ondemand_used && !claimed; i++) {
+    image_ondemand_entry_t *e = &g_ondemand_entries[i];
+    if (e->image_path == SM_PATH_ID_NONE || !e->attached || e->pid != 0 ||
+        now_us < e->last_used_us + idle_us) {
+      continue;
+    }
+    if (!is_image_cache_source(sm_path_str(e->image_path))) {
+      remove_ondemand_entry_locked(i);
+      continue;
+    }
+    (void)strlcpy(title_id, e->title_id, MAX_TITLE_ID);
+    (void)strlcpy(image_path, sm_path_str(e->image_path), MAX_PATH);
+    e->attached = false;
+    claimed = true;
+  }
+  pthread_mutex_unlock(&g_ondemand_mutex);
+  return claimed;
+}
+
+void sm_image_ondemand_poll(void) {
+  if (!sm_image_ondemand_enabled())
+    return;
+
+  char title_id[MAX_TITLE_ID];
+  char image_path[MAX_PATH];
+  uint64_t now_us = monotonic_time_us();
+  while (now_us != 0 && !should_stop_requested() &&
+         !runtime_sleep_mode_active() &&
+         claim_idle_ondemand_entry(now_us, title_id, image_path)) {
+    char source_path[MAX_PATH];
+    if (!read_mount_link(title_id, source_path, sizeof(source_path)) ||
+        !stage_title_launch_stub(title_id, source_path)) {
+      log_debug("  [IMG] launch stub unavailable for %s: %s", title_id,
+                strerror(errno));
+    } else if (park_image_mount(image_path, title_id)) {
+      log_debug("  [IMG] detached idle image: %s (%s)", title_id, image_path);
+      continue;
+    }
+
+    // No stub, busy or failed: keep it attached and retry after another idle
+    // period.
+    pthread_mutex_lock(&g_ondemand_mutex);
+    int entry = find_ondemand_entry_locked(image_path);
+    if (entry >= 0) {
+      g_ondemand_entries[entry].attached = true;
+      g_ondemand_entries[entry].last_used_us = now_us;
+    }
+    pthread_mutex_unlock(&g_ondemand_mutex);
+  }
+}
+
+void sm_image_ondemand_game_shutdown(void) {
+  uint64_t now_us = monotonic_time_us();
+  pthread_mutex_lock(&g_ondemand_mutex);
+  for (int i = 0; i < g_ondemand_used; i++) {
+    image_ondemand_entry_t *e = &g_ondemand_entries[i];
+    if (e->image_path == SM_PATH_ID_NONE || e->pid == 0)
+      continue;
+    e->pid = 0;
+    e->last_used_us = now_us;
+  }
+  pthread_mutex_unlock(&g_ondemand_mutex);
+}
+
+void image_ondemand_memory_usage(sm_state_table_usage_t *out) {
+  pthread_mutex_lock(&g_ondemand_mutex);
+  out->name = "image_ondemand";
+  out->count = g_ondemand_count;
+  out->capacity = g_ondemand_capacity;
+  out->bytes = (size_t)g_ondemand_capacity * sizeof(*g_ondemand_entries) +
+               sm_state_index_bytes(&g_ondemand_index);
+  pthread_mutex_unlock(&g_ondemand_mutex);
+}
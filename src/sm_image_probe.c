@@ -0,0 +1,276 @@
+#include "sm_platform.h"
+#include "sm_image_probe.h"
+
+#include <pthread.h>
+
+#include "sm_log.h"
+#include "sm_path_pool.h"
+#include "sm_state_table.h"
+
+// UFS2 superblock (struct fs) at SBLOCK_UFS2.
+#define PROBE_UFS2_SUPERBLOCK_OFFSET 65536
+#define PROBE_UFS2_MAGIC 0x19540119u
+#define PROBE_UFS2_MAGIC_OFFSET 1372
+// fs_fsize: fragment size, the f_bsize ffs reports through statfs.
+#define PROBE_UFS2_FSIZE_OFFSET 52
+#define PROBE_UFS2_READ_SIZE 2048
+
+// exFAT main boot sector.
+#define PROBE_EXFAT_NAME_OFFSET 3
+#define PROBE_EXFAT_VOLUME_LENGTH_OFFSET 72
+#define PROBE_EXFAT_SECTOR_SHIFT_OFFSET 108
+#define PROBE_EXFAT_CLUSTER_SHIFT_OFFSET 109
+#define PROBE_EXFAT_SIGNATURE_OFFSET 510
+
+// PFS image header: version 1, magic 20130315, basic block size.
+#define PROBE_PFS_VERSION 1u
+#define PROBE_PFS_MAGIC 20130315u
+#define PROBE_PFS_MAGIC_OFFSET 8
+#define PROBE_PFS_BLOCK_SIZE_OFFSET 0x20
+
+#define PROBE_MIN_BLOCK_SIZE 512u
+#define PROBE_MAX_BLOCK_SIZE (1u << 20)
+
+typedef struct {
+  uint64_t dev;
+  uint64_t ino;
+  int64_t size;
+  int64_t mtime_sec;
+  long mtime_nsec;
+} image_probe_stamp_t;
+
+typedef struct {
+  sm_path_id_t image_path;
+  image_probe_stamp_t stamp;
+  image_probe_t probe;
+  int next_free;
+} image_probe_entry_t;
+
+static image_probe_entry_t *g_probe_entries = NULL;
+static int g_probe_capacity = 0;
+static int g_probe_used = 0;
+static int g_probe_count = 0;
+static int g_probe_free_head = -1;
+static sm_state_index_t g_probe_index;
+static pthread_mutex_t g_probe_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static uint32_t probe_path_hash(sm_path_id_t id) {
+  return id * 2654435761u;
+}
+
+static uint32_t probe_le32(const uint8_t *p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) |
+         ((uint32_t)p[3] << 24);
+}
+
+static uint64_t probe_le64(const uint8_t *p) {
+  return (uint64_t)probe_le32(p) | ((uint64_t)probe_le32(p + 4) << 32);
+}
+
+static bool is_probe_block_size(uint64_t size) {
+  return size >= PROBE_MIN_BLOCK_SIZE && size <= PROBE_MAX_BLOCK_SIZE &&
+         (size & (size - 1u)) == 0;
+}
+
+// Read up to len bytes; a short file leaves the tail zeroed.
+static bool probe_read_at(int fd, uint8_t *buf, size_t len, off_t offset) {
+  memset(buf, 0, len);
+  size_t done = 0;
+  while (done < len) {
+    ssize_t n = pread(fd, buf + done, len - done, offset + (off_t)done);
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      return false;
+    }
+    if (n == 0)
+      break;
+    done += (size_t)n;
+  }
+  return true;
+}
+
+static bool probe_exfat_boot_sector(const uint8_t *sector,
+                                    image_probe_t *out) {
+  if (memcmp(sector + PROBE_EXFAT_NAME_OFFSET, "EXFAT   ", 8) != 0 ||
+      sector[PROBE_EXFAT_SIGNATURE_OFFSET] != 0x55 ||
+      sector[PROBE_EXFAT_SIGNATURE_OFFSET + 1] != 0xAA) {
+    return false;
+  }
+  unsigned sector_shift = sector[PROBE_EXFAT_SECTOR_SHIFT_OFFSET];
+  unsigned cluster_shift =
+      sector_shift + sector[PROBE_EXFAT_CLUSTER_SHIFT_OFFSET];
+  if (sector_shift < 9u || sector_shift > 12u || cluster_shift > 25u)
+    return false;
+
+  out->fs_type = IMAGE_FS_EXFAT;
+  uint64_t cluster_size = 1ull << cluster_shift;
+  out->block_size = is_probe_block_size(cluster_size) ? (uint32_t)cluster_size
+                                                      : 0;
+  uint64_t volume_sectors =
+      probe_le64(sector + PROBE_EXFAT_VOLUME_LENGTH_OFFSET);
+  if (volume_sectors <= (UINT64_MAX >> sector_shift))
+    out->fs_size = volume_sectors << sector_shift;
+  return true;
+}
+
+static bool probe_pfs_header(const uint8_t *header, image_probe_t *out) {
+  if (probe_le64(header) != PROBE_PFS_VERSION ||
+      probe_le64(header + PROBE_PFS_MAGIC_OFFSET) != PROBE_PFS_MAGIC) {
+    return false;
+  }
+  out->fs_type = IMAGE_FS_PFS;
+  uint32_t block_size = probe_le32(header + PROBE_PFS_BLOCK_SIZE_OFFSET);
+  out->block_size = is_probe_block_size(block_size) ? block_size : 0;
+  return true;
+}
+
+bool probe_image_fd(int fd, image_probe_t *out) {
+  memset(out, 0, sizeof(*out));
+
+  uint8_t head[512];
+  if (!probe_read_at(fd, head, sizeof(head), 0))
+    return false;
+  if (probe_exfat_boot_sector(head, out) || probe_pfs_header(head, out))
+    return true;
+
+  uint8_t sb[PROBE_UFS2_READ_SIZE];
+  if (!probe_read_at(fd, sb, sizeof(sb), PROBE_UFS2_SUPERBLOCK_OFFSET))
+    return false;
+  if (probe_le32(sb + PROBE_UFS2_MAGIC_OFFSET) == PROBE_UFS2_MAGIC) {
+    out->fs_type = IMAGE_FS_UFS;
+    uint32_t fsize = probe_le32(sb + PROBE_UFS2_FSIZE_OFFSET);
+    out->block_size = is_probe_block_size(fsize) ? fsize : 0;
+  }
+  return true;
+}
+
+static void fill_probe_stamp(const struct stat *st, image_probe_stamp_t *out) {
+  memset(out, 0, sizeof(*out));
+  out->dev = (uint64_t)st->st_dev;
+  out->ino = (uint64_t)st->st_ino;
+  out->size = (int64_t)st->st_size;
+  out->mtime_sec = (int64_t)st->st_mtim.tv_sec;
+  out->mtime_nsec = st->st_mtim.tv_nsec;
+}
+
+static bool probe_stamps_equal(const image_probe_stamp_t *a,
+                               const image_probe_stamp_t *b) {
+  return a->dev == b->dev && a->ino == b->ino && a->size == b->size &&
+         a->mtime_sec == b->mtime_sec && a->mtime_nsec == b->mtime_nsec;
+}
+
+static int find_probe_entry_locked(sm_path_id_t path_id) {
+  uint32_t cursor = 0;
+  int entry;
+  while ((entry = sm_state_index_next(&g_probe_index, probe_path_hash(path_id),
+                                      &cursor)) >= 0) {
+    if (g_probe_entries[entry].image_path == path_id)
+      return entry;
+  }
+  return -1;
+}
+
+static void remove_probe_entry_locked(int entry) {
+  image_probe_entry_t *e = &g_probe_entries[entry];
+  sm_state_index_remove(&g_probe_index, probe_path_hash(e->image_path), entry);
+  sm_path_clear(&e->image_path);
+  memset(e, 0, sizeof(*e));
+  e->next_free = g_probe_free_head;
+  g_probe_free_head = entry;
+  g_probe_count--;
+}
+
+static void store_probe_entry_locked(const char *image_path,
+                                     const image_probe_stamp_t *stamp,
+                                     const image_probe_t *probe) {
+  sm_path_id_t path_id = sm_path_lookup(image_path);
+  int entry = path_id != SM_PATH_ID_NONE ? find_probe_entry_locked(path_id)
+                                         : -1;
+  sm_path_release(path_id);
+  if (entry < 0) {
+    if (g_probe_free_head >= 0) {
+      entry = g_probe_free_head;
+      g_probe_free_head = g_probe_entries[entry].next_free;
+    } else {
+      if (!sm_state_table_reserve((void **)&g_probe_entries, &g_probe_capacity,
+                                  g_probe_used + 1, sizeof(*g_probe_entries))) {
+        return;
+      }
+      entry = g_probe_used++;
+    }
+    image_probe_entry_t *e = &g_probe_entries[entry];
+    memset(e, 0, sizeof(*e));
+    e->image_path = sm_path_intern(image_path);
+    if (e->image_path == SM_PATH_ID_NONE ||
+        !sm_state_index_insert(&g_probe_index, probe_path_hash(e->image_path),
+                               entry)) {
+      sm_path_clear(&e->image_path);
+      e->next_free = g_probe_free_head;
+      g_probe_free_head = entry;
+      return;
+    }
+    g_probe_count++;
+  }
+
+  g_probe_entries[entry].stamp = *stamp;
+  g_probe_entries[entry].probe = *probe;
+}
+
+bool get_image_probe(const char *image_path, image_probe_t *out) {
+  struct stat st;
+  if (stat(image_path, &st) != 0 || !S_ISREG(st.st_mode))
+    return false;
+  image_probe_stamp_t stamp;
+  fill_probe_stamp(&st, &stamp);
+
+  pthread_mutex_lock(&g_probe_mutex);
+  sm_path_id_t path_id = sm_path_lookup(image_path);
+  int entry = path_id != SM_PATH_ID_NONE ? find_probe_entry_locked(path_id)
+                                         : -1;
+  sm_path_release(path_id);
+  if (entry >= 0 && probe_stamps_equal(&g_probe_entries[entry].stamp, &stamp)) {
+    *out = g_probe_entries[entry].probe;
+    pthread_mutex_unlock(&g_probe_mutex);
+    return true;
+  }
+  pthread_mutex_unlock(&g_probe_mutex);
+
+  int fd = open(image_path, O_RDONLY);
+  if (fd < 0)
+    return false;
+  bool ok = probe_image_fd(fd, out);
+  close(fd);
+  if (!ok) {
+    log_debug("  [IMG] probe read failed for %s: %s", image_path,
+              strerror(errno));
+    return false;
+  }
+  pthread_mutex_lock(&g_probe_mutex);
+  store_probe_entry_locked(image_path, &stamp, out);
+  pthread_mutex_unlock(&g_probe_mutex);
+  return true;
+}
+
+void prune_image_probe_cache(void) {
+  pthread_mutex_lock(&g_probe_mutex);
+  for (int i = 0; i < g_probe_used; i++) {
+    image_probe_entry_t *e = &g_probe_entries[i];
+    if (e->image_path == SM_PATH_ID_NONE)
+      continue;
+    struct stat st;
+    if (stat(sm_path_str(e->image_path), &st) != 0 || !S_ISREG(st.st_mode))
+      remove_probe_entry_locked(i);
+  }
+  pthread_mutex_unlock(&g_probe_mutex);
+}
+
+void image_probe_cache_memory_usage(sm_state_table_usage_t *out) {
+  pthread_mutex_lock(&g_probe_mutex);
+  out->name = "image_probes";
+  out->count = g_probe_count;
+  out->capacity = g_probe_capacity;
+  out->bytes = (size_t)g_probe_capacity * sizeof(*g_probe_entries) +
+               sm_state_index_bytes(&g_probe_index);
+  pthread_mutex_unlock(&g_probe_mutex);
+}
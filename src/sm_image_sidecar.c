@@ -0,0 +1,455 @@
+#include "sm_platform.h"
+#include "sm_image_sidecar.h"
+
+#include <pthread.h>
+
+#include "sm_hash.h"
+#include "sm_image.h"
+#include "sm_log.h"
+#include "sm_param_json.h"
+#include "sm_path_pool.h"
+#include "sm_path_utils.h"
+#include "sm_state_table.h"
+
+// Sidecar layout (top-level members; titleId/titleName follow param.json and
+// may also come as localizedParameters):
+//   {"version": 1, "titleId": "PPSA01234", "titleName": "...",
+//    "fsType": "ufs", "clusterSize": 65536, "imageSize": 123456,
+//    "contentHash": "fnv1a64:0123456789abcdef", "headHash": "fnv1a64:..."}
+// A sidecar is trusted only while imageSize and headHash match the image.
+#define IMAGE_SIDECAR_HASH_PREFIX "fnv1a64:"
+
+typedef struct {
+  uint64_t dev;
+  uint64_t ino;
+  int64_t size;
+  int64_t mtime_sec;
+  long mtime_nsec;
+} image_sidecar_stamp_t;
+
+typedef struct {
+  sm_path_id_t image_path;
+  image_sidecar_stamp_t image_stamp;
+  // All zero when the image had no sidecar.
+  image_sidecar_stamp_t sidecar_stamp;
+  bool valid;
+  image_sidecar_t sidecar;
+  int next_free;
+} image_sidecar_entry_t;
+
+static image_sidecar_entry_t *g_sidecar_entries = NULL;
+static int g_sidecar_capacity = 0;
+// Entries [0, g_sidecar_used) have been handed out; freed ones are chained
+// through next_free.
+static int g_sidecar_used = 0;
+static int g_sidecar_count = 0;
+static int g_sidecar_free_head = -1;
+static sm_state_index_t g_sidecar_index;
+static pthread_mutex_t g_sidecar_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static uint32_t sidecar_path_hash(sm_path_id_t id) {
+  return id * 2654435761u;
+}
+
+static void fill_sidecar_stamp(const struct stat *st,
+                               image_sidecar_stamp_t *out) {
+  memset(out, 0, sizeof(*out));
+  out->dev = (uint64_t)st->st_dev;
+  out->ino = (uint64_t)st->st_ino;
+  out->size = (int64_t)st->st_size;
+  out->mtime_sec = (int64_t)st->st_mtim.tv_sec;
+  out->mtime_nsec = st->st_mtim.tv_nsec;
+}
+
+static bool sidecar_stamps_equal(const image_sidecar_stamp_t *a,
+                                 const image_sidecar_stamp_t *b) {
+  return a->dev == b->dev && a->ino == b->ino && a->size == b->size &&
+         a->mtime_sec == b->mtime_sec && a->mtime_nsec == b->mtime_nsec;
+}
+
+static int find_sidecar_entry_locked(sm_path_id_t path_id) {
+  uint32_t cursor = 0;
+  int entry;
+  while ((entry = sm_state_index_next(&g_sidecar_index,
+                                      sidecar_path_hash(path_id), &cursor)) >=
+         0) {
+    if (g_sidecar_entries[entry].image_path == path_id)
+      return entry;
+  }
+  return -1;
+}
+
+static void remove_sidecar_entry_locked(int entry) {
+  image_sidecar_entry_t *e = &g_sidecar_entries[entry];
+  sm_state_index_remove(&g_sidecar_index, sidecar_path_hash(e->image_path),
+                        entry);
+  sm_path_clear(&e->image_path);
+  memset(e, 0, sizeof(*e));
+  e->next_free = g_sidecar_free_head;
+  g_sidecar_free_head = entry;
+  g_sidecar_count--;
+}
+
+static void store_sidecar_entry_locked(const char *image_path,
+                                       const image_sidecar_stamp_t *image_stamp,
+                                       const image_sidecar_stamp_t *sidecar_stamp,
+                                       bool valid,
+                                       const image_sidecar_t *sidecar) {
+  sm_path_id_t path_id = sm_path_lookup(image_path);
+  int entry = path_id != SM_PATH_ID_NONE ? find_sidecar_entry_locked(path_id)
+                                         : -1;
+  sm_path_release(path_id);
+  if (entry < 0) {
+    if (g_sidecar_free_head >= 0) {
+      entry = g_sidecar_free_head;
+      g_sidecar_free_head = g_sidecar_entries[entry].next_free;
+    } else {
+      if (!sm_state_table_reserve((void **)&g_sidecar_entries,
+                                  &g_sidecar_capacity, g_sidecar_used + 1,
+                                  sizeof(*g_sidecar_entries))) {
+        return;
+      }
+      entry = g_sidecar_used++;
+    }
+    image_sidecar_entry_t *e = &g_sidecar_entries[entry];
+    memset(e, 0, sizeof(*e));
+    e->image_path = sm_path_intern(image_path);
+    if (e->image_path == SM_PATH_ID_NONE ||
+        !sm_state_index_insert(&g_sidecar_index,
+                               sidecar_path_hash(e->image_path), entry)) {
+      sm_path_clear(&e->image_path);
+      e->next_free = g_sidecar_free_head;
+      g_sidecar_free_head = entry;
+      return;
+    }
+    g_sidecar_count++;
+  }
+
+  image_sidecar_entry_t *e = &g_sidecar_entries[entry];
+  e->image_stamp = *image_stamp;
+  e->sidecar_stamp = *sidecar_stamp;
+  e->valid = valid;
+  if (valid)
+    e->sidecar = *sidecar;
+  else
+    memset(&e->sidecar, 0, sizeof(e->sidecar));
+}
+
+static bool parse_sidecar_hash(const char *value, uint64_t *out) {
+  size_t prefix_len = sizeof(IMAGE_SIDECAR_HASH_PREFIX) - 1u;
+  if (strncmp(value, IMAGE_SIDECAR_HASH_PREFIX, prefix_len) != 0)
+    return false;
+  const char *hex = value + prefix_len;
+  char *end = NULL;
+  errno = 0;
+  unsigned long long hash = strtoull(hex, &end, 16);
+  if (errno != 0 || end == hex || *end != '\0' || strlen(hex) != 16u)
+    return false;
+  *out = (uint64_t)hash;
+  return true;
+}
+
+static bool parse_sidecar_u64(const char *value, uint64_t *out) {
+  char *end = NULL;
+  errno = 0;
+  unsigned long long n = strtoull(value, &end, 10);
+  if (errno != 0 || end == value || *end != '\0' || value[0] == '-')
+    return false;
+  *out = (uint64_t)n;
+  return true;
+}
+
+static image_fs_type_t parse_sidecar_fs_type(const char *value) {
+  if (strcasecmp(value, "ufs") == 0)
+    return IMAGE_FS_UFS;
+  if (strcasecmp(value, "exfat") == 0)
+    return IMAGE_FS_EXFAT;
+  if (strcasecmp(value, "pfs") == 0)
+    return IMAGE_FS_PFS;
+  if (strcasecmp(value, "pfsc") == 0)
+    return IMAGE_FS_PFSC_CONTAINER;
+  return IMAGE_FS_UNKNOWN;
+}
+
+static const char *sidecar_fs_type_name(image_fs_type_t fs_type) {
+  switch (fs_type) {
+  case IMAGE_FS_UFS:
+    return "ufs";
+  case IMAGE_FS_EXFAT:
+    return "exfat";
+  case IMAGE_FS_PFS:
+    return "pfs";
+  case IMAGE_FS_PFSC_CONTAINER:
+    return "pfsc";
+  default:
+    return NULL;
+  }
+}
+
+typedef struct {
+  image_sidecar_t *sidecar;
+  uint64_t version;
+  bool has_image_size;
+  bool has_head_hash;
+  bool malformed;
+} sidecar_parse_ctx_t;
+
+static void sidecar_member(const char *key, const char *value, void *ctx_ptr) {
+  sidecar_parse_ctx_t *ctx = (sidecar_parse_ctx_t *)ctx_ptr;
+  image_sidecar_t *sidecar = ctx->sidecar;
+  bool ok = true;
+  if (strcmp(key, "version") == 0) {
+    ok = parse_sidecar_u64(value, &ctx->version);
+  } else if (strcmp(key, "fsType") == 0) {
+    sidecar->fs_type = parse_sidecar_fs_type(value);
+    ok = sidecar->fs_type != IMAGE_FS_UNKNOWN;
+  } else if (strcmp(key, "clusterSize") == 0) {
+    uint64_t cluster_size = 0;
+    ok = parse_sidecar_u64(value, &cluster_size) && cluster_size >= 512u &&
+         cluster_size <= (1u << 20) &&
+         (cluster_size & (cluster_size - 1u)) == 0;
+    if (ok)
+      sidecar->cluster_size = (uint32_t)cluster_size;
+  } else if (strcmp(key, "imageSize") == 0) {
+    ok = parse_sidecar_u64(value, &sidecar->image_size);
+    ctx->has_image_size = ok;
+  } else if (strcmp(key, "contentHash") == 0) {
+    ok = parse_sidecar_hash(value, &sidecar->content_hash);
+  } else if (strcmp(key, "headHash") == 0) {
+    ok = parse_sidecar_hash(value, &sidecar->head_hash);
+    ctx->has_head_hash = ok;
+  }
+  if (!ok)
+    ctx->malformed = true;
+}
+
+static bool read_sidecar_file(int fd, const char *sidecar_path,
+                              image_sidecar_t *out) {
+  memset(out, 0, sizeof(*out));
+  sm_param_json_t info;
+  sidecar_parse_ctx_t ctx = {
+      .sidecar = out,
+  };
+  int res = sm_param_json_parse_fd_members(fd, SM_PARAM_JSON_PREFERRED_LOCALE,
+                                           &info, sidecar_member, &ctx);
+  if (res <= 0 || ctx.malformed || ctx.version != IMAGE_SIDECAR_VERSION ||
+      !ctx.has_image_size || !ctx.has_head_hash) {
+    log_debug("  [IMG] sidecar ignored (malformed or unsupported): %s",
+              sidecar_path);
+    return false;
+  }
+  (void)strlcpy(out->title_id, info.title_id, sizeof(out->title_id));
+  (void)strlcpy(out->title_name,
+                info.title_name[0] ? info.title_name : info.title_id,
+                sizeof(out->title_name));
+  return true;
+}
+
+bool compute_image_head_hash(int fd, uint64_t *hash_out) {
+  char chunk[PARAM_JSON_READ_CHUNK];
+  uint64_t hash = SM_FNV1A64_INIT;
+  off_t offset = 0;
+  while ((size_t)offset < IMAGE_SIDECAR_HEAD_BYTES) {
+    size_t want = IMAGE_SIDECAR_HEAD_BYTES - (size_t)offset;
+    if (want > sizeof(chunk))
+      want = sizeof(chunk);
+    ssize_t n = pread(fd, chunk, want, offset);
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      return false;
+    }
+    if (n == 0)
+      break;
+    hash = sm_fnv1a64_update(hash, chunk, (size_t)n);
+    offset += n;
+  }
+  *hash_out = hash;
+  return true;
+}
+
+// Read the sidecar and check it against the image it sits next to.
+static bool load_image_sidecar(int dir_fd, const char *image_path,
+                               const char *image_rel, const char *sidecar_rel,
+                               const struct stat *image_st,
+                               image_sidecar_t *out) {
+  int fd = openat(dir_fd, sidecar_rel, O_RDONLY);
+  if (fd < 0)
+    return false;
+  bool ok = read_sidecar_file(fd, image_path, out);
+  close(fd);
+  if (!ok)
+    return false;
+
+  image_fs_type_t name_fs_type = get_image_fs_type_for_path(image_path);
+  if (out->fs_type != IMAGE_FS_UNKNOWN && out->fs_type != name_fs_type) {
+    log_debug("  [IMG] sidecar fs type mismatch, ignored: %s", image_path);
+    return false;
+  }
+  if (out->image_size != (uint64_t)image_st->st_size) {
+    log_debug("  [IMG] sidecar size mismatch (%llu != %lld), ignored: %s",
+              (unsigned long long)out->image_size,
+              (long long)image_st->st_size, image_path);
+    return false;
+  }
+
+  int image_fd = openat(dir_fd, image_rel, O_RDONLY);
+  if (image_fd < 0)
+    return false;
+  uint64_t head_hash = 0;
+  ok = compute_image_head_hash(image_fd, &head_hash);
+  close(image_fd);
+  if (!ok || head_hash != out->head_hash) {
+    log_debug("  [IMG] sidecar head hash mismatch, ignored: %s", image_path);
+    return false;
+  }
+  return true;
+}
+
+bool get_image_sidecar_at(int parent_fd, const char *image_path,
+                          const char *image_name, image_sidecar_t *out) {
+  if (!image_name || image_name[0] == '\0')
+    image_name = get_filename_component(image_path);
+
+  int dir_fd = parent_fd >= 0 ? parent_fd : AT_FDCWD;
+  const char *image_rel = parent_fd >= 0 ? image_name : image_path;
+  char sidecar_rel[MAX_PATH];
+  int written = snprintf(sidecar_rel, sizeof(sidecar_rel), "%s%s", image_rel,
+                         IMAGE_SIDECAR_SUFFIX);
+  if (written < 0 || (size_t)written >= sizeof(sidecar_rel))
+    return false;
+
+  struct stat image_st;
+  if (fstatat(dir_fd, image_rel, &image_st, 0) != 0 ||
+      !S_ISREG(image_st.st_mode)) {
+    return false;
+  }
+  image_sidecar_stamp_t image_stamp;
+  image_sidecar_stamp_t sidecar_stamp;
+  fill_sidecar_stamp(&image_st, &image_stamp);
+  memset(&sidecar_stamp, 0, sizeof(sidecar_stamp));
+  struct stat sidecar_st;
+  bool has_sidecar = fstatat(dir_fd, sidecar_rel, &sidecar_st, 0) == 0 &&
+                     S_ISREG(sidecar_st.st_mode);
+  if (has_sidecar)
+    fill_sidecar_stamp(&sidecar_st, &sidecar_stamp);
+
+  pthread_mutex_lock(&g_sidecar_mutex);
+  sm_path_id_t path_id = sm_path_lookup(image_path);
+  int entry = path_id != SM_PATH_ID_NONE ? find_sidecar_entry_locked(path_id)
+                                         : -1;
+  sm_path_release(path_id);
+  if (entry >= 0) {
+    const image_sidecar_entry_t *e = &g_sidecar_entries[entry];
+    if (sidecar_stamps_equal(&e->image_stamp, &image_stamp) &&
+        sidecar_stamps_equal(&e->sidecar_stamp, &sidecar_stamp)) {
+      bool valid = e->valid;
+      if (valid)
+        *out = e->sidecar;
+      pthread_mutex_unlock(&g_sidecar_mutex);
+      return valid;
+    }
+  }
+  pthread_mutex_unlock(&g_sidecar_mutex);
+
+  bool valid = has_sidecar &&
+               sidecar_st.st_size <= (off_t)MAX_IMAGE_SIDECAR_SIZE &&
+               load_image_sidecar(dir_fd, image_path, image_rel, sidecar_rel,
+                                  &image_st, out);
+  if (valid) {
+    log_debug("  [IMG] sidecar: %s -> %s (%s)", image_path, out->title_id,
+              out->title_name);
+  }
+
+  pthread_mutex_lock(&g_sidecar_mutex);
+  store_sidecar_entry_locked(image_path, &image_stamp, &sidecar_stamp, valid,
+                             out);
+  pthread_mutex_unlock(&g_sidecar_mutex);
+  return valid;
+}
+
+bool get_image_sidecar(const char *image_path, image_sidecar_t *out) {
+  return get_image_sidecar_at(-1, image_path, NULL, out);
+}
+
+void prune_image_sidecar_cache(void) {
+  pthread_mutex_lock(&g_sidecar_mutex);
+  for (int i = 0; i < g_sidecar_used; i++) {
+    image_sidecar_entry_t *e = &g_sidecar_entries[i];
+    if (e->image_path == SM_PATH_ID_NONE)
+      continue;
+    struct stat st;
+    if (stat(sm_path_str(e->image_path), &st) != 0 || !S_ISREG(st.st_mode))
+      remove_sidecar_entry_locked(i);
+  }
+  pthread_mutex_unlock(&g_sidecar_mutex);
+}
+
+static void write_sidecar_json_string(FILE *f, const char *s) {
+  fputc('"', f);
+  for (const unsigned char *p = (const unsigned char *)s; *p; p++) {
+    if (*p == '"' || *p == '\\')
+      fprintf(f, "\\%c", *p);
+    else if (*p < 0x20u)
+      fprintf(f, "\\u%04x", *p);
+    else
+      fputc(*p, f);
+  }
+  fputc('"', f);
+}
+
+bool write_image_sidecar(const char *image_path,
+                         const image_sidecar_t *sidecar) {
+  char path[MAX_PATH];
+  char tmp_path[MAX_PATH];
+  int written = snprintf(path, sizeof(path), "%s%s", image_path,
+                         IMAGE_SIDECAR_SUFFIX);
+  if (written < 0 || (size_t)written >= sizeof(path))
+    return false;
+  written = snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+  if (written < 0 || (size_t)written >= sizeof(tmp_path))
+    return false;
+
+  FILE *f = fopen(tmp_path, "w");
+  if (!f) {
+    log_debug("  [IMG] sidecar open failed for %s: %s", tmp_path,
+              strerror(errno));
+    return false;
+  }
+  fprintf(f, "{\n  \"version\": %d,\n  \"titleId\": ", IMAGE_SIDECAR_VERSION);
+  write_sidecar_json_string(f, sidecar->title_id);
+  fputs(",\n  \"titleName\": ", f);
+  write_sidecar_json_string(f, sidecar->title_name);
+  const char *fs_name = sidecar_fs_type_name(sidecar->fs_type);
+  if (fs_name)
+    fprintf(f, ",\n  \"fsType\": \"%s\"", fs_name);
+  if (sidecar->cluster_size != 0)
+    fprintf(f, ",\n  \"clusterSize\": %u", sidecar->cluster_size);
+  fprintf(f,
+          ",\n  \"imageSize\": %llu,\n"
+          "  \"contentHash\": \"" IMAGE_SIDECAR_HASH_PREFIX "%016llx\",\n"
+          "  \"headHash\": \"" IMAGE_SIDECAR_HASH_PREFIX "%016llx\"\n}\n",
+          (unsigned long long)sidecar->image_size,
+          (unsigned long long)sidecar->content_hash,
+          (unsigned long long)sidecar->head_hash);
+  bool ok = !ferror(f);
+  if (fclose(f) != 0)
+    ok = false;
+  if (!ok || rename(tmp_path, path) != 0) {
+    log_debug("  [IMG] sidecar write failed for %s: %s", path,
+              strerror(errno));
+    (void)unlink(tmp_path);
+    return false;
+  }
+  return true;
+}
+
+void image_sidecar_cache_memory_usage(sm_state_table_usage_t *out) {
+  pthread_mutex_lock(&g_sidecar_mutex);
+  out->name = "image_sidecars";
+  out->count = g_sidecar_count;
+  out->capacity = g_sidecar_capacity;
+  out->bytes = (size_t)g_sidecar_capacity * sizeof(*g_sidecar_entries) +
+               sm_state_index_bytes(&g_sidecar_index);
+  pthread_mutex_unlock(&g_sidecar_mutex);
+}
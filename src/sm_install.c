@@ -10,9 +10,14 @@
 #include "sm_limits.h"
 #include "sm_path_utils.h"
 #include "sm_appdb.h"
+#include "sm_asset_store.h"
 #include "sm_title_state.h"
 #include "sm_image_cache.h"
+#include "sm_image.h"
+#include "sm_image_ondemand.h"
+#include "sm_mount_stats.h"
 #include "sm_paths.h"
+#include "sm_stage_manifest.h"
 #include "sm_manual.h"
 
 #include <dlfcn.h>
@@ -21,8 +26,7 @@ typedef int (*app_install_title_dir_fn_t)(const char *title_id,
                                           const char *install_path,
                                           void *reserved);
 
-static const char *const k_app_inst_util_sprx_path =
-    "/system/common/lib/libSceAppInstUtil.sprx";
+static const char *const k_app_inst_util_sprx_path = APP_INST_UTIL_SPRX_PATH;
 static const char *const k_app_install_title_dir_symbol =
     "sceAppInstUtilAppInstallTitleDir";
 
@@ -98,43 +102,10 @@ static bool is_appmeta_file(const char *name) {
           strcasecmp(ext, ".at9") == 0);
 }
 
-static bool copy_sce_sys_to_appmeta(const char *src_sce_sys,
-                                    const char *user_appmeta_dir) {
-  DIR *d = opendir(src_sce_sys);
-  if (!d)
-    return false;
-
-  bool ok = true;
-  struct dirent *e;
-  char src_path[MAX_PATH];
-  char dst_path[MAX_PATH];
-  struct stat st;
-  while ((e = readdir(d)) != NULL) {
-    if (strcmp(e->d_name, ".") == 0 || strcmp(e->d_name, "..") == 0)
-      continue;
-    if (!is_appmeta_file(e->d_name))
-      continue;
-
-    snprintf(src_path, sizeof(src_path), "%s/%s", src_sce_sys, e->d_name);
-    if (stat(src_path, &st) != 0 || !S_ISREG(st.st_mode))
-      continue;
-
-    snprintf(dst_path, sizeof(dst_path), "%s/%s", user_appmeta_dir, e->d_name);
-    if (copy_file(src_path, dst_path) != 0) {
-      ok = false;
-      break;
-    }
-  }
-
-  if (closedir(d) != 0)
-    ok = false;
-
-  return ok;
-}
-
 static bool copy_optional_trophy_metadata_file(const char *src_sce_sys,
                                                const char *dst_base,
-                                               const char *relative_path) {
+                                               const char *relative_path,
+                                               sm_copy_stats_t *copy_stats) {
   char src_path[MAX_PATH];
   char dst_path[MAX_PATH];
 
@@ -146,7 +117,7 @@ static bool copy_optional_trophy_metadata_file(const char *src_sce_sys,
   if (access(dst_path, F_OK) == 0)
     return true;
 
-  if (copy_file(src_path, dst_path) == 0)
+  if (asset_store_copy_file(src_path, dst_path, copy_stats) == 0)
     return true;
 
   log_debug("  [COPY] Failed to copy trophy metadata: %s -> %s", src_path,
@@ -155,14 +126,15 @@ static bool copy_optional_trophy_metadata_file(const char *src_sce_sys,
 }
 
 static bool update_trophy_metadata(const char *title_id,
-                                   const char *src_sce_sys) {
+                                   const char *src_sce_sys,
+                                   sm_copy_stats_t *copy_stats) {
   char dst_base[MAX_PATH];
   char dst_dir[MAX_PATH];
   bool ok = true;
 
-  snprintf(dst_base, sizeof(dst_base), "/system_data/priv/appmeta/%s",
+  snprintf(dst_base, sizeof(dst_base), SYSTEM_APPMETA_BASE "/%s",
            title_id);
-  mkdir("/system_data/priv/appmeta", 0755);
+  mkdir(SYSTEM_APPMETA_BASE, 0755);
   mkdir(dst_base, 0755);
 
   snprintf(dst_dir, sizeof(dst_dir), "%s/trophy2", dst_base);
@@ -171,26 +143,28 @@ static bool update_trophy_metadata(const char *title_id,
   mkdir(dst_dir, 0755);
 
   if (!copy_optional_trophy_metadata_file(src_sce_sys, dst_base,
-                                          "trophy2/npbind.dat"))
+                                          "trophy2/npbind.dat", copy_stats))
     ok = false;
   if (!copy_optional_trophy_metadata_file(src_sce_sys, dst_base,
-                                          "uds/npbind.dat"))
+                                          "uds/npbind.dat", copy_stats))
     ok = false;
-  if (!copy_optional_trophy_metadata_file(src_sce_sys, dst_base, "param.json"))
+  if (!copy_optional_trophy_metadata_file(src_sce_sys, dst_base, "param.json",
+                                          copy_stats))
     ok = false;
 
   return ok;
 }
 
 // --- Install/Remount Action ---
-static bool mount_and_install(const char *src_path, const char *title_id,
-                              const char *title_name, bool is_remount,
-                              bool should_register,
-                              bool use_app_install_all,
-                              bool *has_src_snd0_out) {
+static bool stage_and_install_title(const char *src_path, const char *title_id,
+                                    const char *title_name, bool is_remount,
+                                    bool should_register,
+                                    bool use_app_install_all,
+                                    bool *has_src_snd0_out,
+                                    image_fs_type_t *stats_fs_out) {
   char user_appmeta_dir[MAX_PATH];
   char user_app_dir[MAX_PATH];
-  char user_sce_sys[MAX_PATH];
+  char manifest_path[MAX_PATH];
   char src_sce_sys[MAX_PATH];
   char src_snd0[MAX_PATH];
   char image_source_path[MAX_PATH];
@@ -213,6 +187,11 @@ static bool mount_and_install(const char *src_path, const char *title_id,
                 src_path);
     }
   }
+  // Install phases are keyed by the image type backing the title.
+  image_fs_type_t stats_fs = has_image_source
+                                 ? get_image_fs_type_for_path(image_source_path)
+                                 : IMAGE_FS_UNKNOWN;
+  *stats_fs_out = stats_fs;
 
   snprintf(src_sce_sys, sizeof(src_sce_sys), "%s/sce_sys", src_path);
   appmeta_missing = !has_appmeta_data(title_id);
@@ -232,32 +211,58 @@ static bool mount_and_install(const char *src_path, const char *title_id,
   if (!restage_staging && !restage_appmeta)
     log_debug("  [SPEED] Skipping file copy (Assets already exist)");
 
-  if (restage_staging) {
+  sm_copy_stats_t copy_stats;
+  memset(&copy_stats, 0, sizeof(copy_stats));
+  uint64_t phase_start_us = sm_mount_stats_begin();
+  uint32_t unchanged_files = 0;
+  unsigned copy_workers = runtime_config()->copy_workers;
+  if (restage_staging || restage_appmeta) {
     mkdir(APP_BASE, 0777);
     mkdir(user_app_dir, 0777);
-    snprintf(user_sce_sys, sizeof(user_sce_sys), "%s/sce_sys", user_app_dir);
-    mkdir(user_sce_sys, 0777);
-    if (copy_dir(src_sce_sys, user_sce_sys) != 0) {
-      log_debug("  [COPY] Failed to copy sce_sys staging: %s -> %s", src_sce_sys,
-                user_sce_sys);
-      return false;
+  }
+  if (restage_staging) {
+    stage_manifest_t manifest;
+    snprintf(manifest_path, sizeof(manifest_path), "%s/%s", user_app_dir,
+             STAGE_MANIFEST_STAGING_NAME);
+    load_stage_manifest(manifest_path, user_app_dir, &manifest);
+    bool staged = stage_manifest_queue_dir(&manifest, src_sce_sys, "sce_sys",
+                                           true, NULL) == 0;
+    if (!staged) {
+      log_debug("  [COPY] Failed to copy sce_sys staging: %s -> %s/sce_sys",
+                src_sce_sys, user_app_dir);
+    } else {
+      char icon_src[MAX_PATH];
+      struct stat icon_st;
+      snprintf(icon_src, sizeof(icon_src), "%s/icon0.png", src_sce_sys);
+      staged = stat(icon_src, &icon_st) == 0 &&
+               stage_manifest_queue_file(&manifest, icon_src, &icon_st,
+                                         "icon0.png") == 0;
+      if (!staged) {
+        log_debug("  [COPY] Failed to copy staged icon: %s -> %s/icon0.png",
+                  icon_src, user_app_dir);
+      }
     }
-
-    char icon_src[MAX_PATH];
-    char icon_dst[MAX_PATH];
-    snprintf(icon_src, sizeof(icon_src), "%s/icon0.png", src_sce_sys);
-    snprintf(icon_dst, sizeof(icon_dst), "%s/icon0.png", user_app_dir);
-    if (copy_file(icon_src, icon_dst) != 0) {
-      log_debug("  [COPY] Failed to copy staged icon: %s -> %s", icon_src,
-                icon_dst);
+    if (staged)
+      staged = commit_stage_manifest(&manifest, copy_workers, &copy_stats);
+    unchanged_files += manifest.unchanged;
+    free_stage_manifest(&manifest);
+    if (!staged)
       return false;
-    }
   }
 
   if (restage_appmeta) {
     mkdir(APPMETA_BASE, 0777);
     mkdir(user_appmeta_dir, 0777);
-    if (!copy_sce_sys_to_appmeta(src_sce_sys, user_appmeta_dir)) {
+    stage_manifest_t manifest;
+    snprintf(manifest_path, sizeof(manifest_path), "%s/%s", user_app_dir,
+             STAGE_MANIFEST_APPMETA_NAME);
+    load_stage_manifest(manifest_path, user_appmeta_dir, &manifest);
+    bool staged = stage_manifest_queue_dir(&manifest, src_sce_sys, "", false,
+                                           is_appmeta_file) == 0 &&
+                  commit_stage_manifest(&manifest, copy_workers, &copy_stats);
+    unchanged_files += manifest.unchanged;
+    free_stage_manifest(&manifest);
+    if (!staged) {
       log_debug("  [COPY] Failed to copy appmeta files: %s -> %s", src_sce_sys,
                 user_appmeta_dir);
       return false;
@@ -265,13 +270,32 @@ static bool mount_and_install(const char *src_path, const char *title_id,
     metadata_restaged = true;
   }
 
-  if (!update_trophy_metadata(title_id, src_sce_sys))
+  if (!update_trophy_metadata(title_id, src_sce_sys, &copy_stats))
     return false;
+  sm_mount_stats_end(SM_MOUNT_PHASE_STAGE, stats_fs, ATTACH_BACKEND_NONE,
+                     phase_start_us);
+  if (copy_stats.files > 0 || copy_stats.linked_files > 0 ||
+      unchanged_files > 0) {
+    log_debug("  [COPY] staged %s: files=%u linked=%u unchanged=%u bytes=%llu "
+              "linked_bytes=%llu holes=%llu time=%llu us rate=%llu KiB/s",
+              title_id, copy_stats.files, copy_stats.linked_files,
+              unchanged_files,
+              (unsigned long long)copy_stats.bytes,
+              (unsigned long long)copy_stats.linked_bytes,
+              (unsigned long long)copy_stats.hole_bytes,
+              (unsigned long long)copy_stats.elapsed_us,
+              (unsigned long long)(sm_copy_stats_bytes_per_sec(&copy_stats) /
+                                   1024u));
+  }
 
   if (should_stop_requested() || runtime_sleep_mode_active())
     return false;
 
-  if (!mount_title_nullfs(title_id, src_path)) {
+  phase_start_us = sm_mount_stats_begin();
+  bool nullfs_mounted = mount_title_nullfs(title_id, src_path);
+  sm_mount_stats_end(SM_MOUNT_PHASE_NULLFS, stats_fs, ATTACH_BACKEND_NONE,
+                     phase_start_us);
+  if (!nullfs_mounted) {
     log_debug("  [LINK] nullfs mount failed: title=%s src=%s", title_id,
               src_path);
     return false;
@@ -279,6 +303,7 @@ static bool mount_and_install(const char *src_path, const char *title_id,
 
   // WRITE TRACKER
   char lnk_path[MAX_PATH];
+  phase_start_us = sm_mount_stats_begin();
   runtime_mount_state_lock();
   if (runtime_sleep_mode_active()) {
     (void)rollback_title_nullfs_mount(title_id, src_path);
@@ -313,12 +338,15 @@ static bool mount_and_install(const char *src_path, const char *title_id,
       log_debug("  [LINK] image source cache update failed: %s -> %s",
                 src_path, image_source_path);
     }
+    sm_image_ondemand_note_attached(title_id, image_source_path);
   } else if (unlink(img_lnk_path) != 0 && errno != ENOENT) {
     log_debug("  [LINK] remove failed for %s: %s", img_lnk_path,
               strerror(errno));
   }
   bool sleep_started = runtime_sleep_mode_active();
   runtime_mount_state_unlock();
+  sm_mount_stats_end(SM_MOUNT_PHASE_LINK, stats_fs, ATTACH_BACKEND_NONE,
+                     phase_start_us);
   if (sleep_started || runtime_sleep_mode_active())
     return true;
 
@@ -352,7 +380,10 @@ static bool mount_and_install(const char *src_path, const char *title_id,
   }
 
   mark_register_attempted(title_id);
+  phase_start_us = sm_mount_stats_begin();
   int res = app_install_title_dir_fn(title_id, APP_BASE "/", 0);
+  sm_mount_stats_end(SM_MOUNT_PHASE_REGISTER, stats_fs, ATTACH_BACKEND_NONE,
+                     phase_start_us);
   sceKernelUsleep(200000);
 
   if (res == 0) {
@@ -385,6 +416,23 @@ static bool mount_and_install(const char *src_path, const char *title_id,
   return true;
 }
 
+static bool mount_and_install(const char *src_path, const char *title_id,
+                              const char *title_name, bool is_remount,
+                              bool should_register,
+                              bool use_app_install_all,
+                              bool *has_src_snd0_out) {
+  uint64_t install_start_us = sm_mount_stats_begin();
+  image_fs_type_t stats_fs = IMAGE_FS_UNKNOWN;
+  bool installed = stage_and_install_title(
+      src_path, title_id, title_name, is_remount, should_register,
+      use_app_install_all, has_src_snd0_out, &stats_fs);
+  if (installed) {
+    sm_mount_stats_end(SM_MOUNT_PHASE_INSTALL_TOTAL, stats_fs,
+                       ATTACH_BACKEND_NONE, install_start_us);
+  }
+  return installed;
+}
+
 // --- Execution (per discovered candidate) ---
 void process_scan_candidates(const scan_candidate_t *candidates,
                              int candidate_count) {
@@ -8,7 +8,9 @@
 #include "sm_limits.h"
 #include "sm_log.h"
 #include "sm_manual.h"
+#include "sm_path_pool.h"
 #include "sm_runtime.h"
+#include "sm_state_table.h"
 #include "sm_time.h"
 #include "sm_title_state.h"
 
@@ -25,15 +27,16 @@ typedef enum {
 typedef struct {
   char title_id[MAX_TITLE_ID];
   char title_name[MAX_TITLE_NAME];
-  char source_path[MAX_PATH];
-  char manual_source_path[MAX_PATH];
+  sm_path_id_t source_path;
+  sm_path_id_t manual_source_path;
   uint64_t requested_at_us;
   bool has_src_snd0;
   bool manual;
   install_track_state_t state;
 } pending_install_entry_t;
 
-static pending_install_entry_t g_pending_installs[MAX_PENDING];
+static pending_install_entry_t *g_pending_installs = NULL;
+static int g_pending_install_capacity = 0;
 static uint64_t g_pending_install_poll_due_us = 0;
 static uint64_t g_queued_install_submit_due_us = 0;
 static int g_tracked_install_count = 0;
@@ -54,7 +57,7 @@ static pending_install_entry_t *find_pending_install_entry(
   if (!title_id || title_id[0] == '\0')
     return NULL;
 
-  for (int i = 0; i < MAX_PENDING; i++) {
+  for (int i = 0; i < g_pending_install_capacity; i++) {
     if (g_pending_installs[i].state == INSTALL_TRACK_NONE)
       continue;
     if (strcmp(g_pending_installs[i].title_id, title_id) == 0)
@@ -70,12 +73,18 @@ static pending_install_entry_t *reserve_pending_install_entry(
   if (entry)
     return entry;
 
-  for (int i = 0; i < MAX_PENDING; i++) {
+  for (int i = 0; i < g_pending_install_capacity; i++) {
     if (g_pending_installs[i].state == INSTALL_TRACK_NONE)
       return &g_pending_installs[i];
   }
 
-  return NULL;
+  int slot = g_pending_install_capacity;
+  if (!sm_state_table_reserve((void **)&g_pending_installs,
+                              &g_pending_install_capacity, slot + 1,
+                              sizeof(*g_pending_installs))) {
+    return NULL;
+  }
+  return &g_pending_installs[slot];
 }
 
 static uint64_t next_pending_install_timeout_us(void) {
@@ -83,7 +92,7 @@ static uint64_t next_pending_install_timeout_us(void) {
     return 0;
 
   uint64_t next_deadline = 0;
-  for (int i = 0; i < MAX_PENDING; i++) {
+  for (int i = 0; i < g_pending_install_capacity; i++) {
     const pending_install_entry_t *entry = &g_pending_installs[i];
     if (entry->state != INSTALL_TRACK_SUBMITTED || entry->requested_at_us == 0)
       continue;
@@ -132,6 +141,8 @@ static void clear_pending_install_entry(pending_install_entry_t *entry) {
     g_submitted_install_count--;
   if (entry->state != INSTALL_TRACK_NONE && g_tracked_install_count > 0)
     g_tracked_install_count--;
+  sm_path_release(entry->source_path);
+  sm_path_release(entry->manual_source_path);
   memset(entry, 0, sizeof(*entry));
   if (g_submitted_install_count <= 0)
     g_pending_install_poll_due_us = 0;
@@ -193,13 +204,23 @@ bool sm_install_queue_candidate(const scan_candidate_t *candidate,
   if (previous_state == INSTALL_TRACK_SUBMITTED)
     return true;
 
+  sm_path_id_t source_path = sm_path_intern(candidate->path);
+  if (source_path == SM_PATH_ID_NONE) {
+    log_debug("  [REG] install queue path allocation failed: %s (%s)",
+              candidate->title_name, candidate->title_id);
+    return false;
+  }
+  sm_path_id_t manual_source_path =
+      sm_path_intern(candidate->manual_source_path);
+
+  sm_path_release(entry->source_path);
+  sm_path_release(entry->manual_source_path);
   memset(entry, 0, sizeof(*entry));
   (void)strlcpy(entry->title_id, candidate->title_id, sizeof(entry->title_id));
   (void)strlcpy(entry->title_name, candidate->title_name,
                 sizeof(entry->title_name));
-  (void)strlcpy(entry->source_path, candidate->path, sizeof(entry->source_path));
-  (void)strlcpy(entry->manual_source_path, candidate->manual_source_path,
-                sizeof(entry->manual_source_path));
+  entry->source_path = source_path;
+  entry->manual_source_path = manual_source_path;
   entry->manual = candidate->manual;
   entry->has_src_snd0 = has_src_snd0;
   entry->state = INSTALL_TRACK_QUEUED;
@@ -224,10 +245,11 @@ static void finalize_pending_install_success(pending_install_entry_t *entry) {
     if (snd0_updates >= 0)
       log_debug("  [DB] snd0info updated rows=%d", snd0_updates);
   }
-  cache_game_entry(entry->source_path, entry->title_id, entry->title_name);
+  cache_game_entry(sm_path_str(entry->source_path), entry->title_id,
+                   entry->title_name);
   if (entry->manual)
-    sm_manual_note_installed(entry->manual_source_path, entry->title_id,
-                             entry->title_name);
+    sm_manual_note_installed(sm_path_str(entry->manual_source_path),
+                             entry->title_id, entry->title_name);
   clear_register_attempts(entry->title_id);
   clear_failed_mount_attempts(entry->title_id);
   clear_pending_install_entry(entry);
@@ -258,7 +280,7 @@ static void poll_pending_installs(void) {
   if (!app_db_titles_ready)
     log_debug("  [DB] app.db title list unavailable while polling installs");
 
-  for (int i = 0; i < MAX_PENDING; i++) {
+  for (int i = 0; i < g_pending_install_capacity; i++) {
     pending_install_entry_t *entry = &g_pending_installs[i];
     if (entry->state != INSTALL_TRACK_SUBMITTED)
       continue;
@@ -350,7 +372,7 @@ static void log_queued_install_batch(void) {
     return;
 
   log_debug("  [REG] Batch install request contains %d title(s):", queued_count);
-  for (int i = 0; i < MAX_PENDING; i++) {
+  for (int i = 0; i < g_pending_install_capacity; i++) {
     const pending_install_entry_t *entry = &g_pending_installs[i];
     if (entry->state != INSTALL_TRACK_QUEUED)
       continue;
@@ -367,7 +389,7 @@ static void notify_queued_install_batch(void) {
   int shown_count = 0;
   snprintf(message, sizeof(message), "Batch install queued (%d):", queued_count);
 
-  for (int i = 0; i < MAX_PENDING; i++) {
+  for (int i = 0; i < g_pending_install_capacity; i++) {
     const pending_install_entry_t *entry = &g_pending_installs[i];
     if (entry->state != INSTALL_TRACK_QUEUED)
       continue;
@@ -439,7 +461,7 @@ bool sm_install_submit_queued(void) {
 
   g_queued_install_submit_due_us = 0;
   g_queued_install_submit_failure_notified = false;
-  for (int i = 0; i < MAX_PENDING; i++) {
+  for (int i = 0; i < g_pending_install_capacity; i++) {
     pending_install_entry_t *entry = &g_pending_installs[i];
     if (entry->state != INSTALL_TRACK_QUEUED)
       continue;
@@ -455,7 +477,7 @@ bool sm_install_submit_queued(void) {
 }
 
 void sm_install_note_submit_failure(void) {
-  for (int i = 0; i < MAX_PENDING; i++) {
+  for (int i = 0; i < g_pending_install_capacity; i++) {
     pending_install_entry_t *entry = &g_pending_installs[i];
     if (entry->state != INSTALL_TRACK_QUEUED)
       continue;
@@ -464,3 +486,11 @@ void sm_install_note_submit_failure(void) {
       drop_queued_install_entry(entry);
   }
 }
+
+void install_queue_memory_usage(sm_state_table_usage_t *out) {
+  out->name = "install_queue";
+  out->count = g_tracked_install_count;
+  out->capacity = g_pending_install_capacity;
+  out->bytes =
+      (size_t)g_pending_install_capacity * sizeof(*g_pending_installs);
+}
@@ -6,7 +6,12 @@
 #include "sm_types.h"
 #include "sm_paths.h"
 
+// The last error is kept per thread so image attach workers do not report
+// each other's failures; g_last_error backs threads without their own slot.
 static sm_error_t g_last_error;
+static pthread_key_t g_last_error_key;
+static pthread_once_t g_last_error_once = PTHREAD_ONCE_INIT;
+static bool g_last_error_key_ready = false;
 static bool g_notifications_initialized = false;
 static pthread_mutex_t g_notifications_mutex = PTHREAD_MUTEX_INITIALIZER;
 static pthread_mutex_t g_log_mutex = PTHREAD_MUTEX_INITIALIZER;
@@ -34,7 +39,7 @@ static bool ensure_notification_icon_present(void) {
   if (stat(NOTIFY_ICON_FILE, &st) == 0 && st.st_size > 0)
     return true;
 
-  (void)mkdir("/user/data", 0777);
+  (void)mkdir(USER_DATA_DIR, 0777);
   (void)mkdir(NOTIFY_ICON_DIR, 0777);
   FILE *fp = fopen(NOTIFY_ICON_FILE, "wb");
   if (!fp) {
@@ -350,38 +355,66 @@ void notify_system_info(const char *fmt, ...) {
   va_end(args);
 }
 
+static void create_last_error_key(void) {
+  g_last_error_key_ready = pthread_key_create(&g_last_error_key, free) == 0;
+}
+
+static sm_error_t *current_error(void) {
+  (void)pthread_once(&g_last_error_once, create_last_error_key);
+  if (!g_last_error_key_ready)
+    return &g_last_error;
+  sm_error_t *err = (sm_error_t *)pthread_getspecific(g_last_error_key);
+  if (err)
+    return err;
+  err = (sm_error_t *)calloc(1, sizeof(*err));
+  if (!err)
+    return &g_last_error;
+  if (pthread_setspecific(g_last_error_key, err) != 0) {
+    free(err);
+    return &g_last_error;
+  }
+  return err;
+}
+
 void sm_error_clear(void) {
-  memset(&g_last_error, 0, sizeof(g_last_error));
+  memset(current_error(), 0, sizeof(sm_error_t));
 }
 
 void sm_error_set(const char *subsystem, int code, const char *path,
                   const char *fmt, ...) {
-  memset(&g_last_error, 0, sizeof(g_last_error));
-  g_last_error.valid = true;
-  g_last_error.code = code;
+  sm_error_t *err = current_error();
+  memset(err, 0, sizeof(*err));
+  err->valid = true;
+  err->code = code;
   if (subsystem && subsystem[0] != '\0')
-    (void)strlcpy(g_last_error.subsystem, subsystem,
-                  sizeof(g_last_error.subsystem));
+    (void)strlcpy(err->subsystem, subsystem, sizeof(err->subsystem));
   if (path && path[0] != '\0')
-    (void)strlcpy(g_last_error.path, path, sizeof(g_last_error.path));
+    (void)strlcpy(err->path, path, sizeof(err->path));
   if (fmt && fmt[0] != '\0') {
     va_list args;
     va_start(args, fmt);
-    vsnprintf(g_last_error.message, sizeof(g_last_error.message), fmt, args);
+    vsnprintf(err->message, sizeof(err->message), fmt, args);
     va_end(args);
   }
 }
 
+void sm_error_restore(const sm_error_t *err) {
+  if (err)
+    *current_error() = *err;
+  else
+    sm_error_clear();
+}
+
 const sm_error_t *sm_last_error(void) {
-  return &g_last_error;
+  return current_error();
 }
 
 bool sm_error_notified(void) {
-  return g_last_error.notified;
+  return current_error()->notified;
 }
 
 void sm_error_mark_notified(void) {
-  g_last_error.notified = true;
+  current_error()->notified = true;
 }
 
 void notify_system(const char *fmt, ...) {
@@ -392,11 +425,11 @@ void notify_system(const char *fmt, ...) {
 }
 
 void notify_image_mount_failed(const char *path, int mount_err) {
-  if (g_last_error.valid && g_last_error.message[0] != '\0') {
-    const char *error_path =
-        (g_last_error.path[0] != '\0') ? g_last_error.path : path;
-    notify_system("%s\n%s", g_last_error.message, error_path);
-    g_last_error.notified = true;
+  sm_error_t *err = current_error();
+  if (err->valid && err->message[0] != '\0') {
+    const char *error_path = (err->path[0] != '\0') ? err->path : path;
+    notify_system("%s\n%s", err->message, error_path);
+    err->notified = true;
     return;
   }
 
@@ -1,4 +1,6 @@
 #include "sm_platform.h"
+#include <pthread.h>
+
 #include "sm_runtime.h"
 #include "sm_mount_device.h"
 #include "sm_image_cache.h"
@@ -6,8 +8,17 @@
 #include "sm_log.h"
 #include "sm_config_mount.h"
 #include "sm_mount_defs.h"
+#include "sm_mount_stats.h"
+#include "sm_mount_table.h"
 #include "sm_path_utils.h"
 #include "sm_stability.h"
+#include "sm_time.h"
+
+// Observed device node wait latencies. Index 0 = node removal, 1 = creation.
+static sm_latency_hist_t g_dev_node_waits[2];
+static uint32_t g_dev_node_wait_timeouts[2];
+static uint32_t g_dev_node_waits_logged = 0;
+static pthread_mutex_t g_dev_node_waits_mutex = PTHREAD_MUTEX_INITIALIZER;
 
 const char *attach_backend_name(attach_backend_t backend) {
   if (backend == ATTACH_BACKEND_LVD)
@@ -18,16 +29,69 @@ const char *attach_backend_name(attach_backend_t backend) {
 }
 
 // --- Device Node Wait and Source Stability ---
+static void record_dev_node_wait(bool should_exist, uint64_t waited_us,
+                                 bool timed_out) {
+  int kind = should_exist ? 1 : 0;
+  pthread_mutex_lock(&g_dev_node_waits_mutex);
+  sm_latency_hist_add(&g_dev_node_waits[kind], waited_us);
+  if (timed_out)
+    g_dev_node_wait_timeouts[kind]++;
+  pthread_mutex_unlock(&g_dev_node_waits_mutex);
+}
+
 bool wait_for_dev_node_state(const char *devname, bool should_exist) {
-  for (int i = 0; i < LVD_NODE_WAIT_RETRIES; i++) {
-    if (path_exists(devname) == should_exist)
+  uint64_t start_us = monotonic_time_us();
+  unsigned int poll_us = DEV_NODE_WAIT_MIN_POLL_US;
+  // The timeout counts requested sleeps, so it holds without a clock.
+  unsigned int slept_us = 0;
+  for (;;) {
+    if (path_exists(devname) == should_exist) {
+      record_dev_node_wait(should_exist, monotonic_time_us() - start_us,
+                           false);
       return true;
-    sceKernelUsleep(LVD_NODE_WAIT_US);
+    }
+    if (slept_us >= DEV_NODE_WAIT_TIMEOUT_US)
+      break;
+    sceKernelUsleep(poll_us);
+    slept_us += poll_us;
+    poll_us = poll_us < DEV_NODE_WAIT_MAX_POLL_US / 2u
+                  ? poll_us * 2u
+                  : DEV_NODE_WAIT_MAX_POLL_US;
   }
 
+  record_dev_node_wait(should_exist, monotonic_time_us() - start_us, true);
   return false;
 }
 
+void log_dev_node_wait_stats(void) {
+  pthread_mutex_lock(&g_dev_node_waits_mutex);
+  uint32_t total = g_dev_node_waits[0].count + g_dev_node_waits[1].count;
+  if (total == g_dev_node_waits_logged) {
+    pthread_mutex_unlock(&g_dev_node_waits_mutex);
+    return;
+  }
+  g_dev_node_waits_logged = total;
+  sm_latency_hist_t waits[2];
+  uint32_t timeouts[2];
+  memcpy(waits, g_dev_node_waits, sizeof(waits));
+  memcpy(timeouts, g_dev_node_wait_timeouts, sizeof(timeouts));
+  pthread_mutex_unlock(&g_dev_node_waits_mutex);
+
+  for (int i = 1; i >= 0; i--) {
+    const sm_latency_hist_t *stats = &waits[i];
+    if (stats->count == 0)
+      continue;
+    log_debug("  [IMG] dev node %s waits: n=%u timeouts=%u avg=%llu us "
+              "p50<%llu us p90<%llu us p99<%llu us max=%llu us",
+              i == 1 ? "create" : "remove", stats->count, timeouts[i],
+              (unsigned long long)(stats->total_us / stats->count),
+              (unsigned long long)sm_latency_hist_percentile_us(stats, 50u),
+              (unsigned long long)sm_latency_hist_percentile_us(stats, 90u),
+              (unsigned long long)sm_latency_hist_percentile_us(stats, 99u),
+              (unsigned long long)stats->max_us);
+  }
+}
+
 bool is_source_stable_for_mount(const char *path, const char *name,
                                 const char *tag) {
   double age = 0.0;
@@ -57,6 +121,26 @@ static bool parse_unit_from_dev_path(const char *dev_path, const char *prefix,
   return true;
 }
 
+typedef struct {
+  attach_backend_t backend;
+  int unit;
+} mount_device_t;
+
+static bool visit_mount_device(const struct statfs *entry, void *ctx) {
+  mount_device_t *device = (mount_device_t *)ctx;
+  if (parse_unit_from_dev_path(entry->f_mntfromname, LVD_DEV_PREFIX,
+                               &device->unit)) {
+    device->backend = ATTACH_BACKEND_LVD;
+    return false;
+  }
+  if (parse_unit_from_dev_path(entry->f_mntfromname, MD_DEV_PREFIX,
+                               &device->unit)) {
+    device->backend = ATTACH_BACKEND_MD;
+    return false;
+  }
+  return true;
+}
+
 bool resolve_device_from_mount(const char *mount_point,
                                attach_backend_t *backend_out, int *unit_out) {
   *backend_out = ATTACH_BACKEND_NONE;
@@ -65,89 +149,60 @@ bool resolve_device_from_mount(const char *mount_point,
   if (resolve_device_from_mount_cache(mount_point, backend_out, unit_out))
     return true;
 
-  struct statfs sfs;
-  if (statfs(mount_point, &sfs) != 0)
-    return false;
-
-  if (strcmp(sfs.f_mntonname, mount_point) != 0)
-    return false;
-
-  if (parse_unit_from_dev_path(sfs.f_mntfromname, "/dev/lvd", unit_out)) {
-    *backend_out = ATTACH_BACKEND_LVD;
-    return true;
-  }
-
-  if (parse_unit_from_dev_path(sfs.f_mntfromname, "/dev/md", unit_out)) {
-    *backend_out = ATTACH_BACKEND_MD;
-    return true;
-  }
-
-  struct statfs *mntbuf = NULL;
-  int mntcount = getmntinfo(&mntbuf, MNT_NOWAIT);
-  if (mntcount <= 0 || !mntbuf)
-    return false;
-
-  for (int i = 0; i < mntcount; i++) {
-    if (strcmp(mntbuf[i].f_mntonname, mount_point) != 0)
-      continue;
-    if (parse_unit_from_dev_path(mntbuf[i].f_mntfromname, "/dev/lvd", unit_out)) {
-      *backend_out = ATTACH_BACKEND_LVD;
-      return true;
-    }
-    if (parse_unit_from_dev_path(mntbuf[i].f_mntfromname, "/dev/md", unit_out)) {
-      *backend_out = ATTACH_BACKEND_MD;
-      return true;
-    }
-  }
+  mount_device_t device = {ATTACH_BACKEND_NONE, -1};
+  (void)mount_table_for_each_on(mount_point, visit_mount_device, &device);
+  *backend_out = device.backend;
+  *unit_out = device.unit;
+  return device.backend != ATTACH_BACKEND_NONE;
+}
 
-  return false;
+bool is_active_image_mount_point(const char *path) {
+  return mount_table_is_mount_point(path);
 }
 
-static bool is_path_mountpoint(const char *path) {
-  struct statfs sfs;
-  return (statfs(path, &sfs) == 0 && strcmp(sfs.f_mntonname, path) == 0);
+static bool log_lvd_mount_entry(const struct statfs *entry, void *ctx) {
+  (void)ctx;
+  if (strncmp(entry->f_mntfromname, LVD_DEV_PREFIX,
+              sizeof(LVD_DEV_PREFIX) - 1) != 0)
+    return true;
+  log_debug("  [IMG][LVD] mounted: from=%s path=%s type=%s "
+            "bsize=%llu iosize=%llu blocks=%llu bfree=%llu "
+            "bavail=%llu files=%llu ffree=%llu flags=0x%lX",
+            entry->f_mntfromname, entry->f_mntonname, entry->f_fstypename,
+            (unsigned long long)(uint64_t)entry->f_bsize,
+            (unsigned long long)(uint64_t)entry->f_iosize,
+            (unsigned long long)(uint64_t)entry->f_blocks,
+            (unsigned long long)(uint64_t)entry->f_bfree,
+            (unsigned long long)(uint64_t)entry->f_bavail,
+            (unsigned long long)(uint64_t)entry->f_files,
+            (unsigned long long)(uint64_t)entry->f_ffree,
+            (unsigned long)entry->f_flags);
+  return true;
 }
 
-bool is_active_image_mount_point(const char *path) {
-  return is_path_mountpoint(path);
+static bool visit_mount_stop(const struct statfs *entry, void *ctx) {
+  (void)entry;
+  (void)ctx;
+  return false;
 }
 
 bool wait_for_lvd_release(void) {
-  for (unsigned int waited_us = 0;; waited_us += LVD_RELEASE_WAIT_POLL_US) {
-    struct statfs *mntbuf = NULL;
-    int mntcount = getmntinfo(&mntbuf, MNT_NOWAIT);
-    bool mounted = false;
-    for (int i = 0; i < mntcount && mntbuf; i++) {
-      if (strcmp(mntbuf[i].f_mntfromname, "/dev/lvd2") != 0)
-        continue;
-      mounted = true;
-      break;
-    }
+  unsigned int poll_us = LVD_RELEASE_WAIT_MIN_POLL_US;
+  for (unsigned int waited_us = 0;; waited_us += poll_us) {
+    // The release happens outside the payload; read the table again.
+    mount_table_invalidate();
+    bool mounted = mount_table_for_each_from(LVD_DEV_PREFIX "2",
+                                             visit_mount_stop, NULL) > 0;
     if (!mounted) {
       if (waited_us != 0)
-        log_debug("  [IMG][LVD] /dev/lvd2 released");
+        log_debug("  [IMG][LVD] /dev/lvd2 released after ~%u ms",
+                  waited_us / 1000u);
       return true;
     }
 
     if (waited_us == 0) {
       log_debug("  [IMG][LVD] waiting for /dev/lvd2 to be released...");
-      for (int i = 0; i < mntcount && mntbuf; i++) {
-        if (strncmp(mntbuf[i].f_mntfromname, "/dev/lvd", 8) != 0)
-          continue;
-        log_debug("  [IMG][LVD] mounted: from=%s path=%s type=%s "
-                  "bsize=%llu iosize=%llu blocks=%llu bfree=%llu "
-                  "bavail=%llu files=%llu ffree=%llu flags=0x%lX",
-                  mntbuf[i].f_mntfromname, mntbuf[i].f_mntonname,
-                  mntbuf[i].f_fstypename,
-                  (unsigned long long)(uint64_t)mntbuf[i].f_bsize,
-                  (unsigned long long)(uint64_t)mntbuf[i].f_iosize,
-                  (unsigned long long)(uint64_t)mntbuf[i].f_blocks,
-                  (unsigned long long)(uint64_t)mntbuf[i].f_bfree,
-                  (unsigned long long)(uint64_t)mntbuf[i].f_bavail,
-                  (unsigned long long)(uint64_t)mntbuf[i].f_files,
-                  (unsigned long long)(uint64_t)mntbuf[i].f_ffree,
-                  (unsigned long)mntbuf[i].f_flags);
-      }
+      (void)mount_table_for_each(log_lvd_mount_entry, NULL);
     }
     if (should_stop_requested())
       return false;
@@ -156,7 +211,11 @@ bool wait_for_lvd_release(void) {
                 "continuing startup", LVD_RELEASE_WAIT_MAX_US / 1000u);
       return true;
     }
-    sceKernelUsleep(LVD_RELEASE_WAIT_POLL_US);
+    if (waited_us != 0)
+      poll_us = poll_us < LVD_RELEASE_WAIT_POLL_US / 2u
+                    ? poll_us * 2u
+                    : LVD_RELEASE_WAIT_POLL_US;
+    sceKernelUsleep(poll_us);
   }
 }
 
@@ -186,7 +245,7 @@ static bool detach_lvd_unit(int unit_id) {
   close(fd);
 
   char devname[64];
-  snprintf(devname, sizeof(devname), "/dev/lvd%d", unit_id);
+  snprintf(devname, sizeof(devname), LVD_DEV_PREFIX "%d", unit_id);
   if (!wait_for_dev_node_state(devname, false)) {
     log_debug("  [IMG][%s] device node still present after detach: /dev/lvd%d",
               attach_backend_name(ATTACH_BACKEND_LVD), unit_id);
@@ -230,7 +289,7 @@ static bool detach_md_unit(int unit_id) {
   close(fd);
 
   char devname[64];
-  snprintf(devname, sizeof(devname), "/dev/md%d", unit_id);
+  snprintf(devname, sizeof(devname), MD_DEV_PREFIX "%d", unit_id);
   if (!wait_for_dev_node_state(devname, false)) {
     log_debug("  [IMG][%s] device node still present after detach: /dev/md%d",
               attach_backend_name(ATTACH_BACKEND_MD), unit_id);
@@ -0,0 +1,191 @@
+#include "sm_platform.h"
+#include "sm_mount_stats.h"
+
+#include <pthread.h>
+
+#include "sm_log.h"
+#include "sm_mount_device.h"
+#include "sm_paths.h"
+#include "sm_time.h"
+
+// Per (phase, fs type, backend) latency histograms of the mount and install
+// pipelines. Recording is a clock read plus a short locked update, cheap next
+// to the syscalls being timed.
+
+#define MOUNT_STATS_FS_TYPES ((int)IMAGE_FS_PFSC_CONTAINER + 1)
+#define MOUNT_STATS_BACKENDS ((int)ATTACH_BACKEND_MD + 1)
+
+static sm_latency_hist_t g_mount_stats[SM_MOUNT_PHASE_COUNT]
+                                      [MOUNT_STATS_FS_TYPES]
+                                      [MOUNT_STATS_BACKENDS];
+static pthread_mutex_t g_mount_stats_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static const char *const k_mount_phase_names[SM_MOUNT_PHASE_COUNT] = {
+    [SM_MOUNT_PHASE_OVERRIDE] = "override",
+    [SM_MOUNT_PHASE_BACKEND] = "backend",
+    [SM_MOUNT_PHASE_ATTACH] = "attach",
+    [SM_MOUNT_PHASE_DEV_NODE] = "dev_node",
+    [SM_MOUNT_PHASE_NMOUNT] = "nmount",
+    [SM_MOUNT_PHASE_VALIDATE] = "validate",
+    [SM_MOUNT_PHASE_PUBLISH] = "publish",
+    [SM_MOUNT_PHASE_IMAGE_TOTAL] = "image_total",
+    [SM_MOUNT_PHASE_STAGE] = "stage",
+    [SM_MOUNT_PHASE_NULLFS] = "nullfs",
+    [SM_MOUNT_PHASE_LINK] = "link",
+    [SM_MOUNT_PHASE_REGISTER] = "register",
+    [SM_MOUNT_PHASE_INSTALL_TOTAL] = "install_total",
+};
+
+static const char *const k_mount_stats_fs_names[MOUNT_STATS_FS_TYPES] = {
+    [IMAGE_FS_UNKNOWN] = "dir",
+    [IMAGE_FS_UFS] = "ufs",
+    [IMAGE_FS_EXFAT] = "exfatfs",
+    [IMAGE_FS_PFS] = "pfs",
+    [IMAGE_FS_PFSC_CONTAINER] = "pfsc",
+};
+
+void sm_latency_hist_add(sm_latency_hist_t *hist, uint64_t elapsed_us) {
+  int bucket = 0;
+  while (bucket < SM_LATENCY_BUCKETS - 1 &&
+         elapsed_us >= (1ull << bucket)) {
+    bucket++;
+  }
+  hist->count++;
+  hist->total_us += elapsed_us;
+  if (elapsed_us > hist->max_us)
+    hist->max_us = elapsed_us;
+  hist->buckets[bucket]++;
+}
+
+uint64_t sm_latency_hist_percentile_us(const sm_latency_hist_t *hist,
+                                       uint32_t percent) {
+  uint64_t wanted = ((uint64_t)hist->count * percent + 99u) / 100u;
+  uint64_t seen = 0;
+  for (int b = 0; b < SM_LATENCY_BUCKETS; b++) {
+    seen += hist->buckets[b];
+    if (seen >= wanted && seen > 0)
+      return 1ull << b;
+  }
+  return hist->max_us;
+}
+
+uint64_t sm_mount_stats_begin(void) {
+  return monotonic_time_us();
+}
+
+void sm_mount_stats_end(sm_mount_phase_t phase, image_fs_type_t fs_type,
+                        attach_backend_t backend, uint64_t start_us) {
+  uint64_t now_us = monotonic_time_us();
+  if (start_us == 0 || now_us < start_us || (int)phase < 0 ||
+      (int)phase >= SM_MOUNT_PHASE_COUNT || (int)fs_type < 0 ||
+      (int)fs_type >= MOUNT_STATS_FS_TYPES || (int)backend < 0 ||
+      (int)backend >= MOUNT_STATS_BACKENDS) {
+    return;
+  }
+
+  pthread_mutex_lock(&g_mount_stats_mutex);
+  sm_latency_hist_add(&g_mount_stats[phase][fs_type][backend],
+                      now_us - start_us);
+  pthread_mutex_unlock(&g_mount_stats_mutex);
+}
+
+static bool write_mount_stats_file(
+    const sm_latency_hist_t stats[SM_MOUNT_PHASE_COUNT][MOUNT_STATS_FS_TYPES]
+                                 [MOUNT_STATS_BACKENDS]) {
+  char temp_path[MAX_PATH];
+  int written = snprintf(temp_path, sizeof(temp_path), "%s.tmp",
+                         MOUNT_STATS_FILE);
+  if (written < 0 || (size_t)written >= sizeof(temp_path))
+    return false;
+
+  FILE *f = fopen(temp_path, "w");
+  if (!f) {
+    log_debug("  [STATS] open failed for %s: %s", temp_path, strerror(errno));
+    return false;
+  }
+
+  fprintf(f, "# mount phase latency in us; hist=<bucket upper bound>:<count>\n"
+             "# phase fs backend n total avg p50 p90 p99 max hist\n");
+  for (int p = 0; p < SM_MOUNT_PHASE_COUNT; p++) {
+    for (int fs = 0; fs < MOUNT_STATS_FS_TYPES; fs++) {
+      for (int b = 0; b < MOUNT_STATS_BACKENDS; b++) {
+        const sm_latency_hist_t *hist = &stats[p][fs][b];
+        if (hist->count == 0)
+          continue;
+        fprintf(f, "%s %s %s %u %llu %llu %llu %llu %llu %llu ",
+                k_mount_phase_names[p], k_mount_stats_fs_names[fs],
+                b == ATTACH_BACKEND_NONE
+                    ? "-"
+                    : attach_backend_name((attach_backend_t)b),
+                hist->count, (unsigned long long)hist->total_us,
+                (unsigned long long)(hist->total_us / hist->count),
+                (unsigned long long)sm_latency_hist_percentile_us(hist, 50u),
+                (unsigned long long)sm_latency_hist_percentile_us(hist, 90u),
+                (unsigned long long)sm_latency_hist_percentile_us(hist, 99u),
+                (unsigned long long)hist->max_us);
+        const char *sep = "";
+        for (int k = 0; k < SM_LATENCY_BUCKETS; k++) {
+          if (hist->buckets[k] == 0)
+            continue;
+          fprintf(f, "%s%llu:%u", sep, 1ull << k, hist->buckets[k]);
+          sep = ",";
+        }
+        fputc('\n', f);
+      }
+    }
+  }
+
+  bool ok = fflush(f) == 0;
+  if (fclose(f) != 0)
+    ok = false;
+  if (!ok || rename(temp_path, MOUNT_STATS_FILE) != 0) {
+    log_debug("  [STATS] write failed for %s: %s", MOUNT_STATS_FILE,
+              strerror(errno));
+    (void)unlink(temp_path);
+    return false;
+  }
+  return true;
+}
+
+void sm_mount_stats_dump(const char *reason) {
+  // Dumps run on the scanner thread; static keeps the copy off its stack.
+  static sm_latency_hist_t snapshot[SM_MOUNT_PHASE_COUNT][MOUNT_STATS_FS_TYPES]
+                                   [MOUNT_STATS_BACKENDS];
+  pthread_mutex_lock(&g_mount_stats_mutex);
+  memcpy(snapshot, g_mount_stats, sizeof(snapshot));
+  pthread_mutex_unlock(&g_mount_stats_mutex);
+
+  log_debug("[STATS] mount phase latency (%s):",
+            reason ? reason : "requested");
+  for (int p = 0; p < SM_MOUNT_PHASE_COUNT; p++) {
+    for (int fs = 0; fs < MOUNT_STATS_FS_TYPES; fs++) {
+      for (int b = 0; b < MOUNT_STATS_BACKENDS; b++) {
+        const sm_latency_hist_t *hist = &snapshot[p][fs][b];
+        if (hist->count == 0)
+          continue;
+        log_debug("  [STATS] %-13s %-7s %-4s n=%u avg=%llu us p50<%llu us "
+                  "p90<%llu us max=%llu us",
+                  k_mount_phase_names[p], k_mount_stats_fs_names[fs],
+                  b == ATTACH_BACKEND_NONE
+                      ? "-"
+                      : attach_backend_name((attach_backend_t)b),
+                  hist->count,
+                  (unsigned long long)(hist->total_us / hist->count),
+                  (unsigned long long)sm_latency_hist_percentile_us(hist, 50u),
+                  (unsigned long long)sm_latency_hist_percentile_us(hist, 90u),
+                  (unsigned long long)hist->max_us);
+      }
+    }
+  }
+  if (write_mount_stats_file(
+          (const sm_latency_hist_t(*)[MOUNT_STATS_FS_TYPES]
+                                    [MOUNT_STATS_BACKENDS])snapshot)) {
+    log_debug("  [STATS] written to %s", MOUNT_STATS_FILE);
+  }
+}
+
+void sm_mount_stats_poll_request(void) {
+  if (remove(MOUNT_STATS_REQUEST_FILE) != 0)
+    return;
+  sm_mount_stats_dump("requested");
+}
@@ -0,0 +1,303 @@
+#include "sm_platform.h"
+#include "sm_mount_table.h"
+
+#include <pthread.h>
+
+#include "sm_hash.h"
+
+// Entries are a private copy: getmntinfo() reuses its buffer on every call,
+// including calls made from other threads. Each index is a bucket array of
+// chain heads plus a next link per entry; chains keep mount order. Our own
+// mounts are appended and our unmounts blank their entry, so a cycle that
+// mounts many titles reads the table once instead of after every mount.
+typedef struct {
+  struct statfs *entries;
+  int *on_next;
+  int *from_next;
+  int count;
+  int capacity;
+  int *on_heads;
+  int *from_heads;
+  uint32_t bucket_count;
+  // Bumped on every rebuild; an update made across a rebuild is dropped.
+  uint32_t build_seq;
+  bool valid;
+} mount_table_t;
+
+static mount_table_t g_mount_table;
+static pthread_mutex_t g_mount_table_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static bool reserve_mount_entries(mount_table_t *table, int count) {
+  if (count <= table->capacity)
+    return true;
+  int capacity = table->capacity ? table->capacity : 64;
+  while (capacity < count)
+    capacity *= 2;
+  struct statfs *entries = (struct statfs *)realloc(
+      table->entries, (size_t)capacity * sizeof(*entries));
+  if (!entries)
+    return false;
+  table->entries = entries;
+  int *on_next =
+      (int *)realloc(table->on_next, (size_t)capacity * sizeof(*on_next));
+  if (!on_next)
+    return false;
+  table->on_next = on_next;
+  int *from_next =
+      (int *)realloc(table->from_next, (size_t)capacity * sizeof(*from_next));
+  if (!from_next)
+    return false;
+  table->from_next = from_next;
+  table->capacity = capacity;
+  return true;
+}
+
+// Two buckets per entry keeps chains short; the count is a power of two.
+static bool reserve_mount_buckets(mount_table_t *table, int count) {
+  uint32_t wanted = 64u;
+  while (wanted < (uint32_t)count * 2u)
+    wanted *= 2u;
+  if (wanted <= table->bucket_count)
+    return true;
+  int *on_heads =
+      (int *)realloc(table->on_heads, (size_t)wanted * sizeof(*on_heads));
+  if (!on_heads)
+    return false;
+  table->on_heads = on_heads;
+  int *from_heads =
+      (int *)realloc(table->from_heads, (size_t)wanted * sizeof(*from_heads));
+  if (!from_heads)
+    return false;
+  table->from_heads = from_heads;
+  table->bucket_count = wanted;
+  return true;
+}
+
+static uint32_t mount_bucket(const mount_table_t *table, const char *path) {
+  return sm_fnv1a32(path) & (table->bucket_count - 1u);
+}
+
+static bool refresh_mount_table_locked(mount_table_t *table) {
+  if (table->valid)
+    return true;
+  struct statfs *mntbuf = NULL;
+  int count = getmntinfo(&mntbuf, MNT_NOWAIT);
+  if (count <= 0 || !mntbuf)
+    return false;
+  if (!reserve_mount_entries(table, count) ||
+      !reserve_mount_buckets(table, count)) {
+    errno = ENOMEM;
+    return false;
+  }
+
+  memcpy(table->entries, mntbuf, (size_t)count * sizeof(*mntbuf));
+  table->count = count;
+  for (uint32_t i = 0; i < table->bucket_count; i++) {
+    table->on_heads[i] = -1;
+    table->from_heads[i] = -1;
+  }
+  // Linking from the back leaves every chain in mount order.
+  for (int i = count - 1; i >= 0; i--) {
+    uint32_t on_bucket = mount_bucket(table, table->entries[i].f_mntonname);
+    table->on_next[i] = table->on_heads[on_bucket];
+    table->on_heads[on_bucket] = i;
+    uint32_t from_bucket =
+        mount_bucket(table, table->entries[i].f_mntfromname);
+    table->from_next[i] = table->from_heads[from_bucket];
+    table->from_heads[from_bucket] = i;
+  }
+  table->build_seq++;
+  table->valid = true;
+  return true;
+}
+
+static void append_mount_chain(int *heads, int *next, uint32_t bucket,
+                               int index) {
+  next[index] = -1;
+  int *link = &heads[bucket];
+  while (*link >= 0)
+    link = &next[*link];
+  *link = index;
+}
+
+// Add the entry of a mount just made. Returns false when the snapshot has to
+// be rebuilt instead.
+static bool note_mount_locked(mount_table_t *table, const struct statfs *sfs) {
+  if (!reserve_mount_entries(table, table->count + 1) ||
+      (uint32_t)(table->count + 1) * 2u > table->bucket_count) {
+    return false;
+  }
+  int index = table->count++;
+  table->entries[index] = *sfs;
+  append_mount_chain(table->on_heads, table->on_next,
+                     mount_bucket(table, sfs->f_mntonname), index);
+  append_mount_chain(table->from_heads, table->from_next,
+                     mount_bucket(table, sfs->f_mntfromname), index);
+  return true;
+}
+
+// Blank the top entry on path; lookups never match an empty name.
+static bool note_unmount_locked(mount_table_t *table, const char *path) {
+  int top = -1;
+  for (int i = table->on_heads[mount_bucket(table, path)]; i >= 0;
+       i = table->on_next[i]) {
+    if (strcmp(table->entries[i].f_mntonname, path) == 0)
+      top = i;
+  }
+  if (top < 0)
+    return false;
+  table->entries[top].f_mntonname[0] = '\0';
+  table->entries[top].f_mntfromname[0] = '\0';
+  return true;
+}
+
+static const char *find_iov_string(const struct iovec *iov, unsigned int niov,
+                                   const char *name) {
+  for (unsigned int i = 0; i + 1u < niov; i += 2u) {
+    if (iov[i].iov_base && strcmp((const char *)iov[i].iov_base, name) == 0)
+      return (const char *)iov[i + 1u].iov_base;
+  }
+  return NULL;
+}
+
+static uint32_t mount_table_build_seq(void) {
+  pthread_mutex_lock(&g_mount_table_mutex);
+  uint32_t seq = g_mount_table.build_seq;
+  pthread_mutex_unlock(&g_mount_table_mutex);
+  return seq;
+}
+
+void mount_table_invalidate(void) {
+  pthread_mutex_lock(&g_mount_table_mutex);
+  g_mount_table.valid = false;
+  pthread_mutex_unlock(&g_mount_table_mutex);
+}
+
+int mount_table_nmount(struct iovec *iov, unsigned int niov, int flags) {
+  uint32_t seq = mount_table_build_seq();
+  int ret = nmount(iov, niov, flags);
+  int saved_errno = errno;
+  const char *fspath = find_iov_string(iov, niov, "fspath");
+  struct statfs sfs;
+  bool have_entry = ret == 0 && (flags & MNT_UPDATE) == 0 && fspath &&
+                    statfs(fspath, &sfs) == 0 &&
+                    strcmp(sfs.f_mntonname, fspath) == 0;
+  pthread_mutex_lock(&g_mount_table_mutex);
+  mount_table_t *table = &g_mount_table;
+  // A failed mount changes nothing; a remount or anything unclear forces a
+  // rebuild.
+  if (ret == 0 && (!table->valid || table->build_seq != seq || !have_entry ||
+                   !note_mount_locked(table, &sfs))) {
+    table->valid = false;
+  }
+  pthread_mutex_unlock(&g_mount_table_mutex);
+  errno = saved_errno;
+  return ret;
+}
+
+int mount_table_unmount(const char *path, int flags) {
+  uint32_t seq = mount_table_build_seq();
+  int ret = unmount(path, flags);
+  int saved_errno = errno;
+  pthread_mutex_lock(&g_mount_table_mutex);
+  mount_table_t *table = &g_mount_table;
+  if (ret == 0 && (!table->valid || table->build_seq != seq ||
+                   !note_unmount_locked(table, path))) {
+    table->valid = false;
+  }
+  pthread_mutex_unlock(&g_mount_table_mutex);
+  errno = saved_errno;
+  return ret;
+}
+
+// Walk the chain of one index; by_on selects the mount-on index.
+static int visit_mount_chain(const char *key, bool by_on,
+                             mount_table_visit_fn fn, void *ctx) {
+  mount_table_t *table = &g_mount_table;
+  pthread_mutex_lock(&g_mount_table_mutex);
+  if (!refresh_mount_table_locked(table)) {
+    int saved_errno = errno;
+    pthread_mutex_unlock(&g_mount_table_mutex);
+    errno = saved_errno;
+    return -1;
+  }
+  uint32_t bucket = mount_bucket(table, key);
+  const int *next = by_on ? table->on_next : table->from_next;
+  int i = by_on ? table->on_heads[bucket] : table->from_heads[bucket];
+  int visited = 0;
+  for (; i >= 0; i = next[i]) {
+    const struct statfs *entry = &table->entries[i];
+    const char *name = by_on ? entry->f_mntonname : entry->f_mntfromname;
+    if (strcmp(name, key) != 0)
+      continue;
+    visited++;
+    if (!fn(entry, ctx))
+      break;
+  }
+  pthread_mutex_unlock(&g_mount_table_mutex);
+  return visited;
+}
+
+int mount_table_for_each_on(const char *path, mount_table_visit_fn fn,
+                            void *ctx) {
+  return visit_mount_chain(path, true, fn, ctx);
+}
+
+int mount_table_for_each_from(const char *from, mount_table_visit_fn fn,
+                              void *ctx) {
+  return visit_mount_chain(from, false, fn, ctx);
+}
+
+int mount_table_for_each(mount_table_visit_fn fn, void *ctx) {
+  mount_table_t *table = &g_mount_table;
+  pthread_mutex_lock(&g_mount_table_mutex);
+  if (!refresh_mount_table_locked(table)) {
+    int saved_errno = errno;
+    pthread_mutex_unlock(&g_mount_table_mutex);
+    errno = saved_errno;
+    return -1;
+  }
+  int visited = 0;
+  for (int i = 0; i < table->count; i++) {
+    if (table->entries[i].f_mntonname[0] == '\0')
+      continue;
+    visited++;
+    if (!fn(&table->entries[i], ctx))
+      break;
+  }
+  pthread_mutex_unlock(&g_mount_table_mutex);
+  return visited;
+}
+
+typedef struct {
+  struct statfs *out;
+  bool found;
+  bool top_is_unionfs;
+} mount_top_ctx_t;
+
+static bool visit_mount_top(const struct statfs *entry, void *ctx) {
+  mount_top_ctx_t *top = (mount_top_ctx_t *)ctx;
+  bool is_unionfs = strcmp(entry->f_fstypename, "unionfs") == 0;
+  if (!top->found || (is_unionfs && !top->top_is_unionfs)) {
+    *top->out = *entry;
+    top->found = true;
+    top->top_is_unionfs = is_unionfs;
+  }
+  return !top->top_is_unionfs;
+}
+
+bool mount_table_find_top(const char *path, struct statfs *out) {
+  mount_top_ctx_t top = {out, false, false};
+  return mount_table_for_each_on(path, visit_mount_top, &top) > 0 &&
+         top.found;
+}
+
+static bool visit_mount_stop(const struct statfs *entry, void *ctx) {
+  (void)entry;
+  (void)ctx;
+  return false;
+}
+
+bool mount_table_is_mount_point(const char *path) {
+  return mount_table_for_each_on(path, visit_mount_stop, NULL) > 0;
+}
@@ -0,0 +1,698 @@
+#include "sm_platform.h"
+#include "sm_param_json.h"
+
+// Streaming param.json reader. Bytes run through a small state machine that
+// tracks the container stack and the keys of the outer levels, so each value
+// is classified by its path when it starts and only fields of interest are
+// decoded. Nothing is allocated and the whole document is never held.
+
+// Keys are kept for the first levels only; deeper values are never used.
+#define PARAM_JSON_KEY_LEVELS 3
+#define PARAM_JSON_MAX_KEY 40
+#define PARAM_JSON_LOCALIZED_KEY "localizedParameters"
+// titleNames kept while defaultLanguage is still unknown, so a trailing
+// defaultLanguage can pick its name without a second pass. Names share one
+// arena; candidates that do not fit are dropped.
+#define PARAM_JSON_MAX_CANDIDATES 48
+#define PARAM_JSON_CANDIDATE_BYTES 4096
+
+typedef enum {
+  PARAM_JSON_STATE_VALUE = 0,
+  PARAM_JSON_STATE_STRING,
+  PARAM_JSON_STATE_ESCAPE,
+  PARAM_JSON_STATE_UNICODE,
+  PARAM_JSON_STATE_SCALAR,
+  PARAM_JSON_STATE_SKIP,
+  PARAM_JSON_STATE_DONE,
+  PARAM_JSON_STATE_ERROR,
+} param_json_state_t;
+
+typedef enum {
+  PARAM_JSON_FIELD_NONE = 0,
+  PARAM_JSON_FIELD_KEY,
+  PARAM_JSON_FIELD_TITLE_ID,
+  PARAM_JSON_FIELD_TITLE_ID_ALT,
+  PARAM_JSON_FIELD_CONTENT_ID,
+  PARAM_JSON_FIELD_CONTENT_VERSION,
+  PARAM_JSON_FIELD_MASTER_VERSION,
+  PARAM_JSON_FIELD_REQUIRED_FIRMWARE,
+  PARAM_JSON_FIELD_DEFAULT_LANGUAGE,
+  PARAM_JSON_FIELD_TITLE_NAME,
+  PARAM_JSON_FIELD_LOCALE_TITLE_NAME,
+  PARAM_JSON_FIELD_MEMBER,
+} param_json_field_t;
+
+typedef struct {
+  char locale[MAX_PARAM_LOCALE];
+  uint16_t name_offset;
+} param_json_candidate_t;
+
+typedef struct {
+  sm_param_json_t *out;
+  const char *preferred_locale;
+  sm_param_json_member_fn on_member;
+  void *member_ctx;
+  param_json_state_t state;
+  int depth;
+  char containers[PARAM_JSON_MAX_DEPTH];
+  char keys[PARAM_JSON_KEY_LEVELS][PARAM_JSON_MAX_KEY];
+  // Next string in the current object is a key.
+  bool expect_key;
+  // Open containers inside a skipped subtree, and string state within it.
+  int skip_nesting;
+  bool skip_in_string;
+  bool skip_escape;
+
+  // Value being decoded; bytes are dropped when field is NONE.
+  param_json_field_t field;
+  char value[MAX_TITLE_NAME];
+  size_t value_len;
+  bool value_truncated;
+  uint32_t code_point;
+  int hex_digits;
+  // High half of a \u surrogate pair waiting for its low half.
+  uint32_t high_surrogate;
+
+  // titleName fallbacks in case the preferred locale is absent.
+  char default_name[MAX_TITLE_NAME];
+  char first_name[MAX_TITLE_NAME];
+  char first_locale[MAX_PARAM_LOCALE];
+  char master_version[MAX_PARAM_VERSION];
+  bool have_preferred;
+  bool have_default;
+  bool have_first;
+  param_json_candidate_t candidates[PARAM_JSON_MAX_CANDIDATES];
+  int candidate_count;
+  uint16_t candidate_bytes;
+  char candidate_names[PARAM_JSON_CANDIDATE_BYTES];
+} param_json_parser_t;
+
+static void init_param_json_parser(param_json_parser_t *p,
+                                   const char *preferred_locale,
+                                   sm_param_json_t *out,
+                                   sm_param_json_member_fn on_member,
+                                   void *member_ctx) {
+  // The candidate arena is only read up to candidate_bytes.
+  memset(p, 0, offsetof(param_json_parser_t, candidate_names));
+  memset(out, 0, sizeof(*out));
+  p->out = out;
+  p->preferred_locale = preferred_locale ? preferred_locale : "";
+  p->on_member = on_member;
+  p->member_ctx = member_ctx;
+}
+
+static void append_value_bytes(param_json_parser_t *p, const char *bytes,
+                               size_t len) {
+  if (p->field == PARAM_JSON_FIELD_NONE)
+    return;
+  // Whole characters only, so a truncated name stays valid UTF-8.
+  if (p->value_truncated || p->value_len + len >= sizeof(p->value)) {
+    p->value_truncated = true;
+    return;
+  }
+  memcpy(p->value + p->value_len, bytes, len);
+  p->value_len += len;
+}
+
+static void append_code_point(param_json_parser_t *p, uint32_t cp) {
+  char utf8[4];
+  size_t len;
+  if (cp == 0)
+    return;
+  if (cp < 0x80u) {
+    utf8[0] = (char)cp;
+    len = 1;
+  } else if (cp < 0x800u) {
+    utf8[0] = (char)(0xC0u | (cp >> 6));
+    utf8[1] = (char)(0x80u | (cp & 0x3Fu));
+    len = 2;
+  } else if (cp < 0x10000u) {
+    utf8[0] = (char)(0xE0u | (cp >> 12));
+    utf8[1] = (char)(0x80u | ((cp >> 6) & 0x3Fu));
+    utf8[2] = (char)(0x80u | (cp & 0x3Fu));
+    len = 3;
+  } else {
+    utf8[0] = (char)(0xF0u | (cp >> 18));
+    utf8[1] = (char)(0x80u | ((cp >> 12) & 0x3Fu));
+    utf8[2] = (char)(0x80u | ((cp >> 6) & 0x3Fu));
+    utf8[3] = (char)(0x80u | (cp & 0x3Fu));
+    len = 4;
+  }
+  append_value_bytes(p, utf8, len);
+}
+
+// A high surrogate not followed by a low one decodes to U+FFFD.
+static void flush_high_surrogate(param_json_parser_t *p) {
+  if (p->high_surrogate == 0)
+    return;
+  p->high_surrogate = 0;
+  append_code_point(p, 0xFFFDu);
+}
+
+static void append_escaped_unit(param_json_parser_t *p, uint32_t unit) {
+  if (unit >= 0xDC00u && unit <= 0xDFFFu) {
+    if (p->high_surrogate == 0) {
+      append_code_point(p, 0xFFFDu);
+      return;
+    }
+    uint32_t cp =
+        0x10000u + ((p->high_surrogate - 0xD800u) << 10) + (unit - 0xDC00u);
+    p->high_surrogate = 0;
+    append_code_point(p, cp);
+    return;
+  }
+  flush_high_surrogate(p);
+  if (unit >= 0xD800u && unit <= 0xDBFFu) {
+    p->high_surrogate = unit;
+    return;
+  }
+  append_code_point(p, unit);
+}
+
+static bool path_is_object(const param_json_parser_t *p) {
+  for (int i = 0; i < p->depth; i++) {
+    if (p->containers[i] != '{')
+      return false;
+  }
+  return true;
+}
+
+static const char *path_key(const param_json_parser_t *p, int level) {
+  return level < PARAM_JSON_KEY_LEVELS ? p->keys[level] : "";
+}
+
+// Decide what the value starting at the current position is.
+static param_json_field_t classify_value(const param_json_parser_t *p) {
+  if (p->depth < 1 || p->depth > PARAM_JSON_KEY_LEVELS || !path_is_object(p))
+    return PARAM_JSON_FIELD_NONE;
+
+  const char *key = path_key(p, p->depth - 1);
+  if (p->depth == 1) {
+    if (strcmp(key, "titleId") == 0)
+      return PARAM_JSON_FIELD_TITLE_ID;
+    if (strcmp(key, "title_id") == 0)
+      return PARAM_JSON_FIELD_TITLE_ID_ALT;
+    if (strcmp(key, "contentId") == 0)
+      return PARAM_JSON_FIELD_CONTENT_ID;
+    if (strcmp(key, "contentVersion") == 0)
+      return PARAM_JSON_FIELD_CONTENT_VERSION;
+    if (strcmp(key, "masterVersion") == 0)
+      return PARAM_JSON_FIELD_MASTER_VERSION;
+    if (strcmp(key, "requiredSystemSoftwareVersion") == 0)
+      return PARAM_JSON_FIELD_REQUIRED_FIRMWARE;
+    if (strcmp(key, "defaultLanguage") == 0)
+      return PARAM_JSON_FIELD_DEFAULT_LANGUAGE;
+    if (strcmp(key, "titleName") == 0)
+      return PARAM_JSON_FIELD_TITLE_NAME;
+    return p->on_member && key[0] != '\0' ? PARAM_JSON_FIELD_MEMBER
+                                           : PARAM_JSON_FIELD_NONE;
+  }
+
+  if (strcmp(path_key(p, 0), PARAM_JSON_LOCALIZED_KEY) != 0)
+    return PARAM_JSON_FIELD_NONE;
+  if (p->depth == 2 && strcmp(key, "defaultLanguage") == 0)
+    return PARAM_JSON_FIELD_DEFAULT_LANGUAGE;
+  if (p->depth == 3 && strcmp(key, "titleName") == 0 &&
+      path_key(p, 1)[0] != '\0') {
+    return PARAM_JSON_FIELD_LOCALE_TITLE_NAME;
+  }
+  return PARAM_JSON_FIELD_NONE;
+}
+
+static void add_title_name_candidate(param_json_parser_t *p,
+                                     const char *locale) {
+  size_t size = p->value_len + 1u;
+  if (p->candidate_count >= PARAM_JSON_MAX_CANDIDATES ||
+      size > sizeof(p->candidate_names) - p->candidate_bytes) {
+    return;
+  }
+  param_json_candidate_t *candidate = &p->candidates[p->candidate_count++];
+  (void)strlcpy(candidate->locale, locale, sizeof(candidate->locale));
+  candidate->name_offset = p->candidate_bytes;
+  memcpy(p->candidate_names + p->candidate_bytes, p->value, size);
+  p->candidate_bytes = (uint16_t)(p->candidate_bytes + size);
+}
+
+static void store_title_name(param_json_parser_t *p, const char *locale) {
+  sm_param_json_t *out = p->out;
+  if (p->value_len == 0 || p->have_preferred)
+    return;
+
+  if (locale[0] != '\0' && strcmp(locale, p->preferred_locale) == 0) {
+    (void)strlcpy(out->title_name, p->value, sizeof(out->title_name));
+    (void)strlcpy(out->title_locale, locale, sizeof(out->title_locale));
+    p->have_preferred = true;
+    return;
+  }
+  if (locale[0] != '\0' && out->default_language[0] == '\0') {
+    add_title_name_candidate(p, locale);
+  } else if (!p->have_default && locale[0] != '\0' &&
+             strcmp(locale, out->default_language) == 0) {
+    (void)strlcpy(p->default_name, p->value, sizeof(p->default_name));
+    p->have_default = true;
+  }
+  if (!p->have_first) {
+    (void)strlcpy(p->first_name, p->value, sizeof(p->first_name));
+    (void)strlcpy(p->first_locale, locale, sizeof(p->first_locale));
+    p->have_first = true;
+  }
+}
+
+static void finish_value(param_json_parser_t *p) {
+  flush_high_surrogate(p);
+  p->value[p->value_len] = '\0';
+
+  sm_param_json_t *out = p->out;
+  switch (p->field) {
+  case PARAM_JSON_FIELD_KEY:
+    if (p->depth >= 1 && p->depth <= PARAM_JSON_KEY_LEVELS) {
+      // An overlong key can never match, so it is stored as "".
+      char *slot = p->keys[p->depth - 1];
+      if (p->value_len < PARAM_JSON_MAX_KEY && !p->value_truncated)
+        memcpy(slot, p->value, p->value_len + 1u);
+      else
+        slot[0] = '\0';
+    }
+    p->expect_key = false;
+    break;
+  case PARAM_JSON_FIELD_TITLE_ID:
+    (void)strlcpy(out->title_id, p->value, sizeof(out->title_id));
+    break;
+  case PARAM_JSON_FIELD_TITLE_ID_ALT:
+    if (out->title_id[0] == '\0')
+      (void)strlcpy(out->title_id, p->value, sizeof(out->title_id));
+    break;
+  case PARAM_JSON_FIELD_CONTENT_ID:
+    (void)strlcpy(out->content_id, p->value, sizeof(out->content_id));
+    break;
+  case PARAM_JSON_FIELD_CONTENT_VERSION:
+    (void)strlcpy(out->app_version, p->value, sizeof(out->app_version));
+    break;
+  case PARAM_JSON_FIELD_MASTER_VERSION:
+    (void)strlcpy(p->master_version, p->value, sizeof(p->master_version));
+    break;
+  case PARAM_JSON_FIELD_REQUIRED_FIRMWARE:
+    (void)strlcpy(out->required_firmware, p->value,
+                  sizeof(out->required_firmware));
+    break;
+  case PARAM_JSON_FIELD_DEFAULT_LANGUAGE:
+    (void)strlcpy(out->default_language, p->value,
+                  sizeof(out->default_language));
+    break;
+  case PARAM_JSON_FIELD_TITLE_NAME:
+    store_title_name(p, "");
+    break;
+  case PARAM_JSON_FIELD_LOCALE_TITLE_NAME:
+    store_title_name(p, path_key(p, 1));
+    break;
+  case PARAM_JSON_FIELD_MEMBER:
+    p->on_member(path_key(p, 0), p->value, p->member_ctx);
+    break;
+  case PARAM_JSON_FIELD_NONE:
+    break;
+  }
+
+  p->field = PARAM_JSON_FIELD_NONE;
+  p->value_len = 0;
+  p->value_truncated = false;
+  p->state = PARAM_JSON_STATE_VALUE;
+}
+
+static void begin_value(param_json_parser_t *p, param_json_field_t field,
+                        param_json_state_t state) {
+  p->field = field;
+  p->value_len = 0;
+  p->value_truncated = false;
+  p->high_surrogate = 0;
+  p->state = state;
+}
+
+static void pop_container(param_json_parser_t *p, char kind) {
+  if (p->depth == 0 || p->containers[p->depth - 1] != kind) {
+    p->state = PARAM_JSON_STATE_ERROR;
+    return;
+  }
+  p->depth--;
+  p->expect_key = false;
+  if (p->depth == 0)
+    p->state = PARAM_JSON_STATE_DONE;
+}
+
+// Length of the leading string bytes that need no decoding.
+static size_t string_run_length(const char *data, size_t len) {
+  const char *quote = memchr(data, '"', len);
+  size_t span = quote ? (size_t)(quote - data) : len;
+  const char *escape = memchr(data, '\\', span);
+  return escape ? (size_t)(escape - data) : span;
+}
+
+// Bytes a skipped container has to look at; everything else, mostly
+// indentation and separators, is stepped over in a tight loop.
+static const uint8_t k_skip_stop[256] = {
+    ['"'] = 1, ['{'] = 1, ['['] = 1, ['}'] = 1, [']'] = 1,
+};
+
+// Whether the container just opened can hold a field still wanted. Locale
+// blocks are skipped once they can no longer change the chosen titleName;
+// while defaultLanguage is unknown every block is read for its candidate.
+static bool container_is_wanted(const param_json_parser_t *p) {
+  if (p->depth == 1)
+    return true;
+  if (p->depth > PARAM_JSON_KEY_LEVELS || !path_is_object(p) ||
+      strcmp(path_key(p, 0), PARAM_JSON_LOCALIZED_KEY) != 0) {
+    return false;
+  }
+  if (p->depth == 2)
+    return true;
+
+  const char *locale = path_key(p, 1);
+  if (p->have_preferred || locale[0] == '\0')
+    return false;
+  const char *default_language = p->out->default_language;
+  return !p->have_first || default_language[0] == '\0' ||
+         strcmp(locale, p->preferred_locale) == 0 ||
+         (!p->have_default && strcmp(locale, default_language) == 0);
+}
+
+static void push_container(param_json_parser_t *p, char kind) {
+  if (p->depth >= PARAM_JSON_MAX_DEPTH) {
+    p->state = PARAM_JSON_STATE_ERROR;
+    return;
+  }
+  p->containers[p->depth] = kind;
+  if (p->depth < PARAM_JSON_KEY_LEVELS)
+    p->keys[p->depth][0] = '\0';
+  p->depth++;
+  p->expect_key = kind == '{';
+  if (!container_is_wanted(p)) {
+    p->skip_nesting = 1;
+    p->skip_in_string = false;
+    p->skip_escape = false;
+    p->state = PARAM_JSON_STATE_SKIP;
+  }
+}
+
+// Find the quote closing a skipped string that starts at i with no escape
+// pending. Returns its index, or len - 1 with skip_escape set when the chunk
+// ends on an unpaired backslash.
+static size_t skip_string_bytes(param_json_parser_t *p, const char *data,
+                                size_t i, size_t len) {
+  size_t from = i;
+  for (;;) {
+    const char *quote = memchr(data + from, '"', len - from);
+    size_t end = quote ? (size_t)(quote - data) : len;
+    size_t backslashes = 0;
+    while (end - backslashes > i && data[end - backslashes - 1] == '\\')
+      backslashes++;
+    if (!quote) {
+      p->skip_escape = (backslashes & 1u) != 0;
+      return len - 1;
+    }
+    if ((backslashes & 1u) == 0) {
+      p->skip_in_string = false;
+      return end;
+    }
+    from = end + 1;
+    if (from == len)
+      return len - 1;
+  }
+}
+
+// Consume bytes of a skipped container, tracking only nesting and strings.
+// Returns the number of bytes used, including the closing bracket.
+static size_t skip_container_bytes(param_json_parser_t *p, const char *data,
+                                   size_t len) {
+  for (size_t i = 0; i < len; i++) {
+    char c = data[i];
+    if (p->skip_in_string) {
+      if (p->skip_escape) {
+        p->skip_escape = false;
+        continue;
+      }
+      i = skip_string_bytes(p, data, i, len);
+      continue;
+    }
+    if (!k_skip_stop[(uint8_t)c]) {
+      while (i + 1 < len && !k_skip_stop[(uint8_t)data[i + 1]])
+        i++;
+      continue;
+    }
+    switch (c) {
+    case '"':
+      p->skip_in_string = true;
+      break;
+    case '{':
+    case '[':
+      p->skip_nesting++;
+      break;
+    case '}':
+    case ']':
+      if (--p->skip_nesting == 0) {
+        p->state = PARAM_JSON_STATE_VALUE;
+        pop_container(p, p->containers[p->depth - 1]);
+        return i + 1;
+      }
+      break;
+    default:
+      break;
+    }
+  }
+  return len;
+}
+
+static bool is_json_space(char c) {
+  return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+static bool is_scalar_delimiter(char c) {
+  return c == ',' || c == '}' || c == ']' || c == ':' || is_json_space(c);
+}
+
+static int hex_digit_value(char c) {
+  if (c >= '0' && c <= '9')
+    return c - '0';
+  if (c >= 'a' && c <= 'f')
+    return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F')
+    return c - 'A' + 10;
+  return -1;
+}
+
+static void feed_structural(param_json_parser_t *p, char c) {
+  switch (c) {
+  case ' ':
+  case '\t':
+  case '\r':
+  case '\n':
+  case ':':
+    return;
+  case '{':
+  case '[':
+    push_container(p, c);
+    return;
+  case '}':
+    pop_container(p, '{');
+    return;
+  case ']':
+    pop_container(p, '[');
+    return;
+  case ',':
+    p->expect_key = p->depth > 0 && p->containers[p->depth - 1] == '{';
+    return;
+  case '"':
+    if (p->expect_key)
+      begin_value(p, PARAM_JSON_FIELD_KEY, PARAM_JSON_STATE_STRING);
+    else
+      begin_value(p, classify_value(p), PARAM_JSON_STATE_STRING);
+    return;
+  default:
+    // Bytes before the root (a UTF-8 BOM, say) are skipped.
+    if (p->depth == 0)
+      return;
+    if (p->expect_key) {
+      p->state = PARAM_JSON_STATE_ERROR;
+      return;
+    }
+    begin_value(p, classify_value(p), PARAM_JSON_STATE_SCALAR);
+    append_value_bytes(p, &c, 1);
+    return;
+  }
+}
+
+// Run a chunk through the state machine; returns false once parsing stopped.
+static bool feed_param_json(param_json_parser_t *p, const char *data,
+                            size_t len) {
+  for (size_t i = 0; i < len; i++) {
+    char c = data[i];
+    switch (p->state) {
+    case PARAM_JSON_STATE_VALUE:
+      // Indentation runs are the bulk of pretty-printed files.
+      while (is_json_space(c) && ++i < len)
+        c = data[i];
+      if (i < len)
+        feed_structural(p, c);
+      break;
+    case PARAM_JSON_STATE_STRING: {
+      // Copy or skip the plain run up to the next quote or backslash.
+      size_t span = string_run_length(data + i, len - i);
+      if (span > 0) {
+        if (p->field != PARAM_JSON_FIELD_NONE) {
+          flush_high_surrogate(p);
+          append_value_bytes(p, data + i, span);
+        }
+        i += span;
+        if (i == len)
+          break;
+        c = data[i];
+      }
+      if (c == '"')
+        finish_value(p);
+      else
+        p->state = PARAM_JSON_STATE_ESCAPE;
+      break;
+    }
+    case PARAM_JSON_STATE_ESCAPE: {
+      char decoded = c;
+      p->state = PARAM_JSON_STATE_STRING;
+      switch (c) {
+      case 'u':
+        p->code_point = 0;
+        p->hex_digits = 0;
+        p->state = PARAM_JSON_STATE_UNICODE;
+        continue;
+      case 'n':
+        decoded = '\n';
+        break;
+      case 't':
+        decoded = '\t';
+        break;
+      case 'r':
+        decoded = '\r';
+        break;
+      case 'b':
+        decoded = '\b';
+        break;
+      case 'f':
+        decoded = '\f';
+        break;
+      default:
+        break;
+      }
+      flush_high_surrogate(p);
+      append_value_bytes(p, &decoded, 1);
+      break;
+    }
+    case PARAM_JSON_STATE_UNICODE: {
+      int digit = hex_digit_value(c);
+      if (digit < 0) {
+        p->state = PARAM_JSON_STATE_ERROR;
+        break;
+      }
+      p->code_point = (p->code_point << 4) | (uint32_t)digit;
+      if (++p->hex_digits == 4) {
+        append_escaped_unit(p, p->code_point);
+        p->state = PARAM_JSON_STATE_STRING;
+      }
+      break;
+    }
+    case PARAM_JSON_STATE_SCALAR:
+      if (is_scalar_delimiter(c)) {
+        finish_value(p);
+        feed_structural(p, c);
+      } else {
+        append_value_bytes(p, &c, 1);
+      }
+      break;
+    case PARAM_JSON_STATE_SKIP:
+      i += skip_container_bytes(p, data + i, len - i) - 1;
+      break;
+    case PARAM_JSON_STATE_DONE:
+    case PARAM_JSON_STATE_ERROR:
+      return false;
+    }
+  }
+  return p->state != PARAM_JSON_STATE_DONE &&
+         p->state != PARAM_JSON_STATE_ERROR;
+}
+
+// A defaultLanguage that followed the locale blocks picks its titleName from
+// the candidates noted on the way.
+static void resolve_default_candidate(param_json_parser_t *p) {
+  const char *default_language = p->out->default_language;
+  if (p->have_default || default_language[0] == '\0')
+    return;
+  for (int i = 0; i < p->candidate_count; i++) {
+    const param_json_candidate_t *candidate = &p->candidates[i];
+    if (strcmp(candidate->locale, default_language) != 0)
+      continue;
+    (void)strlcpy(p->default_name, p->candidate_names + candidate->name_offset,
+                  sizeof(p->default_name));
+    p->have_default = true;
+    return;
+  }
+}
+
+static void finish_param_json(param_json_parser_t *p) {
+  sm_param_json_t *out = p->out;
+  if (out->app_version[0] == '\0')
+    (void)strlcpy(out->app_version, p->master_version,
+                  sizeof(out->app_version));
+  if (p->have_preferred)
+    return;
+  resolve_default_candidate(p);
+  if (p->have_default) {
+    (void)strlcpy(out->title_name, p->default_name, sizeof(out->title_name));
+    (void)strlcpy(out->title_locale, out->default_language,
+                  sizeof(out->title_locale));
+  } else if (p->have_first) {
+    (void)strlcpy(out->title_name, p->first_name, sizeof(out->title_name));
+    (void)strlcpy(out->title_locale, p->first_locale,
+                  sizeof(out->title_locale));
+  }
+}
+
+bool sm_param_json_parse_buffer(const char *data, size_t len,
+                                const char *preferred_locale,
+                                sm_param_json_t *out) {
+  param_json_parser_t parser;
+  init_param_json_parser(&parser, preferred_locale, out, NULL, NULL);
+  if (len > MAX_PARAM_JSON_SIZE)
+    len = MAX_PARAM_JSON_SIZE;
+  (void)feed_param_json(&parser, data, len);
+  finish_param_json(&parser);
+  return out->title_id[0] != '\0';
+}
+
+int sm_param_json_parse_fd_members(int fd, const char *preferred_locale,
+                                   sm_param_json_t *out,
+                                   sm_param_json_member_fn on_member,
+                                   void *member_ctx) {
+  char chunk[PARAM_JSON_READ_CHUNK];
+  size_t total = 0;
+  param_json_parser_t parser;
+  init_param_json_parser(&parser, preferred_locale, out, on_member,
+                         member_ctx);
+  while (total < MAX_PARAM_JSON_SIZE) {
+    size_t want = MAX_PARAM_JSON_SIZE - total;
+    if (want > sizeof(chunk))
+      want = sizeof(chunk);
+    ssize_t n = read(fd, chunk, want);
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      return -1;
+    }
+    if (n == 0)
+      break;
+    total += (size_t)n;
+    if (!feed_param_json(&parser, chunk, (size_t)n))
+      break;
+  }
+  finish_param_json(&parser);
+  return out->title_id[0] != '\0' ? 1 : 0;
+}
+
+int sm_param_json_parse_fd(int fd, const char *preferred_locale,
+                           sm_param_json_t *out) {
+  return sm_param_json_parse_fd_members(fd, preferred_locale, out, NULL, NULL);
+}
@@ -0,0 +1,251 @@
+#include "sm_platform.h"
+#include <pthread.h>
+
+#include "sm_hash.h"
+#include "sm_limits.h"
+#include "sm_log.h"
+#include "sm_path_pool.h"
+#include "sm_state_table.h"
+
+// Slot value in the hash index for a removed entry; probing continues past it.
+#define PATH_POOL_TOMBSTONE UINT32_MAX
+
+struct PathPoolEntry {
+  char *str;
+  uint32_t hash;
+  // 0 marks a free entry linked through next_free.
+  uint32_t refcount;
+  sm_path_id_t next_free;
+};
+
+static struct PathPoolEntry *g_path_pool = NULL;
+static uint32_t g_path_pool_capacity = 0;
+static uint32_t g_path_pool_count = 0;
+static sm_path_id_t g_path_pool_free_head = SM_PATH_ID_NONE;
+static size_t g_path_pool_string_bytes = 0;
+// Open-addressing index of handles; power-of-two size, at most 3/4 used
+// counting tombstones.
+static uint32_t *g_path_pool_index = NULL;
+static uint32_t g_path_pool_index_size = 0;
+static uint32_t g_path_pool_index_used = 0;
+static pthread_mutex_t g_path_pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static struct PathPoolEntry *path_pool_entry(sm_path_id_t id) {
+  if (id == SM_PATH_ID_NONE || id > g_path_pool_capacity)
+    return NULL;
+  struct PathPoolEntry *entry = &g_path_pool[id - 1u];
+  return entry->refcount > 0 ? entry : NULL;
+}
+
+static bool rebuild_path_pool_index(uint32_t size) {
+  uint32_t *index = calloc(size, sizeof(*index));
+  if (!index) {
+    log_debug("  [MEM] path pool index allocation failed (%u slots)", size);
+    return false;
+  }
+
+  uint32_t mask = size - 1u;
+  for (uint32_t k = 0; k < g_path_pool_capacity; k++) {
+    if (g_path_pool[k].refcount == 0)
+      continue;
+    uint32_t slot = g_path_pool[k].hash & mask;
+    while (index[slot] != 0)
+      slot = (slot + 1u) & mask;
+    index[slot] = k + 1u;
+  }
+
+  free(g_path_pool_index);
+  g_path_pool_index = index;
+  g_path_pool_index_size = size;
+  g_path_pool_index_used = g_path_pool_count;
+  return true;
+}
+
+static bool ensure_path_pool_index_room(void) {
+  if (g_path_pool_index_size != 0 &&
+      (g_path_pool_index_used + 1u) * 4u <= g_path_pool_index_size * 3u) {
+    return true;
+  }
+
+  // Grow when live entries fill half the index, otherwise just sweep
+  // tombstones at the current size.
+  uint32_t size = g_path_pool_index_size ? g_path_pool_index_size : 64u;
+  while ((g_path_pool_count + 1u) * 2u > size)
+    size *= 2u;
+  return rebuild_path_pool_index(size);
+}
+
+static bool ensure_path_pool_capacity(void) {
+  if (g_path_pool_free_head != SM_PATH_ID_NONE)
+    return true;
+
+  uint32_t new_capacity =
+      g_path_pool_capacity ? g_path_pool_capacity * 2u : INITIAL_STATE_CAPACITY;
+  struct PathPoolEntry *entries =
+      realloc(g_path_pool, (size_t)new_capacity * sizeof(*entries));
+  if (!entries) {
+    log_debug("  [MEM] path pool growth failed: %u -> %u entries",
+              g_path_pool_capacity, new_capacity);
+    return false;
+  }
+
+  memset(&entries[g_path_pool_capacity], 0,
+         (size_t)(new_capacity - g_path_pool_capacity) * sizeof(*entries));
+  for (uint32_t k = new_capacity; k > g_path_pool_capacity; k--) {
+    entries[k - 1u].next_free = g_path_pool_free_head;
+    g_path_pool_free_head = k;
+  }
+  g_path_pool = entries;
+  g_path_pool_capacity = new_capacity;
+  return true;
+}
+
+// Return the index slot holding path, or the slot to insert it into.
+static uint32_t probe_path_pool_index(const char *path, uint32_t hash,
+                                      bool *found_out) {
+  uint32_t mask = g_path_pool_index_size - 1u;
+  uint32_t slot = hash & mask;
+  uint32_t insert_slot = UINT32_MAX;
+  *found_out = false;
+  for (uint32_t i = 0; i < g_path_pool_index_size; i++) {
+    uint32_t id = g_path_pool_index[slot];
+    if (id == 0)
+      return insert_slot != UINT32_MAX ? insert_slot : slot;
+    if (id == PATH_POOL_TOMBSTONE) {
+      if (insert_slot == UINT32_MAX)
+        insert_slot = slot;
+    } else {
+      const struct PathPoolEntry *entry = &g_path_pool[id - 1u];
+      if (entry->hash == hash && strcmp(entry->str, path) == 0) {
+        *found_out = true;
+        return slot;
+      }
+    }
+    slot = (slot + 1u) & mask;
+  }
+  return insert_slot;
+}
+
+static sm_path_id_t find_path_locked(const char *path, uint32_t hash) {
+  if (g_path_pool_index_size == 0)
+    return SM_PATH_ID_NONE;
+  bool found = false;
+  uint32_t slot = probe_path_pool_index(path, hash, &found);
+  return found ? g_path_pool_index[slot] : SM_PATH_ID_NONE;
+}
+
+sm_path_id_t sm_path_intern(const char *path) {
+  if (!path || path[0] == '\0')
+    return SM_PATH_ID_NONE;
+
+  uint32_t hash = sm_fnv1a32(path);
+  pthread_mutex_lock(&g_path_pool_mutex);
+  sm_path_id_t id = find_path_locked(path, hash);
+  if (id != SM_PATH_ID_NONE) {
+    g_path_pool[id - 1u].refcount++;
+    pthread_mutex_unlock(&g_path_pool_mutex);
+    return id;
+  }
+
+  size_t len = strlen(path);
+  char *str = malloc(len + 1u);
+  if (!str || !ensure_path_pool_capacity() || !ensure_path_pool_index_room()) {
+    pthread_mutex_unlock(&g_path_pool_mutex);
+    free(str);
+    return SM_PATH_ID_NONE;
+  }
+  memcpy(str, path, len + 1u);
+
+  bool found = false;
+  uint32_t slot = probe_path_pool_index(path, hash, &found);
+  id = g_path_pool_free_head;
+  struct PathPoolEntry *entry = &g_path_pool[id - 1u];
+  g_path_pool_free_head = entry->next_free;
+  entry->str = str;
+  entry->hash = hash;
+  entry->refcount = 1;
+  entry->next_free = SM_PATH_ID_NONE;
+  if (g_path_pool_index[slot] == 0)
+    g_path_pool_index_used++;
+  g_path_pool_index[slot] = id;
+  g_path_pool_count++;
+  g_path_pool_string_bytes += len + 1u;
+  pthread_mutex_unlock(&g_path_pool_mutex);
+  return id;
+}
+
+sm_path_id_t sm_path_lookup(const char *path) {
+  if (!path || path[0] == '\0')
+    return SM_PATH_ID_NONE;
+
+  uint32_t hash = sm_fnv1a32(path);
+  pthread_mutex_lock(&g_path_pool_mutex);
+  sm_path_id_t id = find_path_locked(path, hash);
+  if (id != SM_PATH_ID_NONE)
+    g_path_pool[id - 1u].refcount++;
+  pthread_mutex_unlock(&g_path_pool_mutex);
+  return id;
+}
+
+void sm_path_retain(sm_path_id_t id) {
+  pthread_mutex_lock(&g_path_pool_mutex);
+  struct PathPoolEntry *entry = path_pool_entry(id);
+  if (entry)
+    entry->refcount++;
+  pthread_mutex_unlock(&g_path_pool_mutex);
+}
+
+void sm_path_release(sm_path_id_t id) {
+  pthread_mutex_lock(&g_path_pool_mutex);
+  struct PathPoolEntry *entry = path_pool_entry(id);
+  if (!entry || --entry->refcount > 0) {
+    pthread_mutex_unlock(&g_path_pool_mutex);
+    return;
+  }
+
+  bool found = false;
+  uint32_t slot = probe_path_pool_index(entry->str, entry->hash, &found);
+  if (found)
+    g_path_pool_index[slot] = PATH_POOL_TOMBSTONE;
+  g_path_pool_string_bytes -= strlen(entry->str) + 1u;
+  free(entry->str);
+  entry->str = NULL;
+  entry->hash = 0;
+  entry->next_free = g_path_pool_free_head;
+  g_path_pool_free_head = id;
+  g_path_pool_count--;
+  pthread_mutex_unlock(&g_path_pool_mutex);
+}
+
+bool sm_path_assign(sm_path_id_t *slot, const char *path) {
+  sm_path_id_t id = sm_path_intern(path);
+  sm_path_release(*slot);
+  *slot = id;
+  return id != SM_PATH_ID_NONE || !path || path[0] == '\0';
+}
+
+void sm_path_clear(sm_path_id_t *slot) {
+  sm_path_release(*slot);
+  *slot = SM_PATH_ID_NONE;
+}
+
+const char *sm_path_str(sm_path_id_t id) {
+  if (id == SM_PATH_ID_NONE)
+    return "";
+  pthread_mutex_lock(&g_path_pool_mutex);
+  const struct PathPoolEntry *entry = path_pool_entry(id);
+  const char *str = entry ? entry->str : "";
+  pthread_mutex_unlock(&g_path_pool_mutex);
+  return str;
+}
+
+void path_pool_memory_usage(sm_state_table_usage_t *out) {
+  pthread_mutex_lock(&g_path_pool_mutex);
+  out->name = "path_pool";
+  out->count = (int)g_path_pool_count;
+  out->capacity = (int)g_path_pool_capacity;
+  out->bytes = (size_t)g_path_pool_capacity * sizeof(*g_path_pool) +
+               (size_t)g_path_pool_index_size * sizeof(*g_path_pool_index) +
+               g_path_pool_string_bytes;
+  pthread_mutex_unlock(&g_path_pool_mutex);
+}
@@ -1,13 +1,19 @@
 #include "sm_platform.h"
 #include "sm_path_state.h"
 #include "sm_filesystem.h"
-#include "sm_hash.h"
 #include "sm_limits.h"
 #include "sm_log.h"
+#include "sm_path_pool.h"
 #include "sm_path_utils.h"
+#include "sm_state_table.h"
+
+#define PATH_STATE_NONE (-1)
+
+// Path state is owned by the scan thread; see sm_path_state.h. Nothing here
+// locks.
 
 struct PathStateEntry {
-  char path[MAX_PATH];
+  sm_path_id_t path;
   uint8_t missing_param_attempts;
   uint8_t image_mount_attempts;
   bool missing_param_limit_logged;
@@ -22,104 +28,167 @@ struct PathStateEntry {
   char game_title_id[MAX_TITLE_ID];
   char game_title_name[MAX_TITLE_NAME];
   bool valid;
+  // LRU list links for valid entries (head = most recently used); free
+  // entries are chained through lru_next instead.
+  int lru_prev;
+  int lru_next;
 };
 
-static struct PathStateEntry g_path_state[PATH_STATE_CAPACITY];
-static uint16_t g_path_state_hash[STATE_HASH_SIZE];
+static struct PathStateEntry *g_path_state = NULL;
+static int g_path_state_capacity = 0;
+static int g_path_state_count = 0;
+static int g_path_state_free_head = PATH_STATE_NONE;
+static int g_path_state_lru_head = PATH_STATE_NONE;
+static int g_path_state_lru_tail = PATH_STATE_NONE;
+static sm_state_index_t g_path_state_index;
+static uint32_t g_game_info_generation = 0;
 
-static void rebuild_path_state_hash(void) {
-  memset(g_path_state_hash, 0, sizeof(g_path_state_hash));
-  for (int k = 0; k < PATH_STATE_CAPACITY; k++) {
-    if (!g_path_state[k].valid || g_path_state[k].path[0] == '\0')
-      continue;
-    uint32_t slot = sm_fnv1a32(g_path_state[k].path) & (STATE_HASH_SIZE - 1u);
-    for (uint32_t i = 0; i < STATE_HASH_SIZE; i++) {
-      if (g_path_state_hash[slot] == 0) {
-        g_path_state_hash[slot] = (uint16_t)(k + 1);
-        break;
-      }
-      slot = (slot + 1u) & (STATE_HASH_SIZE - 1u);
-    }
-  }
+static uint32_t path_state_hash(sm_path_id_t path) {
+  return path * 2654435761u;
 }
 
-static struct PathStateEntry *find_path_state(const char *path) {
-  uint32_t slot = sm_fnv1a32(path) & (STATE_HASH_SIZE - 1u);
-  for (uint32_t i = 0; i < STATE_HASH_SIZE; i++) {
-    uint16_t idx = g_path_state_hash[slot];
-    if (idx == 0)
-      return NULL;
-    struct PathStateEntry *entry = &g_path_state[idx - 1u];
-    if (entry->valid && strcmp(entry->path, path) == 0)
-      return entry;
-    slot = (slot + 1u) & (STATE_HASH_SIZE - 1u);
+static void lru_unlink_path_state(int k) {
+  struct PathStateEntry *entry = &g_path_state[k];
+  if (entry->lru_prev != PATH_STATE_NONE)
+    g_path_state[entry->lru_prev].lru_next = entry->lru_next;
+  else
+    g_path_state_lru_head = entry->lru_next;
+  if (entry->lru_next != PATH_STATE_NONE)
+    g_path_state[entry->lru_next].lru_prev = entry->lru_prev;
+  else
+    g_path_state_lru_tail = entry->lru_prev;
+  entry->lru_prev = PATH_STATE_NONE;
+  entry->lru_next = PATH_STATE_NONE;
+}
+
+static void lru_push_path_state(int k) {
+  struct PathStateEntry *entry = &g_path_state[k];
+  entry->lru_prev = PATH_STATE_NONE;
+  entry->lru_next = g_path_state_lru_head;
+  if (g_path_state_lru_head != PATH_STATE_NONE)
+    g_path_state[g_path_state_lru_head].lru_prev = k;
+  g_path_state_lru_head = k;
+  if (g_path_state_lru_tail == PATH_STATE_NONE)
+    g_path_state_lru_tail = k;
+}
+
+static void touch_path_state(int k) {
+  if (g_path_state_lru_head == k)
+    return;
+  lru_unlink_path_state(k);
+  lru_push_path_state(k);
+}
+
+static int find_path_state_index(sm_path_id_t path) {
+  if (path == SM_PATH_ID_NONE)
+    return PATH_STATE_NONE;
+  uint32_t cursor = 0;
+  int k;
+  while ((k = sm_state_index_next(&g_path_state_index, path_state_hash(path),
+                                  &cursor)) >= 0) {
+    if (g_path_state[k].path == path)
+      return k;
   }
-  return NULL;
+  return PATH_STATE_NONE;
 }
 
-static struct PathStateEntry *create_path_state(const char *path) {
-  int slot_k = -1;
-  for (int k = 0; k < PATH_STATE_CAPACITY; k++) {
-    if (!g_path_state[k].valid) {
-      slot_k = k;
-      break;
-    }
+static void remove_path_state(int k) {
+  if (g_path_state[k].game_info_cached && g_path_state[k].game_info_valid)
+    g_game_info_generation++;
+  sm_state_index_remove(&g_path_state_index,
+                        path_state_hash(g_path_state[k].path), k);
+  lru_unlink_path_state(k);
+  sm_path_release(g_path_state[k].path);
+  memset(&g_path_state[k], 0, sizeof(g_path_state[k]));
+  g_path_state[k].lru_prev = PATH_STATE_NONE;
+  g_path_state[k].lru_next = g_path_state_free_head;
+  g_path_state_free_head = k;
+  g_path_state_count--;
+}
+
+static bool grow_path_state(void) {
+  int old_capacity = g_path_state_capacity;
+  if (!sm_state_table_reserve((void **)&g_path_state, &g_path_state_capacity,
+                              old_capacity + 1, sizeof(*g_path_state))) {
+    return false;
   }
-  if (slot_k < 0) {
-    int evict_k = -1;
-    for (int k = 0; k < PATH_STATE_CAPACITY; k++) {
-      if (!g_path_state[k].valid)
-        continue;
-      if (!path_exists(g_path_state[k].path) &&
-          !g_path_state[k].manual_missing_source_logged) {
-        evict_k = k;
-        break;
-      }
-    }
-    if (evict_k < 0) {
-      for (int k = 0; k < PATH_STATE_CAPACITY; k++) {
-        if (!g_path_state[k].valid)
-          continue;
-        if (g_path_state[k].missing_param_attempts == 0 &&
-            g_path_state[k].image_mount_attempts == 0 &&
-            !g_path_state[k].backport_mount_blocked &&
-            !g_path_state[k].manual_missing_source_logged &&
-            !g_path_state[k].game_info_cached) {
-          evict_k = k;
-          break;
-        }
-      }
-    }
-    if (evict_k < 0)
-      evict_k = 0;
-    memset(&g_path_state[evict_k], 0, sizeof(g_path_state[evict_k]));
-    rebuild_path_state_hash();
-    slot_k = evict_k;
+  for (int k = g_path_state_capacity - 1; k >= old_capacity; k--) {
+    g_path_state[k].lru_prev = PATH_STATE_NONE;
+    g_path_state[k].lru_next = g_path_state_free_head;
+    g_path_state_free_head = k;
   }
+  return true;
+}
+
+static struct PathStateEntry *find_path_state_by_id(sm_path_id_t path) {
+  int k = find_path_state_index(path);
+  if (k == PATH_STATE_NONE)
+    return NULL;
+  touch_path_state(k);
+  return &g_path_state[k];
+}
+
+static struct PathStateEntry *find_path_state(const char *path) {
+  sm_path_id_t id = sm_path_lookup(path);
+  struct PathStateEntry *entry = find_path_state_by_id(id);
+  sm_path_release(id);
+  return entry;
+}
 
-  memset(&g_path_state[slot_k], 0, sizeof(g_path_state[slot_k]));
-  g_path_state[slot_k].valid = true;
-  (void)strlcpy(g_path_state[slot_k].path, path,
-                sizeof(g_path_state[slot_k].path));
+// Entries carrying user-visible one-shot or blocking state are kept over
+// plain metadata/retry entries when possible.
+static bool path_state_is_sticky(const struct PathStateEntry *entry) {
+  return entry->manual_missing_source_logged || entry->backport_mount_blocked ||
+         entry->missing_param_limit_logged || entry->image_mount_limit_logged;
+}
 
-  uint32_t slot = sm_fnv1a32(path) & (STATE_HASH_SIZE - 1u);
-  for (uint32_t i = 0; i < STATE_HASH_SIZE; i++) {
-    if (g_path_state_hash[slot] == 0) {
-      g_path_state_hash[slot] = (uint16_t)(slot_k + 1);
-      return &g_path_state[slot_k];
+// Evict from the LRU tail, skipping a bounded number of sticky entries.
+static void evict_path_state(void) {
+  int victim = g_path_state_lru_tail;
+  int k = g_path_state_lru_tail;
+  for (int i = 0; i < STATE_EVICT_SCAN_LIMIT && k != PATH_STATE_NONE; i++) {
+    if (!path_state_is_sticky(&g_path_state[k])) {
+      victim = k;
+      break;
     }
-    slot = (slot + 1u) & (STATE_HASH_SIZE - 1u);
+    k = g_path_state[k].lru_prev;
   }
+  if (victim != PATH_STATE_NONE)
+    remove_path_state(victim);
+}
 
-  g_path_state[slot_k].valid = false;
-  g_path_state[slot_k].path[0] = '\0';
-  rebuild_path_state_hash();
-  return NULL;
+static struct PathStateEntry *create_path_state(sm_path_id_t path) {
+  if (g_path_state_free_head == PATH_STATE_NONE && !grow_path_state()) {
+    if (g_path_state_count <= 0)
+      return NULL;
+    evict_path_state();
+  }
+  if (g_path_state_free_head == PATH_STATE_NONE)
+    return NULL;
+
+  int k = g_path_state_free_head;
+  if (!sm_state_index_insert(&g_path_state_index, path_state_hash(path), k))
+    return NULL;
+  struct PathStateEntry *entry = &g_path_state[k];
+  g_path_state_free_head = entry->lru_next;
+  memset(entry, 0, sizeof(*entry));
+  entry->valid = true;
+  sm_path_retain(path);
+  entry->path = path;
+  g_path_state_count++;
+  lru_push_path_state(k);
+  return entry;
 }
 
 static struct PathStateEntry *get_or_create_path_state(const char *path) {
-  struct PathStateEntry *entry = find_path_state(path);
-  return entry ? entry : create_path_state(path);
+  sm_path_id_t id = sm_path_intern(path);
+  if (id == SM_PATH_ID_NONE)
+    return NULL;
+  struct PathStateEntry *entry = find_path_state_by_id(id);
+  if (!entry)
+    entry = create_path_state(id);
+  sm_path_release(id);
+  return entry;
 }
 
 bool load_cached_game_info(const char *path, const struct stat *param_st,
@@ -147,6 +216,16 @@ void store_cached_game_info(const char *path, const struct stat *param_st,
                             bool valid, const char *title_id,
                             const char *title_name) {
   struct PathStateEntry *entry = get_or_create_path_state(path);
+  if (!entry)
+    return;
+  if (!entry->game_info_cached || entry->game_info_valid != valid ||
+      entry->game_info_mtime != param_st->st_mtime ||
+      entry->game_info_size != param_st->st_size ||
+      entry->game_info_ino != param_st->st_ino ||
+      strcmp(entry->game_title_id, valid ? title_id : "") != 0 ||
+      strcmp(entry->game_title_name, valid ? title_name : "") != 0) {
+    g_game_info_generation++;
+  }
   entry->game_info_cached = true;
   entry->game_info_valid = valid;
   entry->game_info_mtime = param_st->st_mtime;
@@ -156,20 +235,38 @@ void store_cached_game_info(const char *path, const struct stat *param_st,
   (void)strlcpy(entry->game_title_name, valid ? title_name : "", MAX_TITLE_NAME);
 }
 
+void for_each_cached_game_info(cached_game_info_fn fn, void *ctx) {
+  for (int k = 0; k < g_path_state_capacity; k++) {
+    const struct PathStateEntry *entry = &g_path_state[k];
+    if (!entry->valid || !entry->game_info_cached || !entry->game_info_valid)
+      continue;
+    cached_game_info_t info = {
+        .path = sm_path_str(entry->path),
+        .title_id = entry->game_title_id,
+        .title_name = entry->game_title_name,
+        .param_mtime = entry->game_info_mtime,
+        .param_size = entry->game_info_size,
+        .param_ino = entry->game_info_ino,
+    };
+    if (!fn(&info, ctx))
+      return;
+  }
+}
+
+uint32_t cached_game_info_generation(void) {
+  return g_game_info_generation;
+}
+
 void prune_path_state(void) {
-  bool changed = false;
-  for (int k = 0; k < PATH_STATE_CAPACITY; k++) {
-    if (!g_path_state[k].valid || g_path_state[k].path[0] == '\0')
+  for (int k = 0; k < g_path_state_capacity; k++) {
+    if (!g_path_state[k].valid)
       continue;
-    if (path_exists(g_path_state[k].path))
+    if (path_exists(sm_path_str(g_path_state[k].path)))
       continue;
     if (g_path_state[k].manual_missing_source_logged)
       continue;
-    memset(&g_path_state[k], 0, sizeof(g_path_state[k]));
-    changed = true;
+    remove_path_state(k);
   }
-  if (changed)
-    rebuild_path_state_hash();
 }
 
 void prune_path_state_for_root(const char *root) {
@@ -178,21 +275,17 @@ void prune_path_state_for_root(const char *root) {
     return;
   }
 
-  bool changed = false;
-  for (int k = 0; k < PATH_STATE_CAPACITY; k++) {
-    if (!g_path_state[k].valid || g_path_state[k].path[0] == '\0')
+  for (int k = 0; k < g_path_state_capacity; k++) {
+    if (!g_path_state[k].valid)
       continue;
-    if (!path_matches_root_or_child(g_path_state[k].path, root))
+    if (!path_matches_root_or_child(sm_path_str(g_path_state[k].path), root))
       continue;
-    if (path_exists(g_path_state[k].path))
+    if (path_exists(sm_path_str(g_path_state[k].path)))
       continue;
     if (g_path_state[k].manual_missing_source_logged)
       continue;
-    memset(&g_path_state[k], 0, sizeof(g_path_state[k]));
-    changed = true;
+    remove_path_state(k);
   }
-  if (changed)
-    rebuild_path_state_hash();
 }
 
 bool is_missing_param_scan_limited(const char *path) {
@@ -209,6 +302,8 @@ void record_missing_param_failure(const char *path) {
     return;
 
   struct PathStateEntry *entry = get_or_create_path_state(path);
+  if (!entry)
+    return;
   if (entry->missing_param_attempts < UINT8_MAX)
     entry->missing_param_attempts++;
 
@@ -239,6 +334,8 @@ bool is_image_mount_limited(const char *path) {
 
 uint8_t bump_image_mount_attempts(const char *path) {
   struct PathStateEntry *entry = get_or_create_path_state(path);
+  if (!entry)
+    return 0;
   if (entry->image_mount_attempts < UINT8_MAX)
     entry->image_mount_attempts++;
   if (entry->image_mount_attempts >= MAX_IMAGE_MOUNT_ATTEMPTS &&
@@ -304,3 +401,11 @@ void clear_manual_missing_source(const char *path) {
     return;
   entry->manual_missing_source_logged = false;
 }
+
+void path_state_memory_usage(sm_state_table_usage_t *out) {
+  out->name = "path_state";
+  out->count = g_path_state_count;
+  out->capacity = g_path_state_capacity;
+  out->bytes = (size_t)g_path_state_capacity * sizeof(*g_path_state) +
+               sm_state_index_bytes(&g_path_state_index);
+}
@@ -35,9 +35,11 @@ bool path_matches_root_or_child(const char *path, const char *root) {
 
 bool is_usb_storage_path(const char *path) {
   static const char *usb_roots[] = {
-      "/mnt/usb0", "/mnt/usb1", "/mnt/usb2", "/mnt/usb3",
-      "/mnt/usb4", "/mnt/usb5", "/mnt/usb6", "/mnt/usb7",
-      "/mnt/ext0",
+      SM_PATH_ROOT "/mnt/usb0", SM_PATH_ROOT "/mnt/usb1",
+      SM_PATH_ROOT "/mnt/usb2", SM_PATH_ROOT "/mnt/usb3",
+      SM_PATH_ROOT "/mnt/usb4", SM_PATH_ROOT "/mnt/usb5",
+      SM_PATH_ROOT "/mnt/usb6", SM_PATH_ROOT "/mnt/usb7",
+      SM_PATH_ROOT "/mnt/ext0",
   };
 
   if (!path || path[0] == '\0')
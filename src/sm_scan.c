@@ -8,6 +8,7 @@
 #include "sm_log.h"
 #include "sm_config_mount.h"
 #include "sm_mount_device.h"
+#include "sm_mount_table.h"
 #include "sm_filesystem.h"
 #include "sm_appdb.h"
 #include "sm_paths.h"
@@ -17,23 +18,41 @@
 #include "sm_title_state.h"
 #include "sm_image_cache.h"
 #include "sm_image.h"
+#include "sm_image_attach_pool.h"
+#include "sm_image_probe.h"
+#include "sm_image_sidecar.h"
 #include "sm_install_queue.h"
 #include "sm_manual.h"
+#include "sm_state_table.h"
 
 typedef struct {
-  char discovered_param_roots[MAX_PENDING][MAX_PATH];
-  char checked_appmeta_titles[MAX_PENDING][MAX_TITLE_ID];
-  char blocked_ppsa_uninstall_titles[MAX_PENDING][MAX_TITLE_ID];
-  bool checked_appmeta_present[MAX_PENDING];
+  char (*paths)[MAX_PATH];
+  int count;
+  int capacity;
+} scan_path_list_t;
+
+typedef struct {
+  char title_id[MAX_TITLE_ID];
+  bool present;
+} checked_appmeta_entry_t;
+
+typedef struct {
+  scan_path_list_t discovered_param_roots;
+  checked_appmeta_entry_t *checked_appmeta;
+  char (*blocked_ppsa_uninstall_titles)[MAX_TITLE_ID];
   int checked_appmeta_count;
+  int checked_appmeta_capacity;
   int blocked_ppsa_uninstall_count;
+  int blocked_ppsa_uninstall_capacity;
 } scan_workspace_t;
 
-// Reuse the largest transient scan buffer instead of placing ~512 KiB of path
-// state on the stack each cycle.
+// Transient per-cycle scan buffers. They grow on demand up to the
+// state_soft_limit and are kept across cycles so steady-state scans do not
+// reallocate.
 static scan_workspace_t g_scan_workspace;
 
 static void reset_scan_workspace(void) {
+  g_scan_workspace.discovered_param_roots.count = 0;
   g_scan_workspace.checked_appmeta_count = 0;
   g_scan_workspace.blocked_ppsa_uninstall_count = 0;
 }
@@ -54,10 +73,14 @@ static void remember_blocked_ppsa_uninstall(const char *title_id) {
       blocked_ppsa_uninstall_requested(title_id))
     return;
 
-  if (g_scan_workspace.blocked_ppsa_uninstall_count >= MAX_PENDING)
+  int slot = g_scan_workspace.blocked_ppsa_uninstall_count;
+  if (!sm_state_table_reserve(
+          (void **)&g_scan_workspace.blocked_ppsa_uninstall_titles,
+          &g_scan_workspace.blocked_ppsa_uninstall_capacity, slot + 1,
+          sizeof(*g_scan_workspace.blocked_ppsa_uninstall_titles))) {
     return;
-
-  int slot = g_scan_workspace.blocked_ppsa_uninstall_count++;
+  }
+  g_scan_workspace.blocked_ppsa_uninstall_count++;
   (void)strlcpy(g_scan_workspace.blocked_ppsa_uninstall_titles[slot], title_id,
                 sizeof(g_scan_workspace.blocked_ppsa_uninstall_titles[slot]));
 }
@@ -96,25 +119,28 @@ static bool request_blocked_ppsa_uninstall(const char *title_id,
 
 static bool get_appmeta_present_for_scan_cycle(const char *title_id) {
   for (int i = 0; i < g_scan_workspace.checked_appmeta_count; i++) {
-    if (strcmp(g_scan_workspace.checked_appmeta_titles[i], title_id) == 0)
-      return g_scan_workspace.checked_appmeta_present[i];
+    if (strcmp(g_scan_workspace.checked_appmeta[i].title_id, title_id) == 0)
+      return g_scan_workspace.checked_appmeta[i].present;
   }
 
   bool present = has_appmeta_data(title_id);
-  if (g_scan_workspace.checked_appmeta_count < MAX_PENDING) {
-    int slot = g_scan_workspace.checked_appmeta_count++;
-    (void)strlcpy(g_scan_workspace.checked_appmeta_titles[slot], title_id,
-                  sizeof(g_scan_workspace.checked_appmeta_titles[slot]));
-    g_scan_workspace.checked_appmeta_present[slot] = present;
+  int slot = g_scan_workspace.checked_appmeta_count;
+  if (sm_state_table_reserve((void **)&g_scan_workspace.checked_appmeta,
+                             &g_scan_workspace.checked_appmeta_capacity,
+                             slot + 1,
+                             sizeof(*g_scan_workspace.checked_appmeta))) {
+    checked_appmeta_entry_t *entry = &g_scan_workspace.checked_appmeta[slot];
+    (void)strlcpy(entry->title_id, title_id, sizeof(entry->title_id));
+    entry->present = present;
+    g_scan_workspace.checked_appmeta_count++;
   }
   return present;
 }
 
 static bool is_under_discovered_param_root(
-    const char *path, char discovered_param_roots[][MAX_PATH],
-    int discovered_count) {
-  for (int i = 0; i < discovered_count; i++) {
-    const char *root = discovered_param_roots[i];
+    const char *path, const scan_path_list_t *discovered_param_roots) {
+  for (int i = 0; i < discovered_param_roots->count; i++) {
+    const char *root = discovered_param_roots->paths[i];
     size_t root_len = strlen(root);
     if (strncmp(path, root, root_len) != 0)
       continue;
@@ -150,9 +176,25 @@ typedef struct {
   bool blocked_ppsa_titles_ready;
 } scan_app_db_context_t;
 
+static void remember_discovered_param_root(
+    scan_path_list_t *discovered_param_roots, const char *full_path) {
+  if (is_under_discovered_param_root(full_path, discovered_param_roots))
+    return;
+
+  int slot = discovered_param_roots->count;
+  if (!sm_state_table_reserve((void **)&discovered_param_roots->paths,
+                              &discovered_param_roots->capacity, slot + 1,
+                              sizeof(*discovered_param_roots->paths))) {
+    return;
+  }
+  (void)strlcpy(discovered_param_roots->paths[slot], full_path, MAX_PATH);
+  discovered_param_roots->count++;
+}
+
+// dir_fd may be -1, in which case full_path is opened for the probe.
 static directory_candidate_probe_t probe_directory_candidate(
-    const char *full_path, char discovered_param_roots[][MAX_PATH],
-    int *discovered_param_root_count, bool allow_known_param_root,
+    int dir_fd, const char *full_path, scan_path_list_t *discovered_param_roots,
+    bool allow_known_param_root,
     directory_candidate_info_t *info_out) {
   struct stat param_st;
 
@@ -160,8 +202,7 @@ static directory_candidate_probe_t probe_directory_candidate(
     return DIRECTORY_CANDIDATE_DESCEND;
 
   if (!allow_known_param_root &&
-      is_under_discovered_param_root(full_path, discovered_param_roots,
-                                     *discovered_param_root_count)) {
+      is_under_discovered_param_root(full_path, discovered_param_roots)) {
     return DIRECTORY_CANDIDATE_SKIP_DESCEND;
   }
 
@@ -170,7 +211,10 @@ static directory_candidate_probe_t probe_directory_candidate(
     return DIRECTORY_CANDIDATE_SKIP_DESCEND;
   }
 
-  if (!directory_has_param_json(full_path, &param_st)) {
+  bool has_param_json = dir_fd >= 0
+                            ? directory_fd_has_param_json(dir_fd, &param_st)
+                            : directory_has_param_json(full_path, &param_st);
+  if (!has_param_json) {
     if (is_missing_param_scan_limited(full_path)) {
       log_debug("  [SKIP] param.json retry limit reached: %s", full_path);
     } else {
@@ -186,22 +230,15 @@ static directory_candidate_probe_t probe_directory_candidate(
     return DIRECTORY_CANDIDATE_SKIP_DESCEND;
   }
 
-  if (*discovered_param_root_count < MAX_PENDING &&
-      !is_under_discovered_param_root(full_path, discovered_param_roots,
-                                      *discovered_param_root_count)) {
-    (void)strlcpy(discovered_param_roots[*discovered_param_root_count], full_path,
-                  MAX_PATH);
-    (*discovered_param_root_count)++;
-  }
+  remember_discovered_param_root(discovered_param_roots, full_path);
   clear_missing_param_entry(full_path);
   return DIRECTORY_CANDIDATE_READY;
 }
 
-static int find_scan_candidate_index_by_title_id(scan_candidate_t *candidates,
-                                                 int candidate_count,
-                                                 const char *title_id) {
-  for (int i = 0; i < candidate_count; i++) {
-    if (strcmp(candidates[i].title_id, title_id) == 0)
+static int find_scan_candidate_index_by_title_id(
+    const scan_candidate_list_t *candidates, const char *title_id) {
+  for (int i = 0; i < candidates->count; i++) {
+    if (strcmp(candidates->items[i].title_id, title_id) == 0)
       return i;
   }
   return -1;
@@ -217,14 +254,14 @@ static void mark_scan_candidate_manual(scan_candidate_t *candidate,
                 sizeof(candidate->manual_source_path));
 }
 
-static void remove_scan_candidate_at(scan_candidate_t *candidates,
-                                     int *candidate_count, int index) {
-  int trailing_count = *candidate_count - index - 1;
+static void remove_scan_candidate_at(scan_candidate_list_t *candidates,
+                                     int index) {
+  int trailing_count = candidates->count - index - 1;
   if (trailing_count > 0) {
-    memmove(&candidates[index], &candidates[index + 1],
-            (size_t)trailing_count * sizeof(candidates[0]));
+    memmove(&candidates->items[index], &candidates->items[index + 1],
+            (size_t)trailing_count * sizeof(candidates->items[0]));
   }
-  (*candidate_count)--;
+  candidates->count--;
 }
 
 static void notify_duplicate_scan_candidate(const char *title_id,
@@ -298,8 +335,8 @@ static existing_directory_result_t handle_existing_directory_candidate(
 }
 
 static bool enqueue_directory_candidate(
-    const char *full_path, scan_candidate_t *candidates, int max_candidates,
-    int *candidate_count, const directory_candidate_info_t *info, bool installed,
+    const char *full_path, scan_candidate_list_t *candidates,
+    const directory_candidate_info_t *info, bool installed,
     bool in_app_db, const char *manual_source_path,
     bool *unstable_found_out) {
   char metadata_path[MAX_PATH];
@@ -327,37 +364,37 @@ static bool enqueue_directory_candidate(
     return true;
   }
 
-  if (*candidate_count >= max_candidates) {
-    log_debug("  [SKIP] candidate queue full (%d): %s (%s)", max_candidates,
-              info->title_name, info->title_id);
+  if (!sm_state_table_reserve((void **)&candidates->items,
+                              &candidates->capacity, candidates->count + 1,
+                              sizeof(*candidates->items))) {
+    log_debug("  [SKIP] candidate queue full (%d): %s (%s)",
+              candidates->capacity, info->title_name, info->title_id);
     return true;
   }
 
-  (void)strlcpy(candidates[*candidate_count].path, full_path,
-                sizeof(candidates[*candidate_count].path));
-  (void)strlcpy(candidates[*candidate_count].title_id, info->title_id,
-                sizeof(candidates[*candidate_count].title_id));
-  (void)strlcpy(candidates[*candidate_count].title_name, info->title_name,
-                sizeof(candidates[*candidate_count].title_name));
-  candidates[*candidate_count].manual_source_path[0] = '\0';
-  candidates[*candidate_count].installed = installed;
-  candidates[*candidate_count].in_app_db = in_app_db;
-  candidates[*candidate_count].manual = false;
-  mark_scan_candidate_manual(&candidates[*candidate_count], manual_source_path);
-  (*candidate_count)++;
+  scan_candidate_t *candidate = &candidates->items[candidates->count];
+  (void)strlcpy(candidate->path, full_path, sizeof(candidate->path));
+  (void)strlcpy(candidate->title_id, info->title_id,
+                sizeof(candidate->title_id));
+  (void)strlcpy(candidate->title_name, info->title_name,
+                sizeof(candidate->title_name));
+  candidate->manual_source_path[0] = '\0';
+  candidate->installed = installed;
+  candidate->in_app_db = in_app_db;
+  candidate->manual = false;
+  mark_scan_candidate_manual(candidate, manual_source_path);
+  candidates->count++;
   return true;
 }
 
 static bool try_collect_candidate_for_directory(
-    const char *full_path, scan_candidate_t *candidates, int max_candidates,
-    int *candidate_count, const scan_app_db_context_t *app_db,
-    char discovered_param_roots[][MAX_PATH],
-    int *discovered_param_root_count, bool allow_known_param_root,
+    int dir_fd, const char *full_path, scan_candidate_list_t *candidates,
+    const scan_app_db_context_t *app_db,
+    scan_path_list_t *discovered_param_roots, bool allow_known_param_root,
     const char *manual_source_path, bool *unstable_found_out) {
   directory_candidate_info_t info;
   directory_candidate_probe_t probe_result =
-      probe_directory_candidate(full_path, discovered_param_roots,
-                                discovered_param_root_count,
+      probe_directory_candidate(dir_fd, full_path, discovered_param_roots,
                                 allow_known_param_root, &info);
 
   if (probe_result == DIRECTORY_CANDIDATE_SKIP_DESCEND)
@@ -365,11 +402,12 @@ static bool try_collect_candidate_for_directory(
   if (probe_result == DIRECTORY_CANDIDATE_DESCEND)
     return false;
 
-  int duplicate_candidate_index = find_scan_candidate_index_by_title_id(
-      candidates, *candidate_count, info.title_id);
+  int duplicate_candidate_index =
+      find_scan_candidate_index_by_title_id(candidates, info.title_id);
   const char *duplicate_candidate_path =
-      duplicate_candidate_index >= 0 ? candidates[duplicate_candidate_index].path
-                                     : NULL;
+      duplicate_candidate_index >= 0
+          ? candidates->items[duplicate_candidate_index].path
+          : NULL;
   bool duplicate_candidate_same_path =
       duplicate_candidate_path && strcmp(duplicate_candidate_path, full_path) == 0;
   bool installed = false;
@@ -387,8 +425,7 @@ static bool try_collect_candidate_for_directory(
       if (!duplicate_candidate_same_path)
         notify_duplicate_scan_candidate(info.title_id, duplicate_candidate_path,
                                         full_path);
-      remove_scan_candidate_at(candidates, candidate_count,
-                               duplicate_candidate_index);
+      remove_scan_candidate_at(candidates, duplicate_candidate_index);
     }
     return true;
   }
@@ -396,8 +433,7 @@ static bool try_collect_candidate_for_directory(
     notify_duplicate_scan_candidate(info.title_id, full_path,
                                     preferred_existing_path);
     if (duplicate_candidate_index >= 0)
-      remove_scan_candidate_at(candidates, candidate_count,
-                               duplicate_candidate_index);
+      remove_scan_candidate_at(candidates, duplicate_candidate_index);
     return true;
   }
   if (existing_result == EXISTING_DIRECTORY_HANDLED) {
@@ -405,7 +441,7 @@ static bool try_collect_candidate_for_directory(
       notify_duplicate_scan_candidate(info.title_id, full_path,
                                       duplicate_candidate_path);
     if (duplicate_candidate_index >= 0)
-      mark_scan_candidate_manual(&candidates[duplicate_candidate_index],
+      mark_scan_candidate_manual(&candidates->items[duplicate_candidate_index],
                                  manual_source_path);
     return true;
   }
@@ -414,45 +450,39 @@ static bool try_collect_candidate_for_directory(
     if (!duplicate_candidate_same_path)
       notify_duplicate_scan_candidate(info.title_id, full_path,
                                       duplicate_candidate_path);
-    mark_scan_candidate_manual(&candidates[duplicate_candidate_index],
+    mark_scan_candidate_manual(&candidates->items[duplicate_candidate_index],
                                manual_source_path);
     return true;
   }
 
-  return enqueue_directory_candidate(full_path, candidates, max_candidates,
-                                     candidate_count, &info, installed,
+  return enqueue_directory_candidate(full_path, candidates, &info, installed,
                                      in_app_db, manual_source_path,
                                      unstable_found_out);
 }
 
 typedef struct {
-  scan_candidate_t *candidates;
-  int max_candidates;
-  int *candidate_count;
+  scan_candidate_list_t *candidates;
   const scan_app_db_context_t *app_db;
-  char (*discovered_param_roots)[MAX_PATH];
-  int *discovered_param_root_count;
+  scan_path_list_t *discovered_param_roots;
   const char *manual_source_path;
   bool *unstable_found_out;
 } collect_candidates_walk_ctx_t;
 
 static void collect_scan_candidates_from_manual_root(
     const char *scan_path, const char *manual_source_path,
-    scan_candidate_t *candidates, int max_candidates, int *candidate_count,
-    const scan_app_db_context_t *app_db,
-    char discovered_param_roots[][MAX_PATH], int *discovered_param_root_count,
-    bool *unstable_found_out);
+    scan_candidate_list_t *candidates, const scan_app_db_context_t *app_db,
+    scan_path_list_t *discovered_param_roots, bool *unstable_found_out);
 
 static sm_scan_tree_dir_visit_t collect_candidate_directory_visit(
-    const char *dir_path, unsigned int depth_from_root, void *ctx_ptr) {
+    int dir_fd, const char *dir_path, unsigned int depth_from_root,
+    void *ctx_ptr) {
   if (depth_from_root == 0u)
     return SM_SCAN_TREE_DIR_DESCEND;
 
   collect_candidates_walk_ctx_t *ctx = (collect_candidates_walk_ctx_t *)ctx_ptr;
   if (try_collect_candidate_for_directory(
-          dir_path, ctx->candidates, ctx->max_candidates, ctx->candidate_count,
-          ctx->app_db, ctx->discovered_param_roots,
-          ctx->discovered_param_root_count, false, ctx->manual_source_path,
+          dir_fd, dir_path, ctx->candidates, ctx->app_db,
+          ctx->discovered_param_roots, false, ctx->manual_source_path,
           ctx->unstable_found_out)) {
     return SM_SCAN_TREE_DIR_SKIP_DESCEND;
   }
@@ -460,13 +490,79 @@ static sm_scan_tree_dir_visit_t collect_candidate_directory_visit(
   return SM_SCAN_TREE_DIR_DESCEND;
 }
 
-static bool collect_candidate_image_visit(const char *image_path,
+// Use the image sidecar to decide, before attaching, that mounting the image
+// could only end in a skip. Returns true when the attach should be skipped.
+static bool skip_image_attach_from_sidecar(
+    int parent_fd, const char *image_path, const char *image_name,
+    const collect_candidates_walk_ctx_t *ctx) {
+  if (is_image_cache_source(image_path))
+    return false;
+
+  image_sidecar_t sidecar;
+  if (!get_image_sidecar_at(parent_fd, image_path, image_name, &sidecar))
+    return false;
+
+  const scan_app_db_context_t *app_db = ctx->app_db;
+  if (is_blocked_ppsa_title(app_db->blocked_ppsa_titles,
+                            app_db->blocked_ppsa_titles_ready,
+                            sidecar.title_id)) {
+    request_blocked_ppsa_uninstall(sidecar.title_id, image_path);
+    return true;
+  }
+
+  uint8_t failed_attempts = get_failed_mount_attempts(sidecar.title_id);
+  if (failed_attempts >= MAX_FAILED_MOUNT_ATTEMPTS) {
+    log_debug("  [SKIP] mount/register retry limit reached (%u/%u): %s (%s)",
+              (unsigned)failed_attempts, (unsigned)MAX_FAILED_MOUNT_ATTEMPTS,
+              sidecar.title_name, image_path);
+    return true;
+  }
+
+  int duplicate_index =
+      find_scan_candidate_index_by_title_id(ctx->candidates, sidecar.title_id);
+  if (duplicate_index >= 0) {
+    notify_duplicate_scan_candidate(sidecar.title_id, image_path,
+                                    ctx->candidates->items[duplicate_index].path);
+    return true;
+  }
+
+  if (!app_db->titles_ready ||
+      !app_db_title_list_contains(app_db->titles, sidecar.title_id) ||
+      !is_installed(sidecar.title_id)) {
+    return false;
+  }
+
+  char tracked_path[MAX_PATH];
+  char mount_point[MAX_PATH];
+  get_image_mount_point_for_source(image_path, mount_point);
+  if (read_mount_link(sidecar.title_id, tracked_path, sizeof(tracked_path)) &&
+      strcmp(tracked_path, mount_point) != 0 &&
+      is_data_mounted(sidecar.title_id)) {
+    notify_duplicate_scan_candidate(sidecar.title_id, image_path,
+                                    tracked_path);
+    return true;
+  }
+  return false;
+}
+
+static bool collect_candidate_image_visit(int parent_fd,
+                                          const char *image_path,
                                           const char *image_name,
                                           unsigned int depth_from_root,
                                           void *ctx_ptr) {
   (void)depth_from_root;
 
   collect_candidates_walk_ctx_t *ctx = (collect_candidates_walk_ctx_t *)ctx_ptr;
+  if (skip_image_attach_from_sidecar(parent_fd, image_path, image_name, ctx))
+    return true;
+  // Scan roots only need the image attached before the image mount base is
+  // walked, so it goes to the attach pool; manual PFSC containers are walked
+  // right away and attach inline.
+  if (!ctx->manual_source_path) {
+    (void)image_attach_pool_submit(image_path, image_name,
+                                   ctx->unstable_found_out);
+    return true;
+  }
   if (!maybe_mount_image_file(image_path, image_name, ctx->unstable_found_out))
     return true;
 
@@ -474,20 +570,16 @@ static bool collect_candidate_image_visit(const char *image_path,
     char mount_point[MAX_PATH];
     get_image_mount_point_for_source(image_path, mount_point);
     collect_scan_candidates_from_manual_root(
-        mount_point, ctx->manual_source_path, ctx->candidates,
-        ctx->max_candidates, ctx->candidate_count, ctx->app_db,
-        ctx->discovered_param_roots, ctx->discovered_param_root_count,
-        ctx->unstable_found_out);
+        mount_point, ctx->manual_source_path, ctx->candidates, ctx->app_db,
+        ctx->discovered_param_roots, ctx->unstable_found_out);
   }
   return true;
 }
 
 static void collect_scan_candidates_from_manual_root(
     const char *scan_path, const char *manual_source_path,
-    scan_candidate_t *candidates, int max_candidates, int *candidate_count,
-    const scan_app_db_context_t *app_db,
-    char discovered_param_roots[][MAX_PATH], int *discovered_param_root_count,
-    bool *unstable_found_out) {
+    scan_candidate_list_t *candidates, const scan_app_db_context_t *app_db,
+    scan_path_list_t *discovered_param_roots, bool *unstable_found_out) {
   if (should_stop_requested() || runtime_sleep_mode_active())
     return;
 
@@ -500,8 +592,7 @@ static void collect_scan_candidates_from_manual_root(
 
   if (try_root_candidate) {
     if (try_collect_candidate_for_directory(
-            scan_path, candidates, max_candidates, candidate_count,
-            app_db, discovered_param_roots, discovered_param_root_count, true,
+            -1, scan_path, candidates, app_db, discovered_param_roots, true,
             manual_source_path, unstable_found_out)) {
       return;
     }
@@ -511,11 +602,8 @@ static void collect_scan_candidates_from_manual_root(
 
   collect_candidates_walk_ctx_t ctx = {
       .candidates = candidates,
-      .max_candidates = max_candidates,
-      .candidate_count = candidate_count,
       .app_db = app_db,
       .discovered_param_roots = discovered_param_roots,
-      .discovered_param_root_count = discovered_param_root_count,
       .manual_source_path = manual_source_path,
       .unstable_found_out = unstable_found_out,
   };
@@ -528,10 +616,9 @@ static void collect_scan_candidates_from_manual_root(
 }
 
 static void collect_scan_candidates_from_manual_path(
-    const char *manual_path, scan_candidate_t *candidates, int max_candidates,
-    int *candidate_count, const scan_app_db_context_t *app_db,
-    char discovered_param_roots[][MAX_PATH],
-    int *discovered_param_root_count, bool *unstable_found_out) {
+    const char *manual_path, scan_candidate_list_t *candidates,
+    const scan_app_db_context_t *app_db,
+    scan_path_list_t *discovered_param_roots, bool *unstable_found_out) {
   if (should_stop_requested() || runtime_sleep_mode_active())
     return;
 
@@ -552,8 +639,7 @@ static void collect_scan_candidates_from_manual_path(
     char mount_point[MAX_PATH];
     get_image_mount_point_for_source(manual_path, mount_point);
     collect_scan_candidates_from_manual_root(
-        mount_point, manual_path, candidates, max_candidates, candidate_count,
-        app_db, discovered_param_roots, discovered_param_root_count,
+        mount_point, manual_path, candidates, app_db, discovered_param_roots,
         unstable_found_out);
     return;
   }
@@ -566,18 +652,14 @@ static void collect_scan_candidates_from_manual_path(
   }
 
   collect_scan_candidates_from_manual_root(
-      manual_path, manual_path, candidates, max_candidates, candidate_count,
-      app_db, discovered_param_roots, discovered_param_root_count,
+      manual_path, manual_path, candidates, app_db, discovered_param_roots,
       unstable_found_out);
 }
 
 typedef struct {
-  scan_candidate_t *candidates;
-  int max_candidates;
-  int *candidate_count;
+  scan_candidate_list_t *candidates;
   const scan_app_db_context_t *app_db;
-  char (*discovered_param_roots)[MAX_PATH];
-  int *discovered_param_root_count;
+  scan_path_list_t *discovered_param_roots;
   bool *unstable_found_out;
   int path_count;
 } manual_scan_ctx_t;
@@ -586,17 +668,16 @@ static bool collect_manual_path_visit(const char *manual_path, void *ctx_ptr) {
   manual_scan_ctx_t *ctx = (manual_scan_ctx_t *)ctx_ptr;
   if (should_stop_requested() || runtime_sleep_mode_active())
     return false;
-  if (*ctx->candidate_count >= ctx->max_candidates) {
+  if (ctx->candidates->count >= sm_state_soft_limit()) {
     log_debug("  [MANUAL] candidate queue full (%d), remaining sources deferred",
-              ctx->max_candidates);
+              ctx->candidates->count);
     return false;
   }
 
   ctx->path_count++;
   collect_scan_candidates_from_manual_path(
-      manual_path, ctx->candidates, ctx->max_candidates, ctx->candidate_count,
-      ctx->app_db, ctx->discovered_param_roots,
-      ctx->discovered_param_root_count, ctx->unstable_found_out);
+      manual_path, ctx->candidates, ctx->app_db, ctx->discovered_param_roots,
+      ctx->unstable_found_out);
   return true;
 }
 
@@ -694,7 +775,7 @@ static bool mount_backport_overlay_for_cached_game(const char *source_path,
   }
 
   char system_ex_path[MAX_PATH];
-  snprintf(system_ex_path, sizeof(system_ex_path), "/system_ex/app/%s",
+  snprintf(system_ex_path, sizeof(system_ex_path), SYSTEM_EX_APP_BASE "/%s",
            title_id);
   if (!mount_backport_overlay(system_ex_path, backport_path, title_id)) {
     note_backport_mount_failure(backport_path);
@@ -713,6 +794,8 @@ void mount_backport_overlays(bool *unstable_found_out) {
 
 // --- Unified Scan Pass (images + game candidates) ---
 void cleanup_lost_sources_before_scan(void) {
+  // Mounts may have changed outside the payload since the last pass.
+  mount_table_invalidate();
   // 1) Drop stale game cache entries for deleted sources.
   prune_game_cache();
   // 2) Drop stale/broken mount links and unmount stale /system_ex stacks.
@@ -721,9 +804,13 @@ void cleanup_lost_sources_before_scan(void) {
   cleanup_stale_image_mounts();
   // 4) Drop stale path-state entries.
   prune_path_state();
+  // 5) Drop cached sidecars and header probes of deleted images.
+  prune_image_sidecar_cache();
+  prune_image_probe_cache();
 }
 
 void cleanup_lost_sources_for_scan_root(const char *scan_root) {
+  mount_table_invalidate();
   prune_game_cache_for_root(scan_root);
   cleanup_mount_links(scan_root, true);
   cleanup_stale_image_mounts_for_root(scan_root);
@@ -741,22 +828,23 @@ void unmount_usb_sources_for_suspend(void) {
 }
 
 static void collect_scan_candidates_from_root(
-    const char *scan_path, scan_candidate_t *candidates, int max_candidates,
-    int *candidate_count, const scan_app_db_context_t *app_db,
-    char discovered_param_roots[][MAX_PATH],
-    int *discovered_param_root_count, bool *unstable_found_out) {
+    const char *scan_path, scan_candidate_list_t *candidates,
+    const scan_app_db_context_t *app_db,
+    scan_path_list_t *discovered_param_roots, bool *unstable_found_out) {
   if (should_stop_requested() || runtime_sleep_mode_active())
     return;
+  // Images queued so far must be mounted before their mount base is walked.
+  // This runs before each managed root: the PFSC container base queues the
+  // images nested in mounted containers, which mount under IMAGE_MOUNT_BASE.
+  if (path_matches_root_or_child(scan_path, IMAGE_MOUNT_BASE))
+    image_attach_pool_drain();
 
   unsigned int scan_depth = get_scan_depth_for_root(scan_path);
 
   collect_candidates_walk_ctx_t ctx = {
       .candidates = candidates,
-      .max_candidates = max_candidates,
-      .candidate_count = candidate_count,
       .app_db = app_db,
       .discovered_param_roots = discovered_param_roots,
-      .discovered_param_root_count = discovered_param_root_count,
       .manual_source_path = NULL,
       .unstable_found_out = unstable_found_out,
   };
@@ -768,10 +856,8 @@ static void collect_scan_candidates_from_root(
 }
 
 static void collect_scan_candidates_from_manual_list(
-    scan_candidate_t *candidates, int max_candidates, int *candidate_count,
-    const scan_app_db_context_t *app_db,
-    char discovered_param_roots[][MAX_PATH], int *discovered_param_root_count,
-    bool *unstable_found_out) {
+    scan_candidate_list_t *candidates, const scan_app_db_context_t *app_db,
+    scan_path_list_t *discovered_param_roots, bool *unstable_found_out) {
   if (should_stop_requested() || runtime_sleep_mode_active())
     return;
 
@@ -780,11 +866,8 @@ static void collect_scan_candidates_from_manual_list(
 
   manual_scan_ctx_t ctx = {
       .candidates = candidates,
-      .max_candidates = max_candidates,
-      .candidate_count = candidate_count,
       .app_db = app_db,
       .discovered_param_roots = discovered_param_roots,
-      .discovered_param_root_count = discovered_param_root_count,
       .unstable_found_out = unstable_found_out,
       .path_count = 0,
   };
@@ -816,18 +899,17 @@ static void uninstall_blocked_ppsa_titles(
 }
 
 int collect_scan_candidates_for_scan_root(const char *scan_root,
-                                          scan_candidate_t *candidates,
-                                          int max_candidates,
+                                          scan_candidate_list_t *candidates,
                                           int *total_found_out,
                                           bool *unstable_found_out) {
   reset_scan_workspace();
-  int candidate_count = 0;
+  flush_dropped_image_mounts();
+  candidates->count = 0;
   struct AppDbTitleList app_db_titles = {0};
   struct AppDbTitleList blocked_ppsa_titles = {0};
   bool app_db_titles_ready = get_app_db_title_list_cached(&app_db_titles);
   bool blocked_ppsa_titles_ready =
       get_app_db_blocked_uninstall_ppsa_list(&blocked_ppsa_titles);
-  int discovered_param_root_count = 0;
 
   if (!app_db_titles_ready)
     log_debug("  [DB] app.db title list unavailable for this scan cycle");
@@ -840,30 +922,29 @@ int collect_scan_candidates_for_scan_root(const char *scan_root,
       .titles_ready = app_db_titles_ready,
       .blocked_ppsa_titles_ready = blocked_ppsa_titles_ready,
   };
-  collect_scan_candidates_from_root(scan_root, candidates, max_candidates,
-                                    &candidate_count, &app_db,
-                                    g_scan_workspace.discovered_param_roots,
-                                    &discovered_param_root_count,
+  collect_scan_candidates_from_root(scan_root, candidates, &app_db,
+                                    &g_scan_workspace.discovered_param_roots,
                                     unstable_found_out);
+  image_attach_pool_drain();
 
   if (total_found_out)
-    *total_found_out = discovered_param_root_count;
+    *total_found_out = g_scan_workspace.discovered_param_roots.count;
   free_app_db_title_list(&blocked_ppsa_titles);
   free_app_db_title_list(&app_db_titles);
-  return candidate_count;
+  return candidates->count;
 }
 
-int collect_scan_candidates(scan_candidate_t *candidates, int max_candidates,
+int collect_scan_candidates(scan_candidate_list_t *candidates,
                             int *total_found_out,
                             bool *unstable_found_out) {
   reset_scan_workspace();
-  int candidate_count = 0;
+  flush_dropped_image_mounts();
+  candidates->count = 0;
   struct AppDbTitleList app_db_titles = {0};
   struct AppDbTitleList blocked_ppsa_titles = {0};
   bool app_db_titles_ready = get_app_db_title_list_cached(&app_db_titles);
   bool blocked_ppsa_titles_ready =
       get_app_db_blocked_uninstall_ppsa_list(&blocked_ppsa_titles);
-  int discovered_param_root_count = 0;
 
   if (!app_db_titles_ready)
     log_debug("  [DB] app.db title list unavailable for this scan cycle");
@@ -879,25 +960,52 @@ int collect_scan_candidates(scan_candidate_t *candidates, int max_candidates,
   for (int i = 0; i < get_scan_path_count(); i++) {
     if (should_stop_requested() || runtime_sleep_mode_active())
       break;
-    collect_scan_candidates_from_root(get_scan_path(i), candidates,
-                                      max_candidates,
-                                      &candidate_count, &app_db,
-                                      g_scan_workspace.discovered_param_roots,
-                                      &discovered_param_root_count,
+    collect_scan_candidates_from_root(get_scan_path(i), candidates, &app_db,
+                                      &g_scan_workspace.discovered_param_roots,
                                       unstable_found_out);
   }
+  image_attach_pool_drain();
 
   collect_scan_candidates_from_manual_list(
-      candidates, max_candidates, &candidate_count, &app_db,
-      g_scan_workspace.discovered_param_roots, &discovered_param_root_count,
+      candidates, &app_db, &g_scan_workspace.discovered_param_roots,
       unstable_found_out);
 
   uninstall_blocked_ppsa_titles(&blocked_ppsa_titles,
                                 blocked_ppsa_titles_ready);
 
   if (total_found_out)
-    *total_found_out = discovered_param_root_count;
+    *total_found_out = g_scan_workspace.discovered_param_roots.count;
   free_app_db_title_list(&blocked_ppsa_titles);
   free_app_db_title_list(&app_db_titles);
-  return candidate_count;
+  return candidates->count;
+}
+
+void free_scan_candidate_list(scan_candidate_list_t *list) {
+  if (!list)
+    return;
+  free(list->items);
+  list->items = NULL;
+  list->count = 0;
+  list->capacity = 0;
+}
+
+void scan_candidate_list_memory_usage(const scan_candidate_list_t *list,
+                                      sm_state_table_usage_t *out) {
+  out->name = "scan_candidates";
+  out->count = list->count;
+  out->capacity = list->capacity;
+  out->bytes = (size_t)list->capacity * sizeof(*list->items);
+}
+
+void scan_workspace_memory_usage(sm_state_table_usage_t *out) {
+  const scan_workspace_t *ws = &g_scan_workspace;
+  out->name = "scan_workspace";
+  out->count = ws->discovered_param_roots.count;
+  out->capacity = ws->discovered_param_roots.capacity;
+  out->bytes =
+      (size_t)ws->discovered_param_roots.capacity *
+          sizeof(*ws->discovered_param_roots.paths) +
+      (size_t)ws->checked_appmeta_capacity * sizeof(*ws->checked_appmeta) +
+      (size_t)ws->blocked_ppsa_uninstall_capacity *
+          sizeof(*ws->blocked_ppsa_uninstall_titles);
 }
@@ -0,0 +1,285 @@
+#include "sm_platform.h"
+#include "sm_scan_index.h"
+
+#include <sys/mman.h>
+
+#include "sm_hash.h"
+#include "sm_limits.h"
+#include "sm_log.h"
+#include "sm_path_state.h"
+#include "sm_paths.h"
+
+// On-disk layout: header, record_count fixed-size records, then a string
+// table of NUL-terminated strings referenced by offset. Everything is
+// naturally aligned so the file can be used straight from a mapping.
+#define SCAN_INDEX_MAGIC "SMSI"
+// Version 2 dropped the image source, fs type and mount outcome fields that
+// nothing read back.
+#define SCAN_INDEX_VERSION 2u
+// Larger files are ignored rather than mapped.
+#define SCAN_INDEX_MAX_FILE_SIZE (64u * 1024u * 1024u)
+
+typedef struct {
+  char magic[4];
+  uint32_t version;
+  uint32_t record_size;
+  uint32_t record_count;
+  uint32_t strings_size;
+  // FNV-1a over the records and the string table.
+  uint32_t checksum;
+  uint64_t reserved;
+} scan_index_header_t;
+
+typedef struct {
+  // stat identity of sce_sys/param.json when it was parsed.
+  uint64_t param_ino;
+  int64_t param_size;
+  int64_t param_mtime;
+  // Title directory the game info was read from.
+  uint32_t path_offset;
+  uint32_t title_id_offset;
+  uint32_t title_name_offset;
+  uint32_t reserved;
+} scan_index_record_t;
+
+static uint32_t g_scan_index_saved_generation = 0;
+static bool g_scan_index_saved = false;
+
+static const char *scan_index_string(const char *strings, uint32_t size,
+                                     uint32_t offset) {
+  if (offset >= size)
+    return NULL;
+  if (!memchr(strings + offset, '\0', size - offset))
+    return NULL;
+  return strings + offset;
+}
+
+static bool validate_scan_index(const uint8_t *data, size_t size,
+                                const scan_index_header_t **header_out) {
+  if (size < sizeof(scan_index_header_t))
+    return false;
+  const scan_index_header_t *header = (const scan_index_header_t *)data;
+  if (memcmp(header->magic, SCAN_INDEX_MAGIC, sizeof(header->magic)) != 0 ||
+      header->version != SCAN_INDEX_VERSION ||
+      header->record_size != sizeof(scan_index_record_t)) {
+    return false;
+  }
+  uint64_t body = (uint64_t)header->record_count * sizeof(scan_index_record_t) +
+                  header->strings_size;
+  if (body != size - sizeof(*header))
+    return false;
+  if (sm_fnv1a32_update(SM_FNV1A32_INIT, data + sizeof(*header),
+                        (size_t)body) != header->checksum) {
+    return false;
+  }
+  *header_out = header;
+  return true;
+}
+
+int load_scan_index(void) {
+  int fd = open(SCAN_INDEX_FILE, O_RDONLY);
+  if (fd < 0) {
+    if (errno != ENOENT)
+      log_debug("  [INDEX] open failed for %s: %s", SCAN_INDEX_FILE,
+                strerror(errno));
+    return 0;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size <= 0 ||
+      (uint64_t)st.st_size > SCAN_INDEX_MAX_FILE_SIZE) {
+    close(fd);
+    return 0;
+  }
+  size_t size = (size_t)st.st_size;
+  void *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    log_debug("  [INDEX] mmap failed for %s: %s", SCAN_INDEX_FILE,
+              strerror(errno));
+    return 0;
+  }
+
+  const scan_index_header_t *header = NULL;
+  if (!validate_scan_index(map, size, &header)) {
+    log_debug("  [INDEX] ignoring invalid or outdated %s", SCAN_INDEX_FILE);
+    munmap(map, size);
+    return 0;
+  }
+
+  const scan_index_record_t *records =
+      (const scan_index_record_t *)((const uint8_t *)map + sizeof(*header));
+  const char *strings = (const char *)(records + header->record_count);
+  int loaded = 0;
+  for (uint32_t i = 0; i < header->record_count; i++) {
+    const scan_index_record_t *record = &records[i];
+    const char *path =
+        scan_index_string(strings, header->strings_size, record->path_offset);
+    const char *title_id = scan_index_string(strings, header->strings_size,
+                                             record->title_id_offset);
+    const char *title_name = scan_index_string(strings, header->strings_size,
+                                               record->title_name_offset);
+    if (!path || path[0] == '\0' || !title_id || title_id[0] == '\0' ||
+        !title_name) {
+      continue;
+    }
+
+    // Entries are trusted only while param.json keeps this identity; the
+    // startup scan still stats every source before using them.
+    struct stat param_st;
+    memset(&param_st, 0, sizeof(param_st));
+    param_st.st_mode = S_IFREG;
+    param_st.st_ino = (ino_t)record->param_ino;
+    param_st.st_size = (off_t)record->param_size;
+    param_st.st_mtime = (time_t)record->param_mtime;
+    store_cached_game_info(path, &param_st, true, title_id, title_name);
+    loaded++;
+  }
+
+  uint32_t record_count = header->record_count;
+  munmap(map, size);
+  g_scan_index_saved_generation = cached_game_info_generation();
+  g_scan_index_saved = true;
+  log_debug("  [INDEX] loaded %d/%u titles from %s", loaded, record_count,
+            SCAN_INDEX_FILE);
+  return loaded;
+}
+
+typedef struct {
+  uint8_t *strings;
+  uint32_t strings_size;
+  uint32_t strings_capacity;
+  scan_index_record_t *records;
+  uint32_t record_count;
+  uint32_t record_capacity;
+  bool failed;
+} scan_index_builder_t;
+
+static uint32_t append_scan_index_string(scan_index_builder_t *builder,
+                                         const char *str) {
+  size_t len = strlen(str) + 1u;
+  uint32_t offset = builder->strings_size;
+  if ((uint64_t)offset + len > SCAN_INDEX_MAX_FILE_SIZE) {
+    builder->failed = true;
+    return 0;
+  }
+  if (offset + len > builder->strings_capacity) {
+    uint32_t capacity = builder->strings_capacity ? builder->strings_capacity
+                                                  : 16384u;
+    while (capacity < offset + len)
+      capacity *= 2u;
+    uint8_t *grown = realloc(builder->strings, capacity);
+    if (!grown) {
+      builder->failed = true;
+      return 0;
+    }
+    builder->strings = grown;
+    builder->strings_capacity = capacity;
+  }
+  memcpy(builder->strings + offset, str, len);
+  builder->strings_size += (uint32_t)len;
+  return offset;
+}
+
+static bool add_scan_index_record(const cached_game_info_t *info, void *ctx) {
+  scan_index_builder_t *builder = (scan_index_builder_t *)ctx;
+  if (builder->record_count == builder->record_capacity) {
+    uint32_t capacity = builder->record_capacity ? builder->record_capacity * 2u
+                                                 : (uint32_t)INITIAL_STATE_CAPACITY;
+    scan_index_record_t *grown =
+        realloc(builder->records, (size_t)capacity * sizeof(*grown));
+    if (!grown) {
+      builder->failed = true;
+      return false;
+    }
+    builder->records = grown;
+    builder->record_capacity = capacity;
+  }
+
+  scan_index_record_t *record = &builder->records[builder->record_count];
+  memset(record, 0, sizeof(*record));
+  record->param_ino = (uint64_t)info->param_ino;
+  record->param_size = (int64_t)info->param_size;
+  record->param_mtime = (int64_t)info->param_mtime;
+  record->path_offset = append_scan_index_string(builder, info->path);
+  record->title_id_offset = append_scan_index_string(builder, info->title_id);
+  record->title_name_offset =
+      append_scan_index_string(builder, info->title_name);
+  if (builder->failed)
+    return false;
+  builder->record_count++;
+  return true;
+}
+
+static bool write_scan_index_file(const scan_index_builder_t *builder) {
+  mkdir(LOG_DIR, 0777);
+
+  scan_index_header_t header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, SCAN_INDEX_MAGIC, sizeof(header.magic));
+  header.version = SCAN_INDEX_VERSION;
+  header.record_size = sizeof(scan_index_record_t);
+  header.record_count = builder->record_count;
+  header.strings_size = builder->strings_size;
+  size_t records_size =
+      (size_t)builder->record_count * sizeof(scan_index_record_t);
+  header.checksum = sm_fnv1a32_update(
+      sm_fnv1a32_update(SM_FNV1A32_INIT, builder->records, records_size),
+      builder->strings, builder->strings_size);
+
+  char tmp_path[MAX_PATH];
+  snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", SCAN_INDEX_FILE);
+  FILE *f = fopen(tmp_path, "wb");
+  if (!f) {
+    log_debug("  [INDEX] write open failed for %s: %s", tmp_path,
+              strerror(errno));
+    return false;
+  }
+
+  int saved_errno = 0;
+  if (fwrite(&header, sizeof(header), 1, f) != 1 ||
+      (records_size > 0 &&
+       fwrite(builder->records, records_size, 1, f) != 1) ||
+      (builder->strings_size > 0 &&
+       fwrite(builder->strings, builder->strings_size, 1, f) != 1)) {
+    saved_errno = errno;
+  }
+  if (fflush(f) != 0 && saved_errno == 0)
+    saved_errno = errno;
+  if (fclose(f) != 0 && saved_errno == 0)
+    saved_errno = errno;
+  if (saved_errno != 0) {
+    errno = saved_errno;
+    log_debug("  [INDEX] write failed for %s: %s", tmp_path, strerror(errno));
+    (void)unlink(tmp_path);
+    return false;
+  }
+
+  if (rename(tmp_path, SCAN_INDEX_FILE) != 0) {
+    log_debug("  [INDEX] rename failed for %s: %s", SCAN_INDEX_FILE,
+              strerror(errno));
+    (void)unlink(tmp_path);
+    return false;
+  }
+  return true;
+}
+
+bool save_scan_index(void) {
+  uint32_t generation = cached_game_info_generation();
+  if (g_scan_index_saved && generation == g_scan_index_saved_generation)
+    return true;
+
+  scan_index_builder_t builder;
+  memset(&builder, 0, sizeof(builder));
+  for_each_cached_game_info(add_scan_index_record, &builder);
+  bool ok = !builder.failed && write_scan_index_file(&builder);
+  if (ok) {
+    g_scan_index_saved_generation = generation;
+    g_scan_index_saved = true;
+    log_debug("  [INDEX] saved %u titles to %s", builder.record_count,
+              SCAN_INDEX_FILE);
+  }
+  free(builder.records);
+  free(builder.strings);
+  return ok;
+}
@@ -4,12 +4,17 @@
 #include "sm_config_mount.h"
 #include "sm_filesystem.h"
 #include "sm_image.h"
+#include "sm_limits.h"
+#include "sm_log.h"
+#include "sm_path_pool.h"
 #include "sm_path_utils.h"
 #include "sm_paths.h"
 #include "sm_runtime.h"
+#include "sm_state_table.h"
 
-static void classify_scan_tree_entry(const char *full_path, unsigned char d_type,
-                                     bool *is_dir_out, bool *is_regular_out) {
+static void classify_scan_tree_entry(int dir_fd, const char *name,
+                                     unsigned char d_type, bool *is_dir_out,
+                                     bool *is_regular_out) {
   bool is_dir = false;
   bool is_regular = false;
 
@@ -19,7 +24,7 @@ static void classify_scan_tree_entry(const char *full_path, unsigned char d_type
     is_regular = true;
   } else if (d_type == DT_UNKNOWN) {
     struct stat st;
-    if (lstat(full_path, &st) == 0) {
+    if (fstatat(dir_fd, name, &st, AT_SYMLINK_NOFOLLOW) == 0) {
       is_dir = S_ISDIR(st.st_mode);
       is_regular = S_ISREG(st.st_mode);
     }
@@ -43,82 +48,457 @@ static bool is_distinct_configured_scan_root(const char *current_scan_root,
   return false;
 }
 
-bool sm_scan_tree_walk(const char *scan_root, const char *dir_path,
-                       unsigned int depth_from_root,
-                       unsigned int remaining_depth,
-                       const sm_scan_tree_callbacks_t *callbacks, void *ctx) {
-  if (should_stop_requested() || runtime_sleep_mode_active())
-    return true;
+typedef struct {
+  uint64_t dev;
+  uint64_t inode;
+  uint64_t size;
+  uint64_t nlink;
+  uint64_t mtime_sec;
+  uint64_t mtime_nsec;
+  uint64_t ctime_sec;
+  uint64_t ctime_nsec;
+} scan_tree_dir_stamp_t;
 
-  if (depth_from_root > 0u &&
-      is_distinct_configured_scan_root(scan_root, dir_path)) {
+// Child kinds recorded in a fingerprinted directory listing.
+#define SCAN_TREE_ENTRY_DIR 'd'
+#define SCAN_TREE_ENTRY_FILE 'f'
+
+// Listing of a directory from an earlier walk, reused while its stamp holds.
+struct ScanTreeDirCache {
+  sm_path_id_t path;
+  scan_tree_dir_stamp_t stamp;
+  // Packed children: one SCAN_TREE_ENTRY_* byte, then the NUL-terminated name.
+  char *entries;
+  uint32_t entries_len;
+  uint32_t entry_count;
+  uint32_t walk_generation;
+  // Free entries (path == SM_PATH_ID_NONE) are chained through next_free.
+  int next_free;
+};
+
+static struct ScanTreeDirCache *g_scan_tree_cache = NULL;
+static int g_scan_tree_cache_capacity = 0;
+static int g_scan_tree_cache_count = 0;
+static int g_scan_tree_cache_free_head = -1;
+static size_t g_scan_tree_cache_entry_bytes = 0;
+static sm_state_index_t g_scan_tree_cache_index;
+static uint32_t g_scan_tree_walk_generation = 0;
+static bool g_scan_tree_cache_limit_logged = false;
+
+static uint32_t scan_tree_cache_hash(sm_path_id_t path) {
+  return path * 2654435761u;
+}
+
+static scan_tree_dir_stamp_t make_scan_tree_dir_stamp(const struct stat *st) {
+  scan_tree_dir_stamp_t stamp;
+  memset(&stamp, 0, sizeof(stamp));
+  stamp.dev = (uint64_t)st->st_dev;
+  stamp.inode = (uint64_t)st->st_ino;
+  stamp.size = (uint64_t)st->st_size;
+  stamp.nlink = (uint64_t)st->st_nlink;
+  stamp.mtime_sec = (uint64_t)st->st_mtim.tv_sec;
+  stamp.mtime_nsec = (uint64_t)st->st_mtim.tv_nsec;
+  stamp.ctime_sec = (uint64_t)st->st_ctim.tv_sec;
+  stamp.ctime_nsec = (uint64_t)st->st_ctim.tv_nsec;
+  return stamp;
+}
+
+static bool scan_tree_dir_stamp_equals(const scan_tree_dir_stamp_t *a,
+                                       const scan_tree_dir_stamp_t *b) {
+  return a->dev == b->dev && a->inode == b->inode && a->size == b->size &&
+         a->nlink == b->nlink && a->mtime_sec == b->mtime_sec &&
+         a->mtime_nsec == b->mtime_nsec && a->ctime_sec == b->ctime_sec &&
+         a->ctime_nsec == b->ctime_nsec;
+}
+
+static bool is_scan_tree_dir_stamp_racy(const scan_tree_dir_stamp_t *stamp) {
+  time_t now = time(NULL);
+  if (now == (time_t)-1)
     return true;
+  uint64_t newest = stamp->mtime_sec > stamp->ctime_sec ? stamp->mtime_sec
+                                                        : stamp->ctime_sec;
+  return newest + SCAN_TREE_RACY_SECONDS >= (uint64_t)now;
+}
+
+static int find_scan_tree_cache(sm_path_id_t path) {
+  if (path == SM_PATH_ID_NONE)
+    return -1;
+  uint32_t hash = scan_tree_cache_hash(path);
+  uint32_t cursor = 0;
+  int k;
+  while ((k = sm_state_index_next(&g_scan_tree_cache_index, hash, &cursor)) >=
+         0) {
+    if (g_scan_tree_cache[k].path == path)
+      return k;
   }
+  return -1;
+}
 
-  sm_scan_tree_dir_visit_t dir_visit = SM_SCAN_TREE_DIR_DESCEND;
-  if (callbacks->on_directory) {
-    dir_visit = callbacks->on_directory(dir_path, depth_from_root, ctx);
-    if (dir_visit == SM_SCAN_TREE_DIR_ABORT)
+static void remove_scan_tree_cache(int k) {
+  struct ScanTreeDirCache *entry = &g_scan_tree_cache[k];
+  sm_state_index_remove(&g_scan_tree_cache_index,
+                        scan_tree_cache_hash(entry->path), k);
+  sm_path_release(entry->path);
+  g_scan_tree_cache_entry_bytes -= entry->entries_len;
+  free(entry->entries);
+  memset(entry, 0, sizeof(*entry));
+  entry->next_free = g_scan_tree_cache_free_head;
+  g_scan_tree_cache_free_head = k;
+  g_scan_tree_cache_count--;
+}
+
+static int alloc_scan_tree_cache(void) {
+  if (g_scan_tree_cache_free_head < 0) {
+    int old_capacity = g_scan_tree_cache_capacity;
+    if (!sm_state_table_reserve((void **)&g_scan_tree_cache,
+                                &g_scan_tree_cache_capacity, old_capacity + 1,
+                                sizeof(*g_scan_tree_cache))) {
+      if (!g_scan_tree_cache_limit_logged) {
+        log_debug("  [SCAN] directory fingerprint cache full (%d entries)",
+                  g_scan_tree_cache_capacity);
+        g_scan_tree_cache_limit_logged = true;
+      }
+      return -1;
+    }
+    for (int k = g_scan_tree_cache_capacity - 1; k >= old_capacity; k--) {
+      g_scan_tree_cache[k].next_free = g_scan_tree_cache_free_head;
+      g_scan_tree_cache_free_head = k;
+    }
+  }
+
+  int k = g_scan_tree_cache_free_head;
+  g_scan_tree_cache_free_head = g_scan_tree_cache[k].next_free;
+  g_scan_tree_cache[k].next_free = -1;
+  return k;
+}
+
+// Copy the cached listing of path if its stamp still matches.
+static char *copy_scan_tree_cache_entries(const char *path,
+                                          const scan_tree_dir_stamp_t *stamp,
+                                          uint32_t generation,
+                                          uint32_t *entries_len_out) {
+  sm_path_id_t path_id = sm_path_lookup(path);
+  int k = find_scan_tree_cache(path_id);
+  sm_path_release(path_id);
+  if (k < 0)
+    return NULL;
+
+  struct ScanTreeDirCache *entry = &g_scan_tree_cache[k];
+  if (!scan_tree_dir_stamp_equals(&entry->stamp, stamp)) {
+    remove_scan_tree_cache(k);
+    return NULL;
+  }
+
+  char *entries = malloc(entry->entries_len ? entry->entries_len : 1u);
+  if (!entries)
+    return NULL;
+  memcpy(entries, entry->entries, entry->entries_len);
+  entry->walk_generation = generation;
+  *entries_len_out = entry->entries_len;
+  return entries;
+}
+
+// Take ownership of entries and remember them as the listing of path.
+static void store_scan_tree_cache_entries(const char *path,
+                                          const scan_tree_dir_stamp_t *stamp,
+                                          uint32_t generation, char *entries,
+                                          uint32_t entries_len,
+                                          uint32_t entry_count) {
+  sm_path_id_t path_id = sm_path_intern(path);
+  if (path_id == SM_PATH_ID_NONE) {
+    free(entries);
+    return;
+  }
+
+  int k = find_scan_tree_cache(path_id);
+  if (k >= 0) {
+    // The pool already held a reference for this entry.
+    sm_path_release(path_id);
+  } else {
+    k = alloc_scan_tree_cache();
+    if (k < 0) {
+      sm_path_release(path_id);
+      free(entries);
+      return;
+    }
+    if (!sm_state_index_insert(&g_scan_tree_cache_index,
+                               scan_tree_cache_hash(path_id), k)) {
+      g_scan_tree_cache[k].next_free = g_scan_tree_cache_free_head;
+      g_scan_tree_cache_free_head = k;
+      sm_path_release(path_id);
+      free(entries);
+      return;
+    }
+    g_scan_tree_cache[k].path = path_id;
+    g_scan_tree_cache_count++;
+  }
+
+  struct ScanTreeDirCache *entry = &g_scan_tree_cache[k];
+  g_scan_tree_cache_entry_bytes -= entry->entries_len;
+  free(entry->entries);
+  entry->stamp = *stamp;
+  entry->entries = entries;
+  entry->entries_len = entries_len;
+  entry->entry_count = entry_count;
+  entry->walk_generation = generation;
+  g_scan_tree_cache_entry_bytes += entries_len;
+}
+
+// Drop listings at or below root that the walk of root did not reach.
+static void prune_scan_tree_cache(const char *root, uint32_t generation) {
+  for (int k = 0; k < g_scan_tree_cache_capacity; k++) {
+    struct ScanTreeDirCache *entry = &g_scan_tree_cache[k];
+    if (entry->path != SM_PATH_ID_NONE &&
+        entry->walk_generation != generation &&
+        path_matches_root_or_child(sm_path_str(entry->path), root)) {
+      remove_scan_tree_cache(k);
+    }
+  }
+}
+
+static bool append_scan_tree_listing(char **entries, uint32_t *len,
+                                     uint32_t *capacity, char kind,
+                                     const char *name, size_t name_len) {
+  uint32_t needed = *len + 1u + (uint32_t)name_len + 1u;
+  if (needed > *capacity) {
+    uint32_t new_capacity = *capacity ? *capacity : 1024u;
+    while (new_capacity < needed)
+      new_capacity *= 2u;
+    char *grown = realloc(*entries, new_capacity);
+    if (!grown)
       return false;
-    if (dir_visit == SM_SCAN_TREE_DIR_SKIP_DESCEND)
-      return true;
+    *entries = grown;
+    *capacity = new_capacity;
   }
+  (*entries)[*len] = kind;
+  memcpy(&(*entries)[*len + 1u], name, name_len + 1u);
+  *len = needed;
+  return true;
+}
+
+typedef struct {
+  const char *scan_root;
+  const sm_scan_tree_callbacks_t *callbacks;
+  void *ctx;
+  bool skip_backports_root;
+  bool allow_image_file_visits;
+  uint32_t generation;
+  // Path of the directory being walked; children are appended in place.
+  char path[MAX_PATH];
+} scan_tree_walk_t;
 
-  if (remaining_depth == 0u)
+static bool walk_scan_tree_fd(scan_tree_walk_t *walk, int dir_fd,
+                              size_t path_len, unsigned int depth_from_root,
+                              unsigned int remaining_depth);
+
+// Visit one child of the directory open on parent_fd. Returns false when a
+// callback aborts the walk.
+static bool visit_scan_tree_entry(scan_tree_walk_t *walk, int parent_fd,
+                                  const char *name, bool is_dir,
+                                  bool is_regular, size_t path_len,
+                                  unsigned int depth_from_root,
+                                  unsigned int remaining_depth) {
+  if (depth_from_root == 0u && walk->skip_backports_root &&
+      strcmp(name, DEFAULT_BACKPORTS_DIR_NAME) == 0) {
     return true;
+  }
 
-  DIR *d = opendir(dir_path);
-  if (!d)
+  size_t name_len = strlen(name);
+  if (path_len + 1u + name_len >= sizeof(walk->path))
     return true;
+  walk->path[path_len] = '/';
+  memcpy(&walk->path[path_len + 1u], name, name_len + 1u);
+  size_t child_len = path_len + 1u + name_len;
 
-  bool scan_root_is_pfsc_mount_base =
-      is_pfsc_image_mount_base_or_child(scan_root);
-  bool skip_backports_root =
-      (depth_from_root == 0u && !is_under_image_mount_base(scan_root));
-  bool allow_image_file_visits =
-      callbacks->on_image_file &&
-      (!path_matches_root_or_child(scan_root, IMAGE_MOUNT_BASE) ||
-       scan_root_is_pfsc_mount_base);
+  bool ok = true;
+  if (walk->allow_image_file_visits && is_regular &&
+      is_supported_image_file_path(walk->path, name)) {
+    ok = walk->callbacks->on_image_file(parent_fd, walk->path, name,
+                                        depth_from_root + 1u, walk->ctx);
+  }
+
+  if (ok && is_dir &&
+      !is_distinct_configured_scan_root(walk->scan_root, walk->path)) {
+    int child_fd = openat(parent_fd, name, O_RDONLY | O_DIRECTORY);
+    if (child_fd >= 0)
+      ok = walk_scan_tree_fd(walk, child_fd, child_len, depth_from_root + 1u,
+                             remaining_depth - 1u);
+  }
+
+  walk->path[path_len] = '\0';
+  return ok;
+}
+
+// Replay a fingerprinted listing instead of reading the directory again.
+static bool replay_scan_tree_listing(scan_tree_walk_t *walk, int dir_fd,
+                                     const char *entries,
+                                     uint32_t entries_len, size_t path_len,
+                                     unsigned int depth_from_root,
+                                     unsigned int remaining_depth) {
+  uint32_t pos = 0;
+  while (pos < entries_len) {
+    if (should_stop_requested() || runtime_sleep_mode_active())
+      return true;
+    char kind = entries[pos];
+    const char *name = &entries[pos + 1u];
+    pos += 1u + (uint32_t)strlen(name) + 1u;
+    if (!visit_scan_tree_entry(walk, dir_fd, name, kind == SCAN_TREE_ENTRY_DIR,
+                               kind == SCAN_TREE_ENTRY_FILE, path_len,
+                               depth_from_root, remaining_depth)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Read the directory, visiting children and recording a listing for the
+// fingerprint cache when stamp is set.
+static bool read_scan_tree_listing(scan_tree_walk_t *walk, DIR *d,
+                                   const scan_tree_dir_stamp_t *stamp,
+                                   size_t path_len,
+                                   unsigned int depth_from_root,
+                                   unsigned int remaining_depth) {
+  char *entries = NULL;
+  uint32_t entries_len = 0;
+  uint32_t entries_capacity = 0;
+  uint32_t entry_count = 0;
+  bool record = stamp != NULL;
+  bool complete = true;
+  bool ok = true;
 
   struct dirent *entry;
   while ((entry = readdir(d)) != NULL) {
     if (should_stop_requested() || runtime_sleep_mode_active()) {
-      closedir(d);
-      return true;
+      complete = false;
+      break;
     }
     if (entry->d_name[0] == '.')
       continue;
-    if (skip_backports_root &&
-        strcmp(entry->d_name, DEFAULT_BACKPORTS_DIR_NAME) == 0) {
+
+    bool is_dir = false;
+    bool is_regular = false;
+    classify_scan_tree_entry(dirfd(d), entry->d_name, entry->d_type, &is_dir,
+                             &is_regular);
+    if (!is_dir && !is_regular)
       continue;
+
+    if (record) {
+      record = append_scan_tree_listing(
+          &entries, &entries_len, &entries_capacity,
+          is_dir ? SCAN_TREE_ENTRY_DIR : SCAN_TREE_ENTRY_FILE, entry->d_name,
+          strlen(entry->d_name));
+      entry_count++;
     }
 
-    char full_path[MAX_PATH];
-    snprintf(full_path, sizeof(full_path), "%s/%s", dir_path, entry->d_name);
+    if (!visit_scan_tree_entry(walk, dirfd(d), entry->d_name, is_dir,
+                               is_regular, path_len, depth_from_root,
+                               remaining_depth)) {
+      ok = false;
+      break;
+    }
+  }
 
-    bool is_dir = false;
-    bool is_regular = false;
-    classify_scan_tree_entry(full_path, entry->d_type, &is_dir, &is_regular);
-
-    if (allow_image_file_visits && is_regular &&
-        is_supported_image_file_path(full_path, entry->d_name)) {
-      if (!callbacks->on_image_file(full_path, entry->d_name, depth_from_root + 1u,
-                                    ctx)) {
-        closedir(d);
-        return false;
-      }
+  if (ok && complete && record)
+    store_scan_tree_cache_entries(walk->path, stamp, walk->generation, entries,
+                                  entries_len, entry_count);
+  else
+    free(entries);
+  return ok;
+}
+
+// Walk the directory open on dir_fd, whose path is walk->path[0..path_len).
+// Takes ownership of dir_fd.
+static bool walk_scan_tree_fd(scan_tree_walk_t *walk, int dir_fd,
+                              size_t path_len, unsigned int depth_from_root,
+                              unsigned int remaining_depth) {
+  const sm_scan_tree_callbacks_t *callbacks = walk->callbacks;
+  if (callbacks->on_directory) {
+    sm_scan_tree_dir_visit_t dir_visit = callbacks->on_directory(
+        dir_fd, walk->path, depth_from_root, walk->ctx);
+    if (dir_visit != SM_SCAN_TREE_DIR_DESCEND) {
+      close(dir_fd);
+      return dir_visit != SM_SCAN_TREE_DIR_ABORT;
     }
+  }
 
-    if (!is_dir)
-      continue;
+  if (remaining_depth == 0u) {
+    close(dir_fd);
+    return true;
+  }
 
-    if (!sm_scan_tree_walk(scan_root, full_path, depth_from_root + 1u,
-                           remaining_depth - 1u, callbacks, ctx)) {
-      closedir(d);
-      return false;
+  struct stat dir_st;
+  scan_tree_dir_stamp_t stamp;
+  bool have_stamp = fstat(dir_fd, &dir_st) == 0;
+  if (have_stamp) {
+    stamp = make_scan_tree_dir_stamp(&dir_st);
+    uint32_t entries_len = 0;
+    char *entries = copy_scan_tree_cache_entries(walk->path, &stamp,
+                                                 walk->generation, &entries_len);
+    if (entries) {
+      bool ok = replay_scan_tree_listing(walk, dir_fd, entries, entries_len,
+                                         path_len, depth_from_root,
+                                         remaining_depth);
+      free(entries);
+      close(dir_fd);
+      return ok;
     }
+    have_stamp = !is_scan_tree_dir_stamp_racy(&stamp);
   }
 
+  DIR *d = fdopendir(dir_fd);
+  if (!d) {
+    close(dir_fd);
+    return true;
+  }
+
+  bool ok = read_scan_tree_listing(walk, d, have_stamp ? &stamp : NULL,
+                                   path_len, depth_from_root, remaining_depth);
   closedir(d);
-  return true;
+  return ok;
+}
+
+bool sm_scan_tree_walk(const char *scan_root, const char *dir_path,
+                       unsigned int depth_from_root,
+                       unsigned int remaining_depth,
+                       const sm_scan_tree_callbacks_t *callbacks, void *ctx) {
+  if (should_stop_requested() || runtime_sleep_mode_active())
+    return true;
+
+  if (depth_from_root > 0u &&
+      is_distinct_configured_scan_root(scan_root, dir_path)) {
+    return true;
+  }
+
+  scan_tree_walk_t walk;
+  size_t path_len = strlcpy(walk.path, dir_path, sizeof(walk.path));
+  if (path_len >= sizeof(walk.path))
+    return true;
+
+  int dir_fd = open(dir_path, O_RDONLY | O_DIRECTORY);
+  if (dir_fd < 0)
+    return true;
+
+  walk.scan_root = scan_root;
+  walk.callbacks = callbacks;
+  walk.ctx = ctx;
+  walk.skip_backports_root = !is_under_image_mount_base(scan_root);
+  walk.allow_image_file_visits =
+      callbacks->on_image_file &&
+      (!path_matches_root_or_child(scan_root, IMAGE_MOUNT_BASE) ||
+       is_pfsc_image_mount_base_or_child(scan_root));
+  walk.generation = ++g_scan_tree_walk_generation;
+  bool ok = walk_scan_tree_fd(&walk, dir_fd, path_len, depth_from_root,
+                              remaining_depth);
+  if (ok && !should_stop_requested() && !runtime_sleep_mode_active())
+    prune_scan_tree_cache(dir_path, walk.generation);
+  return ok;
+}
+
+void scan_tree_cache_memory_usage(sm_state_table_usage_t *out) {
+  out->name = "scan_tree_cache";
+  out->count = g_scan_tree_cache_count;
+  out->capacity = g_scan_tree_cache_capacity;
+  out->bytes = (size_t)g_scan_tree_cache_capacity * sizeof(*g_scan_tree_cache) +
+               sm_state_index_bytes(&g_scan_tree_cache_index) +
+               g_scan_tree_cache_entry_bytes;
 }
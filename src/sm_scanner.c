@@ -12,17 +12,24 @@
 #include "sm_game_lifecycle.h"
 #include "sm_hash.h"
 #include "sm_image.h"
+#include "sm_image_attach_pool.h"
+#include "sm_image_ondemand.h"
 #include "sm_install.h"
 #include "sm_install_queue.h"
 #include "sm_kstuff.h"
 #include "sm_limits.h"
 #include "sm_log.h"
+#include "sm_mount_device.h"
+#include "sm_mount_stats.h"
+#include "sm_path_pool.h"
 #include "sm_path_utils.h"
 #include "sm_paths.h"
 #include "sm_runtime.h"
 #include "sm_scan.h"
+#include "sm_scan_index.h"
 #include "sm_scan_tree.h"
 #include "sm_scanner.h"
+#include "sm_state_table.h"
 #include "sm_time.h"
 #include "sm_types.h"
 
@@ -49,7 +56,7 @@ typedef struct {
   scanner_watch_kind_t kind;
   size_t prev_root_watch_index;
   size_t next_root_watch_index;
-  char path[MAX_PATH];
+  sm_path_id_t path;
 } scanner_watch_entry_t;
 
 typedef struct {
@@ -69,7 +76,8 @@ static int g_scanner_wake_pipe[2] = {-1, -1};
 static int g_scanner_config_fd = -1;
 static int g_scanner_manual_fd = -1;
 static volatile sig_atomic_t g_scanner_wake_write_fd = -1;
-static scan_candidate_t g_scanner_scan_candidates[MAX_PENDING];
+static scan_candidate_list_t g_scanner_scan_candidates;
+static uint32_t g_scanner_reported_state_growth = 0;
 static scanner_watch_entry_t *g_scanner_watch_entries = NULL;
 static size_t g_scanner_watch_count = 0;
 static size_t g_scanner_watch_capacity = 0;
@@ -164,6 +172,7 @@ static void clear_scanner_watch_entries(void) {
   for (size_t i = 0; i < g_scanner_watch_count; i++) {
     if (g_scanner_watch_entries[i].fd >= 0)
       close(g_scanner_watch_entries[i].fd);
+    sm_path_release(g_scanner_watch_entries[i].path);
   }
   free(g_scanner_watch_entries);
   free(g_scanner_watch_fd_index);
@@ -360,15 +369,18 @@ static void rebind_scanner_watch_entry_root_index(size_t old_index,
   }
 }
 
-static bool register_scanner_watch_entry(int kq, int scan_root_index,
-                                         const char *path,
-                                         scanner_watch_kind_t kind,
-                                         uint8_t depth) {
+// Open name relative to at_fd (AT_FDCWD with a full path outside tree walks)
+// and register a vnode watch on it; path is what the entry records.
+static bool register_scanner_watch_entry_at(int kq, int scan_root_index,
+                                            int at_fd, const char *name,
+                                            const char *path,
+                                            scanner_watch_kind_t kind,
+                                            uint8_t depth) {
   int open_flags = O_RDONLY;
   if (kind != SCANNER_WATCH_SCAN_IMAGE_FILE)
     open_flags |= O_DIRECTORY;
 
-  int fd = open(path, open_flags);
+  int fd = openat(at_fd, name, open_flags);
   if (fd < 0) {
     if (errno != ENOENT && errno != ENOTDIR) {
       log_debug("  [SCAN] watcher open failed for %s: %s", path,
@@ -377,11 +389,15 @@ static bool register_scanner_watch_entry(int kq, int scan_root_index,
     return true;
   }
 
-  if (!ensure_scanner_watch_capacity(g_scanner_watch_count + 1u)) {
+  sm_path_id_t path_id = sm_path_intern(path);
+  if (path_id == SM_PATH_ID_NONE ||
+      !ensure_scanner_watch_capacity(g_scanner_watch_count + 1u)) {
+    sm_path_release(path_id);
     close(fd);
     return false;
   }
   if (!ensure_scanner_watch_fd_index_capacity(g_scanner_watch_count + 1u)) {
+    sm_path_release(path_id);
     close(fd);
     return false;
   }
@@ -394,6 +410,7 @@ static bool register_scanner_watch_entry(int kq, int scan_root_index,
   if (kevent(kq, &kev, 1, NULL, 0, NULL) != 0) {
     log_debug("  [SCAN] watcher registration failed for %s: %s", path,
               strerror(errno));
+    sm_path_release(path_id);
     close(fd);
     return false;
   }
@@ -406,11 +423,12 @@ static bool register_scanner_watch_entry(int kq, int scan_root_index,
   entry->kind = kind;
   entry->prev_root_watch_index = SCANNER_WATCH_INDEX_NONE;
   entry->next_root_watch_index = SCANNER_WATCH_INDEX_NONE;
-  (void)strlcpy(entry->path, path, sizeof(entry->path));
+  entry->path = path_id;
   link_scanner_watch_entry_to_root(g_scanner_watch_count - 1u);
   if (!insert_scanner_watch_fd_index_entry((uintptr_t)fd,
                                            g_scanner_watch_count - 1u)) {
     unlink_scanner_watch_entry_from_root(g_scanner_watch_count - 1u);
+    sm_path_release(entry->path);
     memset(entry, 0, sizeof(*entry));
     close(fd);
     g_scanner_watch_count--;
@@ -420,6 +438,14 @@ static bool register_scanner_watch_entry(int kq, int scan_root_index,
   return true;
 }
 
+static bool register_scanner_watch_entry(int kq, int scan_root_index,
+                                         const char *path,
+                                         scanner_watch_kind_t kind,
+                                         uint8_t depth) {
+  return register_scanner_watch_entry_at(kq, scan_root_index, AT_FDCWD, path,
+                                         path, kind, depth);
+}
+
 static void remove_scanner_watch_entry_at(size_t index) {
   if (index >= g_scanner_watch_count)
     return;
@@ -427,6 +453,7 @@ static void remove_scanner_watch_entry_at(size_t index) {
   unlink_scanner_watch_entry_from_root(index);
   if (g_scanner_watch_entries[index].fd >= 0)
     close(g_scanner_watch_entries[index].fd);
+  sm_path_release(g_scanner_watch_entries[index].path);
 
   size_t last_index = g_scanner_watch_count - 1u;
   if (index != last_index) {
@@ -453,7 +480,8 @@ static bool remove_scan_root_watch_entries_for_path(int scan_root_index,
   size_t index = g_scanner_root_watch_heads[scan_root_index];
   bool removed_any = false;
   while (index != SCANNER_WATCH_INDEX_NONE) {
-    if (path_matches_root_or_child(g_scanner_watch_entries[index].path, path)) {
+    if (path_matches_root_or_child(
+            sm_path_str(g_scanner_watch_entries[index].path), path)) {
       remove_scanner_watch_entry_at(index);
       removed_any = true;
       index = g_scanner_root_watch_heads[scan_root_index];
@@ -559,7 +587,7 @@ static bool resolve_watch_tree_rebuild_target(const scanner_watch_entry_t *entry
   case SCANNER_WATCH_SCAN_ROOT:
   case SCANNER_WATCH_SCAN_BACKPORT_ROOT:
   case SCANNER_WATCH_SCAN_SUBDIR:
-    (void)strlcpy(rebuild_path, entry->path, MAX_PATH);
+    (void)strlcpy(rebuild_path, sm_path_str(entry->path), MAX_PATH);
     *rebuild_depth_out = entry->depth;
     *kind_out = entry->kind;
     return true;
@@ -570,7 +598,7 @@ static bool resolve_watch_tree_rebuild_target(const scanner_watch_entry_t *entry
     *kind_out = SCANNER_WATCH_SCAN_ROOT;
     return true;
   case SCANNER_WATCH_SCAN_IMAGE_FILE:
-    if (!build_parent_directory_path(entry->path, rebuild_path))
+    if (!build_parent_directory_path(sm_path_str(entry->path), rebuild_path))
       return false;
     *rebuild_depth_out = (entry->depth > 0u) ? (uint8_t)(entry->depth - 1u) : 0u;
     *kind_out =
@@ -587,29 +615,29 @@ typedef struct {
 } register_watch_tree_ctx_t;
 
 static sm_scan_tree_dir_visit_t register_watch_directory_visit(
-    const char *dir_path, unsigned int depth_from_root, void *ctx_ptr) {
+    int dir_fd, const char *dir_path, unsigned int depth_from_root,
+    void *ctx_ptr) {
   register_watch_tree_ctx_t *ctx = (register_watch_tree_ctx_t *)ctx_ptr;
   scanner_watch_kind_t kind =
       (depth_from_root == 0u) ? SCANNER_WATCH_SCAN_ROOT
                               : SCANNER_WATCH_SCAN_SUBDIR;
-  if (!register_scanner_watch_entry(ctx->kq, ctx->scan_root_index, dir_path, kind,
-                                    (uint8_t)depth_from_root)) {
+  if (!register_scanner_watch_entry_at(ctx->kq, ctx->scan_root_index, dir_fd,
+                                       ".", dir_path, kind,
+                                       (uint8_t)depth_from_root)) {
     return SM_SCAN_TREE_DIR_ABORT;
   }
 
   return SM_SCAN_TREE_DIR_DESCEND;
 }
 
-static bool register_watch_image_visit(const char *image_path,
+static bool register_watch_image_visit(int parent_fd, const char *image_path,
                                        const char *image_name,
                                        unsigned int depth_from_root,
                                        void *ctx_ptr) {
-  (void)image_name;
-
   register_watch_tree_ctx_t *ctx = (register_watch_tree_ctx_t *)ctx_ptr;
-  return register_scanner_watch_entry(ctx->kq, ctx->scan_root_index, image_path,
-                                      SCANNER_WATCH_SCAN_IMAGE_FILE,
-                                      (uint8_t)depth_from_root);
+  return register_scanner_watch_entry_at(
+      ctx->kq, ctx->scan_root_index, parent_fd, image_name, image_path,
+      SCANNER_WATCH_SCAN_IMAGE_FILE, (uint8_t)depth_from_root);
 }
 
 static bool register_scan_root_parent_watch(int kq, int scan_root_index,
@@ -949,9 +977,24 @@ static bool should_abort_scan_cycle(void) {
   return should_stop_requested() || runtime_sleep_mode_active();
 }
 
+// Let the lifecycle watcher pick up idle timers of images a scan attached.
+static void wake_image_idle_timer(void) {
+  if (sm_image_ondemand_consume_timer_change() && sm_image_ondemand_enabled())
+    wake_game_lifecycle_watcher();
+}
+
+// Report table sizes only after a cycle made one of them grow.
+static void report_state_growth(const char *reason) {
+  uint32_t growth = sm_state_table_growth_count();
+  if (growth == g_scanner_reported_state_growth)
+    return;
+  g_scanner_reported_state_growth = growth;
+  log_state_memory_budget(reason, &g_scanner_scan_candidates);
+}
+
 static bool run_full_scan_cycle(bool startup_sync, const char *reason,
                                 bool *unstable_found_out) {
-  scan_candidate_t *candidates = g_scanner_scan_candidates;
+  scan_candidate_list_t *candidates = &g_scanner_scan_candidates;
 
   log_immediate_scan_reason(reason);
 
@@ -965,8 +1008,7 @@ static bool run_full_scan_cycle(bool startup_sync, const char *reason,
 
   int total_found_games = 0;
   int *total_found_ptr = startup_sync ? &total_found_games : NULL;
-  int candidate_count = collect_scan_candidates(candidates, MAX_PENDING,
-                                                total_found_ptr,
+  int candidate_count = collect_scan_candidates(candidates, total_found_ptr,
                                                 &unstable_found);
   if (should_abort_scan_cycle())
     return false;
@@ -974,14 +1016,18 @@ static bool run_full_scan_cycle(bool startup_sync, const char *reason,
   if (candidate_count > 0 && startup_sync) {
     int new_games = 0;
     for (int i = 0; i < candidate_count; i++) {
-      if (!candidates[i].installed)
+      if (!candidates->items[i].installed)
         new_games++;
     }
     if (new_games > 0)
       notify_system_info("Found %d new games. Executing...", new_games);
   }
 
-  process_scan_candidates(candidates, candidate_count);
+  process_scan_candidates(candidates->items, candidate_count);
+  report_state_growth("scan");
+  log_dev_node_wait_stats();
+  sm_mount_stats_poll_request();
+  wake_image_idle_timer();
   if (should_abort_scan_cycle())
     return false;
 
@@ -989,12 +1035,14 @@ static bool run_full_scan_cycle(bool startup_sync, const char *reason,
   if (should_abort_scan_cycle())
     return false;
 
+  (void)save_scan_index();
   if (unstable_found_out)
     *unstable_found_out = unstable_found;
 
   if (startup_sync && !should_abort_scan_cycle()) {
     notify_system_rich(true, "Library Synchronized.\nFound %d games.",
                        total_found_games);
+    sm_mount_stats_dump("startup");
   }
 
   return !should_abort_scan_cycle();
@@ -1003,7 +1051,7 @@ static bool run_full_scan_cycle(bool startup_sync, const char *reason,
 static bool run_targeted_scan_cycle(int scan_root_index,
                                     bool *unstable_found_out) {
   const char *scan_root = get_scan_path(scan_root_index);
-  scan_candidate_t *candidates = g_scanner_scan_candidates;
+  scan_candidate_list_t *candidates = &g_scanner_scan_candidates;
 
   log_debug("[SCAN] running targeted scan for %s", scan_root);
 
@@ -1016,11 +1064,15 @@ static bool run_targeted_scan_cycle(int scan_root_index,
     return false;
 
   int candidate_count = collect_scan_candidates_for_scan_root(
-      scan_root, candidates, MAX_PENDING, NULL, &unstable_found);
+      scan_root, candidates, NULL, &unstable_found);
   if (should_abort_scan_cycle())
     return false;
 
-  process_scan_candidates(candidates, candidate_count);
+  process_scan_candidates(candidates->items, candidate_count);
+  report_state_growth("scan");
+  log_dev_node_wait_stats();
+  sm_mount_stats_poll_request();
+  wake_image_idle_timer();
   if (should_abort_scan_cycle())
     return false;
 
@@ -1028,6 +1080,7 @@ static bool run_targeted_scan_cycle(int scan_root_index,
   if (should_abort_scan_cycle())
     return false;
 
+  (void)save_scan_index();
   if (unstable_found_out)
     *unstable_found_out = unstable_found;
 
@@ -1151,10 +1204,13 @@ static bool handle_scan_root_parent_event(
   }
 
   char parent_path[MAX_PATH];
-  if (!resolve_existing_parent_directory_path(scan_root, parent_path) ||
-      strcmp(parent_path, entry->path) != 0) {
+  if (!resolve_existing_parent_directory_path(scan_root, parent_path))
+    return rebuild_scan_root_watch_tree(kq, entry->scan_root_index);
+  sm_path_id_t parent_id = sm_path_lookup(parent_path);
+  bool parent_moved = parent_id != entry->path;
+  sm_path_release(parent_id);
+  if (parent_moved)
     return rebuild_scan_root_watch_tree(kq, entry->scan_root_index);
-  }
 
   return true;
 }
@@ -1278,6 +1334,7 @@ static void request_scanner_shutdown(const char *reason) {
 }
 
 bool sm_scanner_init(void) {
+  set_image_bookkeeping_thread();
   close_scanner_wake_pipe();
   close_scanner_config_file();
   close_scanner_manual_file();
@@ -1325,6 +1382,12 @@ void sm_scanner_wake(void) {
 }
 
 bool sm_scanner_run_startup_sync(void) {
+  // Titles whose param.json is unchanged since the last session are taken
+  // from the index; the sync below still revalidates every source.
+  int indexed_titles = load_scan_index();
+  if (indexed_titles > 0)
+    log_debug("[STARTUP] scan index: %d known titles", indexed_titles);
+
   while (!should_stop_requested()) {
     while (runtime_sleep_mode_active() && !should_stop_requested())
       sceKernelUsleep(200000);
@@ -1661,6 +1724,7 @@ void sm_scanner_run_loop(void) {
 }
 
 void sm_scanner_shutdown(void) {
+  image_attach_pool_stop();
   clear_scanner_watch_entries();
   close_scanner_config_file();
   close_scanner_manual_file();
@@ -0,0 +1,326 @@
+#include "sm_platform.h"
+#include "sm_stage_manifest.h"
+
+#include "sm_asset_store.h"
+#include "sm_log.h"
+
+// Line layout after the "# smp-stage-manifest <version>" header:
+//   <src_size> <mtime_sec> <mtime_nsec> <src_hash hex> <dst_size> <rel_path>
+
+static stage_manifest_entry_t *find_stage_entry(stage_manifest_t *manifest,
+                                                const char *rel_path) {
+  for (int i = 0; i < manifest->count; i++) {
+    if (strcmp(manifest->entries[i].rel_path, rel_path) == 0)
+      return &manifest->entries[i];
+  }
+  return NULL;
+}
+
+static stage_manifest_entry_t *add_stage_entry(stage_manifest_t *manifest,
+                                               const char *rel_path) {
+  if (manifest->count == manifest->capacity) {
+    int capacity = manifest->capacity ? manifest->capacity * 2 : 32;
+    stage_manifest_entry_t *entries = (stage_manifest_entry_t *)realloc(
+        manifest->entries, (size_t)capacity * sizeof(*entries));
+    if (!entries)
+      return NULL;
+    manifest->entries = entries;
+    manifest->capacity = capacity;
+  }
+  stage_manifest_entry_t *entry = &manifest->entries[manifest->count++];
+  memset(entry, 0, sizeof(*entry));
+  (void)strlcpy(entry->rel_path, rel_path, sizeof(entry->rel_path));
+  return entry;
+}
+
+void load_stage_manifest(const char *manifest_path, const char *dst_root,
+                         stage_manifest_t *out) {
+  memset(out, 0, sizeof(*out));
+  (void)strlcpy(out->path, manifest_path, sizeof(out->path));
+  (void)strlcpy(out->dst_root, dst_root, sizeof(out->dst_root));
+
+  FILE *f = fopen(manifest_path, "r");
+  if (!f)
+    return;
+  char line[MAX_PATH + 128];
+  int version = 0;
+  if (!fgets(line, sizeof(line), f) ||
+      sscanf(line, "# smp-stage-manifest %d", &version) != 1 ||
+      version != STAGE_MANIFEST_VERSION) {
+    fclose(f);
+    return;
+  }
+  while (fgets(line, sizeof(line), f)) {
+    unsigned long long src_size = 0;
+    long long mtime_sec = 0;
+    long mtime_nsec = 0;
+    unsigned long long src_hash = 0;
+    unsigned long long dst_size = 0;
+    int rel_start = 0;
+    if (sscanf(line, "%llu %lld %ld %llx %llu %n", &src_size, &mtime_sec,
+               &mtime_nsec, &src_hash, &dst_size, &rel_start) != 5 ||
+        rel_start <= 0) {
+      continue;
+    }
+    char *rel_path = line + rel_start;
+    rel_path[strcspn(rel_path, "\r\n")] = '\0';
+    if (rel_path[0] == '\0' || rel_path[0] == '/' ||
+        strstr(rel_path, "..") != NULL) {
+      continue;
+    }
+    stage_manifest_entry_t *entry = add_stage_entry(out, rel_path);
+    if (!entry)
+      break;
+    entry->src_size = src_size;
+    entry->src_mtime_sec = mtime_sec;
+    entry->src_mtime_nsec = mtime_nsec;
+    entry->src_hash = src_hash;
+    entry->dst_size = dst_size;
+  }
+  fclose(f);
+}
+
+static bool build_stage_path(char *out, size_t out_size, const char *dir,
+                             const char *name) {
+  int written = dir[0] != '\0' ? snprintf(out, out_size, "%s/%s", dir, name)
+                               : snprintf(out, out_size, "%s", name);
+  return written >= 0 && (size_t)written < out_size;
+}
+
+// True when the staged copy still matches what the entry recorded for src.
+static bool stage_entry_is_current(stage_manifest_entry_t *entry,
+                                   const char *src, const struct stat *src_st,
+                                   const char *dst, bool *refreshed_out) {
+  struct stat dst_st;
+  if (stat(dst, &dst_st) != 0 || !S_ISREG(dst_st.st_mode) ||
+      (uint64_t)dst_st.st_size != entry->dst_size ||
+      (uint64_t)src_st->st_size != entry->src_size) {
+    return false;
+  }
+  if ((int64_t)src_st->st_mtim.tv_sec == entry->src_mtime_sec &&
+      src_st->st_mtim.tv_nsec == entry->src_mtime_nsec) {
+    return true;
+  }
+  // Same size, new mtime: a touched but identical file only costs a read.
+  uint64_t hash = 0;
+  if (!sm_copy_hash_file(src, &hash) || hash != entry->src_hash)
+    return false;
+  entry->src_mtime_sec = (int64_t)src_st->st_mtim.tv_sec;
+  entry->src_mtime_nsec = src_st->st_mtim.tv_nsec;
+  *refreshed_out = true;
+  return true;
+}
+
+static bool queue_stage_copy(stage_manifest_t *manifest, const char *src,
+                             const struct stat *src_st, const char *rel_path,
+                             const char *dst) {
+  if (manifest->pending_count == manifest->pending_capacity) {
+    int capacity =
+        manifest->pending_capacity ? manifest->pending_capacity * 2 : 16;
+    sm_copy_job_t *jobs = (sm_copy_job_t *)realloc(
+        manifest->jobs, (size_t)capacity * sizeof(*jobs));
+    if (!jobs)
+      return false;
+    manifest->jobs = jobs;
+    stage_manifest_pending_t *pending = (stage_manifest_pending_t *)realloc(
+        manifest->pending, (size_t)capacity * sizeof(*pending));
+    if (!pending)
+      return false;
+    manifest->pending = pending;
+    manifest->pending_capacity = capacity;
+  }
+  int index = manifest->pending_count++;
+  sm_copy_job_t *job = &manifest->jobs[index];
+  stage_manifest_pending_t *pending = &manifest->pending[index];
+  memset(job, 0, sizeof(*job));
+  (void)strlcpy(job->src, src, sizeof(job->src));
+  (void)strlcpy(job->dst, dst, sizeof(job->dst));
+  (void)strlcpy(pending->rel_path, rel_path, sizeof(pending->rel_path));
+  pending->src_size = (uint64_t)src_st->st_size;
+  pending->src_mtime_sec = (int64_t)src_st->st_mtim.tv_sec;
+  pending->src_mtime_nsec = src_st->st_mtim.tv_nsec;
+  return true;
+}
+
+int stage_manifest_queue_file(stage_manifest_t *manifest, const char *src,
+                              const struct stat *src_st, const char *rel_path) {
+  char dst[MAX_PATH];
+  if (!build_stage_path(dst, sizeof(dst), manifest->dst_root, rel_path))
+    return -1;
+
+  stage_manifest_entry_t *entry = find_stage_entry(manifest, rel_path);
+  bool refreshed = false;
+  if (entry && stage_entry_is_current(entry, src, src_st, dst, &refreshed)) {
+    entry->seen = true;
+    manifest->unchanged++;
+    if (refreshed)
+      manifest->dirty = true;
+    return 0;
+  }
+  if (entry)
+    entry->seen = true;
+  return queue_stage_copy(manifest, src, src_st, rel_path, dst) ? 0 : -1;
+}
+
+int stage_manifest_queue_dir(stage_manifest_t *manifest, const char *src_dir,
+                             const char *rel_dir, bool recursive,
+                             stage_manifest_filter_fn filter) {
+  char dst_dir[MAX_PATH];
+  if (!build_stage_path(dst_dir, sizeof(dst_dir), manifest->dst_root,
+                        rel_dir) ||
+      (mkdir(dst_dir, 0777) != 0 && errno != EEXIST)) {
+    return -1;
+  }
+  DIR *d = opendir(src_dir);
+  if (!d)
+    return -1;
+  int ret = 0;
+  struct dirent *e;
+  char src_path[MAX_PATH];
+  char rel_path[MAX_PATH];
+  struct stat st;
+  struct stat lst;
+  while ((e = readdir(d))) {
+    if (!strcmp(e->d_name, ".") || !strcmp(e->d_name, ".."))
+      continue;
+    if (!build_stage_path(src_path, sizeof(src_path), src_dir, e->d_name) ||
+        !build_stage_path(rel_path, sizeof(rel_path), rel_dir, e->d_name) ||
+        lstat(src_path, &lst) != 0) {
+      ret = -1;
+      break;
+    }
+    if (S_ISLNK(lst.st_mode)) {
+      if (stat(src_path, &st) != 0) {
+        ret = -1;
+        break;
+      }
+    } else {
+      st = lst;
+    }
+    if (S_ISDIR(st.st_mode)) {
+      if (!recursive)
+        continue;
+      // Same symlink policy as copy_dir().
+      if (S_ISLNK(lst.st_mode)) {
+        log_debug("  [COPY] refusing symlink directory: %s", src_path);
+        ret = -1;
+        break;
+      }
+      if (stage_manifest_queue_dir(manifest, src_path, rel_path, true,
+                                   filter) != 0) {
+        ret = -1;
+        break;
+      }
+      continue;
+    }
+    if (!S_ISREG(st.st_mode) || (filter && !filter(e->d_name)))
+      continue;
+    if (stage_manifest_queue_file(manifest, src_path, &st, rel_path) != 0) {
+      ret = -1;
+      break;
+    }
+  }
+  if (closedir(d) != 0)
+    ret = -1;
+  return ret;
+}
+
+static bool write_stage_manifest(const stage_manifest_t *manifest) {
+  char tmp_path[MAX_PATH];
+  int written = snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", manifest->path);
+  if (written < 0 || (size_t)written >= sizeof(tmp_path))
+    return false;
+  FILE *f = fopen(tmp_path, "w");
+  if (!f)
+    return false;
+  bool ok = fprintf(f, "# smp-stage-manifest %d\n", STAGE_MANIFEST_VERSION) > 0;
+  for (int i = 0; ok && i < manifest->count; i++) {
+    const stage_manifest_entry_t *entry = &manifest->entries[i];
+    ok = fprintf(f, "%llu %lld %ld %016llx %llu %s\n",
+                 (unsigned long long)entry->src_size,
+                 (long long)entry->src_mtime_sec, entry->src_mtime_nsec,
+                 (unsigned long long)entry->src_hash,
+                 (unsigned long long)entry->dst_size, entry->rel_path) > 0;
+  }
+  if (fclose(f) != 0)
+    ok = false;
+  if (!ok || rename(tmp_path, manifest->path) != 0) {
+    (void)unlink(tmp_path);
+    return false;
+  }
+  return true;
+}
+
+// Record the copied files in their entries.
+static bool apply_stage_copies(stage_manifest_t *manifest) {
+  for (int i = 0; i < manifest->pending_count; i++) {
+    const stage_manifest_pending_t *pending = &manifest->pending[i];
+    stage_manifest_entry_t *entry =
+        find_stage_entry(manifest, pending->rel_path);
+    if (!entry && !(entry = add_stage_entry(manifest, pending->rel_path)))
+      return false;
+    entry->src_size = pending->src_size;
+    entry->src_mtime_sec = pending->src_mtime_sec;
+    entry->src_mtime_nsec = pending->src_mtime_nsec;
+    entry->src_hash = manifest->jobs[i].src_hash;
+    entry->dst_size = manifest->jobs[i].dst_size;
+    entry->seen = true;
+  }
+  if (manifest->pending_count > 0)
+    manifest->dirty = true;
+  manifest->pending_count = 0;
+  return true;
+}
+
+bool commit_stage_manifest(stage_manifest_t *manifest, unsigned workers,
+                           sm_copy_stats_t *stats) {
+  if (!sm_copy_run_jobs(manifest->jobs, manifest->pending_count, workers,
+                        asset_store_copy_file,
+                        SM_COPY_JOB_HASH_SOURCE | SM_COPY_JOB_ATOMIC, stats)) {
+    log_debug("  [COPY] staging batch failed under %s: %s",
+              manifest->dst_root, strerror(errno));
+    return false;
+  }
+  if (!apply_stage_copies(manifest))
+    return false;
+
+  int kept = 0;
+  for (int i = 0; i < manifest->count; i++) {
+    stage_manifest_entry_t *entry = &manifest->entries[i];
+    if (entry->seen) {
+      if (kept != i)
+        manifest->entries[kept] = *entry;
+      kept++;
+      continue;
+    }
+    char dst[MAX_PATH];
+    if (build_stage_path(dst, sizeof(dst), manifest->dst_root,
+                         entry->rel_path) &&
+        unlink(dst) == 0) {
+      log_debug("  [COPY] removed stale staged file: %s", dst);
+    }
+    manifest->dirty = true;
+  }
+  manifest->count = kept;
+  // Without the manifest the next restage just copies everything again.
+  if (manifest->dirty && !write_stage_manifest(manifest)) {
+    log_debug("  [COPY] cannot write stage manifest %s: %s", manifest->path,
+              strerror(errno));
+  } else {
+    manifest->dirty = false;
+  }
+  return true;
+}
+
+void free_stage_manifest(stage_manifest_t *manifest) {
+  free(manifest->entries);
+  free(manifest->jobs);
+  free(manifest->pending);
+  manifest->entries = NULL;
+  manifest->jobs = NULL;
+  manifest->pending = NULL;
+  manifest->count = 0;
+  manifest->capacity = 0;
+  manifest->pending_count = 0;
+  manifest->pending_capacity = 0;
+}
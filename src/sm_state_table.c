@@ -0,0 +1,194 @@
+#include "sm_platform.h"
+#include "sm_state_table.h"
+
+#include <stdatomic.h>
+
+#include "sm_config_mount.h"
+#include "sm_game_cache.h"
+#include "sm_image_attach_pool.h"
+#include "sm_image_ondemand.h"
+#include "sm_image_probe.h"
+#include "sm_image_sidecar.h"
+#include "sm_install_queue.h"
+#include "sm_limits.h"
+#include "sm_log.h"
+#include "sm_path_pool.h"
+#include "sm_path_state.h"
+#include "sm_scan.h"
+#include "sm_scan_tree.h"
+#include "sm_title_state.h"
+#include "sm_types.h"
+
+static atomic_uint g_state_table_growth_count = 0;
+
+int sm_state_soft_limit(void) {
+  uint32_t limit = runtime_config()->state_soft_limit;
+  if (limit < MIN_STATE_SOFT_LIMIT)
+    limit = MIN_STATE_SOFT_LIMIT;
+  if (limit > MAX_STATE_SOFT_LIMIT)
+    limit = MAX_STATE_SOFT_LIMIT;
+  return (int)limit;
+}
+
+bool sm_state_table_reserve(void **items, int *capacity, int needed,
+                            size_t entry_size) {
+  if (needed <= *capacity)
+    return true;
+
+  int limit = sm_state_soft_limit();
+  if (needed > limit)
+    return false;
+
+  int new_capacity = *capacity > 0 ? *capacity : INITIAL_STATE_CAPACITY;
+  while (new_capacity < needed)
+    new_capacity *= 2;
+  if (new_capacity > limit)
+    new_capacity = limit;
+
+  void *new_items = realloc(*items, (size_t)new_capacity * entry_size);
+  if (!new_items) {
+    log_debug("  [MEM] table growth failed: %d -> %d entries (%zu bytes each)",
+              *capacity, new_capacity, entry_size);
+    return false;
+  }
+  memset((char *)new_items + (size_t)*capacity * entry_size, 0,
+         (size_t)(new_capacity - *capacity) * entry_size);
+  *items = new_items;
+  *capacity = new_capacity;
+  atomic_fetch_add_explicit(&g_state_table_growth_count, 1u,
+                            memory_order_relaxed);
+  return true;
+}
+
+static bool rebuild_state_index(sm_state_index_t *index, uint32_t size) {
+  sm_state_index_slot_t *slots = calloc(size, sizeof(*slots));
+  if (!slots) {
+    log_debug("  [MEM] index allocation failed (%u slots)", size);
+    return false;
+  }
+
+  uint32_t mask = size - 1u;
+  for (uint32_t i = 0; i < index->size; i++) {
+    uint32_t value = index->slots[i].value;
+    if (value == 0 || value == SM_STATE_INDEX_TOMBSTONE)
+      continue;
+    uint32_t slot = index->slots[i].hash & mask;
+    while (slots[slot].value != 0)
+      slot = (slot + 1u) & mask;
+    slots[slot] = index->slots[i];
+  }
+
+  free(index->slots);
+  index->slots = slots;
+  index->size = size;
+  index->used = index->live;
+  return true;
+}
+
+bool sm_state_index_insert(sm_state_index_t *index, uint32_t hash, int entry) {
+  if (index->size == 0 || (index->used + 1u) * 4u > index->size * 3u) {
+    // Grow when live entries fill half the index, otherwise only sweep
+    // tombstones at the current size.
+    uint32_t size = index->size ? index->size : 16u;
+    while ((index->live + 1u) * 2u > size)
+      size *= 2u;
+    if (!rebuild_state_index(index, size))
+      return false;
+  }
+
+  uint32_t mask = index->size - 1u;
+  uint32_t slot = hash & mask;
+  while (index->slots[slot].value != 0 &&
+         index->slots[slot].value != SM_STATE_INDEX_TOMBSTONE) {
+    slot = (slot + 1u) & mask;
+  }
+  if (index->slots[slot].value == 0)
+    index->used++;
+  index->slots[slot].hash = hash;
+  index->slots[slot].value = (uint32_t)entry + 1u;
+  index->live++;
+  return true;
+}
+
+void sm_state_index_remove(sm_state_index_t *index, uint32_t hash, int entry) {
+  if (index->size == 0)
+    return;
+  uint32_t mask = index->size - 1u;
+  uint32_t slot = hash & mask;
+  for (uint32_t i = 0; i < index->size; i++) {
+    uint32_t value = index->slots[slot].value;
+    if (value == 0)
+      return;
+    if (value == (uint32_t)entry + 1u) {
+      index->slots[slot].value = SM_STATE_INDEX_TOMBSTONE;
+      index->live--;
+      return;
+    }
+    slot = (slot + 1u) & mask;
+  }
+}
+
+int sm_state_index_next(const sm_state_index_t *index, uint32_t hash,
+                        uint32_t *cursor) {
+  if (index->size == 0)
+    return -1;
+  uint32_t mask = index->size - 1u;
+  while (*cursor < index->size) {
+    const sm_state_index_slot_t *slot =
+        &index->slots[(hash + *cursor) & mask];
+    (*cursor)++;
+    if (slot->value == 0)
+      break;
+    if (slot->value != SM_STATE_INDEX_TOMBSTONE && slot->hash == hash)
+      return (int)slot->value - 1;
+  }
+  *cursor = index->size;
+  return -1;
+}
+
+size_t sm_state_index_bytes(const sm_state_index_t *index) {
+  return (size_t)index->size * sizeof(*index->slots);
+}
+
+uint32_t sm_state_table_growth_count(void) {
+  return atomic_load_explicit(&g_state_table_growth_count,
+                              memory_order_relaxed);
+}
+
+size_t collect_state_memory_usage(const scan_candidate_list_t *candidates,
+                                  sm_state_table_usage_t *out, int *count_out) {
+  int count = 0;
+  game_cache_memory_usage(&out[count++]);
+  path_state_memory_usage(&out[count++]);
+  title_state_memory_usage(&out[count++]);
+  install_queue_memory_usage(&out[count++]);
+  path_pool_memory_usage(&out[count++]);
+  scan_workspace_memory_usage(&out[count++]);
+  scan_tree_cache_memory_usage(&out[count++]);
+  image_sidecar_cache_memory_usage(&out[count++]);
+  image_probe_cache_memory_usage(&out[count++]);
+  image_ondemand_memory_usage(&out[count++]);
+  image_attach_pool_memory_usage(&out[count++]);
+  if (candidates)
+    scan_candidate_list_memory_usage(candidates, &out[count++]);
+
+  size_t total = 0;
+  for (int i = 0; i < count; i++)
+    total += out[i].bytes;
+  *count_out = count;
+  return total;
+}
+
+void log_state_memory_budget(const char *reason,
+                             const scan_candidate_list_t *candidates) {
+  sm_state_table_usage_t usage[SM_STATE_TABLE_MAX_REPORT];
+  int count = 0;
+  size_t total = collect_state_memory_usage(candidates, usage, &count);
+
+  log_debug("  [MEM] state tables (%s): %zu KiB total, soft limit %d entries",
+            reason ? reason : "report", total / 1024u, sm_state_soft_limit());
+  for (int i = 0; i < count; i++) {
+    log_debug("  [MEM]   %-16s %6d/%-6d entries %8zu KiB", usage[i].name,
+              usage[i].count, usage[i].capacity, usage[i].bytes / 1024u);
+  }
+}
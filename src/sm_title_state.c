@@ -3,108 +3,161 @@
 #include "sm_hash.h"
 #include "sm_limits.h"
 #include "sm_log.h"
+#include "sm_state_table.h"
+
+#define TITLE_STATE_NONE (-1)
 
 struct TitleStateEntry {
   char title_id[MAX_TITLE_ID];
+  uint32_t hash;
   uint8_t mount_reg_attempts;
   uint8_t register_attempts;
   bool duplicate_notified_once;
   bool valid;
+  // LRU list links for valid entries (head = most recently used); free
+  // entries are chained through lru_next instead.
+  int lru_prev;
+  int lru_next;
 };
 
-static struct TitleStateEntry g_title_state[TITLE_STATE_CAPACITY];
-static uint16_t g_title_state_hash[STATE_HASH_SIZE];
-
-static void rebuild_title_state_hash(void) {
-  memset(g_title_state_hash, 0, sizeof(g_title_state_hash));
-  for (int k = 0; k < TITLE_STATE_CAPACITY; k++) {
-    if (!g_title_state[k].valid || g_title_state[k].title_id[0] == '\0')
-      continue;
-    uint32_t slot =
-        sm_fnv1a32(g_title_state[k].title_id) & (STATE_HASH_SIZE - 1u);
-    for (uint32_t i = 0; i < STATE_HASH_SIZE; i++) {
-      if (g_title_state_hash[slot] == 0) {
-        g_title_state_hash[slot] = (uint16_t)(k + 1);
-        break;
-      }
-      slot = (slot + 1u) & (STATE_HASH_SIZE - 1u);
+static struct TitleStateEntry *g_title_state = NULL;
+static int g_title_state_capacity = 0;
+static int g_title_state_count = 0;
+static int g_title_state_free_head = TITLE_STATE_NONE;
+static int g_title_state_lru_head = TITLE_STATE_NONE;
+static int g_title_state_lru_tail = TITLE_STATE_NONE;
+static sm_state_index_t g_title_state_index;
+
+static void lru_unlink_title_state(int k) {
+  struct TitleStateEntry *entry = &g_title_state[k];
+  if (entry->lru_prev != TITLE_STATE_NONE)
+    g_title_state[entry->lru_prev].lru_next = entry->lru_next;
+  else
+    g_title_state_lru_head = entry->lru_next;
+  if (entry->lru_next != TITLE_STATE_NONE)
+    g_title_state[entry->lru_next].lru_prev = entry->lru_prev;
+  else
+    g_title_state_lru_tail = entry->lru_prev;
+  entry->lru_prev = TITLE_STATE_NONE;
+  entry->lru_next = TITLE_STATE_NONE;
+}
+
+static void lru_push_title_state(int k) {
+  struct TitleStateEntry *entry = &g_title_state[k];
+  entry->lru_prev = TITLE_STATE_NONE;
+  entry->lru_next = g_title_state_lru_head;
+  if (g_title_state_lru_head != TITLE_STATE_NONE)
+    g_title_state[g_title_state_lru_head].lru_prev = k;
+  g_title_state_lru_head = k;
+  if (g_title_state_lru_tail == TITLE_STATE_NONE)
+    g_title_state_lru_tail = k;
+}
+
+static void touch_title_state(int k) {
+  if (g_title_state_lru_head == k)
+    return;
+  lru_unlink_title_state(k);
+  lru_push_title_state(k);
+}
+
+static int find_title_state_index(const char *title_id, uint32_t hash) {
+  uint32_t cursor = 0;
+  int k;
+  while ((k = sm_state_index_next(&g_title_state_index, hash, &cursor)) >= 0) {
+    if (g_title_state[k].hash == hash &&
+        strcmp(g_title_state[k].title_id, title_id) == 0) {
+      return k;
     }
   }
+  return TITLE_STATE_NONE;
 }
 
-static struct TitleStateEntry *find_title_state(const char *title_id) {
-  uint32_t slot = sm_fnv1a32(title_id) & (STATE_HASH_SIZE - 1u);
-  for (uint32_t i = 0; i < STATE_HASH_SIZE; i++) {
-    uint16_t idx = g_title_state_hash[slot];
-    if (idx == 0)
-      return NULL;
-    struct TitleStateEntry *entry = &g_title_state[idx - 1u];
-    if (entry->valid && strcmp(entry->title_id, title_id) == 0)
-      return entry;
-    slot = (slot + 1u) & (STATE_HASH_SIZE - 1u);
-  }
-  return NULL;
+static void remove_title_state(int k) {
+  struct TitleStateEntry *entry = &g_title_state[k];
+  sm_state_index_remove(&g_title_state_index, entry->hash, k);
+  lru_unlink_title_state(k);
+  memset(entry, 0, sizeof(*entry));
+  entry->lru_prev = TITLE_STATE_NONE;
+  entry->lru_next = g_title_state_free_head;
+  g_title_state_free_head = k;
+  g_title_state_count--;
 }
 
-static struct TitleStateEntry *create_title_state(const char *title_id) {
-  int slot_k = -1;
-  for (int k = 0; k < TITLE_STATE_CAPACITY; k++) {
-    if (!g_title_state[k].valid) {
-      slot_k = k;
-      break;
-    }
+static bool grow_title_state(void) {
+  int old_capacity = g_title_state_capacity;
+  if (!sm_state_table_reserve((void **)&g_title_state, &g_title_state_capacity,
+                              old_capacity + 1, sizeof(*g_title_state))) {
+    return false;
   }
-  if (slot_k < 0) {
-    int evict_k = -1;
-    for (int k = 0; k < TITLE_STATE_CAPACITY; k++) {
-      if (!g_title_state[k].valid)
-        continue;
-      if (g_title_state[k].mount_reg_attempts == 0 &&
-          g_title_state[k].register_attempts == 0) {
-        evict_k = k;
-        break;
-      }
-    }
-    if (evict_k < 0) {
-      for (int k = 0; k < TITLE_STATE_CAPACITY; k++) {
-        if (!g_title_state[k].valid)
-          continue;
-        if (g_title_state[k].mount_reg_attempts == 0) {
-          evict_k = k;
-          break;
-        }
-      }
-    }
-    if (evict_k < 0)
-      evict_k = 0;
-    memset(&g_title_state[evict_k], 0, sizeof(g_title_state[evict_k]));
-    rebuild_title_state_hash();
-    slot_k = evict_k;
+  for (int k = g_title_state_capacity - 1; k >= old_capacity; k--) {
+    g_title_state[k].lru_prev = TITLE_STATE_NONE;
+    g_title_state[k].lru_next = g_title_state_free_head;
+    g_title_state_free_head = k;
   }
+  return true;
+}
 
-  memset(&g_title_state[slot_k], 0, sizeof(g_title_state[slot_k]));
-  g_title_state[slot_k].valid = true;
-  (void)strlcpy(g_title_state[slot_k].title_id, title_id,
-                sizeof(g_title_state[slot_k].title_id));
+static struct TitleStateEntry *find_title_state(const char *title_id) {
+  if (!title_id || title_id[0] == '\0')
+    return NULL;
+  int k = find_title_state_index(title_id, sm_fnv1a32(title_id));
+  if (k == TITLE_STATE_NONE)
+    return NULL;
+  touch_title_state(k);
+  return &g_title_state[k];
+}
 
-  uint32_t slot = sm_fnv1a32(title_id) & (STATE_HASH_SIZE - 1u);
-  for (uint32_t i = 0; i < STATE_HASH_SIZE; i++) {
-    if (g_title_state_hash[slot] == 0) {
-      g_title_state_hash[slot] = (uint16_t)(slot_k + 1);
-      return &g_title_state[slot_k];
+// Evict from the LRU tail, preferring entries without retry counters so
+// attempt limits survive as long as possible.
+static void evict_title_state(void) {
+  int victim = g_title_state_lru_tail;
+  int k = g_title_state_lru_tail;
+  for (int i = 0; i < STATE_EVICT_SCAN_LIMIT && k != TITLE_STATE_NONE; i++) {
+    if (g_title_state[k].mount_reg_attempts == 0 &&
+        g_title_state[k].register_attempts == 0) {
+      victim = k;
+      break;
     }
-    slot = (slot + 1u) & (STATE_HASH_SIZE - 1u);
+    k = g_title_state[k].lru_prev;
   }
+  if (victim != TITLE_STATE_NONE)
+    remove_title_state(victim);
+}
 
-  g_title_state[slot_k].valid = false;
-  g_title_state[slot_k].title_id[0] = '\0';
-  rebuild_title_state_hash();
-  return NULL;
+static struct TitleStateEntry *create_title_state(const char *title_id,
+                                                  uint32_t hash) {
+  if (g_title_state_free_head == TITLE_STATE_NONE && !grow_title_state()) {
+    if (g_title_state_count <= 0)
+      return NULL;
+    evict_title_state();
+  }
+  if (g_title_state_free_head == TITLE_STATE_NONE)
+    return NULL;
+
+  int k = g_title_state_free_head;
+  if (!sm_state_index_insert(&g_title_state_index, hash, k))
+    return NULL;
+  struct TitleStateEntry *entry = &g_title_state[k];
+  g_title_state_free_head = entry->lru_next;
+  memset(entry, 0, sizeof(*entry));
+  entry->valid = true;
+  entry->hash = hash;
+  (void)strlcpy(entry->title_id, title_id, sizeof(entry->title_id));
+  g_title_state_count++;
+  lru_push_title_state(k);
+  return entry;
 }
 
 static struct TitleStateEntry *get_or_create_title_state(const char *title_id) {
-  struct TitleStateEntry *entry = find_title_state(title_id);
-  return entry ? entry : create_title_state(title_id);
+  if (!title_id || title_id[0] == '\0')
+    return NULL;
+  uint32_t hash = sm_fnv1a32(title_id);
+  int k = find_title_state_index(title_id, hash);
+  if (k != TITLE_STATE_NONE) {
+    touch_title_state(k);
+    return &g_title_state[k];
+  }
+  return create_title_state(title_id, hash);
 }
 
 bool was_register_attempted(const char *title_id) {
@@ -119,6 +172,8 @@ uint8_t get_register_attempts(const char *title_id) {
 
 void mark_register_attempted(const char *title_id) {
   struct TitleStateEntry *entry = get_or_create_title_state(title_id);
+  if (!entry)
+    return;
   if (entry->register_attempts < UINT8_MAX)
     entry->register_attempts++;
 }
@@ -132,7 +187,7 @@ void clear_register_attempts(const char *title_id) {
 void notify_duplicate_title_once(const char *title_id, const char *path_a,
                                  const char *path_b) {
   struct TitleStateEntry *entry = get_or_create_title_state(title_id);
-  if (entry->duplicate_notified_once)
+  if (!entry || entry->duplicate_notified_once)
     return;
   entry->duplicate_notified_once = true;
   notify_system("Duplicate %s ignored:\n%s\nexisting: %s", title_id, path_a,
@@ -158,7 +213,17 @@ void clear_failed_mount_attempts(const char *title_id) {
 
 uint8_t bump_failed_mount_attempts(const char *title_id) {
   struct TitleStateEntry *entry = get_or_create_title_state(title_id);
+  if (!entry)
+    return 0;
   if (entry->mount_reg_attempts < UINT8_MAX)
     entry->mount_reg_attempts++;
   return entry->mount_reg_attempts;
 }
+
+void title_state_memory_usage(sm_state_table_usage_t *out) {
+  out->name = "title_state";
+  out->count = g_title_state_count;
+  out->capacity = g_title_state_capacity;
+  out->bytes = (size_t)g_title_state_capacity * sizeof(*g_title_state) +
+               sm_state_index_bytes(&g_title_state_index);
+}
@@ -0,0 +1,254 @@
+// Host tool: write <image>.smp.bitmap marking the blocks of an image that
+// hold data, so the payload can attach it as a sparse LVD layer. With --trim
+// the all-zero tail of the image is cut off; with --punch all-zero blocks
+// inside it become holes where the host filesystem supports that.
+//
+//   smp_bitmap [--block-size N] [--trim] [--punch] <image>
+//
+// Run it before smp_sidecar: the sidecar records the stored image size.
+
+#include "sm_platform.h"
+
+#include "sm_image_bitmap.h"
+#include "sm_image_sidecar.h"
+
+static void usage(const char *argv0) {
+  fprintf(stderr, "usage: %s [--block-size N] [--trim] [--punch] <image>\n",
+          argv0);
+}
+
+static bool is_zero_block(const uint8_t *buf, size_t len) {
+  return len == 0 || (buf[0] == 0 && memcmp(buf, buf + 1, len - 1) == 0);
+}
+
+// An image trimmed by an earlier run still describes its original device.
+static uint64_t get_previous_device_size(const char *image_path,
+                                         uint64_t file_size) {
+  char bitmap_path[MAX_PATH];
+  if (!build_image_bitmap_path(image_path, bitmap_path, sizeof(bitmap_path)))
+    return file_size;
+  int fd = open(bitmap_path, O_RDONLY);
+  if (fd < 0)
+    return file_size;
+  uint8_t raw[IMAGE_BITMAP_HEADER_SIZE];
+  image_bitmap_header_t header;
+  bool ok = pread(fd, raw, sizeof(raw), 0) == (ssize_t)sizeof(raw) &&
+            decode_image_bitmap_header(raw, &header);
+  close(fd);
+  if (!ok || header.device_size < file_size)
+    return file_size;
+  return header.device_size;
+}
+
+// Set a bit per block holding any non-zero byte; returns the stored size up
+// to the end of the last such block, or UINT64_MAX on a read error.
+static uint64_t scan_image_blocks(int fd, uint64_t file_size,
+                                  uint32_t block_size, uint8_t *bits,
+                                  uint64_t *allocated_out) {
+  uint8_t *buf = malloc(block_size);
+  if (!buf)
+    return UINT64_MAX;
+  uint64_t used_end = 0;
+  uint64_t allocated = 0;
+  for (uint64_t offset = 0, block = 0; offset < file_size;
+       offset += block_size, block++) {
+    size_t want = file_size - offset < block_size ? (size_t)(file_size - offset)
+                                                  : block_size;
+    size_t got = 0;
+    while (got < want) {
+      ssize_t n = pread(fd, buf + got, want - got, (off_t)(offset + got));
+      if (n < 0 && errno == EINTR)
+        continue;
+      if (n <= 0) {
+        free(buf);
+        return UINT64_MAX;
+      }
+      got += (size_t)n;
+    }
+    if (is_zero_block(buf, want))
+      continue;
+    bits[block / 8u] |= (uint8_t)(1u << (block % 8u));
+    allocated++;
+    used_end = offset + want;
+  }
+  free(buf);
+  *allocated_out = allocated;
+  return used_end;
+}
+
+static bool punch_zero_blocks(int fd, uint64_t data_size, uint32_t block_size,
+                              const uint8_t *bits) {
+#ifdef FALLOC_FL_PUNCH_HOLE
+  uint64_t blocks = (data_size + block_size - 1u) / block_size;
+  uint64_t run_start = 0;
+  bool in_run = false;
+  for (uint64_t block = 0; block <= blocks; block++) {
+    bool clear = block < blocks &&
+                 (bits[block / 8u] & (1u << (block % 8u))) == 0;
+    if (clear && !in_run) {
+      run_start = block;
+      in_run = true;
+    } else if (!clear && in_run) {
+      uint64_t start = run_start * block_size;
+      uint64_t end = block * block_size;
+      if (end > data_size)
+        end = data_size;
+      if (fallocate(fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE,
+                    (off_t)start, (off_t)(end - start)) != 0) {
+        return false;
+      }
+      in_run = false;
+    }
+  }
+  return true;
+#else
+  (void)fd;
+  (void)data_size;
+  (void)block_size;
+  (void)bits;
+  errno = EOPNOTSUPP;
+  return false;
+#endif
+}
+
+static bool write_bitmap_file(const char *image_path,
+                              const image_bitmap_header_t *header,
+                              const uint8_t *bits) {
+  char path[MAX_PATH];
+  char tmp_path[MAX_PATH];
+  if (!build_image_bitmap_path(image_path, path, sizeof(path)))
+    return false;
+  int written = snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+  if (written < 0 || (size_t)written >= sizeof(tmp_path))
+    return false;
+
+  FILE *f = fopen(tmp_path, "wb");
+  if (!f)
+    return false;
+  uint8_t raw[IMAGE_BITMAP_HEADER_SIZE];
+  encode_image_bitmap_header(header, raw);
+  bool ok = fwrite(raw, 1, sizeof(raw), f) == sizeof(raw) &&
+            fwrite(bits, 1, (size_t)header->bitmap_size, f) ==
+                (size_t)header->bitmap_size &&
+            fflush(f) == 0;
+  if (fclose(f) != 0)
+    ok = false;
+  if (!ok || rename(tmp_path, path) != 0) {
+    (void)unlink(tmp_path);
+    return false;
+  }
+  return true;
+}
+
+int main(int argc, char **argv) {
+  uint32_t block_size = IMAGE_BITMAP_DEFAULT_BLOCK_SIZE;
+  bool trim = false;
+  bool punch = false;
+  int argi = 1;
+  while (argi < argc && strncmp(argv[argi], "--", 2) == 0) {
+    if (strcmp(argv[argi], "--trim") == 0) {
+      trim = true;
+      argi++;
+    } else if (strcmp(argv[argi], "--punch") == 0) {
+      punch = true;
+      argi++;
+    } else if (strcmp(argv[argi], "--block-size") == 0 && argi + 1 < argc) {
+      char *end = NULL;
+      unsigned long n = strtoul(argv[argi + 1], &end, 0);
+      if (!end || *end != '\0' || n < IMAGE_BITMAP_MIN_BLOCK_SIZE ||
+          n > IMAGE_BITMAP_MAX_BLOCK_SIZE || (n & (n - 1u)) != 0) {
+        fprintf(stderr, "invalid block size: %s\n", argv[argi + 1]);
+        return 2;
+      }
+      block_size = (uint32_t)n;
+      argi += 2;
+    } else {
+      usage(argv[0]);
+      return 2;
+    }
+  }
+  if (argc - argi != 1) {
+    usage(argv[0]);
+    return 2;
+  }
+  const char *image_path = argv[argi];
+
+  int fd = open(image_path, (trim || punch) ? O_RDWR : O_RDONLY);
+  struct stat st;
+  if (fd < 0 || fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) ||
+      st.st_size <= 0) {
+    fprintf(stderr, "cannot open image %s: %s\n", image_path,
+            fd < 0 ? strerror(errno) : "not a non-empty regular file");
+    if (fd >= 0)
+      close(fd);
+    return 1;
+  }
+
+  image_bitmap_header_t header;
+  memset(&header, 0, sizeof(header));
+  header.block_size = block_size;
+  header.device_size =
+      get_previous_device_size(image_path, (uint64_t)st.st_size);
+  header.bitmap_offset = IMAGE_BITMAP_HEADER_SIZE;
+  header.bitmap_size = image_bitmap_size_for(header.device_size, block_size);
+  uint8_t *bits = calloc(1, (size_t)header.bitmap_size);
+  if (!bits) {
+    close(fd);
+    fprintf(stderr, "out of memory for %llu bitmap bytes\n",
+            (unsigned long long)header.bitmap_size);
+    return 1;
+  }
+
+  uint64_t allocated = 0;
+  uint64_t used_end = scan_image_blocks(fd, (uint64_t)st.st_size, block_size,
+                                        bits, &allocated);
+  if (used_end == UINT64_MAX) {
+    fprintf(stderr, "read failed: %s\n", image_path);
+    free(bits);
+    close(fd);
+    return 1;
+  }
+  header.data_size = trim ? used_end : (uint64_t)st.st_size;
+
+  if (trim && header.data_size < IMAGE_SIDECAR_HEAD_BYTES &&
+      (uint64_t)st.st_size > header.data_size) {
+    // The payload hashes the stored head; keep all of it so the hash taken
+    // here still matches after the cut.
+    header.data_size = (uint64_t)st.st_size < IMAGE_SIDECAR_HEAD_BYTES
+                           ? (uint64_t)st.st_size
+                           : IMAGE_SIDECAR_HEAD_BYTES;
+  }
+  // The bitmap is in place before the image shrinks, so an interrupted run
+  // leaves a mismatch the payload rejects rather than a short image without
+  // a bitmap.
+  bool ok = compute_image_head_hash(fd, &header.head_hash);
+  if (ok && !write_bitmap_file(image_path, &header, bits)) {
+    fprintf(stderr, "cannot write bitmap for %s: %s\n", image_path,
+            strerror(errno));
+    ok = false;
+  }
+  if (ok && trim && header.data_size < (uint64_t)st.st_size &&
+      ftruncate(fd, (off_t)header.data_size) != 0) {
+    fprintf(stderr, "trim failed for %s: %s\n", image_path, strerror(errno));
+    ok = false;
+  }
+  if (ok && punch &&
+      !punch_zero_blocks(fd, header.data_size, block_size, bits)) {
+    fprintf(stderr, "punching holes failed for %s: %s\n", image_path,
+            strerror(errno));
+    ok = false;
+  }
+  free(bits);
+  close(fd);
+  if (!ok)
+    return 1;
+
+  uint64_t blocks = (header.device_size + block_size - 1u) / block_size;
+  printf("%s%s: block=%u blocks=%llu allocated=%llu device=%llu "
+         "stored=%llu\n",
+         image_path, IMAGE_BITMAP_SUFFIX, block_size,
+         (unsigned long long)blocks, (unsigned long long)allocated,
+         (unsigned long long)header.device_size,
+         (unsigned long long)header.data_size);
+  return 0;
+}
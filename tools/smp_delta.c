@@ -0,0 +1,239 @@
+// Host tool: build a delta layer holding the blocks in which <new> differs
+// from <old>, plus its .smp.bitmap, so <new> can be mounted as <old> with the
+// delta stacked on top through an <base>.smp.layers manifest.
+//
+//   smp_delta [--block-size N] [--base <base_image>] <old> <new> <delta>
+//
+// <old> is the image the delta applies on top of: the base image for the
+// first layer, the base patched by the first layer for the second. --base
+// names the base image when <old> is not it. Unchanged blocks are left as
+// holes in <delta>; name it with an extension the scanner ignores (.smdelta).
+
+#include "sm_platform.h"
+
+#include "sm_image_bitmap.h"
+#include "sm_image_layers.h"
+#include "sm_image_sidecar.h"
+#include "sm_path_utils.h"
+
+static void usage(const char *argv0) {
+  fprintf(stderr,
+          "usage: %s [--block-size N] [--base <base_image>] <old> <new> "
+          "<delta>\n",
+          argv0);
+}
+
+// Read up to len bytes at offset; bytes past the end of the file read as
+// zeros. Returns false on a read error.
+static bool read_block_padded(int fd, uint8_t *buf, size_t len,
+                              uint64_t offset) {
+  size_t got = 0;
+  while (got < len) {
+    ssize_t n = pread(fd, buf + got, len - got, (off_t)(offset + got));
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n < 0)
+      return false;
+    if (n == 0)
+      break;
+    got += (size_t)n;
+  }
+  memset(buf + got, 0, len - got);
+  return true;
+}
+
+static bool write_all_at(int fd, const uint8_t *buf, size_t len,
+                         uint64_t offset) {
+  size_t done = 0;
+  while (done < len) {
+    ssize_t n = pwrite(fd, buf + done, len - done, (off_t)(offset + done));
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return false;
+    done += (size_t)n;
+  }
+  return true;
+}
+
+static bool write_bitmap_file(const char *delta_path,
+                              const image_bitmap_header_t *header,
+                              const uint8_t *bits) {
+  char path[MAX_PATH];
+  char tmp_path[MAX_PATH];
+  if (!build_image_bitmap_path(delta_path, path, sizeof(path)))
+    return false;
+  int written = snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+  if (written < 0 || (size_t)written >= sizeof(tmp_path))
+    return false;
+
+  FILE *f = fopen(tmp_path, "wb");
+  if (!f)
+    return false;
+  uint8_t raw[IMAGE_BITMAP_HEADER_SIZE];
+  encode_image_bitmap_header(header, raw);
+  bool ok = fwrite(raw, 1, sizeof(raw), f) == sizeof(raw) &&
+            fwrite(bits, 1, (size_t)header->bitmap_size, f) ==
+                (size_t)header->bitmap_size &&
+            fflush(f) == 0;
+  if (fclose(f) != 0)
+    ok = false;
+  if (!ok || rename(tmp_path, path) != 0) {
+    (void)unlink(tmp_path);
+    return false;
+  }
+  return true;
+}
+
+static bool compute_path_head_hash(const char *path, uint64_t *hash_out) {
+  int fd = open(path, O_RDONLY);
+  if (fd < 0)
+    return false;
+  bool ok = compute_image_head_hash(fd, hash_out);
+  close(fd);
+  return ok;
+}
+
+// Copy the blocks of new_fd that differ from old_fd into delta_fd at the same
+// offsets. Returns the end of the last changed block, or UINT64_MAX on error.
+static uint64_t diff_image_blocks(int old_fd, int new_fd, int delta_fd,
+                                  uint64_t new_size, uint32_t block_size,
+                                  uint8_t *bits, uint64_t *changed_out) {
+  uint8_t *old_buf = malloc(block_size);
+  uint8_t *new_buf = malloc(block_size);
+  uint64_t changed_end = UINT64_MAX;
+  uint64_t changed = 0;
+  if (!old_buf || !new_buf)
+    goto out;
+
+  uint64_t last_end = 0;
+  for (uint64_t offset = 0, block = 0; offset < new_size;
+       offset += block_size, block++) {
+    size_t want = new_size - offset < block_size ? (size_t)(new_size - offset)
+                                                 : block_size;
+    if (!read_block_padded(new_fd, new_buf, want, offset) ||
+        !read_block_padded(old_fd, old_buf, want, offset)) {
+      goto out;
+    }
+    if (memcmp(old_buf, new_buf, want) == 0)
+      continue;
+    if (!write_all_at(delta_fd, new_buf, want, offset))
+      goto out;
+    bits[block / 8u] |= (uint8_t)(1u << (block % 8u));
+    changed++;
+    last_end = offset + want;
+  }
+  changed_end = last_end;
+  *changed_out = changed;
+
+out:
+  free(old_buf);
+  free(new_buf);
+  return changed_end;
+}
+
+int main(int argc, char **argv) {
+  uint32_t block_size = IMAGE_BITMAP_DEFAULT_BLOCK_SIZE;
+  const char *base_path = NULL;
+  int argi = 1;
+  while (argi + 1 < argc && strncmp(argv[argi], "--", 2) == 0) {
+    if (strcmp(argv[argi], "--base") == 0) {
+      base_path = argv[argi + 1];
+    } else if (strcmp(argv[argi], "--block-size") == 0) {
+      char *end = NULL;
+      unsigned long n = strtoul(argv[argi + 1], &end, 0);
+      if (!end || *end != '\0' || n < IMAGE_BITMAP_MIN_BLOCK_SIZE ||
+          n > IMAGE_BITMAP_MAX_BLOCK_SIZE || (n & (n - 1u)) != 0) {
+        fprintf(stderr, "invalid block size: %s\n", argv[argi + 1]);
+        return 2;
+      }
+      block_size = (uint32_t)n;
+    } else {
+      usage(argv[0]);
+      return 2;
+    }
+    argi += 2;
+  }
+  if (argc - argi != 3) {
+    usage(argv[0]);
+    return 2;
+  }
+  const char *old_path = argv[argi];
+  const char *new_path = argv[argi + 1];
+  const char *delta_path = argv[argi + 2];
+  if (!base_path)
+    base_path = old_path;
+
+  image_bitmap_header_t header;
+  memset(&header, 0, sizeof(header));
+  if (!compute_path_head_hash(base_path, &header.base_hash)) {
+    fprintf(stderr, "cannot read base image %s: %s\n", base_path,
+            strerror(errno));
+    return 1;
+  }
+
+  int old_fd = open(old_path, O_RDONLY);
+  int new_fd = open(new_path, O_RDONLY);
+  struct stat new_st;
+  if (old_fd < 0 || new_fd < 0 || fstat(new_fd, &new_st) != 0 ||
+      !S_ISREG(new_st.st_mode) || new_st.st_size <= 0) {
+    fprintf(stderr, "cannot open %s and %s as images\n", old_path, new_path);
+    if (old_fd >= 0)
+      close(old_fd);
+    if (new_fd >= 0)
+      close(new_fd);
+    return 1;
+  }
+  int delta_fd = open(delta_path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (delta_fd < 0) {
+    fprintf(stderr, "cannot create %s: %s\n", delta_path, strerror(errno));
+    close(old_fd);
+    close(new_fd);
+    return 1;
+  }
+
+  header.block_size = block_size;
+  header.device_size = (uint64_t)new_st.st_size;
+  header.bitmap_offset = IMAGE_BITMAP_HEADER_SIZE;
+  header.bitmap_size = image_bitmap_size_for(header.device_size, block_size);
+  uint8_t *bits = calloc(1, (size_t)header.bitmap_size);
+  uint64_t changed = 0;
+  uint64_t changed_end =
+      bits ? diff_image_blocks(old_fd, new_fd, delta_fd, header.device_size,
+                               block_size, bits, &changed)
+           : UINT64_MAX;
+  close(old_fd);
+  close(new_fd);
+
+  bool ok = changed_end != UINT64_MAX;
+  if (!ok) {
+    fprintf(stderr, "diff failed: %s\n", strerror(errno));
+  } else if (changed == 0) {
+    fprintf(stderr, "%s and %s are identical\n", old_path, new_path);
+    ok = false;
+  } else if (ftruncate(delta_fd, (off_t)changed_end) != 0) {
+    fprintf(stderr, "cannot size %s: %s\n", delta_path, strerror(errno));
+    ok = false;
+  }
+  header.data_size = changed_end;
+  close(delta_fd);
+  if (ok && (!compute_path_head_hash(delta_path, &header.head_hash) ||
+             !write_bitmap_file(delta_path, &header, bits))) {
+    fprintf(stderr, "cannot write bitmap for %s: %s\n", delta_path,
+            strerror(errno));
+    ok = false;
+  }
+  free(bits);
+  if (!ok) {
+    (void)unlink(delta_path);
+    return 1;
+  }
+
+  printf("%s: block=%u changed=%llu device=%llu stored=%llu\n", delta_path,
+         block_size, (unsigned long long)changed,
+         (unsigned long long)header.device_size,
+         (unsigned long long)header.data_size);
+  printf("add \"layer=%s\" to %s%s\n", get_filename_component(delta_path),
+         base_path, IMAGE_LAYERS_SUFFIX);
+  return 0;
+}
@@ -0,0 +1,142 @@
+// Host tool: write <image>.smp.json for an image built from a game root, so
+// the payload can identify the image without attaching it.
+//
+//   smp_sidecar [--cluster-size N] <image> <game_root_dir|param.json>
+
+#include "sm_platform.h"
+
+#include "sm_hash.h"
+#include "sm_image.h"
+#include "sm_image_probe.h"
+#include "sm_image_sidecar.h"
+#include "sm_param_json.h"
+
+#define SIDECAR_HASH_CHUNK (1024u * 1024u)
+
+static void usage(const char *argv0) {
+  fprintf(stderr,
+          "usage: %s [--cluster-size N] <image> <game_root_dir|param.json>\n",
+          argv0);
+}
+
+// Read the cluster size from the image's own boot sector or superblock.
+static uint32_t probe_cluster_size(int fd, image_fs_type_t fs_type) {
+  image_probe_t probe;
+  if (!probe_image_fd(fd, &probe) || probe.fs_type != fs_type)
+    return 0;
+  return probe.block_size;
+}
+
+static bool hash_image(int fd, uint64_t *size_out, uint64_t *hash_out) {
+  char *buf = malloc(SIDECAR_HASH_CHUNK);
+  if (!buf)
+    return false;
+  uint64_t hash = SM_FNV1A64_INIT;
+  uint64_t size = 0;
+  bool ok = true;
+  for (;;) {
+    ssize_t n = pread(fd, buf, SIDECAR_HASH_CHUNK, (off_t)size);
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      ok = false;
+      break;
+    }
+    if (n == 0)
+      break;
+    hash = sm_fnv1a64_update(hash, buf, (size_t)n);
+    size += (uint64_t)n;
+  }
+  free(buf);
+  *size_out = size;
+  *hash_out = hash;
+  return ok;
+}
+
+static bool read_title(const char *source, sm_param_json_t *info) {
+  char param_path[MAX_PATH];
+  struct stat st;
+  if (stat(source, &st) == 0 && S_ISDIR(st.st_mode)) {
+    int written = snprintf(param_path, sizeof(param_path),
+                           "%s/sce_sys/param.json", source);
+    if (written < 0 || (size_t)written >= sizeof(param_path))
+      return false;
+  } else {
+    (void)strlcpy(param_path, source, sizeof(param_path));
+  }
+
+  int fd = open(param_path, O_RDONLY);
+  if (fd < 0) {
+    fprintf(stderr, "cannot open %s: %s\n", param_path, strerror(errno));
+    return false;
+  }
+  int res = sm_param_json_parse_fd(fd, SM_PARAM_JSON_PREFERRED_LOCALE, info);
+  close(fd);
+  if (res <= 0) {
+    fprintf(stderr, "no titleId in %s\n", param_path);
+    return false;
+  }
+  return true;
+}
+
+int main(int argc, char **argv) {
+  uint32_t cluster_size = 0;
+  int argi = 1;
+  if (argi + 1 < argc && strcmp(argv[argi], "--cluster-size") == 0) {
+    char *end = NULL;
+    unsigned long n = strtoul(argv[argi + 1], &end, 0);
+    if (!end || *end != '\0' || n < 512u || n > (1u << 20) ||
+        (n & (n - 1u)) != 0) {
+      fprintf(stderr, "invalid cluster size: %s\n", argv[argi + 1]);
+      return 2;
+    }
+    cluster_size = (uint32_t)n;
+    argi += 2;
+  }
+  if (argc - argi != 2) {
+    usage(argv[0]);
+    return 2;
+  }
+  const char *image_path = argv[argi];
+  const char *source = argv[argi + 1];
+
+  image_sidecar_t sidecar;
+  memset(&sidecar, 0, sizeof(sidecar));
+  sidecar.fs_type = get_image_fs_type_for_path(image_path);
+  if (sidecar.fs_type == IMAGE_FS_UNKNOWN) {
+    fprintf(stderr, "unsupported image extension: %s\n", image_path);
+    return 1;
+  }
+
+  sm_param_json_t info;
+  if (!read_title(source, &info))
+    return 1;
+  (void)strlcpy(sidecar.title_id, info.title_id, sizeof(sidecar.title_id));
+  (void)strlcpy(sidecar.title_name,
+                info.title_name[0] ? info.title_name : info.title_id,
+                sizeof(sidecar.title_name));
+
+  int fd = open(image_path, O_RDONLY);
+  if (fd < 0) {
+    fprintf(stderr, "cannot open %s: %s\n", image_path, strerror(errno));
+    return 1;
+  }
+  sidecar.cluster_size =
+      cluster_size != 0 ? cluster_size : probe_cluster_size(fd, sidecar.fs_type);
+  bool ok = compute_image_head_hash(fd, &sidecar.head_hash) &&
+            hash_image(fd, &sidecar.image_size, &sidecar.content_hash);
+  close(fd);
+  if (!ok) {
+    fprintf(stderr, "read failed: %s\n", image_path);
+    return 1;
+  }
+
+  if (!write_image_sidecar(image_path, &sidecar)) {
+    fprintf(stderr, "cannot write sidecar for %s\n", image_path);
+    return 1;
+  }
+  printf("%s%s: %s (%s) cluster=%u size=%llu\n", image_path,
+         IMAGE_SIDECAR_SUFFIX, sidecar.title_id, sidecar.title_name,
+         sidecar.cluster_size, (unsigned long long)sidecar.image_size);
+  return 0;
+}